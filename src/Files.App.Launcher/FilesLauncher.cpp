@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <dwmapi.h>
 #include <exdisp.h>
+#include <fstream>
 #include <iostream>
 #include <objbase.h>
 #include <propvarutil.h>
@@ -15,7 +16,13 @@
 #include <vector>
 #include <wil/resource.h>
 
+#include "ActivationCommand.h"
+#include "LaunchBatch.h"
 #include "OpenInFolder.h"
+#include "Windows/LaunchLatencyFile.h"
+#include "Windows/LaunchPipe.h"
+#include "Windows/LaunchRulesFile.h"
+#include "Windows/ShellLocations.h"
 
 // Link additional libraries
 #pragma comment(lib, "ole32.lib")
@@ -26,14 +33,20 @@
 
 constexpr auto ID_TIMEREXPIRED = 101;
 
+// Longest command line a batch sends in one activation, protocol activation triples it
+constexpr size_t MAX_BATCH_COMMAND_LINE = 8000;
+
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-bool OpenInExistingShellWindow(const TCHAR* folderPath);
+bool OpenInExistingShellWindow(const TCHAR* folderPath, Files::Native::LaunchRoute route, PCIDLIST_ABSOLUTE targetFolderPidl, Files::Native::ShellLocations& shellLocations);
 bool IsLaunchedByExplorer();
 void WaitForProtocolActivation(HANDLE hProcess);
+bool LaunchFiles(const std::wstring& args, const TCHAR* openDirectory, bool waitForActivation);
+int RunBatch(const TCHAR* listPath, const TCHAR* filesPath, const Files::Native::LaunchRuleSet* rules);
 void RunFileExplorer(const TCHAR* openDirectory);
+void RunFileExplorer(const std::vector<Files::Native::ExplorerGroup>& groups);
+void RecordLaunchLatency(Files::Native::LaunchOutcome outcome);
+void RecordLaunchLatency(Files::Native::LaunchOutcome outcome, uint64_t microseconds);
 size_t strifind(const std::wstring& strHaystack, const std::wstring& strNeedle);
-bool comparei(std::wstring stringA, std::wstring stringB);
-std::string wstring_to_utf8_hex(const std::wstring& input);
 std::wstring str2wstr(const std::string& str);
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int cmdShow)
@@ -59,8 +72,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	bool withArgs = false;
 	LPWSTR* szArglist = CommandLineToArgvW(GetCommandLine(), &numArgs);
 	WCHAR openDirectory[MAX_PATH];
+	// Any length, the list may be deep in a script's working folder
+	std::wstring batchList;
 
-	if (numArgs > 1 && wcsnlen(szArglist[1], 1))
+	// -batch <file>, or - for stdin: opens every location of the list in one go
+	if (numArgs > 2 && _wcsicmp(szArglist[1], L"-batch") == 0)
+	{
+		batchList = szArglist[2];
+	}
+	else if (numArgs > 1 && wcsnlen(szArglist[1], 1))
 	{
 		swprintf(openDirectory, _countof(openDirectory) - 1, L"%s", szArglist[1]);
 		std::wcout << openDirectory << std::endl;
@@ -98,6 +118,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 
 		// Run explorer
 		RunFileExplorer(withArgs ? openDirectory : NULL);
+		RecordLaunchLatency(Files::Native::LaunchOutcome::Uninstall);
 
 		if (_debugStream)
 			fclose(_debugStream);
@@ -105,9 +126,27 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		return 0;
 	}
 
+	// The user's routing rules, in %LOCALAPPDATA%\Files\LaunchRules.txt
+	Files::Native::LaunchRulesFile launchRules;
+
+	if (!batchList.empty())
+	{
+		int result = RunBatch(batchList.c_str(), szBuf, launchRules.Open());
+
+		if (_debugStream)
+			fclose(_debugStream);
+
+		return result;
+	}
+
 	if (withArgs)
 	{
-		if (IsLaunchedByExplorer() && OpenInExistingShellWindow(openDirectory))
+		// Parsed once for the File Explorer windows and for the shell window registered below
+		Files::Native::ShellLocations shellLocations;
+		wil::unique_cotaskmem_ptr<ITEMIDLIST_ABSOLUTE> targetPidl(shellLocations.Parse(openDirectory));
+		auto route = Files::Native::GetLaunchRoute(std::wstring_view(openDirectory), launchRules.Open());
+
+		if (IsLaunchedByExplorer() && OpenInExistingShellWindow(openDirectory, route, targetPidl.get(), shellLocations))
 		{
 			if (_debugStream)
 				fclose(_debugStream);
@@ -127,7 +166,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		RegisterClassEx(&wcex);
 
 		winrt::com_ptr<OpenInFolder> openInFolder;
-		openInFolder.attach(new OpenInFolder());
+		openInFolder.attach(new OpenInFolder(targetPidl.get()));
 
 		// Create the window.
 		HWND hwnd = CreateWindowEx(
@@ -165,32 +204,29 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 
 		auto launchFiles = [&](const wchar_t* verb, const std::wstring& target, bool waitForActivation) -> bool
 		{
-			TCHAR args[1024];
-			swprintf(args, _countof(args) - 1, L"\"%s\" %s \"%s\"", szBuf, verb, target.c_str());
-
-			std::wstring uriWithArgs = L"files-dev:?cmd=" + str2wstr(wstring_to_utf8_hex(args));
-
-			std::wcout << L"Invoking: " << args << L" = " << uriWithArgs << std::endl;
+			Files::Native::ActivationCommand command(szBuf);
+			command.AppendQuoted(verb, target);
 
-			SHELLEXECUTEINFO ShExecInfo = { 0 };
-			ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
-			ShExecInfo.fMask = SEE_MASK_NOASYNC | SEE_MASK_FLAG_NO_UI | SEE_MASK_NOCLOSEPROCESS;
-			ShExecInfo.lpFile = uriWithArgs.c_str();
-			ShExecInfo.lpDirectory = openDirectory;
-			ShExecInfo.nShow = SW_SHOW;
+			return LaunchFiles(command.GetCommandLine(), openDirectory, waitForActivation);
+		};
 
-			if (!ShellExecuteEx(&ShExecInfo))
+		// Selects a late item in the folder opened by the -directory activation, instead of
+		// activating and navigating again. Files started by that activation may not listen yet.
+		auto amendSelection = [&](const std::wstring& target) -> bool
+		{
+			for (int attempt = 0; attempt < 8; attempt++)
 			{
-				std::wcout << L"Protocol error: " << GetLastError() << std::endl;
-				return false;
-			}
+				auto status = Files::Native::LaunchPipe::Send(Files::Native::LaunchRequestKind::AmendSelection, target);
+				if (status != Files::Native::LaunchStatus::Unreachable)
+				{
+					std::wcout << L"Selection amended: " << (status == Files::Native::LaunchStatus::Accepted) << std::endl;
+					return status == Files::Native::LaunchStatus::Accepted;
+				}
 
-			if (waitForActivation)
-				WaitForProtocolActivation(ShExecInfo.hProcess);
-			else if (ShExecInfo.hProcess)
-				CloseHandle(ShExecInfo.hProcess);
+				Sleep(250);
+			}
 
-			return true;
+			return false;
 		};
 
 		if (!item.empty())
@@ -200,9 +236,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 				DestroyWindow(hwnd);
 
 			std::wcout << L"Item: " << item << std::endl;
-			launchFiles(L"-select", item, true);
+			if (launchFiles(L"-select", item, true))
+				RecordLaunchLatency(Files::Native::LaunchOutcome::FilesSelect);
 		}
-		else if (OpenInExistingShellWindow(openDirectory))
+		else if (OpenInExistingShellWindow(openDirectory, route, targetPidl.get(), shellLocations))
 		{
 			openInFolder->RevokeShellWindow();
 			if (IsWindow(hwnd))
@@ -218,12 +255,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 			// Open the folder right away, but keep the shell window registered and the
 			// message pump running: a SHOpenFolderAndSelectItems caller that is still
 			// probing IShellWindows can deliver its selection after the first timeout,
-			// in which case it is forwarded with a follow-up -select activation.
+			// in which case it amends the selection of the running instance, or is
+			// forwarded with a follow-up -select activation.
 			// Pumping here also keeps the process alive while the asynchronous
 			// -directory protocol activation is delivered (#18818).
 			std::wcout << L"No item selected" << std::endl;
 
-			if (launchFiles(L"-directory", openDirectory, false) && IsWindow(hwnd))
+			// Recorded once the grace period is over, a late selection makes it a -select launch
+			bool directoryLaunched = launchFiles(L"-directory", openDirectory, false);
+			uint64_t directoryLatency = Files::Native::LaunchLatencyFile::GetTimeSinceProcessStart();
+			if (directoryLaunched && IsWindow(hwnd))
 			{
 				SetTimer(hwnd, ID_TIMEREXPIRED, 10000, NULL);
 
@@ -241,17 +282,38 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 			if (IsWindow(hwnd))
 				DestroyWindow(hwnd);
 
+			bool selected = false;
 			if (!item.empty())
 			{
-				std::wcout << L"Item: " << item << std::endl;
-				launchFiles(L"-select", item, true);
+				selected = amendSelection(item);
+				if (!selected)
+				{
+					std::wcout << L"Item: " << item << std::endl;
+					selected = launchFiles(L"-select", item, true);
+				}
 			}
+
+			if (selected)
+				RecordLaunchLatency(Files::Native::LaunchOutcome::FilesSelect);
+			else if (directoryLaunched)
+				RecordLaunchLatency(Files::Native::LaunchOutcome::FilesDirectory, directoryLatency);
 		}
 	}
 	else
 	{
 		std::wcout << L"Invoking: no arguments" << std::endl;
 
+		if (Files::Native::LaunchPipe::Send(Files::Native::LaunchRequestKind::Activate, L"") == Files::Native::LaunchStatus::Accepted)
+		{
+			std::wcout << L"Sent to running instance" << std::endl;
+			RecordLaunchLatency(Files::Native::LaunchOutcome::FilesDirectory);
+
+			if (_debugStream)
+				fclose(_debugStream);
+
+			return 0;
+		}
+
 		SHELLEXECUTEINFO ShExecInfo = { 0 };
 		ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
 		ShExecInfo.fMask = SEE_MASK_NOASYNC | SEE_MASK_FLAG_NO_UI | SEE_MASK_NOCLOSEPROCESS;
@@ -270,6 +332,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		else
 		{
 			WaitForProtocolActivation(ShExecInfo.hProcess);
+
+			// Files opens in its start folder
+			RecordLaunchLatency(Files::Native::LaunchOutcome::FilesDirectory);
 		}
 	}
 
@@ -336,50 +401,106 @@ size_t strifind(const std::wstring& strHaystack, const std::wstring& strNeedle)
 	return it != strHaystack.end() ? it - strHaystack.begin() : std::wstring::npos;
 }
 
-bool comparei(std::wstring stringA, std::wstring stringB)
+std::wstring str2wstr(const std::string& str)
 {
-	auto toUpperW = [](wchar_t c) { return static_cast<wchar_t>(std::toupper(c)); };
-	transform(stringA.begin(), stringA.end(), stringA.begin(), toUpperW);
-	transform(stringB.begin(), stringB.end(), stringB.begin(), toUpperW);
+	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+	if (cbNeeded > 0)
+	{
+		std::wstring wstrTo(cbNeeded, 0);
+		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
+		return wstrTo;
+	}
 
-	return (stringA == stringB);
+	return L"";
 }
 
-std::string wstring_to_utf8_hex(const std::wstring& input)
+// Activates Files with the given command line, through the running instance when
+// there is one and protocol activation otherwise
+bool LaunchFiles(const std::wstring& args, const TCHAR* openDirectory, bool waitForActivation)
 {
-	std::string output;
-
-	int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, NULL, 0, NULL, NULL);
-	if (cbNeeded > 0)
+	// A running instance takes the request directly, without the protocol broker
+	if (Files::Native::LaunchPipe::Send(Files::Native::LaunchRequestKind::Activate, args) == Files::Native::LaunchStatus::Accepted)
 	{
-		char* utf8 = new char[cbNeeded];
-		if (WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, utf8, cbNeeded, NULL, NULL) != 0)
-		{
-			for (char* p = utf8; *p; p++)
-			{
-				char onehex[5];
-				sprintf_s(onehex, sizeof(onehex), "%%%02.2X", (unsigned char)*p);
-				output.append(onehex);
-			}
-		}
+		std::wcout << L"Sent to running instance: " << args << std::endl;
+		return true;
+	}
+
+	std::wstring uriWithArgs = Files::Native::ActivationCommand::ToUri(args);
 
-		delete[] utf8;
+	std::wcout << L"Invoking: " << args << L" = " << uriWithArgs << std::endl;
+
+	SHELLEXECUTEINFO ShExecInfo = { 0 };
+	ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
+	ShExecInfo.fMask = SEE_MASK_NOASYNC | SEE_MASK_FLAG_NO_UI | SEE_MASK_NOCLOSEPROCESS;
+	ShExecInfo.lpFile = uriWithArgs.c_str();
+	ShExecInfo.lpDirectory = openDirectory;
+	ShExecInfo.nShow = SW_SHOW;
+
+	if (!ShellExecuteEx(&ShExecInfo))
+	{
+		std::wcout << L"Protocol error: " << GetLastError() << std::endl;
+		return false;
 	}
 
-	return output;
+	if (waitForActivation)
+		WaitForProtocolActivation(ShExecInfo.hProcess);
+	else if (ShExecInfo.hProcess)
+		CloseHandle(ShExecInfo.hProcess);
+
+	return true;
 }
 
-std::wstring str2wstr(const std::string& str)
+// Opens every location of a list, one per line, read from a file or from stdin for "-".
+// The Files locations go out in as few activations as fit, the shell locations Files
+// can't show are opened in File Explorer once the list is through. Unlike single
+// launches, existing File Explorer windows are not reused.
+int RunBatch(const TCHAR* listPath, const TCHAR* filesPath, const Files::Native::LaunchRuleSet* rules)
 {
-	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
-	if (cbNeeded > 0)
+	std::string text;
+	if (wcscmp(listPath, L"-") == 0)
 	{
-		std::wstring wstrTo(cbNeeded, 0);
-		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
-		return wstrTo;
+		HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+		char buffer[4096];
+		DWORD read = 0;
+		while (input && input != INVALID_HANDLE_VALUE && ReadFile(input, buffer, sizeof(buffer), &read, NULL) && read > 0)
+			text.append(buffer, read);
 	}
+	else
+	{
+		std::ifstream file(listPath, std::ios::binary);
+		if (!file)
+		{
+			std::wcout << L"Batch list not found: " << listPath << std::endl;
+			return 1;
+		}
 
-	return L"";
+		text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	auto batch = Files::Native::LaunchBatch::Parse(text, rules);
+	std::wcout << L"Batch: " << batch.FilesTargets.size() << L" for Files, " << batch.ExplorerTargets.size()
+		<< L" for File Explorer, " << batch.Skipped << L" skipped" << std::endl;
+
+	char executable[MAX_PATH * 3] = {};
+	WideCharToMultiByte(CP_UTF8, 0, filesPath, -1, executable, sizeof(executable), NULL, NULL);
+
+	auto commandLines = batch.BuildCommandLines(executable, MAX_BATCH_COMMAND_LINE);
+	// Each waits for Files to take it, so that a Files started by the first one gets the next ones
+	bool launched = false;
+	for (const auto& commandLine : commandLines)
+		launched = LaunchFiles(str2wstr(commandLine), NULL, true) || launched;
+
+	if (!batch.ExplorerTargets.empty())
+		RunFileExplorer(batch.GroupExplorerTargets());
+
+	// One sample for the whole list, by what it opened first
+	bool opensFolders = std::any_of(batch.FilesTargets.begin(), batch.FilesTargets.end(), [](const auto& target) { return !target.Select; });
+	if (launched)
+		RecordLaunchLatency(opensFolders ? Files::Native::LaunchOutcome::FilesDirectory : Files::Native::LaunchOutcome::FilesSelect);
+	else if (!batch.ExplorerTargets.empty())
+		RecordLaunchLatency(Files::Native::LaunchOutcome::ExplorerFallback);
+
+	return 0;
 }
 
 // Packaged-app protocol activations are delivered asynchronously even with
@@ -406,17 +527,75 @@ void RunFileExplorer(const TCHAR* openDirectory)
 	ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
 	ShExecInfo.lpFile = L"explorer.exe";
 
+	std::wstring args;
 	if (openDirectory != NULL)
 	{
-		TCHAR args[1024];
-		swprintf(args, _countof(args) - 1, L"\"%s\"", openDirectory);
-		ShExecInfo.lpParameters = args;
+		args = L"\"" + std::wstring(openDirectory) + L"\"";
+		ShExecInfo.lpParameters = args.c_str();
 	}
 
 	ShExecInfo.nShow = SW_SHOW;
 	ShellExecuteEx(&ShExecInfo);
 }
 
+// Opens the Explorer targets of a batch in one pass, through the shell of this process
+// rather than an explorer.exe per location. The items of a folder are selected in one
+// window. What the shell can't parse goes to explorer.exe, as for single launches.
+void RunFileExplorer(const std::vector<Files::Native::ExplorerGroup>& groups)
+{
+	// Parsed once for every group
+	Files::Native::ShellLocations shellLocations;
+	for (const auto& group : groups)
+	{
+		std::wstring folder = str2wstr(group.Folder);
+		if (strifind(folder, L"::{") == 0)
+			folder = L"shell:" + folder;
+
+		wil::unique_cotaskmem_ptr<ITEMIDLIST_ABSOLUTE> folderPidl(shellLocations.Parse(folder));
+		bool opened = false;
+		if (folderPidl && group.Items.empty())
+		{
+			SHELLEXECUTEINFO ShExecInfo = { 0 };
+			ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
+			ShExecInfo.fMask = SEE_MASK_IDLIST | SEE_MASK_FLAG_NO_UI;
+			ShExecInfo.lpVerb = L"open";
+			ShExecInfo.lpIDList = folderPidl.get();
+			ShExecInfo.nShow = SW_SHOW;
+			opened = ShellExecuteEx(&ShExecInfo);
+		}
+		else if (folderPidl)
+		{
+			std::vector<wil::unique_cotaskmem_ptr<ITEMIDLIST_ABSOLUTE>> items;
+			std::vector<PCUITEMID_CHILD> children;
+			for (const auto& item : group.Items)
+			{
+				items.emplace_back(shellLocations.Parse(str2wstr(item)));
+				if (items.back())
+					children.push_back(ILFindLastID(items.back().get()));
+			}
+
+			opened = !children.empty() && SUCCEEDED(SHOpenFolderAndSelectItems(folderPidl.get(), (UINT)children.size(), children.data(), 0));
+		}
+
+		if (!opened)
+			RunFileExplorer(folder.c_str());
+	}
+}
+
+// Time from the start of the launcher to the location showing, or to Files taking the
+// activation, kept with those of every launch for p50/p99 across settings changes
+void RecordLaunchLatency(Files::Native::LaunchOutcome outcome)
+{
+	RecordLaunchLatency(outcome, Files::Native::LaunchLatencyFile::GetTimeSinceProcessStart());
+}
+
+// Exactly one per launch, on whichever path it ends
+void RecordLaunchLatency(Files::Native::LaunchOutcome outcome, uint64_t microseconds)
+{
+	Files::Native::LaunchLatencyFile latencies;
+	latencies.Record(outcome, microseconds);
+}
+
 bool IsLaunchedByExplorer()
 {
 	DWORD explorerProcessId = 0;
@@ -441,81 +620,31 @@ bool IsLaunchedByExplorer()
 	return false;
 }
 
-bool OpenInExistingShellWindow(const TCHAR* folderPath)
+bool OpenInExistingShellWindow(const TCHAR* folderPath, Files::Native::LaunchRoute route, PCIDLIST_ABSOLUTE targetFolderPidl, Files::Native::ShellLocations& shellLocations)
 {
 	std::wstring openDirectory(folderPath);
-	bool mustOpenInExplorer = false;
-	constexpr auto godModeClsid = L"{ED7BA470-8E54-465E-825C-99712043E01C}";
+
+	// Shell locations Files can't show, god mode and what the user's rules send there
+	// open in File Explorer
+	bool mustOpenInExplorer = route == Files::Native::LaunchRoute::Explorer;
 
 	if (strifind(openDirectory, L"::{") == 0)
 		openDirectory = L"shell:" + openDirectory;
 
-	// Exclude this shell address so that it opens in File Explorer
-	if (strifind(openDirectory, godModeClsid) != std::wstring::npos)
-		mustOpenInExplorer = true;
-
-	if (strifind(openDirectory, L"shell:") == 0)
+	// Cached after the first launch, like the target when it is a virtual location
+	PIDLIST_ABSOLUTE controlPanelCategoryViewPidl = shellLocations.Parse(L"::{26EE0668-A00A-44D7-9371-BEB064C98683}");
+	if (!controlPanelCategoryViewPidl || !targetFolderPidl)
 	{
-		std::vector<std::wstring> supportedShellFolders{
-			L"shell:::{645FF040-5081-101B-9F08-00AA002F954E}",
-			L"shell:::{5E5F29CE-E0A8-49D3-AF32-7A7BDC173478}",
-			L"shell:::{20D04FE0-3AEA-1069-A2D8-08002B30309D}",
-			L"shell:::{F02C1A0D-BE21-4350-88B0-7367FC96EF3C}",
-			L"shell:::{208D2C60-3AEA-1069-A2D7-08002B30309D}",
-			L"Shell:RecycleBinFolder", L"Shell:NetworkPlacesFolder", L"Shell:MyComputerFolder"
-		};
-
-		auto it = std::find_if(
-			supportedShellFolders.begin(), supportedShellFolders.end(),
-			[openDirectory](std::wstring it) { return comparei(it, openDirectory); }
-		);
-
-		mustOpenInExplorer = it == supportedShellFolders.end();
-	}
-
-	IShellItem* psi;
-	PIDLIST_ABSOLUTE controlPanelCategoryViewPidl;
-
-	if (!SUCCEEDED(SHCreateItemFromParsingName(L"::{26EE0668-A00A-44D7-9371-BEB064C98683}", NULL, IID_IShellItem, (void**)&psi)))
-	{
-		if (mustOpenInExplorer)
-			RunFileExplorer(openDirectory.c_str());
-
-		return mustOpenInExplorer;
-	}
-
-	if (!SUCCEEDED(SHGetIDListFromObject(psi, &controlPanelCategoryViewPidl)))
-	{
-		psi->Release();
-		if (mustOpenInExplorer)
-			RunFileExplorer(openDirectory.c_str());
-
-		return mustOpenInExplorer;
-	}
-
-	psi->Release();
-
-	PIDLIST_ABSOLUTE targetFolderPidl;
-
-	if (!SUCCEEDED(SHCreateItemFromParsingName(openDirectory.c_str(), NULL, IID_IShellItem, (void**)&psi)))
-	{
-		if (mustOpenInExplorer)
-			RunFileExplorer(openDirectory.c_str());
-
-		return mustOpenInExplorer;
-	}
-
-	if (!SUCCEEDED(SHGetIDListFromObject(psi, &targetFolderPidl)))
-	{
-		psi->Release();
+		CoTaskMemFree(controlPanelCategoryViewPidl);
 		if (mustOpenInExplorer)
+		{
 			RunFileExplorer(openDirectory.c_str());
+			RecordLaunchLatency(Files::Native::LaunchOutcome::ExplorerFallback);
+		}
 
 		return mustOpenInExplorer;
 	}
 
-	psi->Release();
-
 	bool opened = false;
 	IShellWindows* shellWindows;
 	if (SUCCEEDED(CoCreateInstance(CLSID_ShellWindows, NULL, CLSCTX_LOCAL_SERVER, IID_IShellWindows, (void**)&shellWindows)))
@@ -570,11 +699,17 @@ bool OpenInExistingShellWindow(const TCHAR* folderPath)
 		shellWindows->Release();
 	}
 
-	CoTaskMemFree(targetFolderPidl);
 	CoTaskMemFree(controlPanelCategoryViewPidl);
 
-	if (!opened && mustOpenInExplorer)
+	if (opened)
+	{
+		RecordLaunchLatency(Files::Native::LaunchOutcome::ExplorerWindow);
+	}
+	else if (mustOpenInExplorer)
+	{
 		RunFileExplorer(openDirectory.c_str());
+		RecordLaunchLatency(Files::Native::LaunchOutcome::ExplorerFallback);
+	}
 
 	return opened || mustOpenInExplorer;
 }
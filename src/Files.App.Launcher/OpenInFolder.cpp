@@ -5,8 +5,11 @@
 
 #pragma comment(lib, "oleaut32.lib")
 
-OpenInFolder::OpenInFolder()
+OpenInFolder::OpenInFolder(PCIDLIST_ABSOLUTE folderPidl)
 {
+	if (folderPidl)
+		m_folderPidl = ILCloneFull(folderPidl);
+
 	m_shellWindows = winrt::create_instance<IShellWindows>(CLSID_ShellWindows, CLSCTX_ALL);
 }
 
@@ -423,33 +426,7 @@ void OpenInFolder::SetWindow(HWND hwnd)
 
 void OpenInFolder::OnCreate()
 {
-	int numArgs = 0;
-	LPWSTR* szArglist = CommandLineToArgvW(GetCommandLine(), &numArgs);
-	WCHAR openDirectory[MAX_PATH];
-
-	if (numArgs < 2)
-	{
-		LocalFree(szArglist);
-		return;
-	}
-	else
-	{
-		wsprintf(openDirectory, L"%s", szArglist[1]);
-	}
-
-	LocalFree(szArglist);
-
-	winrt::com_ptr<IShellFolder> desktop;
-	if (FAILED(SHGetDesktopFolder(desktop.put())))
-		return;
-
-	if (FAILED(desktop->ParseDisplayName(
-		nullptr,
-		nullptr,
-		openDirectory,
-		nullptr,
-		&m_folderPidl,
-		nullptr)))
+	if (!m_folderPidl)
 		return;
 
 	if (!SUCCEEDED(NotifyShellOfNavigation(m_folderPidl)))
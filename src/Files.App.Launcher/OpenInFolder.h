@@ -31,7 +31,8 @@ class OpenInFolder final : public IWebBrowserApp, public IServiceProvider, publi
 	std::wstring m_selectedItem;
 
 public:
-	OpenInFolder();
+	// Registers a shell window showing folderPidl once created, none when it is null
+	explicit OpenInFolder(PCIDLIST_ABSOLUTE folderPidl);
 	~OpenInFolder();
 
 	// IUnknown
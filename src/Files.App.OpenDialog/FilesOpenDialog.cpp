@@ -6,18 +6,22 @@
 
 #include "pch.h"
 #include <shlobj.h>
-#include <iostream>
-#include <fstream>
 #include <cstdio>
-#include <locale>
-#include <codecvt>
+#include <chrono>
 #include "FilesOpenDialog.h"
+#include "ActivationCommand.h"
+#include "DialogOptions.h"
+#include "Windows/DialogSettings.h"
+#include "Windows/FilesActivation.h"
+#include "Windows/ResultChannel.h"
 
 //#define SYSTEMDIALOG
 
-using std::cout;
-using std::wcout;
-using std::endl;
+using Files::Native::DialogLog::cout;
+using Files::Native::DialogLog::wcout;
+using Files::Native::DialogLog::endl;
+
+using namespace Files::Native;
 
 CComPtr<IFileOpenDialog> GetSystemDialog()
 {
@@ -26,50 +30,55 @@ CComPtr<IFileOpenDialog> GetSystemDialog()
 
 	HINSTANCE lib = CoLoadLibrary(comdlg32Path, false);
 	BOOL(WINAPI* dllGetClassObject)(REFCLSID, REFIID, LPVOID*) = 
-		(BOOL(WINAPI*)(REFCLSID, REFIID, LPVOID*))GetProcAddress(lib, "DllGetClassObject");
+		lib ? (BOOL(WINAPI*)(REFCLSID, REFIID, LPVOID*))GetProcAddress(lib, "DllGetClassObject") : NULL;
 	CComPtr<IClassFactory> pClassFactory;
-	dllGetClassObject(CLSID_FileOpenDialog, IID_IClassFactory, (void**)&pClassFactory);
+	if (dllGetClassObject)
+		dllGetClassObject(CLSID_FileOpenDialog, IID_IClassFactory, (void**)&pClassFactory);
 	CComPtr<IFileOpenDialog> systemDialog;
-	pClassFactory->CreateInstance(NULL, IID_IFileOpenDialog, (void**)&systemDialog);
+	if (pClassFactory)
+		pClassFactory->CreateInstance(NULL, IID_IFileOpenDialog, (void**)&systemDialog);
 	//CoFreeLibrary(lib);
 	return systemDialog;
 }
 
-std::string wstring_to_utf8_hex(const std::wstring& input)
+std::wstring str2wstr(const std::string& str)
 {
-	std::string output;
-
-	int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, NULL, 0, NULL, NULL);
+	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
 	if (cbNeeded > 0)
 	{
-		char* utf8 = new char[cbNeeded];
-		if (WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, utf8, cbNeeded, NULL, NULL) != 0)
-		{
-			for (char* p = utf8; *p; p++)
-			{
-				char onehex[5];
-				sprintf_s(onehex, sizeof(onehex), "%%%02.2X", (unsigned char)*p);
-				output.append(onehex);
-			}
-		}
-
-		delete[] utf8;
+		std::wstring wstrTo(cbNeeded, 0);
+		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
+		return wstrTo;
 	}
 
-	return output;
+	return L"";
 }
 
-std::wstring str2wstr(const std::string& str)
+std::string wstr2str(const std::wstring& wstr)
 {
-	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+	int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), NULL, 0, NULL, NULL);
 	if (cbNeeded > 0)
 	{
-		std::wstring wstrTo(cbNeeded, 0);
-		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
-		return wstrTo;
+		std::string strTo(cbNeeded, 0);
+		WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), &strTo[0], cbNeeded, NULL, NULL);
+		return strTo;
 	}
 
-	return L"";
+	return "";
+}
+
+// UTF-8 parsing name of an item, empty when it has none
+std::string GetParsingName(IShellItem* psi)
+{
+	std::string name;
+	PWSTR pszPath = NULL;
+	if (psi && SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	{
+		name = wstr2str(pszPath);
+		CoTaskMemFree(pszPath);
+	}
+
+	return name;
 }
 
 template <typename T>
@@ -81,54 +90,161 @@ CComPtr<T> AsInterface(CComPtr<IFileOpenDialog> dialog)
 	return dialogInterface;
 }
 
+HRESULT CreateItemArray(const std::vector<std::string>& paths, IShellItemArray** ppenum)
+{
+	std::vector<PIDLIST_ABSOLUTE> pidls;
+	for (const std::string& ipath : paths)
+	{
+		CComPtr<IShellItem> psi;
+		if (SUCCEEDED(SHCreateItemFromParsingName(str2wstr(ipath).c_str(), NULL, IID_PPV_ARGS(&psi))))
+		{
+			PIDLIST_ABSOLUTE pidl = NULL;
+			if (SUCCEEDED(SHGetIDListFromObject(psi, &pidl)))
+				pidls.push_back(pidl);
+		}
+	}
+
+	if (pidls.empty())
+		return E_FAIL;
+
+	HRESULT hr = SHCreateShellItemArrayFromIDLists((UINT)pidls.size(), (LPCITEMIDLIST*)pidls.data(), ppenum);
+	for (PIDLIST_ABSOLUTE item : pidls)
+	{
+		CoTaskMemFree(item);
+	}
+	return hr;
+}
+
+// Lines Files wrote to the output file, which is deleted
+std::string ReadResults(const std::wstring& outputPath)
+{
+	std::string results;
+	std::string text = ResultChannel::TakeResultFile(outputPath);
+	for (std::string_view line : ParseResultLines(text))
+		results.append(line).push_back('\n');
+
+	return results;
+}
+
 CFilesOpenDialog::CFilesOpenDialog()
 {
-	_fos = FOS_FILEMUSTEXIST | FOS_PATHMUSTEXIST;
+	// Many hosts create dialogs they never show, so nothing here may touch the disk or
+	// the shell namespace. Everything Show() needs is resolved when it is called.
 	_systemDialog = nullptr;
 	_debugStream = NULL;
 	_dialogEvents = NULL;
+	_preActivated = false;
+	_executor = NULL;
+	_closeResult = S_OK;
+	_clientGuid = GUID_NULL;
+	_hasClientGuid = false;
+
+#ifdef  SYSTEMDIALOG
+	_systemDialog = GetSystemDialog();
+#endif
+}
+
+void CFilesOpenDialog::OpenDebugLog()
+{
+#ifdef  DEBUGLOG
+	if (_debugStream)
+		return;
 
 	PWSTR pszPath = NULL;
-	HRESULT hr = SHGetKnownFolderPath(FOLDERID_Desktop, 0, NULL, &pszPath);
-	if (SUCCEEDED(hr))
+	if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_Desktop, 0, NULL, &pszPath)))
 	{
 		TCHAR debugPath[MAX_PATH];
 		wsprintf(debugPath, L"%s\\%s", pszPath, L"open_dialog.txt");
-#ifdef  DEBUGLOG
 		_wfreopen_s(&_debugStream, debugPath, L"w", stdout);
-#endif
 		CoTaskMemFree(pszPath);
 	}
+#endif
+}
 
-	cout << "Create" << endl;
+bool CFilesOpenDialog::EnsureOutputPath()
+{
+	if (!_outputPath.empty())
+		return true;
 
 	TCHAR tempPath[MAX_PATH];
-	GetTempPath(MAX_PATH, tempPath);
 	TCHAR tempName[MAX_PATH];
-	GetTempFileName(tempPath, L"fsd", 0, tempName);
+	if (!GetTempPath(MAX_PATH, tempPath) || !GetTempFileName(tempPath, L"fsd", 0, tempName))
+		return false;
+
 	_outputPath = tempName;
+	return true;
+}
+
+void CFilesOpenDialog::PreActivate()
+{
+	if (_preActivated)
+		return;
 
-	(void)SHGetKnownFolderItem(FOLDERID_Documents, KF_FLAG_DEFAULT_PATH, NULL, IID_PPV_ARGS(&_initFolder));
+	_preActivated = true;
 
-	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_NORMALDISPLAY, &pszPath)))
+	DialogSettings settings = DialogSettings::Load();
+	if (settings.Mode != DialogMode::SystemOnly && settings.PreActivate && FilesActivation::IsInstalled())
+		StartSession();
+}
+
+bool CFilesOpenDialog::StartSession()
+{
+	if (!_session.Listen())
+		return false;
+
+	// Files starts in the background and connects back to the session pipe
+	ActivationCommand command(FilesActivation::GetExecutablePath());
+	command.Append(L"-dialogsession", _session.Name());
+	std::wstring uriWithArgs = command.ToUri();
+
+	if (!FilesActivation::Launch(uriWithArgs.c_str()))
 	{
-		wcout << L"_outputPath: " << _outputPath << L", _initFolder: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
+		_session.Close();
+		return false;
 	}
 
-#ifdef  SYSTEMDIALOG
-	_systemDialog = GetSystemDialog();
-#endif
+	wcout << L"StartSession, session: " << _session.Name() << endl;
+	return true;
+}
+
+// Every call that reads or changes the dialog's state goes through here, to be recorded
+DialogReply CFilesOpenDialog::Apply(DialogCall call)
+{
+	_recorder.Record(call);
+	DialogReply reply = _state.Apply(call);
+
+	// The state stays this thread's, the host's other threads read the published results
+	if (call.Kind == DialogCallKind::Show)
+		_results.Clear();
+	else if (call.Kind == DialogCallKind::Completed)
+		_results.Publish(_state.GetResults());
+
+	return reply;
+}
+
+// IFileDialogCustomize answers E_INVALIDARG for the controls and items the dialog doesn't have
+HRESULT CFilesOpenDialog::ApplyControl(DialogCall call)
+{
+	return Apply(std::move(call)).Succeeded ? S_OK : E_INVALIDARG;
 }
 
 void CFilesOpenDialog::FinalRelease()
 {
+	_session.Close();
 	if (_systemDialog)
 		_systemDialog.Release();
 
 	_initFolder.Release();
+	_defaultFolder.Release();
 	_dialogEvents.Release();
-	DeleteFile(_outputPath.c_str());
+	_itemFilter.Release();
+	_folderPrefetch.Cancel();
+	_recorder.Save();
+	if (!_outputPath.empty())
+	{
+		DeleteFile(_outputPath.c_str());
+		DeleteFile((_outputPath + L".snapshot").c_str());
+	}
 
 	if (_debugStream)
 		fclose(_debugStream);
@@ -136,94 +252,398 @@ void CFilesOpenDialog::FinalRelease()
 
 STDAPICALL CFilesOpenDialog::Show(HWND hwndOwner)
 {
+	OpenDebugLog();
 	cout << "Show, hwndOwner: " << hwndOwner << endl;
-	_selectedItems.clear();
+
+	Apply({ DialogCallKind::Show });
 
 #ifdef  SYSTEMDIALOG
 	return _systemDialog->Show(hwndOwner);
 #endif
 
-	SHELLEXECUTEINFO ShExecInfo = { 0 };
-	ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
-	ShExecInfo.fMask = SEE_MASK_NOCLOSEPROCESS;
+	// The stages of Show() run on the host's thread, which keeps dispatching its messages
+	PumpingExecutorHost host;
+	DialogExecutor executor(host);
+	_executor = &executor;
+	_closeResult = HRESULT_FROM_WIN32(ERROR_CANCELLED);
 
-	PWSTR pszPath = NULL;
-	WCHAR szBuf[MAX_PATH];
-	TCHAR args[1024] = { 0 };
-	ExpandEnvironmentStringsW(L"%LOCALAPPDATA%\\Microsoft\\WindowsApps\\files-dev.exe", szBuf, MAX_PATH - 1);
+	HRESULT hr = executor.Run(ShowAsync(executor, hwndOwner));
+	_executor = NULL;
 
-	HANDLE closeEvent = CreateEvent(NULL, FALSE, FALSE, TEXT("FILEDIALOG"));
+	if (SUCCEEDED(hr))
+		RememberFolder();
+	return hr;
+}
 
-	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+Task<HRESULT> CFilesOpenDialog::ShowAsync(DialogExecutor& executor, HWND hwndOwner)
+{
+	DialogSettings settings = DialogSettings::Load();
+	if (settings.Mode == DialogMode::SystemOnly ||
+		(settings.Mode == DialogMode::Hybrid && !FilesActivation::IsInstalled()))
+		co_return ShowSystemDialog(hwndOwner);
+
+	if (!EnsureOutputPath())
+		co_return settings.Mode == DialogMode::Hybrid ? ShowSystemDialog(hwndOwner) : E_FAIL;
+
+	// Have the fallback ready by the time the activation deadline expires
+	if (settings.Mode == DialogMode::Hybrid)
+		_systemDialogWarmup.Start(CLSID_FileOpenDialog);
+
+	// The host may judge items differently from one Show() to the next
+	_filterVerdicts.Clear();
+	_dialogEventQueue.Reset();
+
+	DWORD ackTimeout = settings.Mode == DialogMode::Hybrid ? settings.ActivationTimeout : INFINITE;
+
+	// Files stays attached to the dialog between Show() calls, so only the first call
+	// (or the pre-activation) pays for starting it. It finishes connecting back while
+	// the command line is prepared.
+	bool reused = _session.IsReady();
+	if (!_session.IsOpen())
+		StartSession();
+	auto sessionReady = executor.Spawn(_session.WaitReadyAsync(executor, ackTimeout));
+
+	std::wstring initFolder = co_await GetStartFolderAsync(executor);
+
+	// Listed while Files starts, which then doesn't have to enumerate the folder cold
+	std::wstring snapshotPath = _outputPath + L".snapshot";
+	if (!initFolder.empty())
+		_folderPrefetch.Start(initFolder, snapshotPath);
+
+	ResultChannel channel;
+	ActivationCommand command(FilesActivation::GetExecutablePath());
+
+	if (!initFolder.empty())
+		command.AppendQuoted(L"-directory", initFolder);
+	command.AppendQuoted(L"-outputpath", _outputPath).Append(L"-dialogchannel", channel.Id());
+	if (!initFolder.empty())
+		wcout << L"Invoking: " << command.GetCommandLine() << endl;
+
+	// Lets Files skip what the host can't take anyway, such as the files of a folder picker
+	command.Append(L"-enumerationmode", DialogOptions::Serialize(DialogOptions::GetEnumerationMode(_state.GetOptions())));
+
+	// Used by Files if complete by the time it lists the folder
+	if (!initFolder.empty())
+		command.AppendQuoted(L"-foldersnapshot", snapshotPath);
+
+	// Files narrows the listing to the selected type, the spec is sent precompiled
+	UINT fileTypeIndex = _state.GetFileTypeIndex();
+	if (fileTypeIndex >= 1 && fileTypeIndex <= _fileTypeFilters.size())
 	{
-		swprintf(args, _countof(args) - 1, L"\"%s\" -directory \"%s\" -outputpath \"%s\"", szBuf, pszPath, _outputPath.c_str());
-		wcout << L"Invoking: " << args << endl;
-		CoTaskMemFree(pszPath);
+		std::wstring fileTypes = _fileTypeFilters[fileTypeIndex - 1].Serialize();
+		if (!fileTypes.empty())
+			command.AppendQuoted(L"-filetypes", fileTypes);
 	}
-	else
+	if (_itemFilter)
+		command.Append(L"-itemfilter", std::to_wstring(FilterQuery::MaxNames));
+
+	const std::wstring& commandLine = command.GetCommandLine();
+	std::wstring uriWithArgs = command.ToUri();
+
+	// The host's controls go ahead of Show in one message, encoded now so that changes made
+	// since the pre-activation are included. Without a session Files shows none.
+	std::string controls = _state.GetControls().IsEmpty() ? std::string() : _state.GetControls().Encode();
+	auto showViaSession = [&]()
 	{
-		swprintf(args, _countof(args) - 1, L"\"%s\" -outputpath \"%s\"", szBuf, _outputPath.c_str());
-	}
+		return (controls.empty() || _session.Send(DialogMessageType::Controls, controls)) && _session.Show(commandLine);
+	};
 
-	std::wstring uriWithArgs = L"files-dev:?cmd=" + str2wstr(wstring_to_utf8_hex(args));
-	ShExecInfo.lpFile = uriWithArgs.c_str();
-	ShExecInfo.nShow = SW_SHOW;
-	ShellExecuteEx(&ShExecInfo);
+	// A session Files has dropped since the last call is replaced once before falling
+	// back to the regular activation
+	bool viaSession = false;
+	auto activate = [&]() -> Task<bool>
+	{
+		bool shown = co_await sessionReady && showViaSession();
+		if (!shown && reused)
+		{
+			_session.Close();
+			shown = StartSession() && co_await _session.WaitReadyAsync(executor, ackTimeout) && showViaSession();
+		}
+
+		if (shown)
+			co_return viaSession = true;
 
-	if (hwndOwner)
-		EnableWindow(hwndOwner, FALSE);
+		_session.Close();
+		co_return FilesActivation::Launch(uriWithArgs.c_str());
+	};
 
-	MSG msg;
-	while (ShExecInfo.hProcess)
+	// Answers what Files asks and reports while the picker is open
+	auto serve = [&]() -> ServiceWait
 	{
-		switch (MsgWaitForMultipleObjectsEx(1, &closeEvent, INFINITE, QS_ALLINPUT, 0))
+		ServiceWait wait;
+		if (!viaSession)
+			return wait;
+
+		bool open = _session.Serve([this](const DialogMessage& message)
 		{
-		case WAIT_OBJECT_0:
-			CloseHandle(ShExecInfo.hProcess);
-			ShExecInfo.hProcess = NULL;
-			break;
-		case WAIT_OBJECT_0 + 1:
-			while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+			switch (message.Type)
 			{
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
+			case DialogMessageType::FilterQuery:
+				AnswerFilterQuery(message.Payload);
+				break;
+			case DialogMessageType::FolderChanged:
+				_dialogEventQueue.Push(DialogEventKind::FolderChange, message.Payload);
+				break;
+			case DialogMessageType::SelectionChanged:
+				_dialogEventQueue.Push(DialogEventKind::SelectionChange, message.Payload);
+				break;
+			case DialogMessageType::ControlsChanged:
+				ApplyControlChanges(message.Payload);
+				break;
 			}
-			continue;
-		default: __debugbreak();
-		}
+		});
+
+		wait.Event = open ? _session.ReadEvent() : NULL;
+		wait.Timeout = RaiseDialogEvents();
+		return wait;
+	};
+
+	DWORD ackLatency = 0;
+	ActivationResult result = co_await FilesActivation::RunAsync(executor, channel, activate, serve, hwndOwner, ackTimeout, &ackLatency);
+
+	cout << "Show, activation: " << (int)result << ", via session: " << viaSession << ", acknowledged after: " << ackLatency << "ms" << endl;
+
+	if (result != ActivationResult::Completed)
+	{
+		// Don't reuse a session whose picker may still turn up
+		_session.Close();
+		DeleteFile(_outputPath.c_str());
+		if (result == ActivationResult::Cancelled)
+			co_return _closeResult;
+		if (settings.Mode == DialogMode::Hybrid)
+			co_return ShowSystemDialog(hwndOwner);
+
+		co_return HRESULT_FROM_WIN32(ERROR_CANCELLED);
 	}
 
-	if (closeEvent)
-		CloseHandle(closeEvent);
+	// Read off the host's thread, large selections take a moment
+	std::string results = co_await executor.Offload([outputPath = _outputPath]()
+	{
+		return ReadResults(outputPath);
+	});
 
-	if (hwndOwner)
+	bool accepted = Apply({ DialogCallKind::Completed, 0, std::move(results) }).Value > 0;
+	if (accepted)
 	{
-		EnableWindow(hwndOwner, TRUE);
-		SetForegroundWindow(hwndOwner);
+		if (_dialogEvents)
+			_dialogEvents->OnFileOk(this);
 	}
 
-	std::ifstream file(_outputPath);
-	if (file.good())
+	co_return accepted ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+}
+
+// The folder set by the host, else the last one of this client, else the default folder
+Task<std::wstring> CFilesOpenDialog::GetStartFolderAsync(DialogExecutor& executor)
+{
+	std::wstring folder;
+	PWSTR pszPath = NULL;
+	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
 	{
-		std::string str;
-		std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+		folder = pszPath;
+		CoTaskMemFree(pszPath);
+		co_return folder;
+	}
 
-		while (std::getline(file, str))
+	// The last folder may be gone, or on a share that no longer answers
+	auto lastFolder = _folderHistory.Lookup(GetClientKey());
+	if (lastFolder)
+	{
+		auto exists = co_await executor.OffloadFor([path = *lastFolder]()
 		{
-			std::wstring wide = converter.from_bytes(str);
-			_selectedItems.push_back(wide);
+			return FolderHistory::FolderExists(path);
+		}, std::chrono::milliseconds(FolderHistory::FolderCheckTimeout));
+
+		if (exists && *exists)
+			co_return *lastFolder;
+	}
+
+	CComPtr<IShellItem> defaultFolder = _defaultFolder;
+	if (!defaultFolder)
+		(void)SHGetKnownFolderItem(FOLDERID_Documents, KF_FLAG_DEFAULT_PATH, NULL, IID_PPV_ARGS(&defaultFolder));
+	if (defaultFolder && SUCCEEDED(defaultFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	{
+		folder = pszPath;
+		CoTaskMemFree(pszPath);
+	}
+
+	co_return folder;
+}
+
+// Where the user ended up in Files, or else the folder of the first result
+void CFilesOpenDialog::RememberFolder()
+{
+	std::wstring folder = str2wstr(_state.GetCurrentFolder());
+	if (folder.empty() && !_state.GetResults().empty())
+		folder = FolderHistory::GetParent(str2wstr(_state.GetResults().front()));
+
+	_folderHistory.Remember(GetClientKey(), folder);
+}
+
+std::string CFilesOpenDialog::GetClientKey()
+{
+	return FolderHistory::GetClientKey(_hasClientGuid ? &_clientGuid : NULL);
+}
+
+HRESULT CFilesOpenDialog::ShowSystemDialog(HWND hwndOwner)
+{
+	auto start = std::chrono::steady_clock::now();
+	_systemDialogWarmup.Wait();
+
+	CComPtr<IFileOpenDialog> systemDialog = GetSystemDialog();
+	if (!systemDialog)
+		return E_FAIL;
+
+	cout << "ShowSystemDialog, ready after: "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms" << endl;
+
+	SystemDialogForwarding::Forward(_state, systemDialog);
+	if (!_fileTypes.empty())
+	{
+		std::vector<COMDLG_FILTERSPEC> specs;
+		for (const auto& fileType : _fileTypes)
+			specs.push_back({ fileType.first.c_str(), fileType.second.c_str() });
+		systemDialog->SetFileTypes((UINT)specs.size(), specs.data());
+		systemDialog->SetFileTypeIndex(_state.GetFileTypeIndex());
+	}
+	if (_itemFilter)
+		systemDialog->SetFilter(_itemFilter);
+	if (_hasClientGuid)
+		systemDialog->SetClientGuid(_clientGuid);
+	if (_defaultFolder)
+		systemDialog->SetDefaultFolder(_defaultFolder);
+	if (_initFolder)
+		systemDialog->SetFolder(_initFolder);
+
+	// The host's handler gets the system dialog's events, so that OnFileOk can still keep
+	// it open
+	DWORD cookie = 0;
+	if (_dialogEvents && FAILED(systemDialog->Advise(_dialogEvents, &cookie)))
+		cookie = 0;
+
+	HRESULT hr = systemDialog->Show(hwndOwner);
+	cout << "ShowSystemDialog, hr: " << hr << endl;
+
+	if (cookie)
+		systemDialog->Unadvise(cookie);
+
+	// The host reads its controls from this dialog
+	if (SUCCEEDED(hr))
+	{
+		for (const DialogControlChange& change : SystemDialogForwarding::ReadControls(_state.GetControls(), systemDialog))
+		{
+			std::string encoded;
+			change.AppendTo(encoded);
+			Apply({ DialogCallKind::ControlChanged, 0, std::move(encoded) });
 		}
 	}
 
-	DeleteFile(_outputPath.c_str());
+	// The type the user ended on, as if the host had picked it
+	UINT fileTypeIndex = 0;
+	if (SUCCEEDED(hr) && SUCCEEDED(systemDialog->GetFileTypeIndex(&fileTypeIndex)))
+		Apply({ DialogCallKind::SetFileTypeIndex, fileTypeIndex });
 
-	if (!_selectedItems.empty())
+	std::string selectedItems;
+	CComPtr<IShellItemArray> results;
+	if (SUCCEEDED(hr) && SUCCEEDED(systemDialog->GetResults(&results)))
 	{
-		if (_dialogEvents)
-			_dialogEvents->OnFileOk(this);
+		DWORD count = 0;
+		results->GetCount(&count);
+		for (DWORD i = 0; i < count; i++)
+		{
+			CComPtr<IShellItem> item;
+			if (SUCCEEDED(results->GetItemAt(i, &item)))
+			{
+				std::string name = GetParsingName(item);
+				if (!name.empty())
+					selectedItems += name + '\n';
+			}
+		}
 	}
 
-	return !_selectedItems.empty() ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	Apply({ DialogCallKind::Completed, 0, std::move(selectedItems) });
+	return hr;
+}
+
+// Runs the names Files is listing through the host's filter. Items the shell can't
+// resolve are listed, the filter has no say on them.
+void CFilesOpenDialog::AnswerFilterQuery(const std::string& payload)
+{
+	FilterQuery query;
+	if (!_itemFilter || !FilterQuery::Decode(payload, query))
+		return;
+
+	FilterVerdicts verdicts = _filterVerdicts.Evaluate(query, [this](const std::string& folder, const std::string& name)
+	{
+		std::wstring path = str2wstr(folder);
+		if (!path.empty() && path.back() != L'\\')
+			path += L'\\';
+		path += str2wstr(name);
+
+		CComPtr<IShellItem> item;
+		if (FAILED(SHCreateItemFromParsingName(path.c_str(), NULL, IID_PPV_ARGS(&item))))
+			return true;
+
+		return _itemFilter->IncludeItem(item) != S_FALSE;
+	});
+
+	cout << "AnswerFilterQuery, items: " << query.Names.size() << endl;
+	_session.Send(DialogMessageType::FilterVerdicts, verdicts.Encode());
+}
+
+// Applies what the user did to the host's controls in Files and raises it on the host.
+// Edit boxes raise nothing, the host reads them when it needs them.
+void CFilesOpenDialog::ApplyControlChanges(const std::string& payload)
+{
+	DialogControlChanges changes;
+	if (!DialogControlChanges::Decode(payload, changes))
+		return;
+
+	CComQIPtr<IFileDialogControlEvents> controlEvents(_dialogEvents);
+	for (const DialogControlChange& change : changes.Changes)
+	{
+		std::string encoded;
+		change.AppendTo(encoded);
+		if (!Apply({ DialogCallKind::ControlChanged, 0, std::move(encoded) }).Succeeded)
+			continue;
+
+		cout << "ApplyControlChanges, kind: " << (int)change.Kind << ", control: " << change.Control << endl;
+		if (!controlEvents)
+			continue;
+
+		if (change.Kind == DialogControlChangeKind::ItemSelected)
+			controlEvents->OnItemSelected(this, change.Control, change.Value);
+		else if (change.Kind == DialogControlChangeKind::CheckToggled)
+			controlEvents->OnCheckButtonToggled(this, change.Control, change.Value != 0);
+		else if (change.Kind == DialogControlChangeKind::ButtonClicked)
+			controlEvents->OnButtonClicked(this, change.Control);
+	}
+}
+
+// Updates the picker state from the coalesced events and raises them on the host.
+// Returns how long until the next pending event is due.
+DWORD CFilesOpenDialog::RaiseDialogEvents()
+{
+	DialogEvent event;
+	while (_dialogEventQueue.Pop(DialogEventQueue::Clock::now(), event))
+	{
+		if (event.Kind == DialogEventKind::FolderChange)
+			Apply({ DialogCallKind::FolderChanged, 0, std::move(event.Payload) });
+		else
+			Apply({ DialogCallKind::SelectionChanged, 0, std::move(event.Payload) });
+
+		cout << "RaiseDialogEvents, kind: " << (int)event.Kind << ", selected: " << _state.GetCurrentSelection().size() << endl;
+
+		if (!_dialogEvents)
+			continue;
+
+		if (event.Kind == DialogEventKind::FolderChange)
+			_dialogEvents->OnFolderChange(this);
+		else
+			_dialogEvents->OnSelectionChange(this);
+	}
+
+	auto due = _dialogEventQueue.NextDue(DialogEventQueue::Clock::now());
+	return due ? (DWORD)due->count() : INFINITE;
 }
 
 STDAPICALL CFilesOpenDialog::SetFileTypes(UINT cFileTypes, const COMDLG_FILTERSPEC* rgFilterSpec)
@@ -232,6 +652,19 @@ STDAPICALL CFilesOpenDialog::SetFileTypes(UINT cFileTypes, const COMDLG_FILTERSP
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileTypes(cFileTypes, rgFilterSpec);
 #endif
+	if (cFileTypes && !rgFilterSpec)
+		return E_INVALIDARG;
+
+	_fileTypes.clear();
+	_fileTypeFilters.clear();
+	for (UINT i = 0; i < cFileTypes; i++)
+	{
+		_fileTypes.emplace_back(rgFilterSpec[i].pszName ? rgFilterSpec[i].pszName : L"", rgFilterSpec[i].pszSpec ? rgFilterSpec[i].pszSpec : L"");
+		_fileTypeFilters.push_back(FileTypeFilter::Compile(_fileTypes.back().second));
+	}
+
+	Apply({ DialogCallKind::SetFileTypes, cFileTypes });
+	PreActivate();
 	return S_OK;
 }
 
@@ -241,6 +674,7 @@ STDAPICALL CFilesOpenDialog::SetFileTypeIndex(UINT iFileType)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileTypeIndex(iFileType);
 #endif
+	Apply({ DialogCallKind::SetFileTypeIndex, iFileType });
 	return S_OK;
 }
 
@@ -250,7 +684,7 @@ STDAPICALL CFilesOpenDialog::GetFileTypeIndex(UINT* piFileType)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetFileTypeIndex(piFileType);
 #endif
-	* piFileType = 1;
+	*piFileType = Apply({ DialogCallKind::GetFileTypeIndex }).Value;
 	return S_OK;
 }
 
@@ -260,8 +694,9 @@ STDAPICALL CFilesOpenDialog::Advise(IFileDialogEvents* pfde, DWORD* pdwCookie)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Advise(pfde, pdwCookie);
 #endif
+	PreActivate();
 	_dialogEvents = pfde;
-	*pdwCookie = 1;
+	*pdwCookie = Apply({ DialogCallKind::Advise }).Value;
 	return S_OK;
 }
 
@@ -271,6 +706,7 @@ STDAPICALL CFilesOpenDialog::Unadvise(DWORD dwCookie)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Unadvise(dwCookie);
 #endif
+	Apply({ DialogCallKind::Unadvise, dwCookie });
 	_dialogEvents.Release();
 	return S_OK;
 }
@@ -281,47 +717,44 @@ STDAPICALL CFilesOpenDialog::SetOptions(FILEOPENDIALOGOPTIONS fos)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetOptions(fos);
 #endif
-	_fos = fos;
+	PreActivate();
+	Apply({ DialogCallKind::SetOptions, (std::uint32_t)fos });
 	return S_OK;
 }
 
 STDAPICALL CFilesOpenDialog::GetOptions(FILEOPENDIALOGOPTIONS* pfos)
 {
-	cout << "GetOptions, fos: " << _fos << endl;
+	cout << "GetOptions, fos: " << _state.GetOptions() << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetOptions(pfos);
 #endif
-	* pfos = _fos;
+	* pfos = Apply({ DialogCallKind::GetOptions }).Value;
 	return S_OK;
 }
 
 STDAPICALL CFilesOpenDialog::SetDefaultFolder(IShellItem* psi)
 {
-	PWSTR pszPath = NULL;
-	if (SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
-	{
-		wcout << L"SetDefaultFolder, psi: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
-	}
+	std::string name = GetParsingName(psi);
+	cout << "SetDefaultFolder, psi: " << name << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetDefaultFolder(psi);
 #endif
-	_initFolder = psi;
+	PreActivate();
+	_defaultFolder = psi;
+	Apply({ DialogCallKind::SetDefaultFolder, psi != NULL, std::move(name) });
 	return S_OK;
 }
 
 STDAPICALL CFilesOpenDialog::SetFolder(IShellItem* psi)
 {
-	PWSTR pszPath = NULL;
-	if (SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
-	{
-		wcout << L"SetFolder, psi: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
-	}
+	std::string name = GetParsingName(psi);
+	cout << "SetFolder, psi: " << name << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFolder(psi);
 #endif
+	PreActivate();
 	_initFolder = psi;
+	Apply({ DialogCallKind::SetFolder, psi != NULL, std::move(name) });
 	return S_OK;
 }
 
@@ -332,6 +765,16 @@ STDAPICALL CFilesOpenDialog::GetFolder(IShellItem** ppsi)
 	return _systemDialog->GetFolder(ppsi);
 #endif
 	* ppsi = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetFolder });
+	switch ((DialogFolderSource)reply.Value)
+	{
+	case DialogFolderSource::Current:
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_PPV_ARGS(ppsi));
+	case DialogFolderSource::Folder:
+		return _initFolder ? _initFolder.CopyTo(ppsi) : E_NOTIMPL;
+	case DialogFolderSource::Default:
+		return _defaultFolder ? _defaultFolder.CopyTo(ppsi) : E_NOTIMPL;
+	}
 	return E_NOTIMPL;
 }
 
@@ -341,7 +784,11 @@ STDAPICALL CFilesOpenDialog::GetCurrentSelection(IShellItem** ppsi)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetCurrentSelection(ppsi);
 #endif
-	return GetResult(ppsi);
+	*ppsi = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetCurrentSelection });
+	if (reply.Succeeded)
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_PPV_ARGS(ppsi));
+	return E_NOTIMPL;
 }
 
 STDAPICALL CFilesOpenDialog::SetFileName(LPCWSTR pszName)
@@ -350,6 +797,8 @@ STDAPICALL CFilesOpenDialog::SetFileName(LPCWSTR pszName)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileName(pszName);
 #endif
+	PreActivate();
+	Apply({ DialogCallKind::SetFileName, 0, wstr2str(pszName) });
 	return S_OK;
 }
 
@@ -359,7 +808,7 @@ STDAPICALL CFilesOpenDialog::GetFileName(LPWSTR* pszName)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetFileName(pszName);
 #endif
-	return SHStrDupW(_selectedItems.empty() ? L"" : _selectedItems[0].c_str(), pszName);
+	return SHStrDupW(str2wstr(std::string(Apply({ DialogCallKind::GetFileName }).Text)).c_str(), pszName);
 }
 
 STDAPICALL CFilesOpenDialog::SetTitle(LPCWSTR pszTitle)
@@ -368,6 +817,8 @@ STDAPICALL CFilesOpenDialog::SetTitle(LPCWSTR pszTitle)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetTitle(pszTitle);
 #endif
+	PreActivate();
+	Apply({ DialogCallKind::SetTitle, 0, wstr2str(pszTitle) });
 	return S_OK;
 }
 
@@ -377,6 +828,7 @@ STDAPICALL CFilesOpenDialog::SetOkButtonLabel(LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetOkButtonLabel(pszText);
 #endif
+	Apply({ DialogCallKind::SetOkButtonLabel, 0, wstr2str(pszText) });
 	return S_OK;
 }
 
@@ -386,6 +838,7 @@ STDAPICALL CFilesOpenDialog::SetFileNameLabel(LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileNameLabel(pszLabel);
 #endif
+	Apply({ DialogCallKind::SetFileNameLabel, 0, wstr2str(pszLabel) });
 	return S_OK;
 }
 
@@ -396,8 +849,9 @@ STDAPICALL CFilesOpenDialog::GetResult(IShellItem** ppsi)
 	return _systemDialog->GetResult(ppsi);
 #endif
 	*ppsi = NULL;
-	if (!_selectedItems.empty())
-		return SHCreateItemFromParsingName(_selectedItems[0].c_str(), NULL, IID_IShellItem, (void**)ppsi);
+	DialogReply reply = Apply({ DialogCallKind::GetResult });
+	if (reply.Succeeded)
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_IShellItem, (void**)ppsi);
 	return E_NOTIMPL;
 }
 
@@ -421,6 +875,7 @@ STDAPICALL CFilesOpenDialog::SetDefaultExtension(LPCWSTR pszDefaultExtension)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetDefaultExtension(pszDefaultExtension);
 #endif
+	Apply({ DialogCallKind::SetDefaultExtension, 0, wstr2str(pszDefaultExtension) });
 	return S_OK;
 }
 
@@ -430,7 +885,14 @@ STDAPICALL CFilesOpenDialog::Close(HRESULT hr)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Close(hr);
 #endif
-	return E_NOTIMPL;
+	// Called by the host from one of its event handlers while Show() waits on Files
+	Apply({ DialogCallKind::Close, (std::uint32_t)hr });
+	if (!_executor)
+		return E_UNEXPECTED;
+
+	_closeResult = hr;
+	_executor->Cancel();
+	return S_OK;
 }
 
 STDAPICALL CFilesOpenDialog::SetClientGuid(REFGUID guid)
@@ -439,6 +901,9 @@ STDAPICALL CFilesOpenDialog::SetClientGuid(REFGUID guid)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetClientGuid(guid);
 #endif
+	_clientGuid = guid;
+	_hasClientGuid = true;
+	Apply({ DialogCallKind::SetClientGuid, 1 });
 	return S_OK;
 }
 
@@ -448,6 +913,8 @@ STDAPICALL CFilesOpenDialog::ClearClientData(void)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->ClearClientData();
 #endif
+	Apply({ DialogCallKind::ClearClientData });
+	_folderHistory.Forget(GetClientKey());
 	return S_OK;
 }
 
@@ -457,40 +924,25 @@ STDAPICALL CFilesOpenDialog::SetFilter(IShellItemFilter* pFilter)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFilter(pFilter);
 #endif
+	_itemFilter = pFilter;
+	_filterVerdicts.Clear();
+	Apply({ DialogCallKind::SetFilter, pFilter != NULL });
+	PreActivate();
 	return S_OK;
 }
 
+// The array never changes and is free-threaded, the host's workers can read it without
+// going back to this thread
 STDAPICALL CFilesOpenDialog::GetResults(IShellItemArray** ppenum)
 {
-	cout << "GetResults, results: " << _selectedItems.size() << endl;
+	std::shared_ptr<const DialogResultSet> results = _results.Get();
+	cout << "GetResults, results: " << (results ? results->Items.size() : 0) << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetResults(ppenum);
 #endif
 	*ppenum = NULL;
-	if (!_selectedItems.empty())
-	{
-		std::vector<PIDLIST_ABSOLUTE> pidls;
-		for (const std::wstring& ipath : _selectedItems)
-		{
-			CComPtr<IShellItem> psi;
-			if (SUCCEEDED(SHCreateItemFromParsingName(ipath.c_str(), NULL, IID_PPV_ARGS(&psi))))
-			{
-				PIDLIST_ABSOLUTE pidl = NULL;
-				if (SUCCEEDED(SHGetIDListFromObject(psi, &pidl)))
-					pidls.push_back(pidl);
-			}
-		}
-
-		if (pidls.empty())
-			return E_FAIL;
-
-		HRESULT hr = SHCreateShellItemArrayFromIDLists((UINT)pidls.size(), (LPCITEMIDLIST*)pidls.data(), ppenum);
-		for (PIDLIST_ABSOLUTE item : pidls)
-		{
-			CoTaskMemFree(item);
-		}
-		return hr;
-	}
+	if (Apply({ DialogCallKind::GetResults }).Succeeded && results)
+		return DialogResultArray::Create(results->Items, ppenum);
 	return E_NOTIMPL;
 }
 
@@ -500,7 +952,12 @@ STDAPICALL CFilesOpenDialog::GetSelectedItems(IShellItemArray** ppsai)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetSelectedItems(ppsai);
 #endif
-	return GetResults(ppsai);
+	*ppsai = NULL;
+	if (!Apply({ DialogCallKind::GetSelectedItems }).Succeeded)
+		return E_NOTIMPL;
+	if (!_state.GetCurrentSelection().empty())
+		return CreateItemArray(_state.GetCurrentSelection(), ppsai);
+	return CreateItemArray(_state.GetResults(), ppsai);
 }
 
 STDAPICALL CFilesOpenDialog::EnableOpenDropDown(DWORD dwIDCtl)
@@ -509,7 +966,7 @@ STDAPICALL CFilesOpenDialog::EnableOpenDropDown(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->EnableOpenDropDown(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::OpenDropDown, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddMenu(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -518,7 +975,7 @@ STDAPICALL CFilesOpenDialog::AddMenu(DWORD dwIDCtl, LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddMenu(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Menu, wstr2str(pszLabel), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddPushButton(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -527,7 +984,7 @@ STDAPICALL CFilesOpenDialog::AddPushButton(DWORD dwIDCtl, LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddPushButton(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::PushButton, wstr2str(pszLabel), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddComboBox(DWORD dwIDCtl)
@@ -536,7 +993,7 @@ STDAPICALL CFilesOpenDialog::AddComboBox(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddComboBox(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::ComboBox, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddRadioButtonList(DWORD dwIDCtl)
@@ -545,7 +1002,7 @@ STDAPICALL CFilesOpenDialog::AddRadioButtonList(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddRadioButtonList(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::RadioButtonList, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddCheckButton(DWORD dwIDCtl, LPCWSTR pszLabel, BOOL bChecked)
@@ -554,7 +1011,7 @@ STDAPICALL CFilesOpenDialog::AddCheckButton(DWORD dwIDCtl, LPCWSTR pszLabel, BOO
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddCheckButton(dwIDCtl, pszLabel, bChecked);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::CheckButton | (bChecked ? 0x100 : 0), wstr2str(pszLabel), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddEditBox(DWORD dwIDCtl, LPCWSTR pszText)
@@ -563,7 +1020,7 @@ STDAPICALL CFilesOpenDialog::AddEditBox(DWORD dwIDCtl, LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddEditBox(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::EditBox, wstr2str(pszText), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddSeparator(DWORD dwIDCtl)
@@ -572,7 +1029,7 @@ STDAPICALL CFilesOpenDialog::AddSeparator(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddSeparator(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Separator, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddText(DWORD dwIDCtl, LPCWSTR pszText)
@@ -581,7 +1038,7 @@ STDAPICALL CFilesOpenDialog::AddText(DWORD dwIDCtl, LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddText(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Text, wstr2str(pszText), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::SetControlLabel(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -590,7 +1047,7 @@ STDAPICALL CFilesOpenDialog::SetControlLabel(DWORD dwIDCtl, LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlLabel(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlLabel, 0, wstr2str(pszLabel), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::GetControlState(DWORD dwIDCtl, CDCONTROLSTATEF* pdwState)
@@ -599,8 +1056,9 @@ STDAPICALL CFilesOpenDialog::GetControlState(DWORD dwIDCtl, CDCONTROLSTATEF* pdw
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetControlState(dwIDCtl, pdwState);
 #endif
-	* pdwState = CDCS_ENABLEDVISIBLE;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetControlState, 0, std::string(), dwIDCtl });
+	*pdwState = (CDCONTROLSTATEF)reply.Value;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 STDAPICALL CFilesOpenDialog::SetControlState(DWORD dwIDCtl, CDCONTROLSTATEF dwState)
@@ -609,7 +1067,7 @@ STDAPICALL CFilesOpenDialog::SetControlState(DWORD dwIDCtl, CDCONTROLSTATEF dwSt
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlState(dwIDCtl, dwState);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlState, (std::uint32_t)dwState, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::GetEditBoxText(DWORD dwIDCtl, WCHAR** ppszText)
@@ -618,8 +1076,11 @@ STDAPICALL CFilesOpenDialog::GetEditBoxText(DWORD dwIDCtl, WCHAR** ppszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetEditBoxText(dwIDCtl, ppszText);
 #endif
-	SHStrDupW(L"", ppszText);
-	return S_OK;
+	*ppszText = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetEditBoxText, 0, std::string(), dwIDCtl });
+	if (!reply.Succeeded)
+		return E_INVALIDARG;
+	return SHStrDupW(str2wstr(std::string(reply.Text)).c_str(), ppszText);
 }
 
 STDAPICALL CFilesOpenDialog::SetEditBoxText(DWORD dwIDCtl, LPCWSTR pszText)
@@ -628,7 +1089,7 @@ STDAPICALL CFilesOpenDialog::SetEditBoxText(DWORD dwIDCtl, LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetEditBoxText(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetEditBoxText, 0, wstr2str(pszText), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::GetCheckButtonState(DWORD dwIDCtl, BOOL* pbChecked)
@@ -637,8 +1098,9 @@ STDAPICALL CFilesOpenDialog::GetCheckButtonState(DWORD dwIDCtl, BOOL* pbChecked)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetCheckButtonState(dwIDCtl, pbChecked);
 #endif
-	* pbChecked = false;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetCheckButtonState, 0, std::string(), dwIDCtl });
+	*pbChecked = reply.Value != 0;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 STDAPICALL CFilesOpenDialog::SetCheckButtonState(DWORD dwIDCtl, BOOL bChecked)
@@ -647,7 +1109,7 @@ STDAPICALL CFilesOpenDialog::SetCheckButtonState(DWORD dwIDCtl, BOOL bChecked)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetCheckButtonState(dwIDCtl, bChecked);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetCheckButtonState, bChecked != FALSE, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::AddControlItem(DWORD dwIDCtl, DWORD dwIDItem, LPCWSTR pszLabel)
@@ -656,7 +1118,7 @@ STDAPICALL CFilesOpenDialog::AddControlItem(DWORD dwIDCtl, DWORD dwIDItem, LPCWS
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddControlItem(dwIDCtl, dwIDItem, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControlItem, 0, wstr2str(pszLabel), dwIDCtl, dwIDItem });
 }
 
 STDAPICALL CFilesOpenDialog::RemoveControlItem(DWORD dwIDCtl, DWORD dwIDItem)
@@ -665,7 +1127,7 @@ STDAPICALL CFilesOpenDialog::RemoveControlItem(DWORD dwIDCtl, DWORD dwIDItem)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->RemoveControlItem(dwIDCtl, dwIDItem);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::RemoveControlItem, 0, std::string(), dwIDCtl, dwIDItem });
 }
 
 STDAPICALL CFilesOpenDialog::RemoveAllControlItems(DWORD dwIDCtl)
@@ -674,7 +1136,7 @@ STDAPICALL CFilesOpenDialog::RemoveAllControlItems(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->RemoveAllControlItems(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::RemoveAllControlItems, 0, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::GetControlItemState(DWORD dwIDCtl, DWORD dwIDItem, CDCONTROLSTATEF* pdwState)
@@ -683,8 +1145,9 @@ STDAPICALL CFilesOpenDialog::GetControlItemState(DWORD dwIDCtl, DWORD dwIDItem,
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetControlItemState(dwIDCtl, dwIDItem, pdwState);
 #endif
-	* pdwState = CDCS_ENABLEDVISIBLE;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetControlItemState, 0, std::string(), dwIDCtl, dwIDItem });
+	*pdwState = (CDCONTROLSTATEF)reply.Value;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 STDAPICALL CFilesOpenDialog::SetControlItemState(DWORD dwIDCtl, DWORD dwIDItem, CDCONTROLSTATEF dwState)
@@ -693,7 +1156,7 @@ STDAPICALL CFilesOpenDialog::SetControlItemState(DWORD dwIDCtl, DWORD dwIDItem,
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlItemState(dwIDCtl, dwIDItem, dwState);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlItemState, (std::uint32_t)dwState, std::string(), dwIDCtl, dwIDItem });
 }
 
 STDAPICALL CFilesOpenDialog::GetSelectedControlItem(DWORD dwIDCtl, DWORD* pdwIDItem)
@@ -702,8 +1165,10 @@ STDAPICALL CFilesOpenDialog::GetSelectedControlItem(DWORD dwIDCtl, DWORD* pdwIDI
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetSelectedControlItem(dwIDCtl, pdwIDItem);
 #endif
-	* pdwIDItem = 0;
-	return S_OK;
+	// Fails until an item is selected, by the host or in Files
+	DialogReply reply = Apply({ DialogCallKind::GetSelectedControlItem, 0, std::string(), dwIDCtl });
+	*pdwIDItem = reply.Value;
+	return reply.Succeeded ? S_OK : E_FAIL;
 }
 
 STDAPICALL CFilesOpenDialog::SetSelectedControlItem(DWORD dwIDCtl, DWORD dwIDItem)
@@ -712,7 +1177,7 @@ STDAPICALL CFilesOpenDialog::SetSelectedControlItem(DWORD dwIDCtl, DWORD dwIDIte
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetSelectedControlItem(dwIDCtl, dwIDItem);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetSelectedControlItem, 0, std::string(), dwIDCtl, dwIDItem });
 }
 
 STDAPICALL CFilesOpenDialog::StartVisualGroup(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -721,7 +1186,7 @@ STDAPICALL CFilesOpenDialog::StartVisualGroup(DWORD dwIDCtl, LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->StartVisualGroup(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::VisualGroup, wstr2str(pszLabel), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::EndVisualGroup(void)
@@ -730,7 +1195,7 @@ STDAPICALL CFilesOpenDialog::EndVisualGroup(void)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->EndVisualGroup();
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::EndVisualGroup });
 }
 
 STDAPICALL CFilesOpenDialog::MakeProminent(DWORD dwIDCtl)
@@ -739,7 +1204,7 @@ STDAPICALL CFilesOpenDialog::MakeProminent(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->MakeProminent(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::MakeProminent, 0, std::string(), dwIDCtl });
 }
 
 STDAPICALL CFilesOpenDialog::SetControlItemText(DWORD dwIDCtl, DWORD dwIDItem, LPCWSTR pszLabel)
@@ -748,7 +1213,7 @@ STDAPICALL CFilesOpenDialog::SetControlItemText(DWORD dwIDCtl, DWORD dwIDItem, L
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlItemText(dwIDCtl, dwIDItem, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlItemText, 0, wstr2str(pszLabel), dwIDCtl, dwIDItem });
 }
 
 STDAPICALL CFilesOpenDialog::SetCancelButtonLabel(LPCWSTR pszLabel)
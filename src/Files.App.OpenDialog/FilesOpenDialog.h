@@ -6,9 +6,10 @@
 
 #pragma once
 
+#ifndef LEANDIALOG
 #define DEBUGLOG
+#endif
 
-#include <iostream>
 #include <string>
 #include <vector>
 
@@ -16,6 +17,19 @@
 #include "resource.h"
 #include "CustomOpenDialog_i.h"
 #include "UndefInterfaces.h"
+#include "Windows/DialogLog.h"
+#include "DialogEventQueue.h"
+#include "DialogResults.h"
+#include "DialogState.h"
+#include "FileTypeFilter.h"
+#include "ItemFilterProtocol.h"
+#include "Windows/DialogRecorder.h"
+#include "Windows/DialogResultArray.h"
+#include "Windows/DialogSession.h"
+#include "Windows/FolderHistory.h"
+#include "Windows/FolderPrefetch.h"
+#include "Windows/SystemDialogForwarding.h"
+#include "Windows/SystemDialogWarmup.h"
 
 #if defined(_WIN32_WCE) && !defined(_CE_DCOM) && !defined(_CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA)
 #error "Single-threaded COM objects are not supported properly on the Windows CE platform, for example Windows Mobile platforms do not include full DCOM support. Define _CE_ALLOW_SINGLE_THREADED_OBJECTS_IN_MTA to make ATL support the creation of single-threaded COM objects and allow implementations with single-threaded COM objects. The threading model in the RGS file has been set to 'Free' as it is the only threading model supported on non-DCOM Windows CE platforms."
@@ -60,15 +74,59 @@ END_COM_MAP()
 
 	CComPtr<IFileOpenDialog> _systemDialog;
 
-	FILEOPENDIALOGOPTIONS _fos;
+	// Options, folders, file types and results, as the host and Files set them
+	Files::Native::DialogState _state{ Files::Native::DialogKind::Open };
+	Files::Native::DialogRecorder _recorder{ Files::Native::DialogKind::Open };
+
+	// What Show() ended with, GetResults hands the host a copy of it
+	Files::Native::DialogResults _results;
 
-	std::vector<std::wstring> _selectedItems;
 	std::wstring _outputPath;
 	CComPtr<IShellItem> _initFolder;
+	CComPtr<IShellItem> _defaultFolder;
 	CComPtr<IFileDialogEvents> _dialogEvents;
 
+	// Where Show() starts when the host doesn't say, per SetClientGuid
+	GUID _clientGuid;
+	bool _hasClientGuid;
+	Files::Native::FolderHistory _folderHistory;
+
+	// Copied from SetFileTypes, the host may free its strings as soon as the call returns
+	std::vector<std::pair<std::wstring, std::wstring>> _fileTypes;
+	std::vector<Files::Native::FileTypeFilter> _fileTypeFilters;
+
+	CComPtr<IShellItemFilter> _itemFilter;
+	Files::Native::FilterVerdictCache _filterVerdicts;
+
+	// Folder and selection changes reported by Files while Show() runs
+	Files::Native::DialogEventQueue _dialogEventQueue;
+
+	Files::Native::SystemDialogWarmup _systemDialogWarmup;
+	Files::Native::FolderPrefetch _folderPrefetch;
+	Files::Native::DialogSession _session;
+
+	// Set while Show() runs, Close() cancels it
+	Files::Native::DialogExecutor* _executor;
+	HRESULT _closeResult;
+	bool _preActivated;
+
 	FILE* _debugStream;
 
+	void OpenDebugLog();
+	bool EnsureOutputPath();
+	void PreActivate();
+	bool StartSession();
+	Files::Native::DialogReply Apply(Files::Native::DialogCall call);
+	HRESULT ApplyControl(Files::Native::DialogCall call);
+	Files::Native::Task<HRESULT> ShowAsync(Files::Native::DialogExecutor& executor, HWND hwndOwner);
+	Files::Native::Task<std::wstring> GetStartFolderAsync(Files::Native::DialogExecutor& executor);
+	void RememberFolder();
+	std::string GetClientKey();
+	HRESULT ShowSystemDialog(HWND hwndOwner);
+	void AnswerFilterQuery(const std::string& payload);
+	void ApplyControlChanges(const std::string& payload);
+	DWORD RaiseDialogEvents();
+
 public:
 	// Inherited through IFileOpenDialog
 	STDAPICALL Show(HWND hwndOwner) override;
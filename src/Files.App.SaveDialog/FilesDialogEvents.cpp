@@ -1,10 +1,10 @@
 #include "pch.h"
 #include "FilesDialogEvents.h"
-#include <iostream>
+#include "Windows/DialogLog.h"
 
-using std::cout;
-using std::wcout;
-using std::endl;
+using Files::Native::DialogLog::cout;
+using Files::Native::DialogLog::wcout;
+using Files::Native::DialogLog::endl;
 
 FilesDialogEvents::FilesDialogEvents(IFileDialogEvents* evt, IFileDialog* cust)
 {
@@ -17,7 +17,7 @@ HRESULT __stdcall FilesDialogEvents::QueryInterface(REFIID riid, void** ppvObjec
 	HRESULT res = _evt->QueryInterface(riid, ppvObject);
 	OLECHAR* guidString;
 	(void)StringFromCLSID(riid, &guidString);
-	std::wcout << L"Event: QueryInterface: " << guidString << L" = " << res << std::endl;
+	wcout << L"Event: QueryInterface: " << guidString << L" = " << res << endl;
 	::CoTaskMemFree(guidString);
 	return res;
 }
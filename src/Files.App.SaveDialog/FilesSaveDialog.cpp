@@ -2,18 +2,24 @@
 
 #include "pch.h"
 #include "FilesSaveDialog.h"
+#include "ActivationCommand.h"
+#include "DialogOptions.h"
+#include "Windows/DialogSettings.h"
+#include "Windows/FilesActivation.h"
+#include "Windows/ResultChannel.h"
+#include "Windows/Win32SaveStorage.h"
 #include <shlobj.h>
-#include <iostream>
-#include <fstream>
 #include <cstdio>
-#include <locale>
-#include <codecvt>
+#include <chrono>
+#include <memory>
 
 //#define SYSTEMDIALOG
 
-using std::cout;
-using std::wcout;
-using std::endl;
+using Files::Native::DialogLog::cout;
+using Files::Native::DialogLog::wcout;
+using Files::Native::DialogLog::endl;
+
+using namespace Files::Native;
 
 // CFilesSaveDialog
 
@@ -24,50 +30,55 @@ CComPtr<IFileSaveDialog> GetSystemDialog()
 
 	HINSTANCE lib = CoLoadLibrary(comdlg32Path, false);
 	BOOL(WINAPI* dllGetClassObject)(REFCLSID, REFIID, LPVOID*) =
-		(BOOL(WINAPI*)(REFCLSID, REFIID, LPVOID*))GetProcAddress(lib, "DllGetClassObject");
+		lib ? (BOOL(WINAPI*)(REFCLSID, REFIID, LPVOID*))GetProcAddress(lib, "DllGetClassObject") : NULL;
 	CComPtr<IClassFactory> pClassFactory;
-	dllGetClassObject(CLSID_FileSaveDialog, IID_IClassFactory, (void**)&pClassFactory);
+	if (dllGetClassObject)
+		dllGetClassObject(CLSID_FileSaveDialog, IID_IClassFactory, (void**)&pClassFactory);
 	CComPtr<IFileSaveDialog> systemDialog;
-	pClassFactory->CreateInstance(NULL, IID_IFileSaveDialog, (void**)&systemDialog);
+	if (pClassFactory)
+		pClassFactory->CreateInstance(NULL, IID_IFileSaveDialog, (void**)&systemDialog);
 	//CoFreeLibrary(lib);
 	return systemDialog;
 }
 
-std::string wstring_to_utf8_hex(const std::wstring& input)
+std::wstring str2wstr(const std::string& str)
 {
-	std::string output;
-
-	int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, NULL, 0, NULL, NULL);
+	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
 	if (cbNeeded > 0)
 	{
-		char* utf8 = new char[cbNeeded];
-		if (WideCharToMultiByte(CP_UTF8, 0, input.c_str(), -1, utf8, cbNeeded, NULL, NULL) != 0)
-		{
-			for (char* p = utf8; *p; p++)
-			{
-				char onehex[5];
-				sprintf_s(onehex, sizeof(onehex), "%%%02.2X", (unsigned char)*p);
-				output.append(onehex);
-			}
-		}
-
-		delete[] utf8;
+		std::wstring wstrTo(cbNeeded, 0);
+		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
+		return wstrTo;
 	}
 
-	return output;
+	return L"";
 }
 
-std::wstring str2wstr(const std::string& str)
+std::string wstr2str(const std::wstring& wstr)
 {
-	int cbNeeded = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), NULL, 0);
+	int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), NULL, 0, NULL, NULL);
 	if (cbNeeded > 0)
 	{
-		std::wstring wstrTo(cbNeeded, 0);
-		MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], cbNeeded);
-		return wstrTo;
+		std::string strTo(cbNeeded, 0);
+		WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), (int)wstr.size(), &strTo[0], cbNeeded, NULL, NULL);
+		return strTo;
 	}
 
-	return L"";
+	return "";
+}
+
+// UTF-8 parsing name of an item, empty when it has none
+std::string GetParsingName(IShellItem* psi)
+{
+	std::string name;
+	PWSTR pszPath = NULL;
+	if (psi && SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	{
+		name = wstr2str(pszPath);
+		CoTaskMemFree(pszPath);
+	}
+
+	return name;
 }
 
 template <typename T>
@@ -78,53 +89,155 @@ CComPtr<T> AsInterface(CComPtr<IFileSaveDialog> dialog)
 	return dialogInterface;
 }
 
+// Lines Files wrote to the output file, which is deleted
+std::vector<std::wstring> ReadResults(const std::wstring& outputPath)
+{
+	std::vector<std::wstring> results;
+	std::string text = ResultChannel::TakeResultFile(outputPath);
+	for (std::string_view line : ParseResultLines(text))
+	{
+		results.push_back(str2wstr(std::string(line)));
+	}
+
+	return results;
+}
+
 CFilesSaveDialog::CFilesSaveDialog()
 {
-	_fos = FOS_PATHMUSTEXIST;
+	// Many hosts create dialogs they never show, so nothing here may touch the disk or
+	// the shell namespace. Everything Show() needs is resolved when it is called.
 	_systemDialog = nullptr;
 	_debugStream = NULL;
 	_dialogEvents = NULL;
+	_preActivated = false;
+	_executor = NULL;
+	_closeResult = S_OK;
+	_clientGuid = GUID_NULL;
+	_hasClientGuid = false;
+
+#ifdef SYSTEMDIALOG
+	_systemDialog = GetSystemDialog();
+#endif
+}
+
+void CFilesSaveDialog::OpenDebugLog()
+{
+#ifdef DEBUGLOG
+	if (_debugStream)
+	{
+		return;
+	}
 
 	PWSTR pszPath = NULL;
-	HRESULT hr = SHGetKnownFolderPath(FOLDERID_Desktop, 0, NULL, &pszPath);
-	if (SUCCEEDED(hr))
+	if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_Desktop, 0, NULL, &pszPath)))
 	{
 		TCHAR debugPath[MAX_PATH];
 		wsprintf(debugPath, L"%s\\%s", pszPath, L"save_dialog.txt");
-#ifdef DEBUGLOG
 		_wfreopen_s(&_debugStream, debugPath, L"w", stdout);
-#endif
 		CoTaskMemFree(pszPath);
 	}
-	cout << "Create" << endl;
+#endif
+}
+
+bool CFilesSaveDialog::EnsureOutputPath()
+{
+	if (!_outputPath.empty())
+	{
+		return true;
+	}
 
 	TCHAR tempPath[MAX_PATH];
-	GetTempPath(MAX_PATH, tempPath);
 	TCHAR tempName[MAX_PATH];
-	GetTempFileName(tempPath, L"fsd", 0, tempName);
+	if (!GetTempPath(MAX_PATH, tempPath) || !GetTempFileName(tempPath, L"fsd", 0, tempName))
+	{
+		return false;
+	}
+
 	_outputPath = tempName;
+	return true;
+}
 
-	(void)SHGetKnownFolderItem(FOLDERID_Documents, KF_FLAG_DEFAULT_PATH, NULL, IID_PPV_ARGS(&_initFolder));
-	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_NORMALDISPLAY, &pszPath)))
+void CFilesSaveDialog::PreActivate()
+{
+	if (_preActivated)
 	{
-		wcout << L"_outputPath: " << _outputPath << L", _initFolder: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
+		return;
 	}
 
-#ifdef SYSTEMDIALOG
-	_systemDialog = GetSystemDialog();
-#endif
+	_preActivated = true;
+
+	DialogSettings settings = DialogSettings::Load();
+	if (settings.Mode != DialogMode::SystemOnly && settings.PreActivate && FilesActivation::IsInstalled())
+	{
+		StartSession();
+	}
+}
+
+bool CFilesSaveDialog::StartSession()
+{
+	if (!_session.Listen())
+	{
+		return false;
+	}
+
+	// Files starts in the background and connects back to the session pipe
+	ActivationCommand command(FilesActivation::GetExecutablePath());
+	command.Append(L"-dialogsession", _session.Name());
+	std::wstring uriWithArgs = command.ToUri();
+
+	if (!FilesActivation::Launch(uriWithArgs.c_str()))
+	{
+		_session.Close();
+		return false;
+	}
+
+	wcout << L"StartSession, session: " << _session.Name() << endl;
+	return true;
+}
+
+// Every call that reads or changes the dialog's state goes through here, to be recorded
+DialogReply CFilesSaveDialog::Apply(DialogCall call)
+{
+	_recorder.Record(call);
+	DialogReply reply = _state.Apply(call);
+
+	// The state stays this thread's, the host's other threads read the published results
+	if (call.Kind == DialogCallKind::Show)
+	{
+		_results.Clear();
+	}
+	else if (call.Kind == DialogCallKind::Completed)
+	{
+		_results.Publish(_state.GetResults());
+	}
+
+	return reply;
+}
+
+// IFileDialogCustomize answers E_INVALIDARG for the controls and items the dialog doesn't have
+HRESULT CFilesSaveDialog::ApplyControl(DialogCall call)
+{
+	return Apply(std::move(call)).Succeeded ? S_OK : E_INVALIDARG;
 }
 
 void CFilesSaveDialog::FinalRelease()
 {
+	_session.Close();
 	if (_systemDialog)
 	{
 		_systemDialog.Release();
 	}
 	_initFolder.Release();
+	_defaultFolder.Release();
 	_dialogEvents.Release();
-	DeleteFile(_outputPath.c_str());
+	_itemFilter.Release();
+	_folderPrefetch.Cancel();
+	_recorder.Save();
+	if (!_outputPath.empty())
+	{
+		DeleteFile(_outputPath.c_str());
+		DeleteFile((_outputPath + L".snapshot").c_str());
+	}
 	if (_debugStream)
 	{
 		fclose(_debugStream);
@@ -155,7 +268,7 @@ HRESULT __stdcall CFilesSaveDialog::EnableOpenDropDown(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->EnableOpenDropDown(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::OpenDropDown, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddMenu(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -164,7 +277,7 @@ HRESULT __stdcall CFilesSaveDialog::AddMenu(DWORD dwIDCtl, LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddMenu(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Menu, wstr2str(pszLabel), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddPushButton(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -173,7 +286,7 @@ HRESULT __stdcall CFilesSaveDialog::AddPushButton(DWORD dwIDCtl, LPCWSTR pszLabe
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddPushButton(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::PushButton, wstr2str(pszLabel), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddComboBox(DWORD dwIDCtl)
@@ -182,7 +295,7 @@ HRESULT __stdcall CFilesSaveDialog::AddComboBox(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddComboBox(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::ComboBox, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddRadioButtonList(DWORD dwIDCtl)
@@ -191,7 +304,7 @@ HRESULT __stdcall CFilesSaveDialog::AddRadioButtonList(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddRadioButtonList(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::RadioButtonList, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddCheckButton(DWORD dwIDCtl, LPCWSTR pszLabel, BOOL bChecked)
@@ -200,7 +313,7 @@ HRESULT __stdcall CFilesSaveDialog::AddCheckButton(DWORD dwIDCtl, LPCWSTR pszLab
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddCheckButton(dwIDCtl, pszLabel, bChecked);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::CheckButton | (bChecked ? 0x100 : 0), wstr2str(pszLabel), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddEditBox(DWORD dwIDCtl, LPCWSTR pszText)
@@ -209,7 +322,7 @@ HRESULT __stdcall CFilesSaveDialog::AddEditBox(DWORD dwIDCtl, LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddEditBox(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::EditBox, wstr2str(pszText), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddSeparator(DWORD dwIDCtl)
@@ -218,7 +331,7 @@ HRESULT __stdcall CFilesSaveDialog::AddSeparator(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddSeparator(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Separator, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddText(DWORD dwIDCtl, LPCWSTR pszText)
@@ -227,7 +340,7 @@ HRESULT __stdcall CFilesSaveDialog::AddText(DWORD dwIDCtl, LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddText(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::Text, wstr2str(pszText), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetControlLabel(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -236,7 +349,7 @@ HRESULT __stdcall CFilesSaveDialog::SetControlLabel(DWORD dwIDCtl, LPCWSTR pszLa
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlLabel(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlLabel, 0, wstr2str(pszLabel), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetControlState(DWORD dwIDCtl, CDCONTROLSTATEF* pdwState)
@@ -245,8 +358,9 @@ HRESULT __stdcall CFilesSaveDialog::GetControlState(DWORD dwIDCtl, CDCONTROLSTAT
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetControlState(dwIDCtl, pdwState);
 #endif
-	* pdwState = CDCS_ENABLEDVISIBLE;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetControlState, 0, std::string(), dwIDCtl });
+	*pdwState = (CDCONTROLSTATEF)reply.Value;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetControlState(DWORD dwIDCtl, CDCONTROLSTATEF dwState)
@@ -255,7 +369,7 @@ HRESULT __stdcall CFilesSaveDialog::SetControlState(DWORD dwIDCtl, CDCONTROLSTAT
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlState(dwIDCtl, dwState);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlState, (std::uint32_t)dwState, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetEditBoxText(DWORD dwIDCtl, WCHAR** ppszText)
@@ -264,8 +378,13 @@ HRESULT __stdcall CFilesSaveDialog::GetEditBoxText(DWORD dwIDCtl, WCHAR** ppszTe
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetEditBoxText(dwIDCtl, ppszText);
 #endif
-	SHStrDupW(L"", ppszText);
-	return S_OK;
+	*ppszText = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetEditBoxText, 0, std::string(), dwIDCtl });
+	if (!reply.Succeeded)
+	{
+		return E_INVALIDARG;
+	}
+	return SHStrDupW(str2wstr(std::string(reply.Text)).c_str(), ppszText);
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetEditBoxText(DWORD dwIDCtl, LPCWSTR pszText)
@@ -274,7 +393,7 @@ HRESULT __stdcall CFilesSaveDialog::SetEditBoxText(DWORD dwIDCtl, LPCWSTR pszTex
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetEditBoxText(dwIDCtl, pszText);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetEditBoxText, 0, wstr2str(pszText), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetCheckButtonState(DWORD dwIDCtl, BOOL* pbChecked)
@@ -283,8 +402,9 @@ HRESULT __stdcall CFilesSaveDialog::GetCheckButtonState(DWORD dwIDCtl, BOOL* pbC
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetCheckButtonState(dwIDCtl, pbChecked);
 #endif
-	* pbChecked = false;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetCheckButtonState, 0, std::string(), dwIDCtl });
+	*pbChecked = reply.Value != 0;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetCheckButtonState(DWORD dwIDCtl, BOOL bChecked)
@@ -293,7 +413,7 @@ HRESULT __stdcall CFilesSaveDialog::SetCheckButtonState(DWORD dwIDCtl, BOOL bChe
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetCheckButtonState(dwIDCtl, bChecked);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetCheckButtonState, bChecked != FALSE, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::AddControlItem(DWORD dwIDCtl, DWORD dwIDItem, LPCWSTR pszLabel)
@@ -302,8 +422,7 @@ HRESULT __stdcall CFilesSaveDialog::AddControlItem(DWORD dwIDCtl, DWORD dwIDItem
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->AddControlItem(dwIDCtl, dwIDItem, pszLabel);
 #endif
-	_ctrlItems.push_back(dwIDItem);
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControlItem, 0, wstr2str(pszLabel), dwIDCtl, dwIDItem });
 }
 
 HRESULT __stdcall CFilesSaveDialog::RemoveControlItem(DWORD dwIDCtl, DWORD dwIDItem)
@@ -312,7 +431,7 @@ HRESULT __stdcall CFilesSaveDialog::RemoveControlItem(DWORD dwIDCtl, DWORD dwIDI
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->RemoveControlItem(dwIDCtl, dwIDItem);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::RemoveControlItem, 0, std::string(), dwIDCtl, dwIDItem });
 }
 
 HRESULT __stdcall CFilesSaveDialog::RemoveAllControlItems(DWORD dwIDCtl)
@@ -321,7 +440,7 @@ HRESULT __stdcall CFilesSaveDialog::RemoveAllControlItems(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->RemoveAllControlItems(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::RemoveAllControlItems, 0, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetControlItemState(DWORD dwIDCtl, DWORD dwIDItem, CDCONTROLSTATEF* pdwState)
@@ -330,8 +449,9 @@ HRESULT __stdcall CFilesSaveDialog::GetControlItemState(DWORD dwIDCtl, DWORD dwI
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetControlItemState(dwIDCtl, dwIDItem, pdwState);
 #endif
-	* pdwState = CDCS_ENABLEDVISIBLE;
-	return S_OK;
+	DialogReply reply = Apply({ DialogCallKind::GetControlItemState, 0, std::string(), dwIDCtl, dwIDItem });
+	*pdwState = (CDCONTROLSTATEF)reply.Value;
+	return reply.Succeeded ? S_OK : E_INVALIDARG;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetControlItemState(DWORD dwIDCtl, DWORD dwIDItem, CDCONTROLSTATEF dwState)
@@ -340,7 +460,7 @@ HRESULT __stdcall CFilesSaveDialog::SetControlItemState(DWORD dwIDCtl, DWORD dwI
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlItemState(dwIDCtl, dwIDItem, dwState);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlItemState, (std::uint32_t)dwState, std::string(), dwIDCtl, dwIDItem });
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetSelectedControlItem(DWORD dwIDCtl, DWORD* pdwIDItem)
@@ -349,11 +469,10 @@ HRESULT __stdcall CFilesSaveDialog::GetSelectedControlItem(DWORD dwIDCtl, DWORD*
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->GetSelectedControlItem(dwIDCtl, pdwIDItem);
 #endif
-	if (!_ctrlItems.empty()) {
-		*pdwIDItem = _ctrlItems.back();
-		return S_OK;
-	}
-	return E_NOTIMPL;
+	// Fails until an item is selected, by the host or in Files
+	DialogReply reply = Apply({ DialogCallKind::GetSelectedControlItem, 0, std::string(), dwIDCtl });
+	*pdwIDItem = reply.Value;
+	return reply.Succeeded ? S_OK : E_FAIL;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetSelectedControlItem(DWORD dwIDCtl, DWORD dwIDItem)
@@ -362,8 +481,7 @@ HRESULT __stdcall CFilesSaveDialog::SetSelectedControlItem(DWORD dwIDCtl, DWORD
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetSelectedControlItem(dwIDCtl, dwIDItem);
 #endif
-	_ctrlItems.push_back(dwIDItem);
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetSelectedControlItem, 0, std::string(), dwIDCtl, dwIDItem });
 }
 
 HRESULT __stdcall CFilesSaveDialog::StartVisualGroup(DWORD dwIDCtl, LPCWSTR pszLabel)
@@ -372,7 +490,7 @@ HRESULT __stdcall CFilesSaveDialog::StartVisualGroup(DWORD dwIDCtl, LPCWSTR pszL
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->StartVisualGroup(dwIDCtl, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::VisualGroup, wstr2str(pszLabel), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::EndVisualGroup(void)
@@ -381,7 +499,7 @@ HRESULT __stdcall CFilesSaveDialog::EndVisualGroup(void)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->EndVisualGroup();
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::EndVisualGroup });
 }
 
 HRESULT __stdcall CFilesSaveDialog::MakeProminent(DWORD dwIDCtl)
@@ -390,7 +508,7 @@ HRESULT __stdcall CFilesSaveDialog::MakeProminent(DWORD dwIDCtl)
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->MakeProminent(dwIDCtl);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::MakeProminent, 0, std::string(), dwIDCtl });
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetControlItemText(DWORD dwIDCtl, DWORD dwIDItem, LPCWSTR pszLabel)
@@ -399,15 +517,18 @@ HRESULT __stdcall CFilesSaveDialog::SetControlItemText(DWORD dwIDCtl, DWORD dwID
 #ifdef SYSTEMDIALOG
 	return AsInterface<IFileDialogCustomize>(_systemDialog)->SetControlItemText(dwIDCtl, dwIDItem, pszLabel);
 #endif
-	return S_OK;
+	return ApplyControl({ DialogCallKind::SetControlItemText, 0, wstr2str(pszLabel), dwIDCtl, dwIDItem });
 }
 
 HRESULT __stdcall CFilesSaveDialog::Show(HWND hwndOwner)
 {
+	OpenDebugLog();
+
 	wchar_t wnd_title[1024];
 	GetWindowText(hwndOwner, wnd_title, 1024);
 	wcout << L"Show, ID: " << GetCurrentProcessId() << endl;
-	_selectedItem.clear();
+
+	Apply({ DialogCallKind::Show });
 
 #ifdef SYSTEMDIALOG
 	HRESULT res = _systemDialog->Show(NULL);
@@ -415,107 +536,496 @@ HRESULT __stdcall CFilesSaveDialog::Show(HWND hwndOwner)
 	return res;
 #endif
 
-	SHELLEXECUTEINFO ShExecInfo = { 0 };
-	ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
-	ShExecInfo.fMask = SEE_MASK_NOCLOSEPROCESS;
-	
-	PWSTR pszPath = NULL;
-	WCHAR szBuf[MAX_PATH];
-	TCHAR args[1024] = { 0 };
-	ExpandEnvironmentStringsW(L"%LOCALAPPDATA%\\Microsoft\\WindowsApps\\files-dev.exe", szBuf, MAX_PATH - 1);
+	// The stages of Show() run on the host's thread, which keeps dispatching its messages
+	PumpingExecutorHost host;
+	DialogExecutor executor(host);
+	_executor = &executor;
+	_closeResult = HRESULT_FROM_WIN32(ERROR_CANCELLED);
 
-	HANDLE closeEvent = CreateEvent(NULL, FALSE, FALSE, TEXT("FILEDIALOG"));
+	HRESULT hr = executor.Run(ShowAsync(executor, hwndOwner));
+	_executor = NULL;
 
-	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	if (SUCCEEDED(hr))
 	{
-		if (!_initName.empty())
+		RememberFolder();
+	}
+	return hr;
+}
+
+Task<HRESULT> CFilesSaveDialog::ShowAsync(DialogExecutor& executor, HWND hwndOwner)
+{
+	DialogSettings settings = DialogSettings::Load();
+	if (settings.Mode == DialogMode::SystemOnly ||
+		(settings.Mode == DialogMode::Hybrid && !FilesActivation::IsInstalled()))
+		co_return ShowSystemDialog(hwndOwner);
+
+	if (!EnsureOutputPath())
+		co_return settings.Mode == DialogMode::Hybrid ? ShowSystemDialog(hwndOwner) : E_FAIL;
+
+	// Have the fallback ready by the time the activation deadline expires
+	if (settings.Mode == DialogMode::Hybrid)
+		_systemDialogWarmup.Start(CLSID_FileSaveDialog);
+
+	// The host may judge items differently from one Show() to the next
+	_filterVerdicts.Clear();
+	_properties.Reset();
+	_dialogEventQueue.Reset();
+
+	DWORD ackTimeout = settings.Mode == DialogMode::Hybrid ? settings.ActivationTimeout : INFINITE;
+
+	// Files stays attached to the dialog between Show() calls, so only the first call
+	// (or the pre-activation) pays for starting it. It finishes connecting back while
+	// the command line is prepared.
+	bool reused = _session.IsReady();
+	if (!_session.IsOpen())
+	{
+		StartSession();
+	}
+	auto sessionReady = executor.Spawn(_session.WaitReadyAsync(executor, ackTimeout));
+
+	std::wstring initFolder = co_await GetStartFolderAsync(executor);
+
+	// Listed while Files starts, which then doesn't have to enumerate the folder cold
+	std::wstring snapshotPath = _outputPath + L".snapshot";
+	if (!initFolder.empty())
+	{
+		_folderPrefetch.Start(initFolder, snapshotPath);
+	}
+
+	ResultChannel channel;
+	ActivationCommand command(FilesActivation::GetExecutablePath());
+
+	std::wstring initName = str2wstr(_state.GetFileName());
+	if (!initFolder.empty())
+	{
+		command.AppendQuoted(L"-directory", initFolder);
+	}
+	command.AppendQuoted(L"-outputpath", _outputPath).Append(L"-dialogchannel", channel.Id());
+	if (!initFolder.empty())
+	{
+		if (!initName.empty())
 		{
-			swprintf(args, _countof(args) - 1, L"\"%s\" -directory \"%s\" -outputpath \"%s\" -select \"%s\"", szBuf, pszPath, _outputPath.c_str(), _initName.c_str());
+			command.AppendQuoted(L"-select", initName);
 		}
-		else
+		wcout << L"Invoking: " << command.GetCommandLine() << endl;
+	}
+
+	// Lets Files skip what the host can't take anyway, such as the files of a folder picker
+	command.Append(L"-enumerationmode", DialogOptions::Serialize(DialogOptions::GetEnumerationMode(_state.GetOptions())));
+
+	// Used by Files if complete by the time it lists the folder
+	if (!initFolder.empty())
+	{
+		command.AppendQuoted(L"-foldersnapshot", snapshotPath);
+	}
+
+	// Files narrows the listing to the selected type, the spec is sent precompiled
+	UINT fileTypeIndex = _state.GetFileTypeIndex();
+	if (fileTypeIndex >= 1 && fileTypeIndex <= _fileTypeFilters.size())
+	{
+		std::wstring fileTypes = _fileTypeFilters[fileTypeIndex - 1].Serialize();
+		if (!fileTypes.empty())
 		{
-			swprintf(args, _countof(args) - 1, L"\"%s\" -directory \"%s\" -outputpath \"%s\"", szBuf, pszPath, _outputPath.c_str());
+			command.AppendQuoted(L"-filetypes", fileTypes);
 		}
-		wcout << L"Invoking: " << args << endl;
-		CoTaskMemFree(pszPath);
 	}
-	else
+	if (_itemFilter)
 	{
-		swprintf(args, _countof(args) - 1, L"\"%s\" -outputpath \"%s\"", szBuf, _outputPath.c_str());
+		command.Append(L"-itemfilter", std::to_wstring(FilterQuery::MaxNames));
 	}
 
-	std::wstring uriWithArgs = L"files-dev:?cmd=" + str2wstr(wstring_to_utf8_hex(args));
-	ShExecInfo.lpFile = uriWithArgs.c_str();
-	ShExecInfo.nShow = SW_SHOW;
-	ShellExecuteEx(&ShExecInfo);
+	const std::wstring& commandLine = command.GetCommandLine();
+	std::wstring uriWithArgs = command.ToUri();
 
-	if (hwndOwner)
-		EnableWindow(hwndOwner, FALSE);
+	// The host's controls go ahead of Show in one message, encoded now so that changes made
+	// since the pre-activation are included. Without a session Files shows none.
+	std::string controls = _state.GetControls().IsEmpty() ? std::string() : _state.GetControls().Encode();
+	auto showViaSession = [&]()
+	{
+		return (controls.empty() || _session.Send(DialogMessageType::Controls, controls)) && _session.Show(commandLine);
+	};
 
-	MSG msg;
-	while (ShExecInfo.hProcess)
+	// A session Files has dropped since the last call is replaced once before falling
+	// back to the regular activation
+	bool viaSession = false;
+	auto activate = [&]() -> Task<bool>
 	{
-		switch (MsgWaitForMultipleObjectsEx(1, &closeEvent, INFINITE, QS_ALLINPUT, 0))
+		bool shown = co_await sessionReady && showViaSession();
+		if (!shown && reused)
 		{
-		case WAIT_OBJECT_0:
-			CloseHandle(ShExecInfo.hProcess);
-			ShExecInfo.hProcess = NULL;
-			break;
-		case WAIT_OBJECT_0 + 1:
-			while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+			_session.Close();
+			shown = StartSession() && co_await _session.WaitReadyAsync(executor, ackTimeout) && showViaSession();
+		}
+
+		if (shown)
+		{
+			co_return viaSession = true;
+		}
+
+		_session.Close();
+		co_return FilesActivation::Launch(uriWithArgs.c_str());
+	};
+
+	// Answers what Files asks and reports while the picker is open
+	auto serve = [&]() -> ServiceWait
+	{
+		ServiceWait wait;
+		if (!viaSession)
+		{
+			return wait;
+		}
+
+		bool open = _session.Serve([this](const DialogMessage& message)
+		{
+			switch (message.Type)
 			{
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
+			case DialogMessageType::FilterQuery:
+				AnswerFilterQuery(message.Payload);
+				break;
+			case DialogMessageType::FolderChanged:
+				_dialogEventQueue.Push(DialogEventKind::FolderChange, message.Payload);
+				break;
+			case DialogMessageType::SelectionChanged:
+				_dialogEventQueue.Push(DialogEventKind::SelectionChange, message.Payload);
+				break;
+			case DialogMessageType::ControlsChanged:
+				ApplyControlChanges(message.Payload);
+				break;
 			}
-			continue;
-		default: __debugbreak();
+		});
+
+		wait.Event = open ? _session.ReadEvent() : NULL;
+		wait.Timeout = RaiseDialogEvents();
+		return wait;
+	};
+
+	DWORD ackLatency = 0;
+	ActivationResult result = co_await FilesActivation::RunAsync(executor, channel, activate, serve, hwndOwner, ackTimeout, &ackLatency);
+
+	cout << "Show, activation: " << (int)result << ", via session: " << viaSession << ", acknowledged after: " << ackLatency << "ms" << endl;
+
+	if (result != ActivationResult::Completed)
+	{
+		// Don't reuse a session whose picker may still turn up
+		_session.Close();
+		DeleteFile(_outputPath.c_str());
+		if (result == ActivationResult::Cancelled)
+		{
+			co_return _closeResult;
 		}
+		if (settings.Mode == DialogMode::Hybrid)
+			co_return ShowSystemDialog(hwndOwner);
+
+		co_return HRESULT_FROM_WIN32(ERROR_CANCELLED);
 	}
 
-	if (closeEvent)
-		CloseHandle(closeEvent);
+	// Read off the host's thread, which keeps painting meanwhile
+	std::vector<std::wstring> results = co_await executor.Offload([outputPath = _outputPath]()
+	{
+		return ReadResults(outputPath);
+	});
+	std::wstring selectedItem;
+	if (!results.empty())
+	{
+		selectedItem = results.back();
+	}
 
-	if (hwndOwner)
+	// Files has closed its picker by now, a target the host can't save to fails Show()
+	// with the reason rather than looking like a cancel
+	HRESULT preflightResult = S_OK;
+	if (!selectedItem.empty())
 	{
-		EnableWindow(hwndOwner, TRUE);
-		SetForegroundWindow(hwndOwner);
+		// Checked off the host's thread. Storage that doesn't answer in time gets the
+		// benefit of the doubt, the host finds out when it writes.
+		SavePreflightOptions options = SavePreflightOptions::FromDialogOptions(_state.GetOptions());
+		auto storage = std::make_shared<Win32SaveStorage>();
+		auto report = co_await executor.OffloadFor([storage, target = selectedItem, options]()
+		{
+			return SavePreflight::Run(*storage, target, options);
+		}, std::chrono::milliseconds(settings.PreflightTimeout));
+
+		if (!report)
+		{
+			cout << "Show, preflight timed out after: " << settings.PreflightTimeout << "ms" << endl;
+			storage->Abandon();
+		}
+		else if (report->Status != SavePreflightStatus::Ready)
+		{
+			cout << "Show, preflight: " << (int)report->Status << ", error: " << report->Error << endl;
+			preflightResult = Win32SaveStorage::GetError(*report);
+			selectedItem.clear();
+		}
 	}
 
-	std::ifstream file(_outputPath);
-	if (file.good())
+	bool accepted = Apply({ DialogCallKind::Completed, 0, wstr2str(selectedItem) }).Value > 0;
+	if (accepted)
 	{
-		std::string str;
-		std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-		while (std::getline(file, str))
+		if (_dialogEvents)
 		{
-			std::wstring wide = converter.from_bytes(str);
-			_selectedItem = wide;
+			_dialogEvents->OnFileOk(this);
 		}
 	}
-	DeleteFile(_outputPath.c_str());
 
-	if (!_selectedItem.empty())
+	if (FAILED(preflightResult))
 	{
-		// Create destination file if not existing
-		HANDLE hFile = CreateFile(_selectedItem.c_str(), GENERIC_WRITE, 0, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
-		if (hFile != INVALID_HANDLE_VALUE)
+		co_return preflightResult;
+	}
+	co_return accepted ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+}
+
+// The folder set by the host, else the last one of this client, else the default folder
+Task<std::wstring> CFilesSaveDialog::GetStartFolderAsync(DialogExecutor& executor)
+{
+	std::wstring folder;
+	PWSTR pszPath = NULL;
+	if (_initFolder && SUCCEEDED(_initFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	{
+		folder = pszPath;
+		CoTaskMemFree(pszPath);
+		co_return folder;
+	}
+
+	// The last folder may be gone, or on a share that no longer answers
+	auto lastFolder = _folderHistory.Lookup(GetClientKey());
+	if (lastFolder)
+	{
+		auto exists = co_await executor.OffloadFor([path = *lastFolder]()
 		{
-			CloseHandle(hFile);
+			return FolderHistory::FolderExists(path);
+		}, std::chrono::milliseconds(FolderHistory::FolderCheckTimeout));
+
+		if (exists && *exists)
+		{
+			co_return *lastFolder;
 		}
-		else
+	}
+
+	CComPtr<IShellItem> defaultFolder = _defaultFolder;
+	if (!defaultFolder)
+	{
+		(void)SHGetKnownFolderItem(FOLDERID_Documents, KF_FLAG_DEFAULT_PATH, NULL, IID_PPV_ARGS(&defaultFolder));
+	}
+	if (defaultFolder && SUCCEEDED(defaultFolder->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
+	{
+		folder = pszPath;
+		CoTaskMemFree(pszPath);
+	}
+
+	co_return folder;
+}
+
+// Where the user ended up in Files, or else the folder of the saved item
+void CFilesSaveDialog::RememberFolder()
+{
+	std::wstring folder = str2wstr(_state.GetCurrentFolder());
+	if (folder.empty() && !_state.GetResults().empty())
+	{
+		folder = FolderHistory::GetParent(str2wstr(_state.GetResults().front()));
+	}
+
+	_folderHistory.Remember(GetClientKey(), folder);
+}
+
+std::string CFilesSaveDialog::GetClientKey()
+{
+	return FolderHistory::GetClientKey(_hasClientGuid ? &_clientGuid : NULL);
+}
+
+HRESULT CFilesSaveDialog::ShowSystemDialog(HWND hwndOwner)
+{
+	auto start = std::chrono::steady_clock::now();
+	_systemDialogWarmup.Wait();
+
+	CComPtr<IFileSaveDialog> systemDialog = GetSystemDialog();
+	if (!systemDialog)
+	{
+		return E_FAIL;
+	}
+
+	cout << "ShowSystemDialog, ready after: "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms" << endl;
+
+	SystemDialogForwarding::Forward(_state, systemDialog);
+	if (!_fileTypes.empty())
+	{
+		std::vector<COMDLG_FILTERSPEC> specs;
+		for (const auto& fileType : _fileTypes)
 		{
-			_selectedItem = L"";
+			specs.push_back({ fileType.first.c_str(), fileType.second.c_str() });
 		}
+		systemDialog->SetFileTypes((UINT)specs.size(), specs.data());
+		systemDialog->SetFileTypeIndex(_state.GetFileTypeIndex());
 	}
-	if (!_selectedItem.empty())
+	if (_itemFilter)
 	{
-		if (_dialogEvents)
+		systemDialog->SetFilter(_itemFilter);
+	}
+	if (_hasClientGuid)
+	{
+		systemDialog->SetClientGuid(_clientGuid);
+	}
+	if (_defaultFolder)
+	{
+		systemDialog->SetDefaultFolder(_defaultFolder);
+	}
+	if (_initFolder)
+	{
+		systemDialog->SetFolder(_initFolder);
+	}
+
+	// The host's handler gets the system dialog's events, so that OnFileOk can still keep
+	// it open
+	DWORD cookie = 0;
+	if (_dialogEvents && FAILED(systemDialog->Advise(_dialogEvents, &cookie)))
+	{
+		cookie = 0;
+	}
+
+	HRESULT hr = systemDialog->Show(hwndOwner);
+	cout << "ShowSystemDialog, hr: " << hr << endl;
+
+	if (cookie)
+	{
+		systemDialog->Unadvise(cookie);
+	}
+
+	// The host reads its controls from this dialog
+	if (SUCCEEDED(hr))
+	{
+		for (const DialogControlChange& change : SystemDialogForwarding::ReadControls(_state.GetControls(), systemDialog))
 		{
-			_dialogEvents->OnFileOk(this);
+			std::string encoded;
+			change.AppendTo(encoded);
+			Apply({ DialogCallKind::ControlChanged, 0, std::move(encoded) });
+		}
+	}
+
+	// The type the user ended on, as if the host had picked it
+	UINT fileTypeIndex = 0;
+	if (SUCCEEDED(hr) && SUCCEEDED(systemDialog->GetFileTypeIndex(&fileTypeIndex)))
+	{
+		Apply({ DialogCallKind::SetFileTypeIndex, fileTypeIndex });
+	}
+
+	CComPtr<IShellItem> result;
+	std::string selectedItem;
+	if (SUCCEEDED(hr) && SUCCEEDED(systemDialog->GetResult(&result)))
+	{
+		selectedItem = GetParsingName(result);
+	}
+
+	Apply({ DialogCallKind::Completed, 0, std::move(selectedItem) });
+	return hr;
+}
+
+// Runs the names Files is listing through the host's filter. Items the shell can't
+// resolve are listed, the filter has no say on them.
+void CFilesSaveDialog::AnswerFilterQuery(const std::string& payload)
+{
+	FilterQuery query;
+	if (!_itemFilter || !FilterQuery::Decode(payload, query))
+	{
+		return;
+	}
+
+	FilterVerdicts verdicts = _filterVerdicts.Evaluate(query, [this](const std::string& folder, const std::string& name)
+	{
+		std::wstring path = str2wstr(folder);
+		if (!path.empty() && path.back() != L'\\')
+		{
+			path += L'\\';
 		}
+		path += str2wstr(name);
+
+		CComPtr<IShellItem> item;
+		if (FAILED(SHCreateItemFromParsingName(path.c_str(), NULL, IID_PPV_ARGS(&item))))
+		{
+			return true;
+		}
+
+		return _itemFilter->IncludeItem(item) != S_FALSE;
+	});
+
+	cout << "AnswerFilterQuery, items: " << query.Names.size() << endl;
+	_session.Send(DialogMessageType::FilterVerdicts, verdicts.Encode());
+}
+
+// Applies what the user did to the host's controls in Files and raises it on the host.
+// Edit boxes raise nothing, the host reads them when it needs them.
+void CFilesSaveDialog::ApplyControlChanges(const std::string& payload)
+{
+	DialogControlChanges changes;
+	if (!DialogControlChanges::Decode(payload, changes))
+	{
+		return;
 	}
 
-	return !_selectedItem.empty() ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	CComQIPtr<IFileDialogControlEvents> controlEvents(_dialogEvents);
+	for (const DialogControlChange& change : changes.Changes)
+	{
+		std::string encoded;
+		change.AppendTo(encoded);
+		if (!Apply({ DialogCallKind::ControlChanged, 0, std::move(encoded) }).Succeeded)
+		{
+			continue;
+		}
+
+		cout << "ApplyControlChanges, kind: " << (int)change.Kind << ", control: " << change.Control << endl;
+		if (!controlEvents)
+		{
+			continue;
+		}
+
+		if (change.Kind == DialogControlChangeKind::ItemSelected)
+		{
+			controlEvents->OnItemSelected(this, change.Control, change.Value);
+		}
+		else if (change.Kind == DialogControlChangeKind::CheckToggled)
+		{
+			controlEvents->OnCheckButtonToggled(this, change.Control, change.Value != 0);
+		}
+		else if (change.Kind == DialogControlChangeKind::ButtonClicked)
+		{
+			controlEvents->OnButtonClicked(this, change.Control);
+		}
+	}
+}
+
+// Updates the picker state from the coalesced events and raises them on the host.
+// Returns how long until the next pending event is due.
+DWORD CFilesSaveDialog::RaiseDialogEvents()
+{
+	DialogEvent event;
+	while (_dialogEventQueue.Pop(DialogEventQueue::Clock::now(), event))
+	{
+		if (event.Kind == DialogEventKind::FolderChange)
+		{
+			Apply({ DialogCallKind::FolderChanged, 0, std::move(event.Payload) });
+		}
+		else
+		{
+			Apply({ DialogCallKind::SelectionChanged, 0, std::move(event.Payload) });
+		}
+
+		cout << "RaiseDialogEvents, kind: " << (int)event.Kind << ", selected: " << _state.GetCurrentSelection().size() << endl;
+
+		if (!_dialogEvents)
+		{
+			continue;
+		}
+
+		if (event.Kind == DialogEventKind::FolderChange)
+		{
+			_dialogEvents->OnFolderChange(this);
+		}
+		else
+		{
+			_dialogEvents->OnSelectionChange(this);
+		}
+	}
+
+	auto due = _dialogEventQueue.NextDue(DialogEventQueue::Clock::now());
+	return due ? (DWORD)due->count() : INFINITE;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetFileTypes(UINT cFileTypes, const COMDLG_FILTERSPEC* rgFilterSpec)
@@ -524,6 +1034,21 @@ HRESULT __stdcall CFilesSaveDialog::SetFileTypes(UINT cFileTypes, const COMDLG_F
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileTypes(cFileTypes, rgFilterSpec);
 #endif
+	if (cFileTypes && !rgFilterSpec)
+	{
+		return E_INVALIDARG;
+	}
+
+	_fileTypes.clear();
+	_fileTypeFilters.clear();
+	for (UINT i = 0; i < cFileTypes; i++)
+	{
+		_fileTypes.emplace_back(rgFilterSpec[i].pszName ? rgFilterSpec[i].pszName : L"", rgFilterSpec[i].pszSpec ? rgFilterSpec[i].pszSpec : L"");
+		_fileTypeFilters.push_back(FileTypeFilter::Compile(_fileTypes.back().second));
+	}
+
+	Apply({ DialogCallKind::SetFileTypes, cFileTypes });
+	PreActivate();
 	return S_OK;
 }
 
@@ -533,6 +1058,7 @@ HRESULT __stdcall CFilesSaveDialog::SetFileTypeIndex(UINT iFileType)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileTypeIndex(iFileType);
 #endif
+	Apply({ DialogCallKind::SetFileTypeIndex, iFileType });
 	return S_OK;
 }
 
@@ -542,7 +1068,7 @@ HRESULT __stdcall CFilesSaveDialog::GetFileTypeIndex(UINT* piFileType)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetFileTypeIndex(piFileType);
 #endif
-	* piFileType = 1;
+	*piFileType = Apply({ DialogCallKind::GetFileTypeIndex }).Value;
 	return S_OK;
 }
 
@@ -552,8 +1078,9 @@ HRESULT __stdcall CFilesSaveDialog::Advise(IFileDialogEvents* pfde, DWORD* pdwCo
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Advise(pfde, pdwCookie);
 #endif
+	PreActivate();
 	_dialogEvents = pfde;
-	*pdwCookie = 4;
+	*pdwCookie = Apply({ DialogCallKind::Advise }).Value;
 	return S_OK;
 }
 
@@ -563,6 +1090,7 @@ HRESULT __stdcall CFilesSaveDialog::Unadvise(DWORD dwCookie)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Unadvise(dwCookie);
 #endif
+	Apply({ DialogCallKind::Unadvise, dwCookie });
 	_dialogEvents.Release();
 	return S_OK;
 }
@@ -573,47 +1101,44 @@ HRESULT __stdcall CFilesSaveDialog::SetOptions(FILEOPENDIALOGOPTIONS fos)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetOptions(fos);
 #endif
-	_fos = fos;
+	PreActivate();
+	Apply({ DialogCallKind::SetOptions, (std::uint32_t)fos });
 	return S_OK;
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetOptions(FILEOPENDIALOGOPTIONS* pfos)
 {
-	cout << "GetOptions, fos: " << _fos << endl;
+	cout << "GetOptions, fos: " << _state.GetOptions() << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetOptions(pfos);
 #endif
-	* pfos = _fos;
+	* pfos = Apply({ DialogCallKind::GetOptions }).Value;
 	return S_OK;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetDefaultFolder(IShellItem* psi)
 {
-	PWSTR pszPath = NULL;
-	if (SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
-	{
-		wcout << L"SetDefaultFolder, psi: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
-	}
+	std::string name = GetParsingName(psi);
+	cout << "SetDefaultFolder, psi: " << name << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetDefaultFolder(psi);
 #endif
-	_initFolder = psi;
+	PreActivate();
+	_defaultFolder = psi;
+	Apply({ DialogCallKind::SetDefaultFolder, psi != NULL, std::move(name) });
 	return S_OK;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetFolder(IShellItem* psi)
 {
-	PWSTR pszPath = NULL;
-	if (SUCCEEDED(psi->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &pszPath)))
-	{
-		wcout << L"SetFolder, psi: " << pszPath << endl;
-		CoTaskMemFree(pszPath);
-	}
+	std::string name = GetParsingName(psi);
+	cout << "SetFolder, psi: " << name << endl;
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFolder(psi);
 #endif
+	PreActivate();
 	_initFolder = psi;
+	Apply({ DialogCallKind::SetFolder, psi != NULL, std::move(name) });
 	return S_OK;
 }
 
@@ -624,6 +1149,16 @@ HRESULT __stdcall CFilesSaveDialog::GetFolder(IShellItem** ppsi)
 	return _systemDialog->GetFolder(ppsi);
 #endif
 	* ppsi = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetFolder });
+	switch ((DialogFolderSource)reply.Value)
+	{
+	case DialogFolderSource::Current:
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_PPV_ARGS(ppsi));
+	case DialogFolderSource::Folder:
+		return _initFolder ? _initFolder.CopyTo(ppsi) : E_NOTIMPL;
+	case DialogFolderSource::Default:
+		return _defaultFolder ? _defaultFolder.CopyTo(ppsi) : E_NOTIMPL;
+	}
 	return E_NOTIMPL;
 }
 
@@ -633,7 +1168,13 @@ HRESULT __stdcall CFilesSaveDialog::GetCurrentSelection(IShellItem** ppsi)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetCurrentSelection(ppsi);
 #endif
-	return GetResult(ppsi);
+	*ppsi = NULL;
+	DialogReply reply = Apply({ DialogCallKind::GetCurrentSelection });
+	if (reply.Succeeded)
+	{
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_PPV_ARGS(ppsi));
+	}
+	return E_NOTIMPL;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetFileName(LPCWSTR pszName)
@@ -642,8 +1183,8 @@ HRESULT __stdcall CFilesSaveDialog::SetFileName(LPCWSTR pszName)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileName(pszName);
 #endif
-	std::wstring absPath = std::wstring(pszName);
-	_initName = absPath.substr(absPath.find_last_of(L"/\\") + 1);
+	PreActivate();
+	Apply({ DialogCallKind::SetFileName, 0, wstr2str(pszName) });
 	return S_OK;
 }
 
@@ -653,7 +1194,7 @@ HRESULT __stdcall CFilesSaveDialog::GetFileName(LPWSTR* pszName)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetFileName(pszName);
 #endif
-	return SHStrDupW(_selectedItem.empty() ? L"" : _selectedItem.c_str(), pszName);
+	return SHStrDupW(str2wstr(std::string(Apply({ DialogCallKind::GetFileName }).Text)).c_str(), pszName);
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetTitle(LPCWSTR pszTitle)
@@ -662,6 +1203,8 @@ HRESULT __stdcall CFilesSaveDialog::SetTitle(LPCWSTR pszTitle)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetTitle(pszTitle);
 #endif
+	PreActivate();
+	Apply({ DialogCallKind::SetTitle, 0, wstr2str(pszTitle) });
 	return S_OK;
 }
 
@@ -671,6 +1214,7 @@ HRESULT __stdcall CFilesSaveDialog::SetOkButtonLabel(LPCWSTR pszText)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetOkButtonLabel(pszText);
 #endif
+	Apply({ DialogCallKind::SetOkButtonLabel, 0, wstr2str(pszText) });
 	return S_OK;
 }
 
@@ -680,6 +1224,7 @@ HRESULT __stdcall CFilesSaveDialog::SetFileNameLabel(LPCWSTR pszLabel)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFileNameLabel(pszLabel);
 #endif
+	Apply({ DialogCallKind::SetFileNameLabel, 0, wstr2str(pszLabel) });
 	return S_OK;
 }
 
@@ -690,8 +1235,11 @@ HRESULT __stdcall CFilesSaveDialog::GetResult(IShellItem** ppsi)
 	return _systemDialog->GetResult(ppsi);
 #endif
 	*ppsi = NULL;
-	if (!_selectedItem.empty())
-		return SHCreateItemFromParsingName(_selectedItem.c_str(), NULL, IID_IShellItem, (void**)ppsi);
+	DialogReply reply = Apply({ DialogCallKind::GetResult });
+	if (reply.Succeeded)
+	{
+		return SHCreateItemFromParsingName(str2wstr(std::string(reply.Text)).c_str(), NULL, IID_IShellItem, (void**)ppsi);
+	}
 	return E_NOTIMPL;
 }
 
@@ -715,6 +1263,7 @@ HRESULT __stdcall CFilesSaveDialog::SetDefaultExtension(LPCWSTR pszDefaultExtens
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetDefaultExtension(pszDefaultExtension);
 #endif
+	Apply({ DialogCallKind::SetDefaultExtension, 0, wstr2str(pszDefaultExtension) });
 	return S_OK;
 }
 
@@ -724,7 +1273,16 @@ HRESULT __stdcall CFilesSaveDialog::Close(HRESULT hr)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->Close(hr);
 #endif
-	return E_NOTIMPL;
+	// Called by the host from one of its event handlers while Show() waits on Files
+	Apply({ DialogCallKind::Close, (std::uint32_t)hr });
+	if (!_executor)
+	{
+		return E_UNEXPECTED;
+	}
+
+	_closeResult = hr;
+	_executor->Cancel();
+	return S_OK;
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetClientGuid(REFGUID guid)
@@ -733,6 +1291,9 @@ HRESULT __stdcall CFilesSaveDialog::SetClientGuid(REFGUID guid)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetClientGuid(guid);
 #endif
+	_clientGuid = guid;
+	_hasClientGuid = true;
+	Apply({ DialogCallKind::SetClientGuid, 1 });
 	return S_OK;
 }
 
@@ -742,6 +1303,8 @@ HRESULT __stdcall CFilesSaveDialog::ClearClientData(void)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->ClearClientData();
 #endif
+	Apply({ DialogCallKind::ClearClientData });
+	_folderHistory.Forget(GetClientKey());
 	return S_OK;
 }
 
@@ -751,6 +1314,10 @@ HRESULT __stdcall CFilesSaveDialog::SetFilter(IShellItemFilter* pFilter)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetFilter(pFilter);
 #endif
+	_itemFilter = pFilter;
+	_filterVerdicts.Clear();
+	Apply({ DialogCallKind::SetFilter, pFilter != NULL });
+	PreActivate();
 	return S_OK;
 }
 
@@ -1045,13 +1612,18 @@ HRESULT __stdcall CFilesSaveDialog::SetSaveAsItem(IShellItem* psi)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetSaveAsItem(psi);
 #endif
+	PreActivate();
 	_initFolder.Release();
 	psi->GetParent(&_initFolder);
+
+	// The name as the user sees it, which the picker starts with
+	std::string item = GetParsingName(_initFolder) + '\\';
 	if (SUCCEEDED(psi->GetDisplayName(SIGDN_NORMALDISPLAY, &pszPath)))
 	{
-		_initName = pszPath;
+		item += wstr2str(pszPath);
 		CoTaskMemFree(pszPath);
 	}
+	Apply({ DialogCallKind::SetSaveAsItem, _initFolder != NULL, std::move(item) });
 	return S_OK;
 }
 
@@ -1061,7 +1633,7 @@ HRESULT __stdcall CFilesSaveDialog::SetProperties(IPropertyStore* pStore)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetProperties(pStore);
 #endif
-	return S_OK;
+	return _properties.SetDefaults(pStore);
 }
 
 HRESULT __stdcall CFilesSaveDialog::SetCollectedProperties(IPropertyDescriptionList* pList, BOOL fAppendDefault)
@@ -1070,6 +1642,8 @@ HRESULT __stdcall CFilesSaveDialog::SetCollectedProperties(IPropertyDescriptionL
 #ifdef SYSTEMDIALOG
 	return _systemDialog->SetCollectedProperties(pList, fAppendDefault);
 #endif
+	// Files has no property pane, so there is nothing to append
+	_properties.SetCollected(pList);
 	return S_OK;
 }
 
@@ -1079,11 +1653,11 @@ HRESULT __stdcall CFilesSaveDialog::GetProperties(IPropertyStore** ppStore)
 #ifdef SYSTEMDIALOG
 	return _systemDialog->GetProperties(ppStore);
 #endif
-	if (!_selectedItem.empty())
+	if (!_state.GetResults().empty())
 	{
-		return SHGetPropertyStoreFromParsingName(_selectedItem.c_str(),
-			NULL, GPS_DEFAULT, __uuidof(IPropertyStore), (void**)ppStore);
+		return _properties.Get(ppStore, str2wstr(_state.GetResults().front()));
 	}
+	*ppStore = NULL;
 	return E_NOTIMPL;
 }
 
@@ -1093,7 +1667,8 @@ HRESULT __stdcall CFilesSaveDialog::ApplyProperties(IShellItem* psi, IPropertySt
 #ifdef SYSTEMDIALOG
 	return _systemDialog->ApplyProperties(psi, pStore, hwnd, pSink);
 #endif
-	return S_OK;
+	// Written directly rather than through the copy engine, there is no progress to show
+	return SavePropertyCache::Apply(psi, pStore);
 }
 
 HRESULT __stdcall CFilesSaveDialog::GetWindow(HWND* phwnd)
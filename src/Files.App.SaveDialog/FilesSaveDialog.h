@@ -4,12 +4,26 @@
 #include "resource.h"       // simboli principali
 
 
+#ifndef LEANDIALOG
 #define DEBUGLOG
+#endif
 
 
 #include "CustomSaveDialog_i.h"
 #include "UndefInterfaces.h"
-#include <iostream>
+#include "Windows/DialogLog.h"
+#include "DialogEventQueue.h"
+#include "DialogResults.h"
+#include "DialogState.h"
+#include "FileTypeFilter.h"
+#include "ItemFilterProtocol.h"
+#include "Windows/DialogRecorder.h"
+#include "Windows/DialogSession.h"
+#include "Windows/FolderHistory.h"
+#include "Windows/FolderPrefetch.h"
+#include "Windows/SavePropertyCache.h"
+#include "Windows/SystemDialogForwarding.h"
+#include "Windows/SystemDialogWarmup.h"
 #include <string>
 #include <vector>
 
@@ -60,18 +74,61 @@ END_COM_MAP()
 
 	CComPtr<IFileSaveDialog> _systemDialog;
 
-	FILEOPENDIALOGOPTIONS _fos;
+	// Options, folders, file name, file types and result, as the host and Files set them
+	Files::Native::DialogState _state{ Files::Native::DialogKind::Save };
+	Files::Native::DialogRecorder _recorder{ Files::Native::DialogKind::Save };
 
-	std::vector<DWORD> _ctrlItems;
+	// What Show() ended with
+	Files::Native::DialogResults _results;
 
-	std::wstring _selectedItem;
 	std::wstring _outputPath;
-	std::wstring _initName;
 	CComPtr<IShellItem> _initFolder;
+	CComPtr<IShellItem> _defaultFolder;
 	CComPtr<IFileDialogEvents> _dialogEvents;
 
+	// Where Show() starts when the host doesn't say, per SetClientGuid
+	GUID _clientGuid;
+	bool _hasClientGuid;
+	Files::Native::FolderHistory _folderHistory;
+
+	// Copied from SetFileTypes, the host may free its strings as soon as the call returns
+	std::vector<std::pair<std::wstring, std::wstring>> _fileTypes;
+	std::vector<Files::Native::FileTypeFilter> _fileTypeFilters;
+
+	CComPtr<IShellItemFilter> _itemFilter;
+	Files::Native::FilterVerdictCache _filterVerdicts;
+
+	Files::Native::SavePropertyCache _properties;
+
+	// Folder and selection changes reported by Files while Show() runs
+	Files::Native::DialogEventQueue _dialogEventQueue;
+
+	Files::Native::SystemDialogWarmup _systemDialogWarmup;
+	Files::Native::FolderPrefetch _folderPrefetch;
+	Files::Native::DialogSession _session;
+
+	// Set while Show() runs, Close() cancels it
+	Files::Native::DialogExecutor* _executor;
+	HRESULT _closeResult;
+	bool _preActivated;
+
 	FILE* _debugStream;
 
+	void OpenDebugLog();
+	bool EnsureOutputPath();
+	void PreActivate();
+	bool StartSession();
+	Files::Native::DialogReply Apply(Files::Native::DialogCall call);
+	HRESULT ApplyControl(Files::Native::DialogCall call);
+	Files::Native::Task<HRESULT> ShowAsync(Files::Native::DialogExecutor& executor, HWND hwndOwner);
+	Files::Native::Task<std::wstring> GetStartFolderAsync(Files::Native::DialogExecutor& executor);
+	void RememberFolder();
+	std::string GetClientKey();
+	HRESULT ShowSystemDialog(HWND hwndOwner);
+	void AnswerFilterQuery(const std::string& payload);
+	void ApplyControlChanges(const std::string& payload);
+	DWORD RaiseDialogEvents();
+
 public:
 	// Ereditato tramite IObjectWithSite
 	HRESULT __stdcall SetSite(IUnknown* pUnkSite) override;
@@ -39,7 +39,7 @@ using namespace ATL;
 		HRESULT res = this->InternalQueryInterface(this, _GetEntries(), iid, ppvObject); \
 		OLECHAR* guidString; \
 		(void)StringFromCLSID(iid, &guidString); \
-		std::wcout << L"QueryInterface: " << guidString << L" = " << res << std::endl; \
+		Files::Native::DialogLog::wcout << L"QueryInterface: " << guidString << L" = " << res << Files::Native::DialogLog::endl; \
 		::CoTaskMemFree(guidString); \
 		return res; \
 	} \
@@ -26,6 +26,9 @@ namespace Files.App
 
 		public static TaskCompletionSource? SplashScreenLoadingTCS { get; private set; }
 		public static string? OutputPath { get; set; }
+		public static string? OutputChannel { get; set; }
+		public static DialogFileTypeFilter? OutputFileTypes { get; set; }
+		public static DialogEnumerationMode OutputEnumerationMode { get; set; }
 
 		private bool _isMainWindowClosing;
 		private static FlyoutBase? _LastOpenedFlyout;
@@ -130,10 +133,13 @@ namespace Files.App
 				var appActivationArguments = Microsoft.Windows.AppLifecycle.AppInstance.GetCurrent().GetActivatedEventArgs();
 				var isStartupTask = appActivationArguments.Data is Windows.ApplicationModel.Activation.IStartupTaskActivatedEventArgs;
 
+				// Instances pre-activated by a file dialog stay hidden until the dialog is shown
+				var dialogSessionName = Program.DialogSessionName;
+
 				// IsDynamicCodeSupported is false on Native AOT, where startup is fast enough to skip the splash screen
 				var showSplashScreen = System.Runtime.CompilerServices.RuntimeFeature.IsDynamicCodeSupported;
 
-				if (!isStartupTask)
+				if (!isStartupTask && dialogSessionName is null)
 				{
 					// Initialize and activate MainWindow
 					MainWindow.Instance.Activate();
@@ -192,7 +198,15 @@ namespace Files.App
 
 				Logger.LogInformation($"App launched. Launch args type: {appActivationArguments.Data.GetType().Name}");
 
-				if (!(isStartupTask && isLeaveAppRunning))
+				// Instances serving a file dialog leave launcher requests to the others
+				if (dialogSessionName is null)
+					LaunchRequestHelper.Start();
+
+				if (dialogSessionName is not null)
+				{
+					_ = ServeDialogSessionAsync(dialogSessionName);
+				}
+				else if (!(isStartupTask && isLeaveAppRunning))
 				{
 					if (SplashScreenLoadingTCS is not null)
 					{
@@ -244,11 +258,48 @@ namespace Files.App
 
 			Logger.LogInformation($"The app is being activated. Activation type: {activatedEventArgsData?.GetType().Name ?? "Unknown"}");
 
+			// A file dialog pre-activated the cached instance
+			if (Program.GetDialogSessionName(activatedEventArgs) is string dialogSessionName)
+			{
+				await MainWindow.Instance.DispatcherQueue.EnqueueOrInvokeAsync(() => ServeDialogSessionAsync(dialogSessionName));
+				return;
+			}
+
 			// InitializeApplication accesses UI, needs to be called on UI thread
 			await MainWindow.Instance.DispatcherQueue.EnqueueOrInvokeAsync(()
 				=> MainWindow.Instance.InitializeApplicationAsync(activatedEventArgsData));
 		}
 
+		/// <summary>
+		/// Serves the file dialog session this instance was activated for.
+		/// </summary>
+		/// <remarks>
+		/// The window is shown each time the dialog asks for the picker and hidden in between. Once the
+		/// dialog is released, the window is closed unless it is on screen, so the usual lifecycle either
+		/// caches or ends this instance.
+		/// </remarks>
+		private static async Task ServeDialogSessionAsync(string sessionName)
+		{
+			await DialogSessionHelper.RunAsync(sessionName, MainWindow.Instance.InitializeFromDialogSessionAsync);
+			if (MainWindow.Instance.AppWindow is { IsVisible: false })
+				MainWindow.Instance.Close();
+		}
+
+		/// <summary>
+		/// Forgets the picker of the file dialog this instance was last activated for.
+		/// </summary>
+		public static void ClearDialogOutput()
+		{
+			DialogSessionHelper.StopWatchingCancellation();
+			OutputPath = null;
+			OutputChannel = null;
+			OutputFileTypes = null;
+			OutputEnumerationMode = DialogEnumerationMode.None;
+			DialogSessionHelper.ItemFilterBatchSize = 0;
+			DialogSessionHelper.Controls = null;
+			DialogFolderSnapshot.PendingPath = null;
+		}
+
 		/// <summary>
 		/// Gets invoked when the main window is activated.
 		/// </summary>
@@ -313,18 +364,35 @@ namespace Files.App
 			{
 				var instance = MainPageViewModel.AppInstances.FirstOrDefault(x =>
 					(x.TabItemContent ?? throw new InvalidOperationException("A tab does not have content.")).IsCurrentInstance);
-				if (instance is null)
-					return;
 
-				var items = (instance.TabItemContent as ShellPanesPage)?.ActivePane?.SlimContentPage?.SelectedItems;
-				if (items is null)
-					return;
+				// Without a tab or a selection the dialog is still answered, with nothing picked
+				var items = (instance?.TabItemContent as ShellPanesPage)?.ActivePane?.SlimContentPage?.SelectedItems ?? [];
 
-				var results = items.Select(x => x.ItemPath!).ToList();
+				var mode = OutputEnumerationMode;
+				var results = items
+					.Where(x => !mode.HasFlag(DialogEnumerationMode.FoldersOnly) || x.PrimaryItemAttribute == StorageItemTypes.Folder)
+					.Where(x => !mode.HasFlag(DialogEnumerationMode.FileSystemOnly) || SystemIO.Path.IsPathFullyQualified(x.ItemPath))
+					.Select(x => !mode.HasFlag(DialogEnumerationMode.NoDereferenceLinks) && x is ShortcutItem { IsUrl: false, TargetPath: { Length: > 0 } targetPath } ? targetPath : x.ItemPath!)
+					.Take(mode.HasFlag(DialogEnumerationMode.SingleSelect) ? 1 : int.MaxValue)
+					.ToList();
 				System.IO.File.WriteAllLines(OutputPath, results);
 
-				using var eventHandle = PInvoke.CreateEvent(null, false, false, "FILEDIALOG");
+				using var eventHandle = PInvoke.CreateEvent(null, false, false, DialogSessionHelper.GetCompletionEventName(OutputChannel));
 				PInvoke.SetEvent(eventHandle);
+
+				// Each picker gets its own output path, don't answer a dialog twice
+				ClearDialogOutput();
+			}
+
+			// Keep the window for the next Show() of the file dialog this instance serves
+			if (DialogSessionHelper.IsActive)
+			{
+				args.Handled = true;
+
+				UIHelpers.CloseAllDialogs();
+				MainWindow.Instance.AppWindow.Hide();
+				AppModel.IsMainWindowClosed = true;
+				return;
 			}
 
 			// Continue running the app on the background
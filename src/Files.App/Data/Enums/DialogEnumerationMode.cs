@@ -0,0 +1,40 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+namespace Files.App.Data.Enums
+{
+	/// <summary>
+	/// Represents what the file dialog this instance serves lets the user pick, derived from its FILEOPENDIALOGOPTIONS.
+	/// </summary>
+	/// <remarks>
+	/// Keep in sync with EnumerationMode in Files.Native.Core.
+	/// </remarks>
+	[Flags]
+	public enum DialogEnumerationMode
+	{
+		/// <summary>
+		/// No restriction
+		/// </summary>
+		None = 0,
+
+		/// <summary>
+		/// Only folders can be picked, files are not listed
+		/// </summary>
+		FoldersOnly = 1,
+
+		/// <summary>
+		/// Only items with a file system path can be picked
+		/// </summary>
+		FileSystemOnly = 2,
+
+		/// <summary>
+		/// A single item is returned
+		/// </summary>
+		SingleSelect = 4,
+
+		/// <summary>
+		/// Shortcuts are returned as such rather than their targets
+		/// </summary>
+		NoDereferenceLinks = 8,
+	}
+}
@@ -41,6 +41,36 @@ namespace Files.App.Data.Enums
 		/// <summary>
 		/// Tag files command type
 		/// </summary>
-		TagFiles
+		TagFiles,
+
+		/// <summary>
+		/// File dialog session command type
+		/// </summary>
+		DialogSession,
+
+		/// <summary>
+		/// File dialog result channel command type
+		/// </summary>
+		DialogChannel,
+
+		/// <summary>
+		/// File dialog file type filter command type
+		/// </summary>
+		FileTypes,
+
+		/// <summary>
+		/// File dialog host item filter command type
+		/// </summary>
+		ItemFilter,
+
+		/// <summary>
+		/// File dialog enumeration mode command type
+		/// </summary>
+		EnumerationMode,
+
+		/// <summary>
+		/// File dialog folder snapshot command type
+		/// </summary>
+		FolderSnapshot
 	}
 }
@@ -0,0 +1,178 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+using System.IO;
+using System.Text;
+
+namespace Files.App.Helpers
+{
+	/// <summary>
+	/// Kinds of the controls a dialog's host adds through IFileDialogCustomize.
+	/// </summary>
+	public enum DialogControlKind : byte
+	{
+		PushButton,
+		Menu,
+		ComboBox,
+		RadioButtonList,
+		CheckButton,
+		EditBox,
+		Separator,
+		Text,
+		VisualGroup,
+		OpenDropDown,
+	}
+
+	/// <summary>
+	/// What the user did to a control, reported back to the dialog.
+	/// </summary>
+	public enum DialogControlChangeKind : byte
+	{
+		ItemSelected,
+		CheckToggled,
+		ButtonClicked,
+		TextChanged,
+	}
+
+	public sealed record DialogControlItem(uint Id, string Label, bool IsEnabled, bool IsVisible);
+
+	/// <param name="Label">The label, or the text of a text control.</param>
+	/// <param name="Text">The text of an edit box.</param>
+	/// <param name="Group">The visual group the control was added in, if any.</param>
+	public sealed record DialogControl(
+		uint Id,
+		DialogControlKind Kind,
+		string Label,
+		string Text,
+		bool IsEnabled,
+		bool IsVisible,
+		bool IsChecked,
+		bool IsProminent,
+		uint? SelectedItem,
+		DialogControl? Group,
+		IReadOnlyList<DialogControlItem> Items);
+
+	/// <summary>
+	/// The controls of the dialog that launched this instance, sent in one message before the picker is shown.
+	/// </summary>
+	/// <remarks>
+	/// Keep in sync with DialogControls in Files.Native.Core.
+	/// </remarks>
+	public static class DialogControlSnapshot
+	{
+		private const int ControlRecordSize = 32;
+		private const int ItemRecordSize = 20;
+		private const uint MaxControls = 1024;
+		private const uint MaxItems = 8192;
+
+		// CDCS_* values
+		private const byte Enabled = 0x1;
+		private const byte Visible = 0x2;
+
+		/// <summary>
+		/// Parses the payload of a Controls message.
+		/// </summary>
+		/// <returns>The controls in the order the host added them, or null when the payload is damaged.</returns>
+		public static IReadOnlyList<DialogControl>? Parse(byte[] payload)
+		{
+			try
+			{
+				using var reader = new BinaryReader(new MemoryStream(payload));
+				var controlCount = reader.ReadUInt32();
+				var itemCount = reader.ReadUInt32();
+				var stringSize = reader.ReadUInt32();
+				if (controlCount > MaxControls || itemCount > MaxItems ||
+					payload.Length - 12 != controlCount * ControlRecordSize + itemCount * ItemRecordSize + stringSize)
+					return null;
+
+				var stringOffset = payload.Length - (int)stringSize;
+				string ReadString()
+				{
+					var offset = reader.ReadUInt32();
+					var size = reader.ReadUInt32();
+					if (offset > stringSize || stringSize - offset < size)
+						throw new InvalidDataException();
+
+					return Encoding.UTF8.GetString(payload, stringOffset + (int)offset, (int)size);
+				}
+
+				var records = new (uint Id, DialogControlKind Kind, byte State, byte Flags, uint Group, string Label, string Text, uint SelectedItem)[controlCount];
+				for (var i = 0; i < controlCount; i++)
+				{
+					var id = reader.ReadUInt32();
+					var kind = reader.ReadByte();
+					var state = reader.ReadByte();
+					var flags = reader.ReadByte();
+					reader.ReadByte();
+					var group = reader.ReadUInt32();
+
+					// Groups come before what they hold
+					if (kind > (byte)DialogControlKind.OpenDropDown || group > i ||
+						(group > 0 && records[group - 1].Kind is not DialogControlKind.VisualGroup))
+						return null;
+
+					records[i] = (id, (DialogControlKind)kind, state, flags, group, ReadString(), ReadString(), reader.ReadUInt32());
+				}
+
+				var items = new List<DialogControlItem>[controlCount];
+				for (var i = 0; i < itemCount; i++)
+				{
+					var control = reader.ReadUInt32();
+					var id = reader.ReadUInt32();
+					var state = reader.ReadByte();
+					reader.ReadBytes(3);
+					if (control >= controlCount)
+						return null;
+
+					(items[control] ??= []).Add(new(id, ReadString(), (state & Enabled) != 0, (state & Visible) != 0));
+				}
+
+				var controls = new DialogControl[controlCount];
+				for (var i = 0; i < controlCount; i++)
+				{
+					var record = records[i];
+					controls[i] = new(
+						record.Id,
+						record.Kind,
+						record.Label,
+						record.Text,
+						(record.State & Enabled) != 0,
+						(record.State & Visible) != 0,
+						(record.Flags & 1) != 0,
+						(record.Flags & 2) != 0,
+						(record.Flags & 4) != 0 ? record.SelectedItem : null,
+						record.Group > 0 ? controls[record.Group - 1] : null,
+						(IReadOnlyList<DialogControlItem>?)items[i] ?? []);
+				}
+
+				return controls;
+			}
+			catch (Exception ex) when (ex is EndOfStreamException or InvalidDataException or ArgumentException)
+			{
+				return null;
+			}
+		}
+
+		/// <summary>
+		/// Encodes changes as the payload of a ControlsChanged message.
+		/// </summary>
+		public static byte[] EncodeChanges(IReadOnlyList<(DialogControlChangeKind Kind, uint Control, uint Value, string Text)> changes)
+		{
+			using var stream = new MemoryStream();
+			using var writer = new BinaryWriter(stream);
+			writer.Write((uint)changes.Count);
+			foreach (var change in changes)
+			{
+				var text = Encoding.UTF8.GetBytes(change.Text);
+				writer.Write((byte)change.Kind);
+				writer.Write(change.Control);
+				writer.Write(change.Value);
+				writer.Write((uint)text.Length);
+				writer.Write(text);
+			}
+
+			writer.Flush();
+			return stream.ToArray();
+		}
+	}
+}
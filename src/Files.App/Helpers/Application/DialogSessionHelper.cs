@@ -0,0 +1,378 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+using Microsoft.Extensions.Logging;
+using System.Buffers.Binary;
+using System.Collections.Concurrent;
+using System.Diagnostics.CodeAnalysis;
+using System.IO;
+using System.IO.Pipes;
+using System.Text;
+
+namespace Files.App.Helpers
+{
+	/// <summary>
+	/// Serves a file dialog session. The open and save dialogs start Files in the background
+	/// as soon as the host configures them, and hand over the picker parameters through
+	/// a named pipe once the host calls Show().
+	/// </summary>
+	public static class DialogSessionHelper
+	{
+		// Keep in sync with DialogMessageType in Files.Native.Core
+		private enum MessageType : byte
+		{
+			Hello = 1,
+			Show = 2,
+			Close = 3,
+			FilterQuery = 4,
+			FilterVerdicts = 5,
+			FolderChanged = 6,
+			SelectionChanged = 7,
+			Controls = 8,
+			ControlsChanged = 9,
+		}
+
+		private const int HeaderSize = 5;
+		private const int MaxPayloadSize = 1024 * 1024;
+		private const int ConnectTimeout = 5000;
+
+		// The dialog answers on the host's thread, which may be busy for a moment
+		private const int FilterTimeout = 3000;
+
+		// Hosts read the selection item by item, more than this is of no use to them
+		// and would not fit in a message
+		private const int MaxReportedSelection = 1000;
+
+		private static readonly SemaphoreSlim _writeLock = new(1, 1);
+		private static readonly ConcurrentDictionary<uint, TaskCompletionSource<byte[]?>> _pendingFilterQueries = new();
+		private static Stream? _pipe;
+		private static uint _lastFilterQueryId;
+		private static int _selectionChangePending;
+		private static EventWaitHandle? _cancelEvent;
+		private static RegisteredWaitHandle? _cancelWait;
+
+		/// <summary>
+		/// Gets whether this instance is attached to a file dialog. The window is then hidden
+		/// rather than closed, so that the dialog can show it again.
+		/// </summary>
+		public static bool IsActive { get; private set; }
+
+		/// <summary>
+		/// Gets or sets the largest batch of names the dialog's host filter takes at once,
+		/// as passed with -itemfilter, or 0 when the host set no filter.
+		/// </summary>
+		public static int ItemFilterBatchSize { get; set; }
+
+		/// <summary>
+		/// Gets or sets the controls the dialog's host added through IFileDialogCustomize, sent
+		/// with the picker, or null when it added none.
+		/// </summary>
+		public static IReadOnlyList<DialogControl>? Controls { get; set; }
+
+		/// <summary>
+		/// Gets the name of the event signalled once the picker is closed and its results are written.
+		/// </summary>
+		/// <param name="channel">The result channel passed by the dialog with -dialogchannel, if any.</param>
+		public static string GetCompletionEventName(string? channel)
+			=> IsValidChannel(channel) ? $"FILEDIALOG_{channel}" : "FILEDIALOG";
+
+		/// <summary>
+		/// Gets the name of the event signalled as soon as the picker activation is received.
+		/// </summary>
+		/// <param name="channel">The result channel passed by the dialog with -dialogchannel, if any.</param>
+		public static string GetAckEventName(string? channel)
+			=> IsValidChannel(channel) ? $"FILEDIALOG_ACK_{channel}" : "FILEDIALOG_ACK";
+
+		/// <summary>
+		/// Watches the dialog's result channel for the dialog giving up on the picker, because Files didn't
+		/// acknowledge it in time or the host closed the dialog.
+		/// </summary>
+		/// <param name="channel">The result channel passed by the dialog with -dialogchannel, if any.</param>
+		/// <param name="cancelled">Called on a thread pool thread once the dialog gives up.</param>
+		/// <returns>False when the dialog already gave up, the picker is then not to be shown.</returns>
+		public static bool WatchCancellation(string? channel, Action cancelled)
+		{
+			StopWatchingCancellation();
+
+			// Dialogs without a channel never give up
+			if (!IsValidChannel(channel))
+				return true;
+
+			// The event goes away with the dialog's handle, an activation that comes late finds none
+			if (!EventWaitHandle.TryOpenExisting($"FILEDIALOG_CANCEL_{channel}", out var cancelEvent))
+				return false;
+
+			if (cancelEvent.WaitOne(0))
+			{
+				cancelEvent.Dispose();
+				return false;
+			}
+
+			_cancelEvent = cancelEvent;
+			_cancelWait = ThreadPool.RegisterWaitForSingleObject(cancelEvent, (_, _) => cancelled(), null, Timeout.Infinite, true);
+			return true;
+		}
+
+		/// <summary>
+		/// Stops watching the result channel, once the picker has answered the dialog.
+		/// </summary>
+		public static void StopWatchingCancellation()
+		{
+			_cancelWait?.Unregister(null);
+			_cancelWait = null;
+			_cancelEvent?.Dispose();
+			_cancelEvent = null;
+		}
+
+		// Channels are "<process id>_<counter>", anything else must not end up in a kernel object name
+		private static bool IsValidChannel([NotNullWhen(true)] string? channel)
+			=> !string.IsNullOrEmpty(channel) && channel.Length <= 32 && channel.All(c => char.IsAsciiDigit(c) || c == '_');
+
+		/// <summary>
+		/// Connects to the dialog that launched this instance and shows the picker each time
+		/// the dialog asks for it, until the dialog is released.
+		/// </summary>
+		/// <returns>Whether the picker was shown at least once.</returns>
+		public static async Task<bool> RunAsync(string sessionName, Func<string, Task> showPickerAsync)
+		{
+			var shown = false;
+			var context = Ioc.Default.GetRequiredService<IContentPageContext>();
+
+			try
+			{
+				await using var pipe = new NamedPipeClientStream(".", sessionName, PipeDirection.InOut, PipeOptions.Asynchronous);
+				await pipe.ConnectAsync(ConnectTimeout);
+				await WriteMessageAsync(pipe, MessageType.Hello, []);
+
+				_pipe = pipe;
+				IsActive = true;
+				context.PropertyChanged += Context_PropertyChanged;
+
+				while (await ReadMessageAsync(pipe) is { } message)
+				{
+					if (message.Type is MessageType.Close)
+						break;
+
+					switch (message.Type)
+					{
+						// Comes right before the Show it belongs to
+						case MessageType.Controls:
+							Controls = DialogControlSnapshot.Parse(message.Payload);
+							break;
+
+						case MessageType.Show:
+							shown = true;
+
+							// Not awaited, listing the first folder may already need the host filter's verdicts
+							_ = showPickerAsync(Encoding.UTF8.GetString(message.Payload));
+							break;
+
+						case MessageType.FilterVerdicts when message.Payload.Length >= 4:
+							if (_pendingFilterQueries.TryRemove(BinaryPrimitives.ReadUInt32LittleEndian(message.Payload), out var query))
+								query.TrySetResult(message.Payload);
+							break;
+					}
+				}
+			}
+			catch (Exception ex) when (ex is TimeoutException or IOException or InvalidDataException)
+			{
+				App.Logger.LogInformation(ex, "Dialog session {SessionName} ended.", sessionName);
+			}
+			finally
+			{
+				IsActive = false;
+				_pipe = null;
+				Controls = null;
+				context.PropertyChanged -= Context_PropertyChanged;
+
+				// Whatever is still waiting for the host filter is listed
+				foreach (var query in _pendingFilterQueries.Values)
+					query.TrySetResult(null);
+				_pendingFilterQueries.Clear();
+			}
+
+			return shown;
+		}
+
+		// Lets the dialog raise OnFolderChange and OnSelectionChange on its host
+		private static void Context_PropertyChanged(object? sender, PropertyChangedEventArgs e)
+		{
+			if (sender is not IContentPageContext context || _pipe is not { } pipe)
+				return;
+
+			switch (e.PropertyName)
+			{
+				case nameof(IContentPageContext.Folder) when context.Folder is { } folder:
+					_ = SendEventAsync(pipe, MessageType.FolderChanged, folder.ItemPath);
+					break;
+
+				case nameof(IContentPageContext.SelectedItems):
+					// Selecting a range changes the selection once per item, only the last one is sent
+					if (Interlocked.Exchange(ref _selectionChangePending, 1) == 0)
+						_ = SendSelectionAsync(pipe, context);
+					break;
+			}
+		}
+
+		private static async Task SendSelectionAsync(Stream pipe, IContentPageContext context)
+		{
+			await Task.Yield();
+			Volatile.Write(ref _selectionChangePending, 0);
+
+			var paths = context.SelectedItems.Take(MaxReportedSelection).Select(x => x.ItemPath);
+			await SendEventAsync(pipe, MessageType.SelectionChanged, string.Join('\n', paths));
+		}
+
+		/// <summary>
+		/// Reports what the user did to the host's controls, so that the dialog raises it on its host.
+		/// </summary>
+		/// <param name="changes">The changes, in the order the user made them.</param>
+		public static Task SendControlChangesAsync(IReadOnlyList<(DialogControlChangeKind Kind, uint Control, uint Value, string Text)> changes)
+		{
+			if (changes.Count == 0 || _pipe is not { } pipe)
+				return Task.CompletedTask;
+
+			return SendEventAsync(pipe, MessageType.ControlsChanged, DialogControlSnapshot.EncodeChanges(changes));
+		}
+
+		private static Task SendEventAsync(Stream pipe, MessageType type, string payload)
+			=> SendEventAsync(pipe, type, Encoding.UTF8.GetBytes(payload));
+
+		private static async Task SendEventAsync(Stream pipe, MessageType type, byte[] payload)
+		{
+			try
+			{
+				await WriteMessageAsync(pipe, type, payload);
+			}
+			catch (Exception ex) when (ex is IOException or ObjectDisposedException)
+			{
+				// The session is over, the dialog no longer listens
+			}
+		}
+
+		/// <summary>
+		/// Removes the items the dialog's host excludes through its IShellItemFilter. Names are
+		/// sent in batches and the host answers each batch with one bit per name. Items are kept
+		/// when there is no filter or the host does not answer.
+		/// </summary>
+		/// <param name="folder">The folder the items were listed from.</param>
+		/// <param name="items">The items to filter in place.</param>
+		public static async Task FilterItemsAsync(string folder, List<ListedItem> items, CancellationToken cancellationToken)
+		{
+			var batchSize = ItemFilterBatchSize;
+			if (batchSize <= 0 || items.Count == 0 || _pipe is not { } pipe)
+				return;
+
+			var included = new bool[items.Count];
+			Array.Fill(included, true);
+
+			for (var start = 0; start < items.Count && !cancellationToken.IsCancellationRequested; start += batchSize)
+			{
+				var count = Math.Min(batchSize, items.Count - start);
+				var names = items.Skip(start).Take(count).Select(x => Path.GetFileName(x.ItemPath) ?? string.Empty).ToArray();
+				if (await QueryFilterAsync(pipe, folder, names, cancellationToken) is not { } verdicts)
+					return;
+
+				for (var i = 0; i < count; i++)
+					included[start + i] = (verdicts[8 + i / 8] & (1 << (i % 8))) != 0;
+			}
+
+			var kept = 0;
+			for (var i = 0; i < items.Count; i++)
+			{
+				if (included[i])
+					items[kept++] = items[i];
+			}
+
+			items.RemoveRange(kept, items.Count - kept);
+		}
+
+		// See FilterQuery and FilterVerdicts in Files.Native.Core
+		private static async Task<byte[]?> QueryFilterAsync(Stream pipe, string folder, string[] names, CancellationToken cancellationToken)
+		{
+			var id = Interlocked.Increment(ref _lastFilterQueryId);
+			var folderBytes = Encoding.UTF8.GetBytes(folder);
+			var nameBytes = names.Select(Encoding.UTF8.GetBytes).ToArray();
+
+			var payload = new byte[12 + folderBytes.Length + nameBytes.Sum(x => 4 + x.Length)];
+			var offset = 0;
+			void WriteUInt32(uint value)
+			{
+				BinaryPrimitives.WriteUInt32LittleEndian(payload.AsSpan(offset), value);
+				offset += 4;
+			}
+			void WriteBytes(byte[] value)
+			{
+				WriteUInt32((uint)value.Length);
+				value.CopyTo(payload, offset);
+				offset += value.Length;
+			}
+
+			WriteUInt32(id);
+			WriteBytes(folderBytes);
+			WriteUInt32((uint)names.Length);
+			foreach (var name in nameBytes)
+				WriteBytes(name);
+
+			var response = new TaskCompletionSource<byte[]?>(TaskCreationOptions.RunContinuationsAsynchronously);
+			_pendingFilterQueries[id] = response;
+
+			try
+			{
+				await WriteMessageAsync(pipe, MessageType.FilterQuery, payload);
+
+				var verdicts = await response.Task.WaitAsync(TimeSpan.FromMilliseconds(FilterTimeout), cancellationToken);
+				return verdicts is not null &&
+					BinaryPrimitives.ReadUInt32LittleEndian(verdicts.AsSpan(4)) == names.Length &&
+					verdicts.Length == 8 + (names.Length + 7) / 8
+						? verdicts
+						: null;
+			}
+			catch (Exception ex) when (ex is TimeoutException or IOException or ObjectDisposedException or OperationCanceledException)
+			{
+				return null;
+			}
+			finally
+			{
+				_pendingFilterQueries.TryRemove(id, out _);
+			}
+		}
+
+		private static async Task WriteMessageAsync(Stream pipe, MessageType type, byte[] payload)
+		{
+			var frame = new byte[HeaderSize + payload.Length];
+
+			BinaryPrimitives.WriteUInt32LittleEndian(frame, (uint)payload.Length);
+			frame[4] = (byte)type;
+			payload.CopyTo(frame, HeaderSize);
+
+			// Filter queries come from the enumeration threads
+			await _writeLock.WaitAsync();
+			try
+			{
+				await pipe.WriteAsync(frame);
+				await pipe.FlushAsync();
+			}
+			finally
+			{
+				_writeLock.Release();
+			}
+		}
+
+		private static async Task<(MessageType Type, byte[] Payload)?> ReadMessageAsync(Stream pipe)
+		{
+			var header = new byte[HeaderSize];
+			if (await pipe.ReadAtLeastAsync(header, HeaderSize, throwOnEndOfStream: false) < HeaderSize)
+				return null;
+
+			var size = BinaryPrimitives.ReadUInt32LittleEndian(header);
+			if (size > MaxPayloadSize)
+				throw new InvalidDataException($"Dialog session message of {size} bytes exceeds the limit.");
+
+			var payload = new byte[size];
+			await pipe.ReadExactlyAsync(payload);
+
+			return ((MessageType)header[4], payload);
+		}
+	}
+}
@@ -0,0 +1,215 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+using Microsoft.Extensions.Logging;
+using System.Buffers.Binary;
+using System.IO;
+using System.IO.Pipes;
+using System.Text;
+using Windows.Storage;
+
+namespace Files.App.Helpers
+{
+	/// <summary>
+	/// Takes the requests the launcher sends straight to the running instance. The launcher
+	/// tries this pipe first and falls back to protocol activation, which goes through the
+	/// activation broker, when nobody listens or the request is declined.
+	/// </summary>
+	public static class LaunchRequestHelper
+	{
+		// Keep in sync with LaunchStatus in Files.Native.Core
+		private enum LaunchStatus : byte
+		{
+			Accepted = 1,
+			Declined = 2,
+		}
+
+		// Keep in sync with LaunchRequestKind in Files.Native.Core
+		private enum LaunchRequestKind : uint
+		{
+			Activate = 1,
+			AmendSelection = 2,
+		}
+
+		// Keep in sync with LaunchProtocol in Files.Native.Core
+		private const uint Magic = 0x48434C46;
+		private const uint Version = 2;
+		private const int HeaderSize = 16;
+		private const int MaxPayloadSize = 32 * 1024;
+
+		// Well within the launcher's own timeout, so that a request is never both taken
+		// here and activated again through the protocol
+		private const int RequestTimeout = 500;
+
+		// How long a selection waits for its folder to finish loading
+		private static readonly TimeSpan PendingSelectionLifetime = TimeSpan.FromSeconds(10);
+
+		private static int _started;
+		private static (string Folder, string Name, DateTime Expiry)? _pendingSelection;
+
+		/// <summary>
+		/// Starts listening for launcher requests, once per process.
+		/// </summary>
+		public static void Start()
+		{
+			if (Interlocked.Exchange(ref _started, 1) == 0)
+				_ = Task.Run(ListenAsync);
+		}
+
+		private static async Task ListenAsync()
+		{
+			// Keep in sync with LaunchPipe in Files.Native.Core
+			var pipeName = $"files-dev-launch-{Process.GetCurrentProcess().SessionId}";
+
+			while (true)
+			{
+				NamedPipeServerStream? pipe = null;
+				try
+				{
+					// Every instance listens, the one that isn't the active instance declines
+					pipe = new(pipeName, PipeDirection.InOut, NamedPipeServerStream.MaxAllowedServerInstances,
+						PipeTransmissionMode.Byte, PipeOptions.Asynchronous | PipeOptions.CurrentUserOnly);
+					await pipe.WaitForConnectionAsync();
+				}
+				catch (Exception ex) when (ex is IOException or UnauthorizedAccessException)
+				{
+					pipe?.Dispose();
+					App.Logger.LogWarning(ex, "Failed to listen for launcher requests.");
+					return;
+				}
+
+				_ = ServeAsync(pipe);
+			}
+		}
+
+		private static async Task ServeAsync(NamedPipeServerStream pipe)
+		{
+			await using (pipe)
+			{
+				try
+				{
+					using var cts = new CancellationTokenSource(RequestTimeout);
+
+					var header = new byte[HeaderSize];
+					await pipe.ReadExactlyAsync(header, cts.Token);
+
+					var kind = (LaunchRequestKind)BinaryPrimitives.ReadUInt32LittleEndian(header.AsSpan(8));
+					var size = BinaryPrimitives.ReadUInt32LittleEndian(header.AsSpan(12));
+					if (BinaryPrimitives.ReadUInt32LittleEndian(header) != Magic ||
+						BinaryPrimitives.ReadUInt32LittleEndian(header.AsSpan(4)) != Version ||
+						kind is not (LaunchRequestKind.Activate or LaunchRequestKind.AmendSelection) ||
+						size > MaxPayloadSize)
+						return;
+
+					var payload = new byte[size];
+					await pipe.ReadExactlyAsync(payload, cts.Token);
+
+					var taken = await TakeAsync(kind, Encoding.UTF8.GetString(payload));
+					var status = taken ? LaunchStatus.Accepted : LaunchStatus.Declined;
+					await pipe.WriteAsync(new[] { (byte)status }, cts.Token);
+				}
+				catch (Exception ex) when (ex is IOException or OperationCanceledException)
+				{
+					App.Logger.LogInformation(ex, "Dropped a launcher request.");
+				}
+			}
+		}
+
+		/// <summary>
+		/// Takes the item the launcher asked to select once the folder it amends has loaded it.
+		/// </summary>
+		/// <returns>The name of the item to select, or null when there is none for this folder.</returns>
+		public static string? TakePendingSelection(ShellViewModel shellViewModel)
+		{
+			if (_pendingSelection is not { } pending)
+				return null;
+
+			if (pending.Expiry < DateTime.UtcNow)
+			{
+				_pendingSelection = null;
+				return null;
+			}
+
+			if (PathNormalization.NormalizePath(shellViewModel.WorkingDirectory) != pending.Folder ||
+				!shellViewModel.FilesAndFolders.ToList().Any(x => pending.Name.Equals(x.ItemNameRaw, StringComparison.OrdinalIgnoreCase)))
+				return null;
+
+			_pendingSelection = null;
+			return pending.Name;
+		}
+
+		// Hands the request to the window, unless the UI thread doesn't get to it in time
+		private static async Task<bool> TakeAsync(LaunchRequestKind kind, string payload)
+		{
+			// 0 while pending, 1 once taken, 2 once given up
+			var state = 0;
+
+			var taken = await MainWindow.Instance.DispatcherQueue.EnqueueOrInvokeAsync(() =>
+			{
+				if (!CanTakeRequest())
+					return false;
+
+				// A declined amendment is sent again by the launcher as a -select activation
+				var amendSelection = kind is LaunchRequestKind.AmendSelection ? GetSelectionAmendment(payload) : null;
+				if (kind is LaunchRequestKind.AmendSelection && amendSelection is null ||
+					Interlocked.CompareExchange(ref state, 1, 0) != 0)
+					return false;
+
+				if (amendSelection is not null)
+					amendSelection();
+				else
+					_ = MainWindow.Instance.InitializeFromLaunchRequestAsync(payload);
+
+				return true;
+			}).WithTimeoutAsync(TimeSpan.FromMilliseconds(RequestTimeout / 2));
+
+			return taken || Interlocked.CompareExchange(ref state, 2, 0) == 1;
+		}
+
+		// Selects the item in the folder an earlier request opened, without navigating. A folder
+		// still loading, or a window still starting, selects it once the item is listed. Null
+		// when no tab was opened for the folder.
+		private static Action? GetSelectionAmendment(string path)
+		{
+			var folder = PathNormalization.NormalizePath(SystemIO.Path.GetDirectoryName(path));
+			var name = SystemIO.Path.GetFileName(path);
+			if (string.IsNullOrEmpty(folder) || string.IsNullOrEmpty(name))
+				return null;
+
+			var shellPage = Ioc.Default.GetRequiredService<IContentPageContext>().ShellPage;
+			if (shellPage?.ShellViewModel is { } shellViewModel &&
+				PathNormalization.NormalizePath(shellViewModel.WorkingDirectory) == folder)
+			{
+				var item = shellViewModel.FilesAndFolders.ToList().FirstOrDefault(x => name.Equals(x.ItemNameRaw, StringComparison.OrdinalIgnoreCase));
+				if (item is not null && shellPage.SlimContentPage is { } contentPage)
+				{
+					return () =>
+					{
+						contentPage.ItemManipulationModel.SetSelectedItem(item);
+						contentPage.ItemManipulationModel.ScrollIntoView(item);
+					};
+				}
+			}
+			else if (MainPageViewModel.AppInstances.Any() &&
+				!MainPageViewModel.AppInstances.Any(x =>
+					x.NavigationParameter?.NavigationParameter is PaneNavigationArguments paneArgs &&
+					PathNormalization.NormalizePath(paneArgs.LeftPaneNavPathParam) == folder))
+			{
+				return null;
+			}
+
+			return () => _pendingSelection = (folder, name, DateTime.UtcNow + PendingSelectionLifetime);
+		}
+
+		// Declines whenever protocol activation would not end up in this window either
+		private static bool CanTakeRequest()
+		{
+			return
+				!DialogSessionHelper.IsActive &&
+				App.OutputPath is null &&
+				!App.AppModel.IsMainWindowClosed &&
+				ApplicationData.Current.LocalSettings.Values.Get("INSTANCE_ACTIVE", -1) == -Environment.ProcessId &&
+				Ioc.Default.GetRequiredService<IGeneralSettingsService>().OpenTabInExistingInstance;
+		}
+	}
+}
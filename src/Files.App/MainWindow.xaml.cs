@@ -215,6 +215,56 @@ namespace Files.App
 					break;
 			}
 
+			ShowWindow();
+		}
+
+		/// <summary>
+		/// Shows the picker a file dialog session asked for, with the dialog's activation command line.
+		/// </summary>
+		public async Task InitializeFromDialogSessionAsync(string arguments)
+		{
+			var rootFrame = EnsureWindowIsInitialized();
+			if (rootFrame is null)
+				return;
+
+			// Set system backdrop
+			SystemBackdrop = new AppSystemBackdrop();
+
+			await InitializeFromCmdLineArgsAsync(rootFrame, CommandLineParser.ParseUntrustedCommands(arguments), Environment.CurrentDirectory);
+
+			ShowWindow();
+		}
+
+		/// <summary>
+		/// Handles a request the launcher sent straight to this instance, like the matching protocol activation.
+		/// </summary>
+		/// <param name="arguments">The activation command line, or an empty string when the launcher got none.</param>
+		public async Task InitializeFromLaunchRequestAsync(string arguments)
+		{
+			var rootFrame = EnsureWindowIsInitialized();
+			if (rootFrame is null)
+				return;
+
+			var ppm = CommandLineParser.ParseUntrustedCommands(arguments);
+			if (ppm.IsEmpty())
+			{
+				rootFrame.Navigate(typeof(MainPage), null, new SuppressNavigationTransitionInfo());
+
+				// Bring to foreground (#14730)
+				Win32Helper.BringToForegroundEx(new(WindowHandle));
+
+				_ = EnsureContentHasKeyboardFocusAsync();
+			}
+			else
+			{
+				await InitializeFromCmdLineArgsAsync(rootFrame, ppm, Environment.CurrentDirectory);
+			}
+
+			ShowWindow();
+		}
+
+		private void ShowWindow()
+		{
 			var appWindow = AppWindow;
 			if (appWindow is not null && !appWindow.IsVisible)
 			{
@@ -325,6 +375,16 @@ namespace Files.App
 				else
 					rootFrame.Navigate(typeof(MainPage), paneNavigationArgs, new SuppressNavigationTransitionInfo());
 			}
+
+			// Narrow the listing to what the dialog can take before the first folder is enumerated
+			if (parsedCommands.Any(x => x.Type == ParsedCommandType.OutputPath))
+			{
+				App.OutputEnumerationMode = Enum.TryParse<DialogEnumerationMode>(parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.EnumerationMode)?.Payload, out var enumerationMode) ? enumerationMode : DialogEnumerationMode.None;
+				App.OutputFileTypes = DialogFileTypeFilter.Parse(parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.FileTypes)?.Payload);
+				DialogSessionHelper.ItemFilterBatchSize = int.TryParse(parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.ItemFilter)?.Payload, out var batchSize) ? batchSize : 0;
+				DialogFolderSnapshot.PendingPath = parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.FolderSnapshot)?.Payload;
+			}
+
 			foreach (var command in parsedCommands)
 			{
 				switch (command.Type)
@@ -332,13 +392,24 @@ namespace Files.App
 					case ParsedCommandType.OpenDirectory:
 					case ParsedCommandType.OpenPath:
 					case ParsedCommandType.ExplorerShellCommand:
+						// Lists of several folders or items come from a launcher batch, where an item is not in the folder next to it
 						var selectItemCommand = parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.SelectItem);
+						if (command.Args.Count > 1 || selectItemCommand?.Args.Count > 1)
+							selectItemCommand = null;
+
 						await PerformNavigationAsync(command.Payload, selectItemCommand?.Payload);
+
+						// A launcher batch lists several folders, each opens in its own tab
+						if (command.Type is ParsedCommandType.OpenDirectory)
+						{
+							foreach (var directory in command.Args.Skip(1))
+								await PerformNavigationAsync(directory);
+						}
 						break;
 
 					case ParsedCommandType.SelectItem:
-						if (IO.Path.IsPathRooted(command.Payload))
-							await PerformNavigationAsync(IO.Path.GetDirectoryName(command.Payload), IO.Path.GetFileName(command.Payload));
+						foreach (var item in command.Args.Where(x => IO.Path.IsPathRooted(x)))
+							await PerformNavigationAsync(IO.Path.GetDirectoryName(item), IO.Path.GetFileName(item));
 						break;
 
 					case ParsedCommandType.TagFiles:
@@ -379,11 +450,33 @@ namespace Files.App
 
 					case ParsedCommandType.OutputPath:
 						App.OutputPath = command.Payload;
+						App.OutputChannel = parsedCommands.FirstOrDefault(x => x.Type == ParsedCommandType.DialogChannel)?.Payload;
+
+						// A dialog that gave up waiting has shown the system picker, don't show a second one
+						if (!DialogSessionHelper.WatchCancellation(App.OutputChannel, () => DispatcherQueue.TryEnqueue(CancelDialogPicker)))
+						{
+							DispatcherQueue.TryEnqueue(CancelDialogPicker);
+							break;
+						}
+
+						// Acknowledge the activation so the dialog doesn't fall back to the system picker
+						using (var ackHandle = Windows.Win32.PInvoke.CreateEvent(null, false, false, DialogSessionHelper.GetAckEventName(App.OutputChannel)))
+							Windows.Win32.PInvoke.SetEvent(ackHandle);
 						break;
 				}
 			}
 		}
 
+		// Closes the picker without answering the dialog, which no longer waits for it
+		private void CancelDialogPicker()
+		{
+			if (App.OutputPath is null)
+				return;
+
+			App.ClearDialogOutput();
+			Close();
+		}
+
 		public bool SetCanWindowToFront(bool canWindowToFront)
 		{
 			lock (_canWindowToFrontLock)
@@ -25,6 +25,11 @@ namespace Files.App
 	{
 		public static Semaphore? Pool { get; set; }
 
+		/// <summary>
+		/// Gets the file dialog session this instance was started for, if any.
+		/// </summary>
+		public static string? DialogSessionName { get; private set; }
+
 		private const string LaunchCwdKey = "LastLaunchCwd";
 
 		/// <summary>
@@ -172,8 +177,10 @@ namespace Files.App
 					}
 				}
 
+				DialogSessionName = parsedCommands?.FirstOrDefault(x => x.Type == ParsedCommandType.DialogSession)?.Payload;
+
 				// Always open a new instance for OpenDialog, never open new instance for "-Tag" command
-				if (parsedCommands is null || !parsedCommands.Any(x => x.Type == ParsedCommandType.OutputPath) &&
+				if (parsedCommands is null || !parsedCommands.Any(x => x.Type is ParsedCommandType.OutputPath or ParsedCommandType.DialogSession) &&
 					(OpenTabInExistingInstance || parsedCommands.Any(x => x.Type == ParsedCommandType.TagFiles)))
 				{
 					var activePid = ApplicationData.Current.LocalSettings.Values.Get("INSTANCE_ACTIVE", -1);
@@ -278,6 +285,19 @@ namespace Files.App
 			return cmdLaunchArgs ?? cmdProtocolArgs ?? cmdLineArgs;
 		}
 
+		/// <summary>
+		/// Gets the file dialog session an activation redirected to this instance was started for, if any.
+		/// </summary>
+		public static string? GetDialogSessionName(AppActivationArguments activatedArgs)
+		{
+			var commandLineArgs = GetCommandLineArgs(activatedArgs);
+			if (commandLineArgs is null)
+				return null;
+
+			return CommandLineParser.ParseUntrustedCommands(commandLineArgs)?
+				.FirstOrDefault(x => x.Type == ParsedCommandType.DialogSession)?.Payload;
+		}
+
 		/// <summary>
 		/// Gets invoked when the application is activated.
 		/// </summary>
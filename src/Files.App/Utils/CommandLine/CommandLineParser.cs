@@ -67,6 +67,30 @@ namespace Files.App.Utils.CommandLine
 						command.Type = ParsedCommandType.TagFiles;
 						break;
 
+					case string s when "DialogSession".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.DialogSession;
+						break;
+
+					case string s when "DialogChannel".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.DialogChannel;
+						break;
+
+					case string s when "FileTypes".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.FileTypes;
+						break;
+
+					case string s when "ItemFilter".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.ItemFilter;
+						break;
+
+					case string s when "EnumerationMode".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.EnumerationMode;
+						break;
+
+					case string s when "FolderSnapshot".Equals(s, StringComparison.OrdinalIgnoreCase):
+						command.Type = ParsedCommandType.FolderSnapshot;
+						break;
+
 					default: //case "Cmdless":
 						try
 						{
@@ -18,7 +18,7 @@ namespace Files.App.Utils.Storage
 
 		private static readonly IIconCacheService iconCacheService = Ioc.Default.GetRequiredService<IIconCacheService>();
 
-		public static async Task<List<ListedItem>> ListEntries(
+		public static Task<List<ListedItem>> ListEntries(
 			string path,
 			Win32PInvoke.SafeFindHandle hFile,
 			Win32PInvoke.WIN32_FIND_DATA findData,
@@ -26,6 +26,20 @@ namespace Files.App.Utils.Storage
 			int countLimit,
 			Func<List<ListedItem>, Task> intermediateAction
 		)
+		{
+			return ListEntries(path, EnumerateFindData(hFile, findData), cancellationToken, countLimit, intermediateAction);
+		}
+
+		/// <summary>
+		/// Lists entries already read, such as the snapshot taken by the dialog that launched this instance.
+		/// </summary>
+		public static async Task<List<ListedItem>> ListEntries(
+			string path,
+			IEnumerable<Win32PInvoke.WIN32_FIND_DATA> entries,
+			CancellationToken cancellationToken,
+			int countLimit,
+			Func<List<ListedItem>, Task> intermediateAction
+		)
 		{
 			var sampler = new IntervalSampler(500);
 			// The first flush is time-based only: folders that enumerate faster than the
@@ -40,91 +54,108 @@ namespace Files.App.Utils.Storage
 			bool showHiddenItems = userSettingsService.FoldersSettingsService.ShowHiddenItems;
 			bool showProtectedSystemFiles = userSettingsService.FoldersSettingsService.ShowProtectedSystemFiles;
 			bool showDotFiles = userSettingsService.FoldersSettingsService.ShowDotFiles;
-			bool areAlternateStreamsVisible = userSettingsService.FoldersSettingsService.AreAlternateStreamsVisible;
+			var fileTypeFilter = App.OutputFileTypes;
+
+			// A folder picker never shows files, and streams can't be picked by a dialog that wants file system items
+			var enumerationMode = App.OutputEnumerationMode;
+			var listFiles = !enumerationMode.HasFlag(DialogEnumerationMode.FoldersOnly);
+			bool areAlternateStreamsVisible = userSettingsService.FoldersSettingsService.AreAlternateStreamsVisible &&
+				(enumerationMode & (DialogEnumerationMode.FoldersOnly | DialogEnumerationMode.FileSystemOnly)) == 0;
 
 			var isGitRepo = GitHelpers.IsRepositoryEx(path, out var repoPath) && !string.IsNullOrEmpty(await GitHelpers.GetRepositoryHeadName(repoPath));
-			var rawHandle = hFile.DangerousGetHandle();
 
-			try
+			foreach (var findData in entries)
 			{
-				do
+				var isSystem = ((FileAttributes)findData.dwFileAttributes & FileAttributes.System) == FileAttributes.System;
+				var isHidden = ((FileAttributes)findData.dwFileAttributes & FileAttributes.Hidden) == FileAttributes.Hidden;
+				var startWithDot = findData.cFileName.StartsWith('.');
+				if ((!isHidden ||
+					(showHiddenItems &&
+						(!isSystem || showProtectedSystemFiles))) &&
+					(!startWithDot || showDotFiles))
 				{
-					var isSystem = ((FileAttributes)findData.dwFileAttributes & FileAttributes.System) == FileAttributes.System;
-					var isHidden = ((FileAttributes)findData.dwFileAttributes & FileAttributes.Hidden) == FileAttributes.Hidden;
-					var startWithDot = findData.cFileName.StartsWith('.');
-					if ((!isHidden ||
-						(showHiddenItems &&
-							(!isSystem || showProtectedSystemFiles))) &&
-						(!startWithDot || showDotFiles))
+					if (((FileAttributes)findData.dwFileAttributes & FileAttributes.Directory) != FileAttributes.Directory)
 					{
-						if (((FileAttributes)findData.dwFileAttributes & FileAttributes.Directory) != FileAttributes.Directory)
+						// Checked on the raw name so files of other types never get to build a ListedItem
+						var file = listFiles && (fileTypeFilter is null || fileTypeFilter.IsMatch(findData.cFileName))
+							? await GetFile(findData, path, isGitRepo, cancellationToken)
+							: null;
+						if (file is not null)
 						{
-							var file = await GetFile(findData, path, isGitRepo, cancellationToken);
-							if (file is not null)
-							{
-								var filePath = file.ItemPath!;
-								file.PreloadedIconData = await iconCacheService.GetIconAsync(file.ItemPath, file.FileExtension, false);
-								tempList.Add(file);
-								++count;
+							var filePath = file.ItemPath!;
+							file.PreloadedIconData = await iconCacheService.GetIconAsync(file.ItemPath, file.FileExtension, false);
+							tempList.Add(file);
+							++count;
 
-								if (areAlternateStreamsVisible)
-									tempList.AddRange(EnumAdsForPath(filePath, file));
-							}
+							if (areAlternateStreamsVisible)
+								tempList.AddRange(EnumAdsForPath(filePath, file));
 						}
-						else if (((FileAttributes)findData.dwFileAttributes & FileAttributes.Directory) == FileAttributes.Directory)
+					}
+					else if (((FileAttributes)findData.dwFileAttributes & FileAttributes.Directory) == FileAttributes.Directory)
+					{
+						if (findData.cFileName != "." && findData.cFileName != "..")
 						{
-							if (findData.cFileName != "." && findData.cFileName != "..")
+							var folder = await GetFolder(findData, path, isGitRepo, cancellationToken);
+							if (folder is not null)
 							{
-								var folder = await GetFolder(findData, path, isGitRepo, cancellationToken);
-								if (folder is not null)
-								{
-									var folderPath = folder.ItemPath!;
-									folder.PreloadedIconData = await iconCacheService.GetIconAsync(folder.ItemPath, null, true);
-									tempList.Add(folder);
-									++count;
+								var folderPath = folder.ItemPath!;
+								folder.PreloadedIconData = await iconCacheService.GetIconAsync(folder.ItemPath, null, true);
+								tempList.Add(folder);
+								++count;
 
-									if (areAlternateStreamsVisible)
-										tempList.AddRange(EnumAdsForPath(folderPath, folder));
+								if (areAlternateStreamsVisible)
+									tempList.AddRange(EnumAdsForPath(folderPath, folder));
 
-									if (CalculateFolderSizes)
+								if (CalculateFolderSizes)
+								{
+									if (folderSizeProvider.TryGetSize(folderPath, out var size))
 									{
-										if (folderSizeProvider.TryGetSize(folderPath, out var size))
-										{
-											folder.FileSizeBytes = (long)size;
-											folder.FileSize = size.ToSizeString();
-										}
-
-										_ = folderSizeProvider.UpdateAsync(folderPath, cancellationToken);
+										folder.FileSizeBytes = (long)size;
+										folder.FileSize = size.ToSizeString();
 									}
+
+									_ = folderSizeProvider.UpdateAsync(folderPath, cancellationToken);
 								}
 							}
 						}
 					}
+				}
 
-					if (cancellationToken.IsCancellationRequested || count == countLimit)
-						break;
+				if (cancellationToken.IsCancellationRequested || count == countLimit)
+					break;
 
-					if (intermediateAction is not null &&
-						(hasFlushedFirstBatch
-							? sampler.CheckNow()
-							: tempList.Count > 0 && firstBatchSampler.CheckNow()))
-					{
-						hasFlushedFirstBatch = true;
-						await intermediateAction(tempList);
+				if (intermediateAction is not null &&
+					(hasFlushedFirstBatch
+						? sampler.CheckNow()
+						: tempList.Count > 0 && firstBatchSampler.CheckNow()))
+				{
+					hasFlushedFirstBatch = true;
+					await DialogSessionHelper.FilterItemsAsync(path, tempList, cancellationToken);
+					await intermediateAction(tempList);
 
-						// clear the temporary list every time we do an intermediate action
-						tempList.Clear();
-					}
-				} while (Win32PInvoke.FindNextFile(rawHandle, out findData));
-			}
-			finally
-			{
-				hFile.Dispose();
+					// clear the temporary list every time we do an intermediate action
+					tempList.Clear();
+				}
 			}
 
+			await DialogSessionHelper.FilterItemsAsync(path, tempList, cancellationToken);
+
 			return tempList;
 		}
 
+		private static IEnumerable<Win32PInvoke.WIN32_FIND_DATA> EnumerateFindData(Win32PInvoke.SafeFindHandle hFile, Win32PInvoke.WIN32_FIND_DATA findData)
+		{
+			// Closed as soon as the listing stops, whether it ran to the end or not
+			using (hFile)
+			{
+				var rawHandle = hFile.DangerousGetHandle();
+				do
+				{
+					yield return findData;
+				} while (Win32PInvoke.FindNextFile(rawHandle, out findData));
+			}
+		}
+
 		private static IEnumerable<ListedItem> EnumAdsForPath(string itemPath, ListedItem main)
 		{
 			foreach (var ads in Win32Helper.GetAlternateStreams(itemPath))
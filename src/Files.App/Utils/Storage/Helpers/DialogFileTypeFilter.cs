@@ -0,0 +1,74 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+using System.IO;
+using System.IO.Enumeration;
+
+namespace Files.App.Utils.Storage
+{
+	/// <summary>
+	/// File type filter selected in the open or save dialog that launched this instance.
+	/// The dialog compiles the host's spec and passes it with -filetypes, either as an
+	/// extension set ("ext:png|jpg") or as a list of wildcard patterns ("glob:report-??.*|*.txt").
+	/// </summary>
+	/// <remarks>
+	/// Keep in sync with FileTypeFilter in Files.Native.Core.
+	/// </remarks>
+	public sealed class DialogFileTypeFilter
+	{
+		private readonly HashSet<string>.AlternateLookup<ReadOnlySpan<char>> _extensions;
+		private readonly string[] _patterns;
+
+		private DialogFileTypeFilter(IEnumerable<string> extensions, string[] patterns)
+		{
+			// Looked up by span so that listing a folder doesn't allocate a string per file
+			_extensions = new HashSet<string>(extensions, StringComparer.OrdinalIgnoreCase).GetAlternateLookup<ReadOnlySpan<char>>();
+			_patterns = patterns;
+		}
+
+		/// <summary>
+		/// Parses the compiled filter passed by the dialog.
+		/// </summary>
+		/// <returns>The filter, or null when every file should be listed.</returns>
+		public static DialogFileTypeFilter? Parse(string? compiled)
+		{
+			if (string.IsNullOrEmpty(compiled))
+				return null;
+
+			if (compiled.StartsWith("ext:", StringComparison.Ordinal))
+				return new(compiled[4..].Split('|', StringSplitOptions.RemoveEmptyEntries), []);
+
+			if (compiled.StartsWith("glob:", StringComparison.Ordinal))
+			{
+				var patterns = compiled[5..].Split('|', StringSplitOptions.RemoveEmptyEntries);
+
+				// Patterns such as "*.png" are kept by the dialog only when mixed with other globs
+				var extensions = patterns.Where(IsExtensionPattern).Select(x => x[2..]).ToArray();
+				return new(extensions, patterns.Where(x => !IsExtensionPattern(x)).ToArray());
+			}
+
+			return null;
+		}
+
+		/// <summary>
+		/// Gets whether a file with the given name should be listed.
+		/// </summary>
+		public bool IsMatch(string fileName)
+		{
+			var extension = Path.GetExtension(fileName.AsSpan());
+			if (extension.Length > 1 && _extensions.Contains(extension[1..]))
+				return true;
+
+			foreach (var pattern in _patterns)
+			{
+				if (FileSystemName.MatchesSimpleExpression(pattern, fileName, ignoreCase: true))
+					return true;
+			}
+
+			return false;
+		}
+
+		private static bool IsExtensionPattern(string pattern)
+			=> pattern.Length > 2 && pattern.StartsWith("*.", StringComparison.Ordinal) && pattern.AsSpan(2).IndexOfAny("*?.") < 0;
+	}
+}
@@ -0,0 +1,108 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+using System.IO;
+using System.Text;
+using FILETIME = System.Runtime.InteropServices.ComTypes.FILETIME;
+
+namespace Files.App.Utils.Storage
+{
+	/// <summary>
+	/// Listing of the folder the open or save dialog that launched this instance opens in.
+	/// The dialog takes it with FindFirstFileEx while Files starts and passes its path with -foldersnapshot.
+	/// </summary>
+	/// <remarks>
+	/// Keep in sync with FolderSnapshot in Files.Native.Core.
+	/// </remarks>
+	public static class DialogFolderSnapshot
+	{
+		private const uint Magic = 0x504E5346; // "FSNP"
+		private const uint Version = 1;
+		private const int MaxEntries = 100000;
+
+		// Past that, sizes and times of the files are too likely to have changed
+		private static readonly TimeSpan MaxAge = TimeSpan.FromSeconds(30);
+
+		/// <summary>
+		/// Gets or sets the path of the snapshot file, until the first folder is listed.
+		/// </summary>
+		public static string? PendingPath { get; set; }
+
+		/// <summary>
+		/// Takes the snapshot for the first listing of the dialog's folder.
+		/// </summary>
+		/// <returns>The entries of the folder, or null when it has to be enumerated.</returns>
+		public static Win32PInvoke.WIN32_FIND_DATA[]? TryTake(string folder)
+		{
+			var snapshotPath = PendingPath;
+			if (snapshotPath is null)
+				return null;
+
+			try
+			{
+				// Missing when the dialog is still listing, Files is faster on its own then
+				if (!File.Exists(snapshotPath))
+				{
+					PendingPath = null;
+					return null;
+				}
+
+				var data = File.ReadAllBytes(snapshotPath);
+				using var reader = new BinaryReader(new MemoryStream(data));
+				if (reader.ReadUInt32() != Magic || reader.ReadUInt32() != Version)
+					return null;
+
+				// Tabs restored at startup may be listed before the dialog's folder
+				var snapshotFolder = ReadString(reader);
+				if (!string.Equals(snapshotFolder.TrimEnd('\\'), folder.TrimEnd('\\'), StringComparison.OrdinalIgnoreCase))
+					return null;
+
+				// Any later listing must see the folder as it is
+				PendingPath = null;
+				File.Delete(snapshotPath);
+
+				var folderLastWriteTime = reader.ReadInt64();
+				var captureTime = reader.ReadInt64();
+				if (DateTime.UtcNow - DateTime.FromFileTimeUtc(captureTime) > MaxAge ||
+					Directory.GetLastWriteTimeUtc(folder).ToFileTimeUtc() != folderLastWriteTime)
+					return null;
+
+				var count = reader.ReadInt32();
+				if (count < 0 || count > MaxEntries)
+					return null;
+
+				var entries = new Win32PInvoke.WIN32_FIND_DATA[count];
+				for (var i = 0; i < count; i++)
+				{
+					entries[i].dwFileAttributes = reader.ReadUInt32();
+					var size = reader.ReadUInt64();
+					entries[i].nFileSizeHigh = (uint)(size >> 32);
+					entries[i].nFileSizeLow = (uint)size;
+					entries[i].ftCreationTime = ToFileTime(reader.ReadInt64());
+					entries[i].ftLastAccessTime = ToFileTime(reader.ReadInt64());
+					entries[i].ftLastWriteTime = ToFileTime(reader.ReadInt64());
+					entries[i].cFileName = ReadString(reader);
+				}
+
+				return entries;
+			}
+			catch (Exception ex) when (ex is IOException or UnauthorizedAccessException or ArgumentException or InvalidDataException)
+			{
+				// EndOfStreamException for a truncated file, ArgumentException for an invalid time
+				return null;
+			}
+		}
+
+		private static string ReadString(BinaryReader reader)
+		{
+			var length = reader.ReadInt32();
+			if (length < 0)
+				throw new InvalidDataException();
+
+			return Encoding.UTF8.GetString(reader.ReadBytes(length));
+		}
+
+		private static FILETIME ToFileTime(long ticks)
+			=> new() { dwLowDateTime = (int)ticks, dwHighDateTime = (int)(ticks >> 32) };
+	}
+}
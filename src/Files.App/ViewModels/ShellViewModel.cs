@@ -2268,11 +2268,20 @@ namespace Files.App.ViewModels
 				{
 					await Task.Run(async () =>
 					{
-						List<ListedItem> fileList = await Win32StorageEnumerator.ListEntries(path, hFile, findData, cancellationToken, -1, intermediateAction: async (intermediateList) =>
+						Func<List<ListedItem>, Task> intermediateAction = async (intermediateList) =>
 						{
 							filesAndFolders.AddRange(intermediateList);
 							await ApplyFilesAndFoldersChangesAsync();
-						});
+						};
+
+						// The dialog that launched this instance may have listed the folder while Files started
+						var snapshot = DialogFolderSnapshot.TryTake(path);
+						if (snapshot is not null)
+							hFile.Dispose();
+
+						List<ListedItem> fileList = snapshot is not null
+							? await Win32StorageEnumerator.ListEntries(path, snapshot, cancellationToken, -1, intermediateAction)
+							: await Win32StorageEnumerator.ListEntries(path, hFile, findData, cancellationToken, -1, intermediateAction);
 
 						filesAndFolders.AddRange(fileList);
 
@@ -822,6 +822,12 @@ namespace Files.App.Views.Layouts
 
 				var itemsToSelect = layoutSwitchSelection ?? navigationArguments?.SelectItems;
 
+				// An item the launcher asked to select while the folder was loading
+				if (itemsToSelect is null &&
+					ParentShellPageInstance?.ShellViewModel is { } loadedShellViewModel &&
+					LaunchRequestHelper.TakePendingSelection(loadedShellViewModel) is { } pendingSelection)
+					itemsToSelect = [pendingSelection];
+
 				if (navigationArguments is not null &&
 					itemsToSelect is not null &&
 					itemsToSelect.Any())
@@ -0,0 +1,195 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Command lines Files is activated with, the protocol URIs carrying them, and the
+//  result lines Files writes back for the dialogs.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Files::Native
+{
+	namespace Detail
+	{
+		// Reads UTF-16 as well as the UTF-32 of a 4-byte wchar_t. Unpaired surrogates read
+		// as U+FFFD, as WideCharToMultiByte converts them.
+		template <typename Char>
+		char32_t ReadCodePoint(std::basic_string_view<Char> input, std::size_t& offset)
+		{
+			char32_t unit = (char32_t)input[offset++];
+			if (sizeof(Char) > 2)
+				return unit > 0x10FFFF || (unit >= 0xD800 && unit <= 0xDFFF) ? 0xFFFD : unit;
+			if (unit < 0xD800 || unit > 0xDFFF)
+				return unit;
+			if (unit > 0xDBFF || offset == input.size())
+				return 0xFFFD;
+
+			char32_t low = (char32_t)input[offset];
+			if (low < 0xDC00 || low > 0xDFFF)
+				return 0xFFFD;
+
+			offset++;
+			return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+		}
+
+		inline std::size_t GetUtf8Size(char32_t codePoint)
+		{
+			return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+		}
+
+		// Writes the UTF-8 bytes of a code point to output, which has room for them
+		inline char* WriteUtf8(char* output, char32_t codePoint)
+		{
+			if (codePoint < 0x80)
+			{
+				*output++ = (char)codePoint;
+			}
+			else if (codePoint < 0x800)
+			{
+				*output++ = (char)(0xC0 | (codePoint >> 6));
+				*output++ = (char)(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				*output++ = (char)(0xE0 | (codePoint >> 12));
+				*output++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				*output++ = (char)(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				*output++ = (char)(0xF0 | (codePoint >> 18));
+				*output++ = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+				*output++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+				*output++ = (char)(0x80 | (codePoint & 0x3F));
+			}
+
+			return output;
+		}
+	}
+
+	template <typename Char>
+	std::string ToUtf8(std::basic_string_view<Char> input)
+	{
+		std::size_t size = 0;
+		for (std::size_t offset = 0; offset < input.size();)
+			size += Detail::GetUtf8Size(Detail::ReadCodePoint(input, offset));
+
+		std::string output(size, '\0');
+		char* next = output.data();
+		for (std::size_t offset = 0; offset < input.size();)
+			next = Detail::WriteUtf8(next, Detail::ReadCodePoint(input, offset));
+
+		return output;
+	}
+
+	// Builds the command line a Files activation carries, e.g.
+	//  "C:\...\Files.exe" -directory "C:\Users" -dialogchannel 1a2b
+	// It grows as needed, where the fixed buffers it replaces cut long paths off.
+	class ActivationCommand
+	{
+	public:
+		static constexpr std::wstring_view UriPrefix = L"files-dev:?cmd=";
+
+		explicit ActivationCommand(std::wstring_view executable)
+		{
+			_commandLine.reserve(executable.size() + 128);
+			AppendQuoted(executable);
+		}
+
+		// Files splits its arguments on the quotes alone, so values are never escaped.
+		// Paths can't contain quotes anyway.
+		ActivationCommand& Append(std::wstring_view flag)
+		{
+			_commandLine.append(L" ").append(flag);
+			return *this;
+		}
+
+		ActivationCommand& Append(std::wstring_view flag, std::wstring_view value)
+		{
+			Append(flag);
+			_commandLine.append(L" ").append(value);
+			return *this;
+		}
+
+		ActivationCommand& AppendQuoted(std::wstring_view flag, std::wstring_view value)
+		{
+			Append(flag);
+			_commandLine.append(L" ");
+			AppendQuoted(value);
+			return *this;
+		}
+
+		const std::wstring& GetCommandLine() const
+		{
+			return _commandLine;
+		}
+
+		std::wstring ToUri() const
+		{
+			return ToUri(_commandLine);
+		}
+
+		// The command line as UTF-8 with every byte percent-encoded, sized up front so
+		// that the URI takes a single allocation
+		static std::wstring ToUri(std::wstring_view commandLine)
+		{
+			std::size_t size = UriPrefix.size();
+			for (std::size_t offset = 0; offset < commandLine.size();)
+				size += 3 * Detail::GetUtf8Size(Detail::ReadCodePoint(commandLine, offset));
+
+			static constexpr wchar_t digits[] = L"0123456789ABCDEF";
+			std::wstring uri(size, L'\0');
+			wchar_t* next = uri.data() + UriPrefix.copy(uri.data(), UriPrefix.size());
+			for (std::size_t offset = 0; offset < commandLine.size();)
+			{
+				char bytes[4];
+				char* end = Detail::WriteUtf8(bytes, Detail::ReadCodePoint(commandLine, offset));
+				for (const char* byte = bytes; byte != end; byte++)
+				{
+					*next++ = L'%';
+					*next++ = digits[(unsigned char)*byte >> 4];
+					*next++ = digits[(unsigned char)*byte & 0xF];
+				}
+			}
+
+			return uri;
+		}
+
+	private:
+		std::wstring _commandLine;
+
+		void AppendQuoted(std::wstring_view value)
+		{
+			_commandLine.append(L"\"").append(value).append(L"\"");
+		}
+	};
+
+	// Files writes the picked items to the output file one per line, with Windows or
+	// Unix line endings. Empty lines are skipped.
+	inline std::vector<std::string_view> ParseResultLines(std::string_view text)
+	{
+		std::vector<std::string_view> lines;
+		for (std::size_t start = 0; start < text.size();)
+		{
+			std::size_t end = text.find('\n', start);
+			if (end == std::string_view::npos)
+				end = text.size();
+
+			std::string_view line = text.substr(start, end - start);
+			if (!line.empty() && line.back() == '\r')
+				line.remove_suffix(1);
+			if (!line.empty())
+				lines.push_back(line);
+
+			start = end + 1;
+		}
+
+		return lines;
+	}
+}
@@ -0,0 +1,66 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <memory>
+#include "ActivationCommand.h"
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/PathCorpus.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+
+BENCHMARK_GROUP(ActivationCommandBenchmarks)
+{
+	for (const PathCorpus& corpus : GetPathCorpora())
+	{
+		// What a dialog starts Files with
+		registry.Add("ActivationCommand/Build/" + corpus.Name, [&corpus](BenchmarkRun& run)
+		{
+			run.BytesPerIteration = corpus.Utf8Size;
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				ActivationCommand command(L"C:\\Users\\User\\AppData\\Local\\Microsoft\\WindowsApps\\files-dev.exe");
+				command.AppendQuoted(L"-directory", corpus.Paths[i % corpus.Paths.size()])
+					.AppendQuoted(L"-outputpath", L"C:\\Users\\User\\AppData\\Local\\Temp\\FilesDialog_1234.txt")
+					.Append(L"-dialogchannel", L"1234_1")
+					.Append(L"-enumerationmode", L"SingleSelect");
+				Consume(command.GetCommandLine());
+			}
+		});
+
+		registry.Add("ActivationCommand/ToUri/" + corpus.Name, [&corpus](BenchmarkRun& run)
+		{
+			run.BytesPerIteration = corpus.Utf8Size;
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(ActivationCommand::ToUri(corpus.Paths[i % corpus.Paths.size()]));
+		});
+
+		registry.Add("ToUtf8/" + corpus.Name, [&corpus](BenchmarkRun& run)
+		{
+			run.BytesPerIteration = corpus.Utf8Size;
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(ToUtf8(std::wstring_view(corpus.Paths[i % corpus.Paths.size()])));
+		});
+
+		// The output file of a Show() picking 16 items
+		auto results = std::make_shared<std::vector<std::string>>();
+		for (std::size_t i = 0; i < corpus.Utf8Paths.size(); i += 16)
+		{
+			std::string text;
+			for (std::size_t j = i; j < i + 16 && j < corpus.Utf8Paths.size(); j++)
+				text.append(corpus.Utf8Paths[j]).append("\r\n");
+			results->push_back(std::move(text));
+		}
+
+		registry.Add("ParseResultLines/16/" + corpus.Name, [results](BenchmarkRun& run)
+		{
+			std::size_t size = 0;
+			for (const std::string& text : *results)
+				size += text.size();
+
+			run.BytesPerIteration = (double)size / results->size();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(ParseResultLines((*results)[i % results->size()]));
+		});
+	}
+}
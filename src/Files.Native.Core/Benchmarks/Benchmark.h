@@ -0,0 +1,104 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Minimal benchmark registry of the portable Files.Native.Core benchmarks.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Files::Native::Benchmarks
+{
+	// Counted by the operator new of the benchmark executable, on every thread
+	inline std::atomic<std::uint64_t> AllocationCount{ 0 };
+
+	struct BenchmarkRun
+	{
+		// Operations to run, the runner divides the time and allocations by them
+		std::size_t Iterations = 1;
+		// Input bytes of an operation on average, for the throughput column
+		double BytesPerIteration = 0;
+		// Averages of anything else worth reporting, e.g. activations per launch
+		std::vector<std::pair<std::string, double>> Counters;
+
+		// Where the measurement starts, moved past its setup by ResetTimer()
+		std::chrono::steady_clock::time_point StartTime;
+		std::uint64_t StartAllocations = 0;
+
+		void Report(std::string name, double value)
+		{
+			Counters.emplace_back(std::move(name), value);
+		}
+
+		void ResetTimer()
+		{
+			StartAllocations = AllocationCount.load();
+			StartTime = std::chrono::steady_clock::now();
+		}
+	};
+
+	struct Benchmark
+	{
+		std::string Name;
+		std::function<void(BenchmarkRun&)> Run;
+	};
+
+	struct BenchmarkRegistry
+	{
+		std::vector<Benchmark> Benchmarks;
+		// Recorded dialog traces given on the command line
+		std::vector<std::string> TracePaths;
+
+		void Add(std::string name, std::function<void(BenchmarkRun&)> run)
+		{
+			Benchmarks.push_back({ std::move(name), std::move(run) });
+		}
+	};
+
+	using BenchmarkGroup = void (*)(BenchmarkRegistry&);
+
+	inline std::vector<BenchmarkGroup>& GetBenchmarkGroups()
+	{
+		static std::vector<BenchmarkGroup> groups;
+		return groups;
+	}
+
+	struct BenchmarkGroupRegistration
+	{
+		explicit BenchmarkGroupRegistration(BenchmarkGroup group)
+		{
+			GetBenchmarkGroups().push_back(group);
+		}
+	};
+
+	// Keeps the compiler from optimizing away the computation of a value
+	template <typename T>
+	inline void Consume(const T& value)
+	{
+#if defined(_MSC_VER)
+		static const void* volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r"(&value) : "memory");
+#endif
+	}
+}
+
+// Groups add their benchmarks when the executable starts, after the command line is
+// read, so that they can build their inputs from it
+#define BENCHMARK_GROUP(name) \
+	static void name(::Files::Native::Benchmarks::BenchmarkRegistry& registry); \
+	static ::Files::Native::Benchmarks::BenchmarkGroupRegistration name##_registration(name); \
+	static void name(::Files::Native::Benchmarks::BenchmarkRegistry& registry)
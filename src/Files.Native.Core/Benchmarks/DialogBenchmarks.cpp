@@ -0,0 +1,573 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/PathCorpus.h"
+#include "DialogEventQueue.h"
+#include "DialogExecutor.h"
+#include "DialogResults.h"
+#include "DialogState.h"
+#include "DialogSessionProtocol.h"
+#include "FileTypeFilter.h"
+#include "ItemFilterProtocol.h"
+#include "SavePreflight.h"
+#include "SaveProperties.h"
+#include "Tests/TestExecutorHost.h"
+#include "Tests/TestPropertyStores.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+using namespace Files::Native::Tests;
+using namespace std::chrono;
+
+namespace
+{
+	std::wstring_view GetFileName(std::wstring_view path)
+	{
+		return path.substr(path.find_last_of(L'\\') + 1);
+	}
+
+	// The IFileDialogCustomize calls of a host adding the given number of controls: a visual
+	// group every eight, combo boxes of eight items, check buttons, edit boxes and buttons
+	std::vector<DialogCall> GetControlCalls(std::uint32_t count)
+	{
+		static const DialogControlKind kinds[] = { DialogControlKind::ComboBox, DialogControlKind::CheckButton,
+			DialogControlKind::PushButton, DialogControlKind::EditBox, DialogControlKind::Text, DialogControlKind::RadioButtonList };
+
+		std::vector<DialogCall> calls;
+		for (std::uint32_t id = 1; id <= count; id++)
+		{
+			if (id % 8 == 1)
+				calls.push_back({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::VisualGroup, "Group " + std::to_string(id / 8), 10000 + id });
+
+			DialogControlKind kind = kinds[id % std::size(kinds)];
+			calls.push_back({ DialogCallKind::AddControl, (std::uint32_t)kind, kind == DialogControlKind::ComboBox ? "" : "Control " + std::to_string(id), id });
+			if (kind == DialogControlKind::ComboBox || kind == DialogControlKind::RadioButtonList)
+			{
+				for (std::uint32_t item = 1; item <= 8; item++)
+					calls.push_back({ DialogCallKind::AddControlItem, 0, "Item " + std::to_string(item), id, item });
+				calls.push_back({ DialogCallKind::SetSelectedControlItem, 0, "", id, 1 });
+			}
+
+			if (id % 8 == 0)
+				calls.push_back({ DialogCallKind::EndVisualGroup });
+		}
+
+		return calls;
+	}
+
+	// Kind, control, item, value and text
+	std::string EncodeCall(const DialogCall& call)
+	{
+		std::string payload;
+		payload.push_back((char)call.Kind);
+		Files::Native::Detail::AppendUInt32(payload, call.Control);
+		Files::Native::Detail::AppendUInt32(payload, call.Item);
+		Files::Native::Detail::AppendUInt32(payload, call.Value);
+		Files::Native::Detail::AppendUInt32(payload, (std::uint32_t)call.Text.size());
+		payload.append(call.Text);
+		return payload;
+	}
+
+	bool DecodeCall(std::string_view payload, DialogCall& call)
+	{
+		std::size_t offset = 1;
+		if (payload.empty() || (unsigned char)payload[0] >= (unsigned char)DialogCallKind::Count)
+			return false;
+
+		call.Kind = (DialogCallKind)payload[0];
+		return Files::Native::Detail::ReadUInt32(payload, offset, call.Control) && Files::Native::Detail::ReadUInt32(payload, offset, call.Item) &&
+			Files::Native::Detail::ReadUInt32(payload, offset, call.Value) && Files::Native::Detail::ReadString(payload, offset, call.Text);
+	}
+
+	// What a dialog holds apart from its COM plumbing, see CFilesOpenDialog
+	struct DialogMembers
+	{
+		DialogState State;
+		DialogResults Results;
+		DialogEventQueue EventQueue;
+		FilterVerdictCache FilterVerdicts;
+		std::vector<FileTypeFilter> FileTypeFilters;
+
+		explicit DialogMembers(DialogKind kind) : State(kind)
+		{
+		}
+	};
+
+	// Storage that takes its time to answer, like a sleeping network share
+	struct DelayedStorage
+	{
+		milliseconds Delay;
+
+		SaveTargetFacts Stat(const std::wstring&)
+		{
+			std::this_thread::sleep_for(Delay);
+			return {};
+		}
+
+		std::optional<std::uint64_t> FreeBytes(const std::wstring&)
+		{
+			return 1ull << 30;
+		}
+
+		std::uint32_t OpenForWrite(const std::wstring&)
+		{
+			return 0;
+		}
+
+		std::uint32_t Create(const std::wstring&, bool)
+		{
+			return 0;
+		}
+	};
+}
+
+BENCHMARK_GROUP(DialogBenchmarks)
+{
+	// A dialog created, given the usual handful of Set* calls and released without being
+	// shown, as many hosts do. Nothing of it touches the disk, allocations are all it costs.
+	for (DialogKind kind : { DialogKind::Open, DialogKind::Save })
+	{
+		registry.Add(std::string("Dialog/CreateConfigureRelease/") + (kind == DialogKind::Open ? "Open" : "Save"), [kind](BenchmarkRun& run)
+		{
+			static const wchar_t* fileTypes[] = { L"*.docx;*.docm;*.dotx", L"*.doc;*.dot", L"*.pdf", L"*.*" };
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				DialogMembers dialog(kind);
+				dialog.State.Apply({ DialogCallKind::SetOptions, 0x1808 });
+				dialog.State.Apply({ DialogCallKind::SetClientGuid, 1 });
+				dialog.State.Apply({ DialogCallKind::SetTitle, 0, kind == DialogKind::Open ? "Open" : "Save As" });
+				dialog.State.Apply({ DialogCallKind::SetFileTypes, (std::uint32_t)std::size(fileTypes) });
+				for (const wchar_t* spec : fileTypes)
+					dialog.FileTypeFilters.push_back(FileTypeFilter::Compile(spec));
+				dialog.State.Apply({ DialogCallKind::SetFileTypeIndex, 1 });
+				dialog.State.Apply({ DialogCallKind::SetDefaultExtension, 0, "docx" });
+				dialog.State.Apply({ DialogCallKind::SetFolder, 1, "C:\\Users\\User\\Documents" });
+				dialog.State.Apply({ DialogCallKind::SetFileName, 0, "Report.docx" });
+				Consume(dialog);
+			}
+		});
+	}
+
+	// A host round-tripping the metadata of its document: GetProperties, four values set,
+	// GetProperties again and the values read back. Against a store made on every call,
+	// which is what each call cost before the cache, less the bind to the shell item.
+	for (bool cached : { true, false })
+	{
+		registry.Add(std::string("SavePropertyCache/GetSet/") + (cached ? "Cached" : "PerCall"), [cached](BenchmarkRun& run)
+		{
+			static const char* keys[] = { "System.Title", "System.Author", "System.Keywords", "System.Comment" };
+			BasicSavePropertyCache<TestPropertyStores> cache;
+			cache.SetDefaults(std::make_shared<std::map<std::string, std::string>>(std::map<std::string, std::string>{
+				{ "System.Title", "Quarterly Report" }, { "System.Author", "User" }, { "System.Company", "Contoso" } }));
+
+			TestPropertyStores::Store store;
+			std::size_t found = 0;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				if (!cached)
+					cache.Reset();
+				cache.Get(store);
+				for (const char* key : keys)
+					(*store)[key] = "Value";
+
+				if (!cached)
+					cache.Reset();
+				cache.Get(store);
+				for (const char* key : keys)
+					found += store->count(key);
+			}
+
+			run.Report("found", (double)found / run.Iterations);
+		});
+	}
+
+	// Selection changes as Files sends them over the session, 16 items each
+	for (const PathCorpus& corpus : GetPathCorpora())
+	{
+		registry.Add("DialogMessageCodec/SelectionChanged/16/" + corpus.Name, [&corpus](BenchmarkRun& run)
+		{
+			std::vector<std::string> payloads;
+			for (std::size_t i = 0; i + 16 <= corpus.Utf8Paths.size(); i += 16)
+			{
+				std::string payload;
+				for (std::size_t j = i; j < i + 16; j++)
+					payload.append(corpus.Utf8Paths[j]).push_back('\n');
+				payloads.push_back(std::move(payload));
+			}
+
+			run.BytesPerIteration = corpus.Utf8Size * 16;
+			DialogMessageCodec codec;
+			DialogMessage message;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				std::string frame = DialogMessageCodec::Encode(DialogMessageType::SelectionChanged, payloads[i % payloads.size()]);
+				codec.Feed(frame.data(), frame.size());
+				codec.Next(message);
+				Consume(message);
+			}
+		});
+	}
+
+	// The user holding an arrow key: a hundred changes, of which the host sees one
+	registry.Add("DialogEventQueue/SelectionBurst/100", [](BenchmarkRun& run)
+	{
+		const PathCorpus& corpus = GetPathCorpus("ascii");
+		DialogEventQueue queue;
+		DialogEventQueue::Clock::time_point now = DialogEventQueue::Clock::now();
+		DialogEvent event;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			for (std::size_t j = 0; j < 100; j++)
+				queue.Push(DialogEventKind::SelectionChange, corpus.Utf8Paths[(i + j) % corpus.Utf8Paths.size()]);
+
+			now += milliseconds(100);
+			queue.Pop(now, event);
+			Consume(event);
+		}
+	});
+
+	registry.Add("DialogExecutor/Yield", [](BenchmarkRun& run)
+	{
+		TestExecutorHost host;
+		DialogExecutor executor(host);
+		executor.Run([](DialogExecutor& executor, std::size_t iterations) -> Task<void>
+		{
+			for (std::size_t i = 0; i < iterations; i++)
+				co_await executor.Schedule();
+		}(executor, run.Iterations));
+	});
+
+	registry.Add("DialogExecutor/SpawnAndAwait", [](BenchmarkRun& run)
+	{
+		TestExecutorHost host;
+		DialogExecutor executor(host);
+		executor.Run([](DialogExecutor& executor, std::size_t iterations) -> Task<void>
+		{
+			for (std::size_t i = 0; i < iterations; i++)
+			{
+				auto spawned = executor.Spawn([]() -> Task<int> { co_return 1; }());
+				Consume(co_await spawned);
+			}
+		}(executor, run.Iterations));
+	});
+
+	// From the host's thread to a worker and back through the host's wait
+	registry.Add("DialogExecutor/Offload", [](BenchmarkRun& run)
+	{
+		TestExecutorHost host;
+		DialogExecutor executor(host);
+		executor.Run([](DialogExecutor& executor, std::size_t iterations) -> Task<void>
+		{
+			for (std::size_t i = 0; i < iterations; i++)
+				Consume(co_await executor.Offload([i]() { return i; }));
+		}(executor, run.Iterations));
+	});
+
+	// The save target checked under the dialog's 100 ms deadline, for storage answering
+	// before and after it
+	for (int delay : { 0, 50, 250 })
+	{
+		registry.Add("SavePreflight/Deadline100ms/" + std::to_string(delay) + "ms", [delay](BenchmarkRun& run)
+		{
+			TestExecutorHost host;
+			DialogExecutor executor(host);
+			std::size_t reports = executor.Run([](DialogExecutor& executor, std::size_t iterations, int delay) -> Task<std::size_t>
+			{
+				std::size_t reports = 0;
+				for (std::size_t i = 0; i < iterations; i++)
+				{
+					auto report = co_await executor.OffloadFor([delay]()
+					{
+						DelayedStorage storage{ milliseconds(delay) };
+						return SavePreflight::Run(storage, L"\\\\nas\\share\\Report.docx", {});
+					}, milliseconds(100));
+					reports += report.has_value();
+				}
+
+				co_return reports;
+			}(executor, run.Iterations, delay));
+
+			run.Report("reports", (double)reports / run.Iterations);
+		});
+	}
+
+	for (const PathCorpus& corpus : GetPathCorpora())
+	{
+		for (const wchar_t* spec : { L"*.png;*.jpg;*.jpeg;*.gif;*.bmp", L"Report-??.*;*.docx" })
+		{
+			std::string kind = spec[0] == L'*' ? "Extensions" : "Wildcards";
+			registry.Add("FileTypeFilter/" + kind + "/" + corpus.Name, [&corpus, spec](BenchmarkRun& run)
+			{
+				FileTypeFilter filter = FileTypeFilter::Compile(spec);
+				std::size_t matches = 0;
+				run.ResetTimer();
+				for (std::size_t i = 0; i < run.Iterations; i++)
+					matches += filter.Matches(GetFileName(corpus.Paths[i % corpus.Paths.size()]));
+
+				run.Report("matches", (double)matches / run.Iterations);
+			});
+		}
+	}
+
+	// The host's IShellItemFilter over a 100k item listing, one batch of FilterQuery::MaxNames
+	// per operation, including what the cache saves on a second listing
+	registry.Add("ItemFilter/Batch/" + std::to_string(FilterQuery::MaxNames), [](BenchmarkRun& run)
+	{
+		const PathCorpus& corpus = GetPathCorpus("ascii");
+		std::vector<FilterQuery> queries;
+		for (std::size_t offset = 0; offset < 100000; offset += FilterQuery::MaxNames)
+		{
+			FilterQuery& query = queries.emplace_back();
+			query.Id = (std::uint32_t)queries.size();
+			query.Folder = "C:\\Users\\User\\Documents";
+			for (std::size_t i = offset; i < offset + FilterQuery::MaxNames && i < 100000; i++)
+			{
+				const std::string& path = corpus.Utf8Paths[i % corpus.Utf8Paths.size()];
+				query.Names.push_back(std::to_string(i) + path.substr(path.find_last_of('\\') + 1));
+			}
+		}
+
+		FilterVerdictCache cache;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			FilterQuery received;
+			FilterQuery::Decode(queries[i % queries.size()].Encode(), received);
+
+			FilterVerdicts verdicts = cache.Evaluate(received, [](const std::string&, const std::string& name)
+			{
+				return name.size() % 3 != 0;
+			});
+			FilterVerdicts decoded;
+			FilterVerdicts::Decode(verdicts.Encode(), decoded);
+			Consume(decoded);
+		}
+	});
+
+	// The whole round trip of a 100k item folder: Files batching the names it lists, the
+	// dialog running them through the host's filter and Files keeping what was included.
+	// First listing of the folder, and a later one answered from the cache.
+	for (bool cached : { false, true })
+	{
+		registry.Add(std::string("ItemFilter/Folder/100k/") + (cached ? "Cached" : "First"), [cached](BenchmarkRun& run)
+		{
+			const PathCorpus& corpus = GetPathCorpus("ascii");
+			std::vector<std::string> names;
+			for (std::size_t i = 0; i < 100000; i++)
+			{
+				const std::string& path = corpus.Utf8Paths[i % corpus.Utf8Paths.size()];
+				names.push_back(std::to_string(i) + path.substr(path.find_last_of('\\') + 1));
+			}
+
+			auto evaluate = [](const std::string&, const std::string& name)
+			{
+				return name.size() % 3 != 0;
+			};
+
+			FilterVerdictCache cache;
+			std::size_t included = 0;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				if (!cached || i == 0)
+					cache.Clear();
+
+				std::vector<const std::string*> listed;
+				for (std::size_t offset = 0; offset < names.size(); offset += FilterQuery::MaxNames)
+				{
+					FilterQuery query;
+					query.Id = (std::uint32_t)(offset / FilterQuery::MaxNames);
+					query.Folder = "C:\\Users\\User\\Documents";
+					query.Names.assign(names.begin() + offset, names.begin() + std::min(offset + FilterQuery::MaxNames, names.size()));
+
+					FilterQuery received;
+					FilterQuery::Decode(query.Encode(), received);
+					FilterVerdicts verdicts;
+					FilterVerdicts::Decode(cache.Evaluate(received, evaluate).Encode(), verdicts);
+
+					for (std::size_t name = 0; name < query.Names.size(); name++)
+					{
+						if (verdicts.Included.Test(name))
+							listed.push_back(&names[offset + name]);
+					}
+				}
+
+				included += listed.size();
+				Consume(listed);
+			}
+
+			run.Report("included", (double)included / run.Iterations);
+		});
+	}
+
+	// A host's workers reading what Show() chose, 64 items, each read walking all of them
+	// through the set the results object of GetResults() holds. Next to it, the same reads
+	// serialized by a lock, as they are when every call goes back to the dialog's thread.
+	for (std::size_t threadCount : { 1, 2, 4, 8 })
+	{
+		for (bool locked : { false, true })
+		{
+			std::string name = std::string("DialogResults/") + (locked ? "LockedRead/" : "Read/") + std::to_string(threadCount) + "threads";
+			registry.Add(name, [threadCount, locked](BenchmarkRun& run)
+			{
+				const PathCorpus& corpus = GetPathCorpus("ascii");
+				DialogResults results;
+				results.Publish(std::vector<std::string>(corpus.Utf8Paths.begin(), corpus.Utf8Paths.begin() + 64));
+				std::shared_ptr<const DialogResultSet> set = results.Get();
+				std::mutex lock;
+
+				run.ResetTimer();
+				std::vector<std::thread> threads;
+				for (std::size_t t = 0; t < threadCount; t++)
+				{
+					threads.emplace_back([&, t]()
+					{
+						for (std::size_t i = t; i < run.Iterations; i += threadCount)
+						{
+							std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+							if (locked)
+								guard.lock();
+
+							std::size_t size = 0;
+							for (const std::string& item : set->Items)
+								size += item.size();
+							Consume(size);
+						}
+					});
+				}
+
+				for (std::thread& thread : threads)
+					thread.join();
+			});
+		}
+	}
+
+	for (std::uint32_t controlCount : { 8, 64 })
+	{
+		std::vector<DialogCall> calls = GetControlCalls(controlCount);
+		std::string suffix = "/" + std::to_string(controlCount);
+
+		registry.Add("DialogControls/Build" + suffix, [calls](BenchmarkRun& run)
+		{
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				DialogState state(DialogKind::Save);
+				for (const DialogCall& call : calls)
+					Consume(state.Apply(call));
+				Consume(state.GetControls().GetItems().size());
+			}
+
+			run.Report("calls", (double)calls.size());
+		});
+
+		// The controls sent as one message before Show, framed, read and decoded by Files
+		registry.Add("DialogControls/Snapshot" + suffix, [calls](BenchmarkRun& run)
+		{
+			DialogState state(DialogKind::Save);
+			for (const DialogCall& call : calls)
+				state.Apply(call);
+
+			DialogMessageCodec codec;
+			DialogMessage message;
+			std::size_t bytes = 0;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				std::string frame = DialogMessageCodec::Encode(DialogMessageType::Controls, state.GetControls().Encode());
+				bytes = frame.size();
+				codec.Feed(frame.data(), frame.size());
+				codec.Next(message);
+
+				DialogControls controls;
+				Consume(DialogControls::Decode(message.Payload, controls));
+			}
+
+			run.BytesPerIteration = (double)bytes;
+			run.Report("bytes", (double)bytes);
+		});
+
+		// What the snapshot replaces: every call forwarded in a message of its own
+		registry.Add("DialogControls/PerCallMessages" + suffix, [calls](BenchmarkRun& run)
+		{
+			DialogMessageCodec codec;
+			DialogMessage message;
+			std::size_t bytes = 0;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				bytes = 0;
+				DialogState state(DialogKind::Save);
+				for (const DialogCall& call : calls)
+				{
+					std::string frame = DialogMessageCodec::Encode(DialogMessageType::Controls, EncodeCall(call));
+					bytes += frame.size();
+					codec.Feed(frame.data(), frame.size());
+					codec.Next(message);
+
+					DialogCall received;
+					if (DecodeCall(message.Payload, received))
+						Consume(state.Apply(received));
+				}
+			}
+
+			run.BytesPerIteration = (double)bytes;
+			run.Report("bytes", (double)bytes);
+			run.Report("messages", (double)calls.size());
+		});
+	}
+
+	// The user going through the controls: 16 changes in one message, applied and answered
+	// with the values the host reads back
+	registry.Add("DialogControls/Changes/16", [](BenchmarkRun& run)
+	{
+		DialogState state(DialogKind::Save);
+		for (const DialogCall& call : GetControlCalls(64))
+			state.Apply(call);
+
+		DialogControlChanges changes;
+		for (std::uint32_t i = 0; i < 16; i++)
+		{
+			std::uint32_t id = 1 + i * 4;
+			switch (state.GetControls().Find(id)->Kind)
+			{
+			case DialogControlKind::ComboBox:
+			case DialogControlKind::RadioButtonList:
+				changes.Changes.push_back({ DialogControlChangeKind::ItemSelected, id, 1 + i % 8 });
+				break;
+			case DialogControlKind::CheckButton:
+				changes.Changes.push_back({ DialogControlChangeKind::CheckToggled, id, i % 2 });
+				break;
+			case DialogControlKind::EditBox:
+				changes.Changes.push_back({ DialogControlChangeKind::TextChanged, id, 0, "Typed " + std::to_string(i) });
+				break;
+			default:
+				changes.Changes.push_back({ DialogControlChangeKind::ButtonClicked, id });
+				break;
+			}
+		}
+
+		std::string payload = changes.Encode();
+		run.BytesPerIteration = (double)payload.size();
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			DialogControlChanges received;
+			DialogControlChanges::Decode(payload, received);
+			for (const DialogControlChange& change : received.Changes)
+			{
+				std::string text;
+				change.AppendTo(text);
+				Consume(state.Apply({ DialogCallKind::ControlChanged, 0, std::move(text) }));
+				Consume(state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", change.Control }));
+			}
+		}
+	});
+}
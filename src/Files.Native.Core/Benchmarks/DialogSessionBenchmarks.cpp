@@ -0,0 +1,120 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <optional>
+#include <string>
+#include <thread>
+#include "Benchmarks/Benchmark.h"
+#include "DialogExecutor.h"
+#include "Tests/FilesStandIn.h"
+#include "Tests/TestExecutorHost.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+using namespace Files::Native::Tests;
+using namespace std::chrono;
+
+namespace
+{
+	// Scaled down from the seconds a cold start of Files takes, what counts is how much of
+	// it the dialog gets to hide
+	constexpr FilesStandInTimings ColdFiles{ milliseconds(40), milliseconds(2), microseconds(0) };
+
+	const std::string Documents = "-directory \"C:\\Users\\User\\Documents\"";
+	const std::string Pictures = "-directory \"C:\\Users\\User\\Pictures\"";
+
+	double ToMilliseconds(steady_clock::duration elapsed)
+	{
+		return duration<double, std::milli>(elapsed).count();
+	}
+}
+
+BENCHMARK_GROUP(DialogSessionBenchmarks)
+{
+	// From Show() to the picker being on screen, with Files started by Show() itself, and by
+	// the pre-activation while the host spends the given time configuring the dialog
+	for (int configure : { -1, 20, 60 })
+	{
+		std::string name = configure < 0 ? "OnShow" : "PreActivated" + std::to_string(configure) + "ms";
+		registry.Add("DialogSession/TimeToVisible/" + name, [configure](BenchmarkRun& run)
+		{
+			TestExecutorHost host;
+			DialogExecutor executor(host);
+			double visible = 0;
+			std::size_t failures = 0;
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				std::optional<StandInSession> session;
+				if (configure >= 0)
+				{
+					session.emplace(ColdFiles, host);
+					std::this_thread::sleep_for(milliseconds(configure));
+				}
+
+				steady_clock::time_point start = steady_clock::now();
+				if (!session)
+					session.emplace(ColdFiles, host);
+
+				if (executor.Run(ShowAsync(executor, *session, Documents)) == Documents)
+					visible += ToMilliseconds(session->GetVisibleTime() - start);
+				else
+					failures++;
+			}
+
+			run.Report("visible_ms", visible / run.Iterations);
+			run.Report("failures", (double)failures);
+		});
+	}
+
+	// Show() on a new dialog, which starts Files, against the later calls on the same dialog,
+	// which only send the parameters to the session the first one left attached
+	registry.Add("DialogSession/Show/First", [](BenchmarkRun& run)
+	{
+		TestExecutorHost host;
+		DialogExecutor executor(host);
+		double shown = 0;
+		std::size_t failures = 0;
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			steady_clock::time_point start = steady_clock::now();
+			StandInSession session(ColdFiles, host);
+			failures += executor.Run(ShowAsync(executor, session, Documents)) != Documents;
+			shown += ToMilliseconds(steady_clock::now() - start);
+		}
+
+		run.Report("show_ms", shown / run.Iterations);
+		run.Report("failures", (double)failures);
+	});
+
+	registry.Add("DialogSession/Show/Nth", [](BenchmarkRun& run)
+	{
+		TestExecutorHost host;
+		DialogExecutor executor(host);
+		StandInSession session(ColdFiles, host);
+		std::size_t failures = executor.Run(ShowAsync(executor, session, Documents)) != Documents;
+
+		run.ResetTimer();
+		double shown = 0;
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			steady_clock::time_point start = steady_clock::now();
+			failures += executor.Run(ShowAsync(executor, session, Pictures)) != Pictures;
+			shown += ToMilliseconds(steady_clock::now() - start);
+		}
+
+		run.Report("show_ms", shown / run.Iterations);
+		run.Report("failures", (double)failures);
+	});
+
+	// Dialogs shown at once, each with its own session and result channel, none waiting on
+	// another's. Every dialog shows the picker Iterations times.
+	for (std::size_t dialogs : { 1, 8, 64 })
+	{
+		registry.Add("DialogSession/Concurrent/" + std::to_string(dialogs), [dialogs](BenchmarkRun& run)
+		{
+			ConcurrentDialogsResult result = RunConcurrentDialogs(dialogs, run.Iterations, { microseconds(0), milliseconds(1), microseconds(0) });
+			run.Report("shows_per_s", result.Shows / duration<double>(result.Elapsed).count());
+			run.Report("failures", (double)result.Failures);
+		});
+	}
+}
@@ -0,0 +1,193 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/PathCorpus.h"
+#include "DialogTrace.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+
+namespace
+{
+	class TraceBuilder
+	{
+		DialogTrace _trace;
+
+	public:
+		TraceBuilder(DialogKind kind, std::string host)
+		{
+			_trace.Kind = kind;
+			_trace.Host = std::move(host);
+		}
+
+		TraceBuilder& Add(DialogCallKind kind, std::uint32_t value = 0, std::string text = std::string(), std::uint64_t delay = 20)
+		{
+			_trace.Records.push_back({ delay, { kind, value, std::move(text) } });
+			return *this;
+		}
+
+		TraceBuilder& AddControlCall(DialogCallKind kind, std::uint32_t control, std::uint32_t item = 0, std::uint32_t value = 0, std::string text = std::string())
+		{
+			_trace.Records.push_back({ 20, { kind, value, std::move(text), control, item } });
+			return *this;
+		}
+
+		DialogTrace Build()
+		{
+			return std::move(_trace);
+		}
+	};
+
+	std::string GetFolder(const std::string& path)
+	{
+		return path.substr(0, path.find_last_of('\\'));
+	}
+
+	std::string Join(const std::vector<std::string>& paths, std::size_t first, std::size_t count)
+	{
+		std::string text;
+		for (std::size_t i = first; i < first + count; i++)
+			text.append(paths[i % paths.size()]).push_back('\n');
+
+		return text;
+	}
+
+	// Save As of an Office app: custom controls, the options read back over and over,
+	// a few folders visited
+	DialogTrace GetOfficeTrace()
+	{
+		const std::vector<std::string>& paths = GetPathCorpus("ascii").Utf8Paths;
+		TraceBuilder trace(DialogKind::Save, "winword.exe");
+		trace.Add(DialogCallKind::SetClientGuid, 1).Add(DialogCallKind::Advise)
+			.Add(DialogCallKind::SetOptions, 0x2 | 0x4 | 0x800 | 0x8000)
+			.Add(DialogCallKind::SetFileTypes, 18).Add(DialogCallKind::SetFileTypeIndex, 1)
+			.Add(DialogCallKind::SetDefaultExtension, 0, "docx")
+			.Add(DialogCallKind::SetFolder, 1, GetFolder(paths[0]))
+			.Add(DialogCallKind::SetFileName, 0, "Quarterly report.docx")
+			.Add(DialogCallKind::SetTitle, 0, "Save As");
+		trace.AddControlCall(DialogCallKind::AddControl, 100, 0, (std::uint32_t)DialogControlKind::CheckButton, "Save Thumbnail")
+			.AddControlCall(DialogCallKind::AddControl, 101, 0, (std::uint32_t)DialogControlKind::ComboBox);
+		for (std::uint32_t item = 1; item <= 3; item++)
+			trace.AddControlCall(DialogCallKind::AddControlItem, 101, item, 0, "Tools " + std::to_string(item));
+		trace.AddControlCall(DialogCallKind::SetSelectedControlItem, 101, 1);
+		for (int i = 0; i < 12; i++)
+			trace.Add(DialogCallKind::GetOptions);
+
+		trace.Add(DialogCallKind::Show, 0, std::string(), 5000);
+		for (std::size_t i = 1; i <= 5; i++)
+		{
+			trace.Add(DialogCallKind::FolderChanged, 0, GetFolder(paths[i]), 800);
+			trace.Add(DialogCallKind::GetFolder).Add(DialogCallKind::GetFileTypeIndex);
+			for (std::size_t j = 0; j < 4; j++)
+				trace.Add(DialogCallKind::SelectionChanged, 0, paths[i * 4 + j], 150).Add(DialogCallKind::GetCurrentSelection);
+		}
+
+		trace.Add(DialogCallKind::Completed, 0, paths[5] + "\n", 2000)
+			.Add(DialogCallKind::GetFileTypeIndex)
+			.AddControlCall(DialogCallKind::GetCheckButtonState, 100).AddControlCall(DialogCallKind::GetSelectedControlItem, 101)
+			.Add(DialogCallKind::GetResult).Add(DialogCallKind::GetFolder)
+			.Add(DialogCallKind::Close, 0).Add(DialogCallKind::Unadvise);
+		return trace.Build();
+	}
+
+	// Upload picker of a browser: multiple selection, many items picked
+	DialogTrace GetBrowserTrace()
+	{
+		const std::vector<std::string>& paths = GetPathCorpus("emoji").Utf8Paths;
+		TraceBuilder trace(DialogKind::Open, "msedge.exe");
+		trace.Add(DialogCallKind::SetOptions, 0x200 | 0x800 | 0x1000 | 0x40)
+			.Add(DialogCallKind::SetFileTypes, 3).Add(DialogCallKind::SetFileTypeIndex, 1)
+			.Add(DialogCallKind::SetClientGuid, 1).Add(DialogCallKind::Advise)
+			.Add(DialogCallKind::Show, 0, std::string(), 3000)
+			.Add(DialogCallKind::FolderChanged, 0, GetFolder(paths[0]), 600);
+		for (std::size_t i = 1; i <= 40; i++)
+			trace.Add(DialogCallKind::SelectionChanged, 0, Join(paths, 0, i), 120);
+
+		trace.Add(DialogCallKind::Completed, 0, Join(paths, 0, 40), 900)
+			.Add(DialogCallKind::GetResults).Add(DialogCallKind::GetSelectedItems)
+			.Add(DialogCallKind::Unadvise);
+		return trace.Build();
+	}
+
+	// Open Folder of an IDE: a folder picker polled for where it is
+	DialogTrace GetIdeTrace()
+	{
+		const std::vector<std::string>& paths = GetPathCorpus("cjk").Utf8Paths;
+		TraceBuilder trace(DialogKind::Open, "devenv.exe");
+		trace.Add(DialogCallKind::SetOptions, 0x20 | 0x40 | 0x800)
+			.Add(DialogCallKind::SetDefaultFolder, 1, GetFolder(GetFolder(paths[0])))
+			.Add(DialogCallKind::SetOkButtonLabel, 0, "Select Folder")
+			.Add(DialogCallKind::Advise)
+			.Add(DialogCallKind::Show, 0, std::string(), 2000);
+		for (std::size_t i = 0; i < 50; i++)
+		{
+			trace.Add(DialogCallKind::FolderChanged, 0, GetFolder(paths[i]), 400);
+			for (int poll = 0; poll < 4; poll++)
+				trace.Add(DialogCallKind::GetFolder, 0, std::string(), 50);
+		}
+
+		trace.Add(DialogCallKind::Completed, 0, GetFolder(paths[49]), 700)
+			.Add(DialogCallKind::GetResult).Add(DialogCallKind::Unadvise);
+		return trace.Build();
+	}
+
+	void AddTraceBenchmarks(BenchmarkRegistry& registry, const std::string& name, std::shared_ptr<const std::string> encoded)
+	{
+		registry.Add("DialogTrace/Decode/" + name, [encoded](BenchmarkRun& run)
+		{
+			run.BytesPerIteration = (double)encoded->size();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				DialogTrace trace;
+				Consume(DialogTrace::Decode(*encoded, trace));
+			}
+		});
+
+		// Everything the host asked and Files answered, without the waits in between
+		registry.Add("DialogTrace/Replay/" + name, [encoded](BenchmarkRun& run)
+		{
+			DialogTrace trace;
+			if (!DialogTrace::Decode(*encoded, trace))
+				return;
+
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				DialogState state(trace.Kind);
+				for (const DialogTraceRecord& record : trace.Records)
+					Consume(state.Apply(record.Call));
+			}
+
+			run.Report("calls", (double)trace.Records.size());
+		});
+	}
+}
+
+BENCHMARK_GROUP(DialogTraceBenchmarks)
+{
+	AddTraceBenchmarks(registry, "office", std::make_shared<std::string>(GetOfficeTrace().Encode()));
+	AddTraceBenchmarks(registry, "browser", std::make_shared<std::string>(GetBrowserTrace().Encode()));
+	AddTraceBenchmarks(registry, "ide", std::make_shared<std::string>(GetIdeTrace().Encode()));
+
+	// Recorded with RecordTraces set in the dialog settings
+	for (const std::string& path : registry.TracePaths)
+	{
+		std::ifstream file(path, std::ios::binary);
+		auto encoded = std::make_shared<std::string>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		DialogTrace trace;
+		if (!file || !DialogTrace::Decode(*encoded, trace))
+		{
+			std::fprintf(stderr, "Skipping %s: not a dialog trace of version %u or earlier\n", path.c_str(), DialogTrace::Version);
+			continue;
+		}
+
+		AddTraceBenchmarks(registry, path.substr(path.find_last_of("/\\") + 1), encoded);
+	}
+}
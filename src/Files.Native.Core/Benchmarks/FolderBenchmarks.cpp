@@ -0,0 +1,289 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/PathCorpus.h"
+#include "DialogOptions.h"
+#include "FolderMruStore.h"
+#include "FolderSnapshot.h"
+#include "ShellLocationCache.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+
+namespace
+{
+	// A folder of the given number of files and folders under the temporary folder, removed
+	// with the last benchmark using it
+	class TemporaryFolder
+	{
+		std::filesystem::path _path;
+
+	public:
+		TemporaryFolder(std::size_t fileCount, std::size_t folderCount)
+		{
+			_path = std::filesystem::temp_directory_path() /
+				("FilesNativeCoreBenchmarks-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+			std::filesystem::create_directories(_path);
+
+			const PathCorpus& corpus = GetPathCorpus("ascii");
+			for (std::size_t i = 0; i < fileCount; i++)
+			{
+				const std::string& path = corpus.Utf8Paths[i % corpus.Utf8Paths.size()];
+				std::ofstream(_path / (std::to_string(i) + "-" + path.substr(path.find_last_of('\\') + 1))) << path;
+			}
+
+			for (std::size_t i = 0; i < folderCount; i++)
+				std::filesystem::create_directory(_path / ("Folder " + std::to_string(i)));
+		}
+
+		~TemporaryFolder()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(_path, error);
+		}
+
+		const std::filesystem::path& GetPath() const
+		{
+			return _path;
+		}
+	};
+
+	// Lists a folder the way the Win32 enumerator does, through std::filesystem
+	class DirectorySource
+	{
+		std::filesystem::directory_iterator _next;
+
+	public:
+		explicit DirectorySource(const std::filesystem::path& path) :
+			_next(path)
+		{
+		}
+
+		bool Next(FolderSnapshotEntry& entry)
+		{
+			if (_next == std::filesystem::directory_iterator())
+				return false;
+
+			const std::filesystem::directory_entry& current = *_next;
+			entry.Name = current.path().filename().string();
+			entry.Attributes = current.is_directory() ? 0x10 : 0x80;
+			entry.Size = current.is_regular_file() ? current.file_size() : 0;
+			entry.LastWriteTime = (std::uint64_t)current.last_write_time().time_since_epoch().count();
+			++_next;
+			return true;
+		}
+	};
+
+	// Names and details of every entry, without building anything from them: what listing
+	// the folder costs Files when there is no snapshot
+	std::size_t ReadDirectory(const std::filesystem::path& path)
+	{
+		std::size_t count = 0;
+		for (const std::filesystem::directory_entry& current : std::filesystem::directory_iterator(path))
+		{
+			Consume(current.path().filename());
+			Consume(current.is_regular_file() ? current.file_size() : 0);
+			Consume(current.last_write_time());
+			count++;
+		}
+
+		return count;
+	}
+
+	// Lists a folder for a picker the way the Win32 enumerator does, where files are
+	// skipped before any of their details are read when the picker only wants folders
+	std::size_t ListForPicker(const std::filesystem::path& path, EnumerationMode mode)
+	{
+		bool listFiles = !HasFlag(mode, EnumerationMode::FoldersOnly);
+		std::vector<FolderSnapshotEntry> items;
+		for (const std::filesystem::directory_entry& current : std::filesystem::directory_iterator(path))
+		{
+			bool directory = current.is_directory();
+			if (!directory && !listFiles)
+				continue;
+
+			FolderSnapshotEntry& item = items.emplace_back();
+			item.Name = current.path().filename().string();
+			item.Attributes = directory ? 0x10 : 0x80;
+			item.Size = directory ? 0 : current.file_size();
+			item.LastWriteTime = (std::uint64_t)current.last_write_time().time_since_epoch().count();
+		}
+
+		Consume(items);
+		return items.size();
+	}
+
+	// Created by the first benchmark using the folder
+	std::function<const std::filesystem::path&()> SharedFolder(std::size_t fileCount, std::size_t folderCount)
+	{
+		auto folder = std::make_shared<std::optional<TemporaryFolder>>();
+		return [folder, fileCount, folderCount]() -> const std::filesystem::path&
+		{
+			if (!*folder)
+				folder->emplace(fileCount, folderCount);
+			return (*folder)->GetPath();
+		};
+	}
+}
+
+BENCHMARK_GROUP(FolderBenchmarks)
+{
+	// Shared by every host process through the mapping, 3 lookups to every write
+	for (std::size_t threadCount : { 1, 2, 4, 8 })
+	{
+		registry.Add("FolderMruStore/Contention/" + std::to_string(threadCount) + "threads", [threadCount](BenchmarkRun& run)
+		{
+			std::vector<char> region(FolderMruStore::RequiredSize, 0);
+			const PathCorpus& corpus = GetPathCorpus("ascii");
+
+			run.ResetTimer();
+			std::vector<std::thread> threads;
+			for (std::size_t t = 0; t < threadCount; t++)
+			{
+				threads.emplace_back([&, t]()
+				{
+					FolderMruStore store(region.data(), region.size());
+					for (std::size_t i = t; i < run.Iterations; i += threadCount)
+					{
+						std::string key = "{client-" + std::to_string(i % 64) + "}";
+						if (i % 4 == 0)
+							store.Remember(key, corpus.Utf8Paths[i % corpus.Utf8Paths.size()]);
+						else
+							Consume(store.Lookup(key));
+					}
+				});
+			}
+
+			for (std::thread& thread : threads)
+				thread.join();
+		});
+	}
+
+	// Listing the folder, against decoding the snapshot Files would be handed instead. The
+	// large folder is as large as a snapshot gets. The listings run on a warm cache, a
+	// cold one only adds to what the snapshot saves.
+	for (std::size_t fileCount : { (std::size_t)2000, FolderSnapshot::MaxEntries })
+	{
+		std::string size = std::to_string(fileCount);
+		auto getFolder = SharedFolder(fileCount, 0);
+
+		registry.Add("FolderSnapshot/ReadDirStat/" + size, [getFolder](BenchmarkRun& run)
+		{
+			const std::filesystem::path& path = getFolder();
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(ReadDirectory(path));
+		});
+
+		registry.Add("FolderSnapshot/Capture/" + size, [getFolder](BenchmarkRun& run)
+		{
+			const std::filesystem::path& path = getFolder();
+			std::atomic<bool> cancelled{ false };
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				DirectorySource source(path);
+				FolderSnapshot snapshot;
+				snapshot.Folder = path.string();
+				snapshot.Capture(source, cancelled);
+				Consume(snapshot);
+			}
+		});
+
+		registry.Add("FolderSnapshot/Encode/" + size, [getFolder](BenchmarkRun& run)
+		{
+			DirectorySource source(getFolder());
+			std::atomic<bool> cancelled{ false };
+			FolderSnapshot snapshot;
+			snapshot.Capture(source, cancelled);
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(snapshot.Encode());
+		});
+
+		registry.Add("FolderSnapshot/Decode/" + size, [getFolder](BenchmarkRun& run)
+		{
+			DirectorySource source(getFolder());
+			std::atomic<bool> cancelled{ false };
+			FolderSnapshot snapshot;
+			snapshot.Capture(source, cancelled);
+			std::string encoded = snapshot.Encode();
+
+			run.BytesPerIteration = (double)encoded.size();
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				FolderSnapshot decoded;
+				Consume(FolderSnapshot::Decode(encoded, decoded));
+			}
+		});
+	}
+
+	// A folder picker over a folder of 200k files, listing everything as before the
+	// enumeration mode reached Files, and skipping the files as it does now
+	auto getPickFolder = SharedFolder(200000, 1000);
+	for (std::uint32_t fos : { DialogOptions::PickFolders | DialogOptions::AllowMultiSelect, DialogOptions::AllowMultiSelect })
+	{
+		EnumerationMode mode = DialogOptions::GetEnumerationMode(fos);
+		registry.Add(std::string("FolderPick/200k/") + (HasFlag(mode, EnumerationMode::FoldersOnly) ? "FoldersOnly" : "AllItems"), [getPickFolder, mode](BenchmarkRun& run)
+		{
+			const std::filesystem::path& path = getPickFolder();
+			std::size_t items = 0;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				items += ListForPicker(path, mode);
+
+			run.Report("items", (double)items / run.Iterations);
+		});
+	}
+
+	// A full cache, looked up straight from the mapped file
+	auto cache = std::make_shared<std::string>();
+	{
+		ShellLocationCache locations;
+		locations.OsBuild = 26100;
+		locations.OsRevision = 4351;
+		locations.User = "S-1-5-21-1004336348-1177238915-682003330-1001";
+		std::string idList(2 + 20 * 8, '\x14');
+		for (std::size_t i = 0; i + 2 < idList.size(); i += 20)
+			idList[i + 1] = '\0';
+		idList[idList.size() - 2] = idList[idList.size() - 1] = '\0';
+
+		for (std::size_t i = 0; i < ShellLocationCache::MaxEntries; i++)
+			locations.Add("::{26ee0668-a00a-44d7-9371-beb064c98683}\\" + std::to_string(i), idList);
+		*cache = locations.Encode();
+	}
+
+	registry.Add("ShellLocationCache/Find/64", [cache](BenchmarkRun& run)
+	{
+		std::string keys[8];
+		for (std::size_t i = 0; i < 8; i++)
+			keys[i] = "::{26ee0668-a00a-44d7-9371-beb064c98683}\\" + std::to_string(i * 9);
+
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+			Consume(ShellLocationCache::Find(*cache, 26100, 4351, "S-1-5-21-1004336348-1177238915-682003330-1001", keys[i % 8]));
+	});
+
+	registry.Add("ShellLocationCache/GetKey", [](BenchmarkRun& run)
+	{
+		static constexpr std::wstring_view locations[] =
+		{
+			L"::{26EE0668-A00A-44D7-9371-BEB064C98683}\\0\\::{BB06C0E4-D293-4F75-8A90-CB05B6477EEE}",
+			L"shell:::{645FF040-5081-101B-9F08-00AA002F954E}",
+			L"Shell:RecycleBinFolder",
+			L"C:\\Users\\User\\Documents",
+		};
+
+		for (std::size_t i = 0; i < run.Iterations; i++)
+			Consume(ShellLocationCache::GetKey(locations[i % 4]));
+	});
+}
@@ -0,0 +1,289 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ActivationCommand.h"
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/PathCorpus.h"
+#include "LaunchBatch.h"
+#include "LaunchLatency.h"
+#include "LaunchProtocol.h"
+#include "LaunchRules.h"
+#include "Tests/TestPipe.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Benchmarks;
+using namespace Files::Native::Tests;
+
+namespace
+{
+	// 100k rules: shares routed to File Explorer, and the folders of the first ASCII
+	// paths routed to Files, so that some lookups hit deep in the tree
+	std::string GetLargeRules()
+	{
+		CorpusRandom random(0x52554C45);
+		std::string rules;
+		const PathCorpus& ascii = GetPathCorpus("ascii");
+		for (std::size_t i = 0; i < 100000; i++)
+		{
+			if (i < ascii.Utf8Paths.size())
+			{
+				const std::string& path = ascii.Utf8Paths[i];
+				rules.append("files ").append(path, 0, path.find_last_of('\\')).append("\n");
+			}
+			else
+			{
+				rules.append("explorer \\\\server").append(std::to_string(random.Next(1000000))).append("\\share").append(std::to_string(i)).append("\n");
+			}
+		}
+
+		return rules;
+	}
+
+	struct LargeRuleSet
+	{
+		std::string Rules = GetLargeRules();
+		std::string Image;
+		LaunchRuleSet Set;
+
+		LargeRuleSet()
+		{
+			std::size_t skipped;
+			Image = LaunchRuleSet::Compile(Rules, 1, Rules.size(), skipped);
+			Set.Attach(Image, 1, Rules.size());
+		}
+	};
+
+	// Stand-in for a running Files instance serving launch requests until the client
+	// closes the pipe. Activations navigate, amended selections don't.
+	class StandInInstance
+	{
+		std::pair<TestPipe, TestPipe> _pipe = TestPipe::Create();
+		std::thread _thread;
+
+	public:
+		std::size_t Navigations = 0;
+		std::size_t Selections = 0;
+
+		StandInInstance()
+		{
+			_thread = std::thread([this]()
+			{
+				LaunchRequestKind kind;
+				std::string payload;
+				while (LaunchProtocol::Receive(_pipe.second, kind, payload))
+				{
+					if (kind == LaunchRequestKind::Activate)
+						Navigations++;
+					if (kind == LaunchRequestKind::AmendSelection || payload.find(" -select ") != std::string::npos)
+						Selections++;
+
+					LaunchProtocol::Reply(_pipe.second, LaunchStatus::Accepted);
+				}
+			});
+		}
+
+		~StandInInstance()
+		{
+			_pipe.first.Close();
+			_thread.join();
+		}
+
+		TestPipe& GetClient()
+		{
+			return _pipe.first;
+		}
+	};
+
+	// Launch latencies in microseconds, mostly a quarter to half a second with a long tail
+	std::vector<std::uint64_t> GetLatencies()
+	{
+		CorpusRandom random(0x4C415445);
+		std::vector<std::uint64_t> latencies(65536);
+		for (std::uint64_t& latency : latencies)
+			latency = 250000 + random.Next(250000) + (random.Next(100) < 5 ? random.Next(1u << random.Next(10, 24)) : 0);
+
+		return latencies;
+	}
+}
+
+BENCHMARK_GROUP(LaunchBenchmarks)
+{
+	for (const PathCorpus& corpus : GetPathCorpora())
+	{
+		registry.Add("GetLaunchRoute/" + corpus.Name, [&corpus](BenchmarkRun& run)
+		{
+			run.BytesPerIteration = corpus.Utf8Size;
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				Consume(GetLaunchRoute(std::wstring_view(corpus.Paths[i % corpus.Paths.size()])));
+		});
+	}
+
+	auto rules = std::make_shared<std::optional<LargeRuleSet>>();
+	auto getRules = [rules]() -> LargeRuleSet&
+	{
+		if (!*rules)
+			rules->emplace();
+		return **rules;
+	};
+
+	registry.Add("LaunchRules/Compile/100k", [getRules](BenchmarkRun& run)
+	{
+		const std::string& text = getRules().Rules;
+		run.BytesPerIteration = (double)text.size();
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			std::size_t skipped;
+			Consume(LaunchRuleSet::Compile(text, 1, text.size(), skipped));
+		}
+	});
+
+	registry.Add("LaunchRules/Attach/100k", [getRules](BenchmarkRun& run)
+	{
+		LargeRuleSet& large = getRules();
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			LaunchRuleSet set;
+			Consume(set.Attach(large.Image, 1, large.Rules.size()));
+		}
+	});
+
+	for (const PathCorpus& corpus : GetPathCorpora())
+	{
+		registry.Add("LaunchRules/Match/100k/" + corpus.Name, [&corpus, getRules](BenchmarkRun& run)
+		{
+			const LaunchRuleSet& set = getRules().Set;
+			std::size_t hits = 0;
+			run.BytesPerIteration = corpus.Utf8Size;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+				hits += set.Match(std::wstring_view(corpus.Paths[i % corpus.Paths.size()])).has_value();
+
+			run.Report("hits", (double)hits / run.Iterations);
+		});
+	}
+
+	// A -batch list of 10k locations: a third selections, the rest folders
+	auto list = std::make_shared<std::string>();
+	const PathCorpus& ascii = GetPathCorpus("ascii");
+	for (std::size_t i = 0; i < 10000; i++)
+	{
+		const std::string& path = ascii.Utf8Paths[i % ascii.Utf8Paths.size()];
+		if (i % 3 == 0)
+			list->append("-select \"").append(path).append("\"\r\n");
+		else
+			list->append(path, 0, path.find_last_of('\\')).append("\r\n");
+	}
+
+	registry.Add("LaunchBatch/Parse/10k", [list](BenchmarkRun& run)
+	{
+		run.BytesPerIteration = (double)list->size();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+			Consume(LaunchBatch::Parse(*list));
+	});
+
+	registry.Add("LaunchBatch/BuildCommandLines/10k", [list](BenchmarkRun& run)
+	{
+		LaunchBatch batch = LaunchBatch::Parse(*list);
+		std::size_t commandLines = 0;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			auto built = batch.BuildCommandLines("C:\\Users\\User\\AppData\\Local\\Microsoft\\WindowsApps\\files-dev.exe", 8000);
+			commandLines += built.size();
+			Consume(built);
+		}
+
+		run.Report("activations", (double)commandLines / run.Iterations);
+	});
+
+	// A launch handed to a running instance, request to reply
+	registry.Add("LaunchProtocol/RoundTrip", [&ascii](BenchmarkRun& run)
+	{
+		StandInInstance instance;
+		run.BytesPerIteration = ascii.Utf8Size;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			std::string commandLine = "\"files-dev.exe\" -directory \"" + ascii.Utf8Paths[i % ascii.Utf8Paths.size()] + "\"";
+			Consume(LaunchProtocol::Send(instance.GetClient(), LaunchRequestKind::Activate, commandLine));
+		}
+	});
+
+	// An item turning up after the launcher opened its folder: amending the selection of
+	// the activation, against activating Files again with -select
+	for (bool amend : { true, false })
+	{
+		registry.Add(std::string("LaunchProtocol/LateSelection/") + (amend ? "Amend" : "Reactivate"), [&ascii, amend](BenchmarkRun& run)
+		{
+			StandInInstance instance;
+			run.ResetTimer();
+			for (std::size_t i = 0; i < run.Iterations; i++)
+			{
+				const std::string& path = ascii.Utf8Paths[i % ascii.Utf8Paths.size()];
+				std::string folder = path.substr(0, path.find_last_of('\\'));
+				LaunchProtocol::Send(instance.GetClient(), LaunchRequestKind::Activate, "\"files-dev.exe\" -directory \"" + folder + "\"");
+				if (amend)
+					LaunchProtocol::Send(instance.GetClient(), LaunchRequestKind::AmendSelection, path);
+				else
+					LaunchProtocol::Send(instance.GetClient(), LaunchRequestKind::Activate, "\"files-dev.exe\" -select \"" + path + "\"");
+			}
+
+			// Each request was answered, so the instance has counted them all
+			run.Report("navigations", (double)instance.Navigations / run.Iterations);
+			run.Report("selections", (double)instance.Selections / run.Iterations);
+		});
+	}
+
+	auto latencies = std::make_shared<std::vector<std::uint64_t>>(GetLatencies());
+
+	// A launcher's update, the named mutex of the mapped file stood in for by a mutex
+	registry.Add("LaunchLatency/Record", [latencies](BenchmarkRun& run)
+	{
+		std::vector<char> region(LaunchLatencyStore::RequiredSize, 0);
+		std::mutex lock;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			LaunchLatencyStore store(region.data(), region.size());
+			store.Record((LaunchOutcome)(i % (std::size_t)LaunchOutcome::Count), (*latencies)[i % latencies->size()]);
+		}
+
+		Consume(region);
+	});
+
+	registry.Add("LaunchLatency/Percentiles/64k", [latencies](BenchmarkRun& run)
+	{
+		LatencyHistogram histogram;
+		for (std::uint64_t latency : *latencies)
+			histogram.Record(latency);
+
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+		{
+			Consume(histogram.GetPercentile(50));
+			Consume(histogram.GetPercentile(99));
+		}
+	});
+
+	// Adding the file of one machine to a fleet total, as the dump tool does per file
+	registry.Add("LaunchLatency/MergeFile", [latencies](BenchmarkRun& run)
+	{
+		std::vector<char> fleet(LaunchLatencyStore::RequiredSize, 0), machine(LaunchLatencyStore::RequiredSize, 0);
+		LaunchLatencyStore total(fleet.data(), fleet.size()), file(machine.data(), machine.size());
+		for (std::size_t i = 0; i < latencies->size(); i++)
+			file.Record((LaunchOutcome)(i % (std::size_t)LaunchOutcome::Count), (*latencies)[i]);
+
+		run.BytesPerIteration = (double)LaunchLatencyStore::RequiredSize;
+		run.ResetTimer();
+		for (std::size_t i = 0; i < run.Iterations; i++)
+			total.Merge(LaunchLatencyStore(machine.data(), machine.size()));
+
+		Consume(fleet);
+	});
+}
@@ -0,0 +1,153 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Runs the benchmarks and reports the time, throughput and allocations of one
+//  operation of each.
+//
+//  Files.Native.Core.Benchmarks [--filter <text>]... [--min-time <ms>] [--quick] [--list]
+//                               [--trace <file>]...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "Benchmarks/Benchmark.h"
+
+using namespace Files::Native::Benchmarks;
+
+void* operator new(std::size_t size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* block = std::malloc(size ? size : 1))
+		return block;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
+namespace
+{
+	struct Measurement
+	{
+		double Seconds;
+		std::uint64_t Allocations;
+	};
+
+	Measurement Measure(const Benchmark& benchmark, BenchmarkRun& run)
+	{
+		run.Counters.clear();
+		run.ResetTimer();
+		benchmark.Run(run);
+		auto elapsed = std::chrono::steady_clock::now() - run.StartTime;
+
+		return { std::chrono::duration<double>(elapsed).count(), AllocationCount.load() - run.StartAllocations };
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> filters;
+	double minTime = 0.2;
+	bool quick = false, list = false;
+
+	BenchmarkRegistry registry;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+		{
+			filters.push_back(argv[++i]);
+		}
+		else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+		{
+			minTime = std::atof(argv[++i]) / 1000;
+		}
+		else if (!std::strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			registry.TracePaths.push_back(argv[++i]);
+		}
+		else if (!std::strcmp(argv[i], "--quick"))
+		{
+			quick = true;
+		}
+		else if (!std::strcmp(argv[i], "--list"))
+		{
+			list = true;
+		}
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [--filter <text>]... [--min-time <ms>] [--quick] [--list] [--trace <file>]...\n", argv[0]);
+			return 2;
+		}
+	}
+
+	for (BenchmarkGroup group : GetBenchmarkGroups())
+		group(registry);
+
+	if (!list)
+		std::printf("%-52s %12s %10s %10s\n", "Benchmark", "ns/op", "MB/s", "allocs/op");
+
+	int run = 0;
+	for (const Benchmark& benchmark : registry.Benchmarks)
+	{
+		bool selected = filters.empty();
+		for (const std::string& filter : filters)
+			selected = selected || benchmark.Name.find(filter) != std::string::npos;
+		if (!selected)
+			continue;
+
+		run++;
+		if (list)
+		{
+			std::printf("%s\n", benchmark.Name.c_str());
+			continue;
+		}
+
+		// The first run warms up, and is all a quick run does
+		BenchmarkRun current;
+		Measurement measurement = Measure(benchmark, current);
+		if (!quick)
+		{
+			// Grows the run until it takes a tenth of the time, then sizes it to take all of it
+			while (measurement.Seconds < minTime / 10 && current.Iterations < ((std::size_t)1 << 40))
+			{
+				current.Iterations *= 10;
+				measurement = Measure(benchmark, current);
+			}
+
+			if (measurement.Seconds < minTime)
+			{
+				current.Iterations = (std::size_t)(current.Iterations * minTime / std::max(measurement.Seconds, 1e-9)) + 1;
+				measurement = Measure(benchmark, current);
+			}
+		}
+
+		double iterations = (double)current.Iterations;
+		std::printf("%-52s %12.1f %10.1f %10.2f", benchmark.Name.c_str(), measurement.Seconds * 1e9 / iterations,
+			current.BytesPerIteration * iterations / measurement.Seconds / 1e6, measurement.Allocations / iterations);
+		for (const auto& [name, value] : current.Counters)
+			std::printf("  %s=%.2f", name.c_str(), value);
+
+		std::printf("\n");
+		std::fflush(stdout);
+	}
+
+	if (run == 0)
+	{
+		std::fprintf(stderr, "No benchmarks selected\n");
+		return 1;
+	}
+
+	return 0;
+}
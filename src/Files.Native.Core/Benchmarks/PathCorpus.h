@@ -0,0 +1,226 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Synthetic paths the benchmarks run over, the same on every platform and every run.
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "ActivationCommand.h"
+
+namespace Files::Native::Benchmarks
+{
+	struct PathCorpus
+	{
+		// ascii, cjk, emoji, long32k or deepunc
+		std::string Name;
+		std::vector<std::wstring> Paths;
+		std::vector<std::string> Utf8Paths;
+		// Average UTF-8 size of a path
+		double Utf8Size = 0;
+	};
+
+	// std::mt19937 yields the same sequence everywhere, unlike the standard distributions,
+	// so bounds are applied here
+	class CorpusRandom
+	{
+		std::mt19937 _engine;
+
+	public:
+		explicit CorpusRandom(std::uint32_t seed) :
+			_engine(seed)
+		{
+		}
+
+		// In [0, bound)
+		std::uint32_t Next(std::uint32_t bound)
+		{
+			return (std::uint32_t)(((std::uint64_t)_engine() * bound) >> 32);
+		}
+
+		// In [minimum, maximum]
+		std::uint32_t Next(std::uint32_t minimum, std::uint32_t maximum)
+		{
+			return minimum + Next(maximum - minimum + 1);
+		}
+	};
+
+	namespace Detail
+	{
+		// UTF-16 where wchar_t is 2 bytes, UTF-32 otherwise
+		inline void AppendCodePoint(std::wstring& output, char32_t codePoint)
+		{
+			if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+			{
+				output.push_back((wchar_t)(0xD800 + ((codePoint - 0x10000) >> 10)));
+				output.push_back((wchar_t)(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+			}
+			else
+			{
+				output.push_back((wchar_t)codePoint);
+			}
+		}
+
+		enum class SegmentKind
+		{
+			Ascii,
+			Cjk,
+			Emoji,
+		};
+
+		inline void AppendSegment(std::wstring& output, CorpusRandom& random, SegmentKind kind)
+		{
+			static constexpr char asciiCharacters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-";
+			switch (kind)
+			{
+			case SegmentKind::Ascii:
+				for (std::uint32_t i = random.Next(3, 16); i > 0; i--)
+					output.push_back((wchar_t)asciiCharacters[random.Next(sizeof(asciiCharacters) - 1)]);
+				break;
+			case SegmentKind::Cjk:
+				// Mostly ideographs, some kana
+				for (std::uint32_t i = random.Next(2, 8); i > 0; i--)
+					AppendCodePoint(output, random.Next(4) ? random.Next(0x4E00, 0x9FFF) : random.Next(0x3041, 0x3096));
+				break;
+			case SegmentKind::Emoji:
+				for (std::uint32_t i = random.Next(1, 4); i > 0; i--)
+					output.push_back((wchar_t)asciiCharacters[random.Next(26)]);
+				for (std::uint32_t i = random.Next(1, 3); i > 0; i--)
+				{
+					if (random.Next(4) == 0)
+					{
+						// Woman technologist, a joined sequence
+						AppendCodePoint(output, 0x1F469);
+						AppendCodePoint(output, 0x200D);
+						AppendCodePoint(output, 0x1F4BB);
+					}
+					else
+					{
+						AppendCodePoint(output, random.Next(2) ? random.Next(0x1F300, 0x1F5FF) : random.Next(0x1F600, 0x1F64F));
+					}
+				}
+				break;
+			}
+		}
+
+		inline void AppendFileName(std::wstring& output, CorpusRandom& random, SegmentKind kind)
+		{
+			static constexpr const wchar_t* extensions[] = { L".txt", L".docx", L".png", L".jpg", L".pdf", L".cpp", L".xlsx", L".zip" };
+			AppendSegment(output, random, kind);
+			output.append(extensions[random.Next(sizeof(extensions) / sizeof(*extensions))]);
+		}
+
+		inline PathCorpus CreateCorpus(std::string name, std::vector<std::wstring> paths)
+		{
+			PathCorpus corpus;
+			corpus.Name = std::move(name);
+			corpus.Paths = std::move(paths);
+
+			std::size_t utf8Size = 0;
+			for (const std::wstring& path : corpus.Paths)
+			{
+				corpus.Utf8Paths.push_back(ToUtf8(std::wstring_view(path)));
+				utf8Size += corpus.Utf8Paths.back().size();
+			}
+
+			corpus.Utf8Size = (double)utf8Size / corpus.Paths.size();
+			return corpus;
+		}
+
+		// Local paths under a user profile, with folders and files named by kind
+		inline PathCorpus CreateLocalCorpus(std::string name, std::uint32_t seed, SegmentKind kind)
+		{
+			CorpusRandom random(seed);
+			std::vector<std::wstring> paths;
+			for (int i = 0; i < 4096; i++)
+			{
+				std::wstring path = L"C:\\Users\\";
+				AppendSegment(path, random, SegmentKind::Ascii);
+				for (std::uint32_t depth = random.Next(2, 8); depth > 0; depth--)
+				{
+					path.push_back(L'\\');
+					AppendSegment(path, random, kind);
+				}
+
+				path.push_back(L'\\');
+				AppendFileName(path, random, kind);
+				paths.push_back(std::move(path));
+			}
+
+			return CreateCorpus(std::move(name), std::move(paths));
+		}
+
+		// Paths just short of the 32767 characters Windows allows
+		inline PathCorpus CreateLongCorpus(std::uint32_t seed)
+		{
+			CorpusRandom random(seed);
+			std::vector<std::wstring> paths;
+			for (int i = 0; i < 16; i++)
+			{
+				std::wstring path = L"\\\\?\\C:\\Data";
+				while (path.size() < 32000 - 40)
+				{
+					path.push_back(L'\\');
+					AppendSegment(path, random, random.Next(8) ? SegmentKind::Ascii : SegmentKind::Cjk);
+				}
+
+				path.push_back(L'\\');
+				AppendFileName(path, random, SegmentKind::Ascii);
+				paths.push_back(std::move(path));
+			}
+
+			return CreateCorpus("long32k", std::move(paths));
+		}
+
+		// Shares on a handful of servers, many folders deep
+		inline PathCorpus CreateUncCorpus(std::uint32_t seed)
+		{
+			CorpusRandom random(seed);
+			std::vector<std::wstring> paths;
+			for (int i = 0; i < 1024; i++)
+			{
+				std::wstring path = L"\\\\fileserver" + std::to_wstring(random.Next(8)) + L"\\share" + std::to_wstring(random.Next(32));
+				for (std::uint32_t depth = random.Next(24, 48); depth > 0; depth--)
+				{
+					path.push_back(L'\\');
+					AppendSegment(path, random, SegmentKind::Ascii);
+				}
+
+				path.push_back(L'\\');
+				AppendFileName(path, random, SegmentKind::Ascii);
+				paths.push_back(std::move(path));
+			}
+
+			return CreateCorpus("deepunc", std::move(paths));
+		}
+	}
+
+	inline const std::vector<PathCorpus>& GetPathCorpora()
+	{
+		static const std::vector<PathCorpus> corpora =
+		{
+			Detail::CreateLocalCorpus("ascii", 0x46494C45, Detail::SegmentKind::Ascii),
+			Detail::CreateLocalCorpus("cjk", 0x46494C46, Detail::SegmentKind::Cjk),
+			Detail::CreateLocalCorpus("emoji", 0x46494C47, Detail::SegmentKind::Emoji),
+			Detail::CreateLongCorpus(0x46494C48),
+			Detail::CreateUncCorpus(0x46494C49),
+		};
+
+		return corpora;
+	}
+
+	inline const PathCorpus& GetPathCorpus(std::string_view name)
+	{
+		for (const PathCorpus& corpus : GetPathCorpora())
+		{
+			if (corpus.Name == name)
+				return corpus;
+		}
+
+		return GetPathCorpora().front();
+	}
+}
@@ -0,0 +1,669 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  The controls a host adds to a dialog through IFileDialogCustomize, kept as flat
+//  records with their strings in one arena. Files gets them as one snapshot along
+//  with the picker and sends back what the user changed.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	// Stored in snapshots and traces, only ever append
+	enum class DialogControlKind : std::uint8_t
+	{
+		PushButton,
+		Menu,
+		ComboBox,
+		RadioButtonList,
+		CheckButton,
+		EditBox,
+		Separator,
+		Text,
+		VisualGroup,
+		// The open button, made a drop-down by EnableOpenDropDown
+		OpenDropDown,
+		Count,
+	};
+
+	// A string of the registry's arena
+	struct DialogControlText
+	{
+		std::uint32_t Offset = 0;
+		std::uint32_t Size = 0;
+	};
+
+	struct DialogControl
+	{
+		std::uint32_t Id = 0;
+		DialogControlKind Kind = DialogControlKind::PushButton;
+		// CDCS_* flags
+		std::uint8_t State = 0;
+		bool Checked = false;
+		bool Prominent = false;
+		bool HasSelection = false;
+		// Index + 1 of the visual group the control was added in, 0 when in none
+		std::uint32_t Group = 0;
+		// The label, or the text of a text control
+		DialogControlText Label;
+		// What an edit box holds
+		DialogControlText Text;
+		std::uint32_t SelectedItem = 0;
+	};
+
+	struct DialogControlItem
+	{
+		// Index of the control in the registry
+		std::uint32_t Control = 0;
+		std::uint32_t Id = 0;
+		std::uint8_t State = 0;
+		DialogControlText Label;
+	};
+
+	// Stored in traces, only ever append
+	enum class DialogControlChangeKind : std::uint8_t
+	{
+		// Value is the item picked in a combo box, radio button list, menu or the drop-down
+		ItemSelected,
+		// Value is 1 when checked
+		CheckToggled,
+		ButtonClicked,
+		// Text is what the edit box holds
+		TextChanged,
+		Count,
+	};
+
+	// Files -> dialog: what the user did to one control
+	struct DialogControlChange
+	{
+		DialogControlChangeKind Kind = DialogControlChangeKind::ButtonClicked;
+		std::uint32_t Control = 0;
+		std::uint32_t Value = 0;
+		std::string Text;
+
+		// Kind, control, value, then the text prefixed with its byte length
+		void AppendTo(std::string& output) const
+		{
+			output.push_back((char)Kind);
+			Detail::AppendUInt32(output, Control);
+			Detail::AppendUInt32(output, Value);
+			Detail::AppendUInt32(output, (std::uint32_t)Text.size());
+			output.append(Text);
+		}
+
+		static bool Read(std::string_view input, std::size_t& offset, DialogControlChange& change)
+		{
+			if (offset >= input.size() || (unsigned char)input[offset] >= (unsigned char)DialogControlChangeKind::Count)
+				return false;
+
+			change.Kind = (DialogControlChangeKind)input[offset++];
+			return Detail::ReadUInt32(input, offset, change.Control) &&
+				Detail::ReadUInt32(input, offset, change.Value) &&
+				Detail::ReadString(input, offset, change.Text);
+		}
+	};
+
+	// Files -> dialog: the changes since the last message, in the order the user made them.
+	// Payload: count, then the changes.
+	struct DialogControlChanges
+	{
+		static constexpr std::uint32_t MaxChanges = 1024;
+
+		std::vector<DialogControlChange> Changes;
+
+		std::string Encode() const
+		{
+			std::string payload;
+			Detail::AppendUInt32(payload, (std::uint32_t)Changes.size());
+			for (const DialogControlChange& change : Changes)
+				change.AppendTo(payload);
+
+			return payload;
+		}
+
+		static bool Decode(std::string_view payload, DialogControlChanges& changes)
+		{
+			std::size_t offset = 0;
+			std::uint32_t count;
+			// A change takes at least 13 bytes, a larger count is a lie
+			if (!Detail::ReadUInt32(payload, offset, count) || count > MaxChanges || count > (payload.size() - offset) / 13)
+				return false;
+
+			changes.Changes.resize(count);
+			for (DialogControlChange& change : changes.Changes)
+			{
+				if (!DialogControlChange::Read(payload, offset, change))
+					return false;
+			}
+
+			return offset == payload.size();
+		}
+	};
+
+	// Every call of IFileDialogCustomize lands here. Controls are never removed, so their
+	// indexes are stable, and ids map to them through a sorted index. Strings replaced by a
+	// later call leave their bytes in the arena until they make up most of it.
+	class DialogControls
+	{
+	public:
+		// CDCS_* values of shobjidl_core.h, repeated here so that this header builds anywhere
+		static constexpr std::uint8_t Enabled = 0x1;
+		static constexpr std::uint8_t Visible = 0x2;
+
+		// Past these the host is refused, the snapshot stays well within a session message
+		static constexpr std::size_t MaxControls = 1024;
+		static constexpr std::size_t MaxItems = 8192;
+		static constexpr std::size_t MaxTextSize = 4096;
+		static constexpr std::size_t MaxArenaSize = 256 * 1024;
+
+		static constexpr std::size_t ControlRecordSize = 32;
+		static constexpr std::size_t ItemRecordSize = 20;
+
+		bool IsEmpty() const
+		{
+			return _controls.empty();
+		}
+
+		const std::vector<DialogControl>& GetControls() const
+		{
+			return _controls;
+		}
+
+		const std::vector<DialogControlItem>& GetItems() const
+		{
+			return _items;
+		}
+
+		std::string_view GetString(DialogControlText text) const
+		{
+			return std::string_view(_arena).substr(text.Offset, text.Size);
+		}
+
+		// Bytes of the arena no record points to any more
+		std::size_t GetGarbageSize() const
+		{
+			return _garbage;
+		}
+
+		const DialogControl* Find(std::uint32_t id) const
+		{
+			std::size_t index = FindIndex(id);
+			return index < _controls.size() ? &_controls[index] : nullptr;
+		}
+
+		// A control added between StartVisualGroup and EndVisualGroup belongs to the group
+		bool Add(std::uint32_t id, DialogControlKind kind, std::string_view label, bool checked = false)
+		{
+			auto position = std::lower_bound(_index.begin(), _index.end(), id, CompareId);
+			if (kind >= DialogControlKind::Count || _controls.size() >= MaxControls ||
+				(position != _index.end() && position->first == id) ||
+				(kind == DialogControlKind::VisualGroup && _group) ||
+				!CanStore(label.size()))
+				return false;
+
+			DialogControl& control = _controls.emplace_back();
+			control.Id = id;
+			control.Kind = kind;
+			control.State = Enabled | Visible;
+			control.Checked = kind == DialogControlKind::CheckButton && checked;
+			control.Group = _group;
+			if (kind == DialogControlKind::EditBox)
+				control.Text = Store(label);
+			else
+				control.Label = Store(label);
+
+			std::uint32_t index = (std::uint32_t)_controls.size() - 1;
+			_index.insert(position, { id, index });
+			if (kind == DialogControlKind::VisualGroup)
+				_group = index + 1;
+
+			return true;
+		}
+
+		void EndGroup()
+		{
+			_group = 0;
+		}
+
+		bool SetLabel(std::uint32_t id, std::string_view label)
+		{
+			DialogControl* control = FindMutable(id);
+			return control && control->Kind != DialogControlKind::Separator && Replace(control->Label, label);
+		}
+
+		bool SetState(std::uint32_t id, std::uint32_t state)
+		{
+			DialogControl* control = FindMutable(id);
+			if (!control)
+				return false;
+
+			control->State = (std::uint8_t)(state & (Enabled | Visible));
+			return true;
+		}
+
+		bool GetState(std::uint32_t id, std::uint32_t& state) const
+		{
+			const DialogControl* control = Find(id);
+			state = control ? control->State : 0;
+			return control != nullptr;
+		}
+
+		bool SetText(std::uint32_t id, std::string_view text)
+		{
+			DialogControl* control = FindMutable(id);
+			return control && control->Kind == DialogControlKind::EditBox && Replace(control->Text, text);
+		}
+
+		// Points into the arena, valid until the next change
+		bool GetText(std::uint32_t id, std::string_view& text) const
+		{
+			const DialogControl* control = Find(id);
+			if (!control || control->Kind != DialogControlKind::EditBox)
+				return false;
+
+			text = GetString(control->Text);
+			return true;
+		}
+
+		bool SetChecked(std::uint32_t id, bool checked)
+		{
+			DialogControl* control = FindMutable(id);
+			if (!control || control->Kind != DialogControlKind::CheckButton)
+				return false;
+
+			control->Checked = checked;
+			return true;
+		}
+
+		bool GetChecked(std::uint32_t id, bool& checked) const
+		{
+			const DialogControl* control = Find(id);
+			checked = control && control->Checked;
+			return control && control->Kind == DialogControlKind::CheckButton;
+		}
+
+		// One control at most is shown next to the OK button
+		bool MakeProminent(std::uint32_t id)
+		{
+			DialogControl* control = FindMutable(id);
+			if (!control || !(control->Kind == DialogControlKind::PushButton || control->Kind == DialogControlKind::CheckButton ||
+				control->Kind == DialogControlKind::ComboBox || control->Kind == DialogControlKind::Menu ||
+				control->Kind == DialogControlKind::VisualGroup))
+				return false;
+
+			for (DialogControl& other : _controls)
+				other.Prominent = false;
+
+			control->Prominent = true;
+			return true;
+		}
+
+		bool AddItem(std::uint32_t id, std::uint32_t item, std::string_view label)
+		{
+			std::size_t index = FindIndex(id);
+			if (index >= _controls.size() || !HasItems(_controls[index].Kind) || _items.size() >= MaxItems ||
+				FindItem(index, item) < _items.size() || !CanStore(label.size()))
+				return false;
+
+			DialogControlItem& entry = _items.emplace_back();
+			entry.Control = (std::uint32_t)index;
+			entry.Id = item;
+			entry.State = Enabled | Visible;
+			entry.Label = Store(label);
+			return true;
+		}
+
+		bool RemoveItem(std::uint32_t id, std::uint32_t item)
+		{
+			std::size_t index = FindIndex(id);
+			std::size_t position = index < _controls.size() ? FindItem(index, item) : _items.size();
+			if (position >= _items.size())
+				return false;
+
+			_garbage += _items[position].Label.Size;
+			_items.erase(_items.begin() + position);
+
+			DialogControl& control = _controls[index];
+			if (control.HasSelection && control.SelectedItem == item)
+				control.HasSelection = false;
+
+			return true;
+		}
+
+		bool RemoveAllItems(std::uint32_t id)
+		{
+			std::size_t index = FindIndex(id);
+			if (index >= _controls.size() || !HasItems(_controls[index].Kind))
+				return false;
+
+			std::erase_if(_items, [&](const DialogControlItem& item)
+			{
+				if (item.Control != index)
+					return false;
+
+				_garbage += item.Label.Size;
+				return true;
+			});
+
+			_controls[index].HasSelection = false;
+			return true;
+		}
+
+		bool SetItemLabel(std::uint32_t id, std::uint32_t item, std::string_view label)
+		{
+			DialogControlItem* entry = FindItemMutable(id, item);
+			return entry && Replace(entry->Label, label);
+		}
+
+		bool SetItemState(std::uint32_t id, std::uint32_t item, std::uint32_t state)
+		{
+			DialogControlItem* entry = FindItemMutable(id, item);
+			if (!entry)
+				return false;
+
+			entry->State = (std::uint8_t)(state & (Enabled | Visible));
+			return true;
+		}
+
+		bool GetItemState(std::uint32_t id, std::uint32_t item, std::uint32_t& state) const
+		{
+			std::size_t index = FindIndex(id);
+			std::size_t position = index < _controls.size() ? FindItem(index, item) : _items.size();
+			state = position < _items.size() ? _items[position].State : 0;
+			return position < _items.size();
+		}
+
+		// Menus and the drop-down pick an item without keeping it selected
+		bool SelectItem(std::uint32_t id, std::uint32_t item)
+		{
+			std::size_t index = FindIndex(id);
+			if (index >= _controls.size() || FindItem(index, item) >= _items.size())
+				return false;
+
+			DialogControl& control = _controls[index];
+			if (control.Kind == DialogControlKind::ComboBox || control.Kind == DialogControlKind::RadioButtonList)
+			{
+				control.SelectedItem = item;
+				control.HasSelection = true;
+			}
+
+			return true;
+		}
+
+		bool GetSelectedItem(std::uint32_t id, std::uint32_t& item) const
+		{
+			const DialogControl* control = Find(id);
+			item = control && control->HasSelection ? control->SelectedItem : 0;
+			return control && control->HasSelection;
+		}
+
+		// What Files reports, refused for controls the user can't have changed
+		bool Apply(const DialogControlChange& change)
+		{
+			const DialogControl* control = Find(change.Control);
+			if (!control || (control->State & (Enabled | Visible)) != (Enabled | Visible))
+				return false;
+
+			switch (change.Kind)
+			{
+			case DialogControlChangeKind::ItemSelected:
+			{
+				std::size_t position = FindItem(FindIndex(change.Control), change.Value);
+				return position < _items.size() && (_items[position].State & Enabled) && SelectItem(change.Control, change.Value);
+			}
+			case DialogControlChangeKind::CheckToggled:
+				return SetChecked(change.Control, change.Value != 0);
+			case DialogControlChangeKind::ButtonClicked:
+				return control->Kind == DialogControlKind::PushButton;
+			case DialogControlChangeKind::TextChanged:
+				return SetText(change.Control, change.Text);
+			default:
+				return false;
+			}
+		}
+
+		void Clear()
+		{
+			_controls.clear();
+			_items.clear();
+			_index.clear();
+			_arena.clear();
+			_garbage = 0;
+			_group = 0;
+		}
+
+		// Dialog -> Files, along with the picker. Payload: control count, item count, string
+		// bytes, then fixed size records and the strings they point to.
+		//  Control, 32 bytes: id, kind, state, flags (1 checked, 2 prominent, 4 has a selected
+		//   item), a reserved byte, group, label offset and size, text offset and size, selected item
+		//  Item, 20 bytes: control index, id, state, 3 reserved bytes, label offset and size
+		// Strings are written without the garbage of the arena.
+		std::string Encode() const
+		{
+			std::size_t stringSize = _arena.size() - _garbage;
+			std::string payload;
+			payload.reserve(12 + _controls.size() * ControlRecordSize + _items.size() * ItemRecordSize + stringSize);
+			Detail::AppendUInt32(payload, (std::uint32_t)_controls.size());
+			Detail::AppendUInt32(payload, (std::uint32_t)_items.size());
+			Detail::AppendUInt32(payload, (std::uint32_t)stringSize);
+
+			std::string strings;
+			strings.reserve(stringSize);
+			auto appendText = [&](DialogControlText text)
+			{
+				Detail::AppendUInt32(payload, (std::uint32_t)strings.size());
+				Detail::AppendUInt32(payload, text.Size);
+				strings.append(GetString(text));
+			};
+
+			for (const DialogControl& control : _controls)
+			{
+				Detail::AppendUInt32(payload, control.Id);
+				payload.push_back((char)control.Kind);
+				payload.push_back((char)control.State);
+				payload.push_back((char)((control.Checked ? 1 : 0) | (control.Prominent ? 2 : 0) | (control.HasSelection ? 4 : 0)));
+				payload.push_back('\0');
+				Detail::AppendUInt32(payload, control.Group);
+				appendText(control.Label);
+				appendText(control.Text);
+				Detail::AppendUInt32(payload, control.SelectedItem);
+			}
+
+			for (const DialogControlItem& item : _items)
+			{
+				Detail::AppendUInt32(payload, item.Control);
+				Detail::AppendUInt32(payload, item.Id);
+				payload.push_back((char)item.State);
+				payload.append(3, '\0');
+				appendText(item.Label);
+			}
+
+			payload.append(strings);
+			return payload;
+		}
+
+		static bool Decode(std::string_view payload, DialogControls& controls)
+		{
+			controls.Clear();
+
+			std::size_t offset = 0;
+			std::uint32_t controlCount, itemCount, stringSize;
+			if (!Detail::ReadUInt32(payload, offset, controlCount) || controlCount > MaxControls ||
+				!Detail::ReadUInt32(payload, offset, itemCount) || itemCount > MaxItems ||
+				!Detail::ReadUInt32(payload, offset, stringSize) || stringSize > MaxArenaSize ||
+				payload.size() - offset != controlCount * ControlRecordSize + itemCount * ItemRecordSize + stringSize)
+				return false;
+
+			controls._arena.assign(payload.substr(payload.size() - stringSize));
+			auto readText = [&](DialogControlText& text)
+			{
+				return Detail::ReadUInt32(payload, offset, text.Offset) && Detail::ReadUInt32(payload, offset, text.Size) &&
+					text.Size <= MaxTextSize && text.Offset <= stringSize && stringSize - text.Offset >= text.Size;
+			};
+
+			controls._controls.resize(controlCount);
+			for (std::uint32_t i = 0; i < controlCount; i++)
+			{
+				DialogControl& control = controls._controls[i];
+				Detail::ReadUInt32(payload, offset, control.Id);
+				std::uint8_t kind = (std::uint8_t)payload[offset];
+				std::uint8_t flags = (std::uint8_t)payload[offset + 2];
+				control.State = (std::uint8_t)payload[offset + 1] & (Enabled | Visible);
+				offset += 4;
+
+				// Groups come before what they hold, and don't nest
+				if (kind >= (std::uint8_t)DialogControlKind::Count ||
+					!Detail::ReadUInt32(payload, offset, control.Group) || control.Group > i ||
+					(control.Group && controls._controls[control.Group - 1].Kind != DialogControlKind::VisualGroup) ||
+					!readText(control.Label) || !readText(control.Text) ||
+					!Detail::ReadUInt32(payload, offset, control.SelectedItem))
+					return false;
+
+				control.Kind = (DialogControlKind)kind;
+				control.Checked = flags & 1;
+				control.Prominent = flags & 2;
+				control.HasSelection = flags & 4;
+				controls._index.emplace_back(control.Id, i);
+			}
+
+			std::sort(controls._index.begin(), controls._index.end());
+			if (std::adjacent_find(controls._index.begin(), controls._index.end(), [](const auto& a, const auto& b) { return a.first == b.first; }) != controls._index.end())
+				return false;
+
+			controls._items.resize(itemCount);
+			for (DialogControlItem& item : controls._items)
+			{
+				if (!Detail::ReadUInt32(payload, offset, item.Control) || item.Control >= controlCount ||
+					!HasItems(controls._controls[item.Control].Kind) ||
+					!Detail::ReadUInt32(payload, offset, item.Id))
+					return false;
+
+				item.State = (std::uint8_t)payload[offset] & (Enabled | Visible);
+				offset += 4;
+				if (!readText(item.Label))
+					return false;
+			}
+
+			// Strings may share bytes, whatever isn't pointed to counts as garbage
+			std::size_t used = 0;
+			for (const DialogControl& control : controls._controls)
+				used += control.Label.Size + control.Text.Size;
+			for (const DialogControlItem& item : controls._items)
+				used += item.Label.Size;
+			controls._garbage = stringSize - std::min<std::size_t>(used, stringSize);
+
+			return true;
+		}
+
+	private:
+		std::vector<DialogControl> _controls;
+		std::vector<DialogControlItem> _items;
+		// Id and index of every control, sorted by id
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> _index;
+		std::string _arena;
+		std::size_t _garbage = 0;
+		// Index + 1 of the visual group being filled
+		std::uint32_t _group = 0;
+
+		static bool CompareId(const std::pair<std::uint32_t, std::uint32_t>& entry, std::uint32_t id)
+		{
+			return entry.first < id;
+		}
+
+		static bool HasItems(DialogControlKind kind)
+		{
+			return kind == DialogControlKind::ComboBox || kind == DialogControlKind::RadioButtonList ||
+				kind == DialogControlKind::Menu || kind == DialogControlKind::OpenDropDown;
+		}
+
+		std::size_t FindIndex(std::uint32_t id) const
+		{
+			auto position = std::lower_bound(_index.begin(), _index.end(), id, CompareId);
+			return position != _index.end() && position->first == id ? position->second : _controls.size();
+		}
+
+		DialogControl* FindMutable(std::uint32_t id)
+		{
+			std::size_t index = FindIndex(id);
+			return index < _controls.size() ? &_controls[index] : nullptr;
+		}
+
+		std::size_t FindItem(std::size_t index, std::uint32_t item) const
+		{
+			for (std::size_t i = 0; i < _items.size(); i++)
+			{
+				if (_items[i].Control == index && _items[i].Id == item)
+					return i;
+			}
+
+			return _items.size();
+		}
+
+		DialogControlItem* FindItemMutable(std::uint32_t id, std::uint32_t item)
+		{
+			std::size_t index = FindIndex(id);
+			std::size_t position = index < _controls.size() ? FindItem(index, item) : _items.size();
+			return position < _items.size() ? &_items[position] : nullptr;
+		}
+
+		bool CanStore(std::size_t size, std::size_t released = 0) const
+		{
+			return size <= MaxTextSize && _arena.size() - _garbage - released + size <= MaxArenaSize;
+		}
+
+		DialogControlText Store(std::string_view text)
+		{
+			if (_garbage > 4096 && _garbage > _arena.size() / 2)
+				Compact();
+
+			DialogControlText stored{ (std::uint32_t)_arena.size(), (std::uint32_t)text.size() };
+			_arena.append(text);
+			return stored;
+		}
+
+		// The text must not point into the arena, which may move
+		bool Replace(DialogControlText& text, std::string_view value)
+		{
+			if (!CanStore(value.size(), text.Size))
+				return false;
+
+			_garbage += text.Size;
+			text = DialogControlText();
+			text = Store(value);
+			return true;
+		}
+
+		void Compact()
+		{
+			std::string arena;
+			arena.reserve(_arena.size() - _garbage);
+			auto move = [&](DialogControlText& text)
+			{
+				std::uint32_t offset = (std::uint32_t)arena.size();
+				arena.append(GetString(text));
+				text.Offset = offset;
+			};
+
+			for (DialogControl& control : _controls)
+			{
+				move(control.Label);
+				move(control.Text);
+			}
+			for (DialogControlItem& item : _items)
+				move(item.Label);
+
+			_arena = std::move(arena);
+			_garbage = 0;
+		}
+	};
+}
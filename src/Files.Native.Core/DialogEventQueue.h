@@ -0,0 +1,119 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Coalescing of the navigation and selection events Files reports while the
+//  picker is open, before they are raised on the host's IFileDialogEvents.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Files::Native
+{
+	enum class DialogEventKind : std::uint8_t
+	{
+		FolderChange,
+		SelectionChange,
+	};
+
+	struct DialogEvent
+	{
+		DialogEventKind Kind;
+		std::string Payload;
+	};
+
+	// Only the latest state matters to the host, so a pending event is replaced rather
+	// than queued behind: the host sees every folder Files settles on, and selection
+	// changes at most once per interval, however fast Files reports them. A folder change
+	// also drops the pending selection, which belonged to the previous folder.
+	class DialogEventQueue
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		explicit DialogEventQueue(std::chrono::milliseconds selectionInterval = std::chrono::milliseconds(100)) :
+			_selectionInterval(selectionInterval)
+		{
+		}
+
+		void Push(DialogEventKind kind, std::string payload)
+		{
+			_pushed++;
+
+			if (kind == DialogEventKind::FolderChange)
+			{
+				_folder = std::move(payload);
+				_selection.reset();
+			}
+			else
+			{
+				_selection = std::move(payload);
+			}
+		}
+
+		// Takes the next event that is due at the given time, folder changes first
+		bool Pop(Clock::time_point now, DialogEvent& event)
+		{
+			if (_folder)
+			{
+				event = { DialogEventKind::FolderChange, std::move(*_folder) };
+				_folder.reset();
+				_delivered++;
+				return true;
+			}
+
+			if (_selection && (!_lastSelection || now - *_lastSelection >= _selectionInterval))
+			{
+				event = { DialogEventKind::SelectionChange, std::move(*_selection) };
+				_selection.reset();
+				_lastSelection = now;
+				_delivered++;
+				return true;
+			}
+
+			return false;
+		}
+
+		// How long until Pop has something, or nullopt when nothing is pending
+		std::optional<std::chrono::milliseconds> NextDue(Clock::time_point now) const
+		{
+			if (_folder || (_selection && !_lastSelection))
+				return std::chrono::milliseconds(0);
+			if (!_selection)
+				return std::nullopt;
+
+			auto due = *_lastSelection + _selectionInterval;
+			return due <= now ? std::chrono::milliseconds(0) : std::chrono::ceil<std::chrono::milliseconds>(due - now);
+		}
+
+		// Starts over for the next Show()
+		void Reset()
+		{
+			_folder.reset();
+			_selection.reset();
+			_lastSelection.reset();
+		}
+
+		std::uint64_t Pushed() const
+		{
+			return _pushed;
+		}
+
+		std::uint64_t Delivered() const
+		{
+			return _delivered;
+		}
+
+	private:
+		std::chrono::milliseconds _selectionInterval;
+		std::optional<std::string> _folder;
+		std::optional<std::string> _selection;
+		std::optional<Clock::time_point> _lastSelection;
+		std::uint64_t _pushed = 0;
+		std::uint64_t _delivered = 0;
+	};
+}
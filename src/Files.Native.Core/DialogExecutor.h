@@ -0,0 +1,657 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Coroutine tasks and the single threaded executor that runs the stages of a
+//  dialog's Show() on the host's thread, blocking only in the host's own wait.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Files::Native
+{
+	template <typename T = void>
+	class Task;
+
+	namespace Detail
+	{
+		struct TaskPromiseBase
+		{
+			std::coroutine_handle<> Continuation = std::noop_coroutine();
+			std::exception_ptr Exception;
+
+			// Tasks are lazy, they start when awaited
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept
+				{
+					return false;
+				}
+
+				template <typename TPromise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> handle) noexcept
+				{
+					return handle.promise().Continuation;
+				}
+
+				void await_resume() noexcept
+				{
+				}
+			};
+
+			FinalAwaiter final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void unhandled_exception() noexcept
+			{
+				Exception = std::current_exception();
+			}
+		};
+
+		template <typename T>
+		struct TaskPromise : TaskPromiseBase
+		{
+			std::optional<T> Value;
+
+			Task<T> get_return_object() noexcept;
+
+			template <typename TValue>
+			void return_value(TValue&& value)
+			{
+				Value.emplace(std::forward<TValue>(value));
+			}
+
+			T Result()
+			{
+				if (Exception)
+					std::rethrow_exception(Exception);
+				return std::move(*Value);
+			}
+		};
+
+		template <>
+		struct TaskPromise<void> : TaskPromiseBase
+		{
+			Task<void> get_return_object() noexcept;
+
+			void return_void() noexcept
+			{
+			}
+
+			void Result()
+			{
+				if (Exception)
+					std::rethrow_exception(Exception);
+			}
+		};
+
+		// Runs on its own and frees itself once done, see DialogExecutor::Spawn
+		struct DetachedTask
+		{
+			struct promise_type
+			{
+				DetachedTask get_return_object() noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never initial_suspend() noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never final_suspend() noexcept
+				{
+					return {};
+				}
+
+				void return_void() noexcept
+				{
+				}
+
+				void unhandled_exception() noexcept
+				{
+					std::terminate();
+				}
+			};
+		};
+
+		template <typename T>
+		struct SpawnState
+		{
+			std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> Value;
+			std::exception_ptr Exception;
+			std::coroutine_handle<> Joiner;
+			bool Done = false;
+		};
+	}
+
+	// A coroutine that starts when awaited and resumes its awaiter when done. Await it once.
+	template <typename T>
+	class [[nodiscard]] Task
+	{
+	public:
+		using promise_type = Detail::TaskPromise<T>;
+
+		explicit Task(std::coroutine_handle<promise_type> handle) noexcept : _handle(handle)
+		{
+		}
+
+		Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr))
+		{
+		}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		~Task()
+		{
+			if (_handle)
+				_handle.destroy();
+		}
+
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+				std::coroutine_handle<promise_type> Handle;
+
+				bool await_ready() const noexcept
+				{
+					return Handle.done();
+				}
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					Handle.promise().Continuation = awaiting;
+					return Handle;
+				}
+
+				T await_resume()
+				{
+					return Handle.promise().Result();
+				}
+			};
+
+			return Awaiter{ _handle };
+		}
+
+	private:
+		std::coroutine_handle<promise_type> _handle;
+	};
+
+	template <typename T>
+	Task<T> Detail::TaskPromise<T>::get_return_object() noexcept
+	{
+		return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+	}
+
+	inline Task<void> Detail::TaskPromise<void>::get_return_object() noexcept
+	{
+		return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+	}
+
+	// A task started with DialogExecutor::Spawn, running alongside its parent until joined
+	template <typename T>
+	class Spawned
+	{
+		std::shared_ptr<Detail::SpawnState<T>> _state;
+
+	public:
+		explicit Spawned(std::shared_ptr<Detail::SpawnState<T>> state) : _state(std::move(state))
+		{
+		}
+
+		bool IsDone() const
+		{
+			return _state->Done;
+		}
+
+		T Result()
+		{
+			if (_state->Exception)
+				std::rethrow_exception(_state->Exception);
+			if constexpr (!std::is_void_v<T>)
+				return *_state->Value;
+		}
+
+		// Waits for the task, once
+		auto operator co_await() noexcept
+		{
+			struct Awaiter
+			{
+				Spawned& Owner;
+
+				bool await_ready() const noexcept
+				{
+					return Owner.IsDone();
+				}
+
+				void await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					Owner._state->Joiner = awaiting;
+				}
+
+				T await_resume()
+				{
+					return Owner.Result();
+				}
+			};
+
+			return Awaiter{ *this };
+		}
+	};
+
+	enum class WaitResult
+	{
+		Signalled,
+		TimedOut,
+		Cancelled,
+	};
+
+	// Where the executor blocks when it has nothing to run. The dialogs dispatch the
+	// host's window messages there, so the host keeps painting while Show() waits.
+	class ExecutorHost
+	{
+	public:
+		static constexpr std::size_t NoHandle = (std::size_t)-1;
+
+		virtual ~ExecutorHost() = default;
+
+		// Blocks until one of the handles is signalled, Wake() is called or the timeout
+		// elapses. Returns the index of the signalled handle, or NoHandle.
+		virtual std::size_t Wait(const std::vector<void*>& handles, std::optional<std::chrono::milliseconds> timeout) = 0;
+
+		// Ends a pending Wait() early, from any thread
+		virtual void Wake() = 0;
+
+		// Runs the work on another thread. The work an executor gives up on may outlive it,
+		// so the host must keep the code it runs loaded until it returns.
+		virtual void Submit(std::function<void()> work) = 0;
+	};
+
+	// Runs tasks on the thread that calls Run(), switching between them whenever one waits.
+	// Stages of a Show() can so overlap, e.g. Files connecting back while the command line
+	// is prepared, and all of them end on Cancel() without any locking on the dialog's state.
+	class DialogExecutor
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		class WaitAwaiter
+		{
+			friend class DialogExecutor;
+
+			DialogExecutor& _executor;
+			void* _handle;
+			std::optional<Clock::time_point> _deadline;
+			std::stop_token _token;
+			std::coroutine_handle<> _coroutine;
+			WaitResult _result = WaitResult::Signalled;
+
+		public:
+			WaitAwaiter(DialogExecutor& executor, void* handle, std::optional<Clock::time_point> deadline, std::stop_token token) :
+				_executor(executor), _handle(handle), _deadline(deadline), _token(std::move(token))
+			{
+			}
+
+			bool await_ready() noexcept
+			{
+				if (!_executor.IsCancelled() && !_token.stop_requested())
+					return false;
+
+				_result = WaitResult::Cancelled;
+				return true;
+			}
+
+			void await_suspend(std::coroutine_handle<> coroutine)
+			{
+				_coroutine = coroutine;
+				_executor._waits.push_back(this);
+			}
+
+			WaitResult await_resume() const noexcept
+			{
+				return _result;
+			}
+		};
+
+		template <typename TFunction>
+		class OffloadAwaiter
+		{
+			using Result = std::invoke_result_t<TFunction&>;
+
+			DialogExecutor& _executor;
+			TFunction _function;
+			std::optional<std::conditional_t<std::is_void_v<Result>, bool, Result>> _result;
+
+		public:
+			OffloadAwaiter(DialogExecutor& executor, TFunction function) :
+				_executor(executor), _function(std::move(function))
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> coroutine)
+			{
+				_executor._host.Submit([this, coroutine]()
+				{
+					if constexpr (std::is_void_v<Result>)
+					{
+						_function();
+						_result.emplace(true);
+					}
+					else
+					{
+						_result.emplace(_function());
+					}
+
+					_executor.PostRemote(coroutine);
+				});
+			}
+
+			Result await_resume()
+			{
+				if constexpr (!std::is_void_v<Result>)
+					return std::move(*_result);
+			}
+		};
+
+		explicit DialogExecutor(ExecutorHost& host) : _host(host)
+		{
+		}
+
+		DialogExecutor(const DialogExecutor&) = delete;
+		DialogExecutor& operator=(const DialogExecutor&) = delete;
+
+		~DialogExecutor()
+		{
+			// An offloaded function wakes the host under the lock, let it finish
+			std::lock_guard<std::mutex> lock(_remoteLock);
+		}
+
+		// Runs the task and everything it spawns until the task is done. Stages the task
+		// left running are cancelled and run to their end before this returns.
+		template <typename T>
+		T Run(Task<T> task)
+		{
+			Spawned<T> main = Spawn(std::move(task));
+			while (!main.IsDone())
+				Step();
+
+			_stop.request_stop();
+			while (_spawned)
+				Step();
+
+			// Ready for the next Run() once this one is over rather than when it starts, so
+			// that a Cancel() made between publishing the executor and running it isn't lost
+			{
+				std::lock_guard<std::mutex> lock(_remoteLock);
+				_stop = std::stop_source();
+			}
+
+			return main.Result();
+		}
+
+		// Starts the task on the next turn of the executor, to be awaited later if at all
+		template <typename T>
+		Spawned<T> Spawn(Task<T> task)
+		{
+			auto state = std::make_shared<Detail::SpawnState<T>>();
+			_spawned++;
+			RunDetached(std::move(task), state);
+			return Spawned<T>(state);
+		}
+
+		// Ends every wait with WaitResult::Cancelled, now and until Run() returns. Can be
+		// called from any thread.
+		void Cancel()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_remoteLock);
+				_stop.request_stop();
+			}
+
+			_host.Wake();
+		}
+
+		bool IsCancelled() const
+		{
+			return _stop.stop_requested();
+		}
+
+		// Lets the other tasks run before resuming
+		auto Schedule()
+		{
+			struct Awaiter
+			{
+				DialogExecutor& Executor;
+
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> coroutine)
+				{
+					Executor._ready.push_back(coroutine);
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+			};
+
+			return Awaiter{ *this };
+		}
+
+		// Waits for the host handle to be signalled, the timeout to elapse, the token or the
+		// executor to be cancelled. Without a handle this is a plain delay.
+		WaitAwaiter Wait(void* handle, std::optional<std::chrono::milliseconds> timeout = std::nullopt, std::stop_token token = {})
+		{
+			std::optional<Clock::time_point> deadline;
+			if (timeout)
+				deadline = Clock::now() + *timeout;
+
+			return WaitAwaiter(*this, handle, deadline, std::move(token));
+		}
+
+		WaitAwaiter Delay(std::chrono::milliseconds delay, std::stop_token token = {})
+		{
+			return Wait(nullptr, delay, std::move(token));
+		}
+
+		// Calls the function on a thread of the host and resumes with its result. Not
+		// cancellable, the function must not block for long.
+		template <typename TFunction>
+		OffloadAwaiter<TFunction> Offload(TFunction function)
+		{
+			return OffloadAwaiter<TFunction>(*this, std::move(function));
+		}
+
+		// Like Offload, but gives up on the function after the timeout or when the executor
+		// is cancelled, resuming with nullopt. The function keeps running on its thread and
+		// its result is dropped, so it must own everything it touches.
+		template <typename TFunction, typename TResult = std::invoke_result_t<TFunction&>>
+		Task<std::optional<TResult>> OffloadFor(TFunction function, std::chrono::milliseconds timeout)
+		{
+			struct State
+			{
+				std::mutex Lock;
+				DialogExecutor* Executor = nullptr;
+				std::optional<TResult> Result;
+				std::stop_source Finished;
+			};
+
+			auto state = std::make_shared<State>();
+			state->Executor = this;
+
+			// Shared, the host takes copyable work only
+			_host.Submit([state, function = std::make_shared<TFunction>(std::move(function))]()
+			{
+				TResult result = (*function)();
+
+				std::lock_guard<std::mutex> lock(state->Lock);
+				if (!state->Executor)
+					return;
+
+				state->Result.emplace(std::move(result));
+				state->Finished.request_stop();
+				state->Executor->_host.Wake();
+			});
+
+			// Ends as cancelled once the function is done
+			co_await Wait(nullptr, timeout, state->Finished.get_token());
+
+			std::lock_guard<std::mutex> lock(state->Lock);
+			state->Executor = nullptr;
+			co_return std::move(state->Result);
+		}
+
+	private:
+		ExecutorHost& _host;
+		std::deque<std::coroutine_handle<>> _ready;
+		std::vector<WaitAwaiter*> _waits;
+		std::stop_source _stop;
+		std::size_t _spawned = 0;
+
+		std::mutex _remoteLock;
+		std::vector<std::coroutine_handle<>> _remote;
+
+		template <typename T>
+		Detail::DetachedTask RunDetached(Task<T> task, std::shared_ptr<Detail::SpawnState<T>> state)
+		{
+			co_await Schedule();
+
+			try
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					co_await std::move(task);
+					state->Value.emplace(true);
+				}
+				else
+				{
+					state->Value.emplace(co_await std::move(task));
+				}
+			}
+			catch (...)
+			{
+				state->Exception = std::current_exception();
+			}
+
+			state->Done = true;
+			if (state->Joiner)
+				_ready.push_back(state->Joiner);
+
+			_spawned--;
+		}
+
+		void PostRemote(std::coroutine_handle<> coroutine)
+		{
+			std::lock_guard<std::mutex> lock(_remoteLock);
+			_remote.push_back(coroutine);
+			_host.Wake();
+		}
+
+		void Resume(std::size_t index, WaitResult result)
+		{
+			WaitAwaiter* wait = _waits[index];
+			wait->_result = result;
+			_waits.erase(_waits.begin() + index);
+			_ready.push_back(wait->_coroutine);
+		}
+
+		// Resumes what is ready, or else blocks in the host until something is
+		void Step()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_remoteLock);
+				_ready.insert(_ready.end(), _remote.begin(), _remote.end());
+				_remote.clear();
+			}
+
+			if (!_ready.empty())
+			{
+				std::coroutine_handle<> coroutine = _ready.front();
+				_ready.pop_front();
+				coroutine.resume();
+				return;
+			}
+
+			auto now = Clock::now();
+			bool resumed = false;
+			for (std::size_t i = 0; i < _waits.size();)
+			{
+				WaitAwaiter* wait = _waits[i];
+				if (IsCancelled() || wait->_token.stop_requested())
+					Resume(i, WaitResult::Cancelled);
+				else if (wait->_deadline && *wait->_deadline <= now)
+					Resume(i, WaitResult::TimedOut);
+				else
+				{
+					i++;
+					continue;
+				}
+
+				resumed = true;
+			}
+
+			if (resumed)
+				return;
+
+			// Handles can be waited on by several tasks but only be passed to the host once
+			std::vector<void*> handles;
+			std::optional<std::chrono::milliseconds> timeout;
+			for (WaitAwaiter* wait : _waits)
+			{
+				if (wait->_handle && std::find(handles.begin(), handles.end(), wait->_handle) == handles.end())
+					handles.push_back(wait->_handle);
+
+				if (wait->_deadline)
+				{
+					auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*wait->_deadline - now);
+					if (!timeout || remaining < *timeout)
+						timeout = remaining;
+				}
+			}
+
+			std::size_t index = _host.Wait(handles, timeout);
+			if (index >= handles.size())
+				return;
+
+			for (std::size_t i = 0; i < _waits.size();)
+			{
+				if (_waits[i]->_handle == handles[index])
+					Resume(i, WaitResult::Signalled);
+				else
+					i++;
+			}
+		}
+	};
+}
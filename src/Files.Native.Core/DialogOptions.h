@@ -0,0 +1,93 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  What Files has to list and return for a given set of FILEOPENDIALOGOPTIONS.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Files::Native
+{
+	// Keep in sync with DialogEnumerationMode in Files.App
+	enum class EnumerationMode : std::uint32_t
+	{
+		None = 0,
+		// FOS_PICKFOLDERS: files are never listed
+		FoldersOnly = 1,
+		// FOS_FORCEFILESYSTEM: only items with a file system path can be picked
+		FileSystemOnly = 2,
+		// No FOS_ALLOWMULTISELECT: a single item is returned
+		SingleSelect = 4,
+		// FOS_NODEREFERENCELINKS: shortcuts are returned as such, not their targets
+		NoDereferenceLinks = 8,
+	};
+
+	inline EnumerationMode operator|(EnumerationMode left, EnumerationMode right)
+	{
+		return (EnumerationMode)((std::uint32_t)left | (std::uint32_t)right);
+	}
+
+	inline bool HasFlag(EnumerationMode mode, EnumerationMode flag)
+	{
+		return ((std::uint32_t)mode & (std::uint32_t)flag) != 0;
+	}
+
+	class DialogOptions
+	{
+	public:
+		// FOS_* values of shobjidl_core.h, repeated here so that this header builds anywhere
+		static constexpr std::uint32_t PickFolders = 0x20;
+		static constexpr std::uint32_t ForceFileSystem = 0x40;
+		static constexpr std::uint32_t AllowMultiSelect = 0x200;
+		static constexpr std::uint32_t CreatePrompt = 0x2000;
+		static constexpr std::uint32_t NoReadOnlyReturn = 0x8000;
+		static constexpr std::uint32_t NoTestFileCreate = 0x10000;
+		static constexpr std::uint32_t NoDereferenceLinks = 0x100000;
+
+		static EnumerationMode GetEnumerationMode(std::uint32_t fos)
+		{
+			EnumerationMode mode = EnumerationMode::None;
+			if (fos & PickFolders)
+				mode = mode | EnumerationMode::FoldersOnly;
+			if (fos & ForceFileSystem)
+				mode = mode | EnumerationMode::FileSystemOnly;
+			if (!(fos & AllowMultiSelect))
+				mode = mode | EnumerationMode::SingleSelect;
+			if (fos & NoDereferenceLinks)
+				mode = mode | EnumerationMode::NoDereferenceLinks;
+
+			return mode;
+		}
+
+		// Comma separated flag names, as parsed by Enum.TryParse on the Files side
+		static std::wstring Serialize(EnumerationMode mode)
+		{
+			static const struct
+			{
+				EnumerationMode Flag;
+				const wchar_t* Name;
+			} names[] =
+			{
+				{ EnumerationMode::FoldersOnly, L"FoldersOnly" },
+				{ EnumerationMode::FileSystemOnly, L"FileSystemOnly" },
+				{ EnumerationMode::SingleSelect, L"SingleSelect" },
+				{ EnumerationMode::NoDereferenceLinks, L"NoDereferenceLinks" },
+			};
+
+			std::wstring result;
+			for (const auto& name : names)
+			{
+				if (!HasFlag(mode, name.Flag))
+					continue;
+				if (!result.empty())
+					result += L',';
+				result += name.Name;
+			}
+
+			return result.empty() ? L"None" : result;
+		}
+	};
+}
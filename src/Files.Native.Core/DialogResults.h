@@ -0,0 +1,60 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  The items a Show() ended with, published when it returns as an immutable set that
+//  the results objects of the dialog share, so that host threads other than the
+//  dialog's can read them without a call into the dialog's apartment.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Files::Native
+{
+	// Never changes once published
+	struct DialogResultSet
+	{
+		std::vector<std::string> Items;
+	};
+
+	// Published, cleared and read on the dialog's thread. A set lives as long as whoever
+	// still holds it, e.g. a results object a host's worker is walking while the next
+	// Show() publishes its own.
+	class DialogResults
+	{
+		std::shared_ptr<const DialogResultSet> _current;
+
+	public:
+		DialogResults() = default;
+		DialogResults(const DialogResults&) = delete;
+		DialogResults& operator=(const DialogResults&) = delete;
+
+		void Publish(const std::vector<std::string>& items)
+		{
+			if (items.empty())
+			{
+				Clear();
+				return;
+			}
+
+			auto set = std::make_shared<DialogResultSet>();
+			set->Items = items;
+			_current = std::move(set);
+		}
+
+		// While Show() runs there are no results, as with the system dialog
+		void Clear()
+		{
+			_current.reset();
+		}
+
+		// Null until a Show() ends with items
+		std::shared_ptr<const DialogResultSet> Get() const
+		{
+			return _current;
+		}
+	};
+}
@@ -0,0 +1,122 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Framing of the messages exchanged between a file dialog and the Files
+//  instance that serves it over a dialog session.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	// Keep in sync with DialogSessionHelper.MessageType in Files.App
+	enum class DialogMessageType : std::uint8_t
+	{
+		// Files -> dialog: the session is connected and ready to show the picker
+		Hello = 1,
+		// Dialog -> Files: show the picker, payload is the activation command line (UTF-8)
+		Show = 2,
+		// Dialog -> Files: the dialog was released, the session is over
+		Close = 3,
+		// Files -> dialog: names to run through the host's IShellItemFilter, see FilterQuery
+		FilterQuery = 4,
+		// Dialog -> Files: the host's verdicts on a FilterQuery, see FilterVerdicts
+		FilterVerdicts = 5,
+		// Files -> dialog: the picker navigated, payload is the folder path (UTF-8)
+		FolderChanged = 6,
+		// Files -> dialog: the selection changed, payload is the selected paths (UTF-8), one per line
+		SelectionChanged = 7,
+		// Dialog -> Files: the controls the host added, sent before Show, see DialogControls
+		Controls = 8,
+		// Files -> dialog: what the user did to them, see DialogControlChanges
+		ControlsChanged = 9,
+	};
+
+	struct DialogMessage
+	{
+		DialogMessageType Type;
+		std::string Payload;
+	};
+
+	// A frame is a little-endian 32-bit payload length, a one byte message type
+	// and the payload itself.
+	class DialogMessageCodec
+	{
+	public:
+		static constexpr std::size_t HeaderSize = 5;
+
+		// Anything larger is a protocol error rather than a legitimate message
+		static constexpr std::uint32_t MaxPayloadSize = 1024 * 1024;
+
+		static std::string Encode(DialogMessageType type, const std::string& payload = std::string())
+		{
+			std::uint32_t size = (std::uint32_t)payload.size();
+
+			std::string frame;
+			frame.reserve(HeaderSize + payload.size());
+			Detail::AppendUInt32(frame, size);
+			frame.push_back((char)type);
+			frame.append(payload);
+
+			return frame;
+		}
+
+		// Appends bytes read from the transport. Frames may arrive split or batched.
+		void Feed(const char* data, std::size_t size)
+		{
+			_buffer.append(data, size);
+		}
+
+		// Extracts the next complete message, returns false when more bytes are needed
+		// or the stream is corrupt.
+		bool Next(DialogMessage& message)
+		{
+			std::size_t offset = _offset;
+			std::uint32_t size;
+			if (_corrupt || _buffer.size() - _offset < HeaderSize || !Detail::ReadUInt32(_buffer, offset, size))
+				return false;
+
+			if (size > MaxPayloadSize)
+			{
+				_corrupt = true;
+				return false;
+			}
+
+			if (_buffer.size() - _offset - HeaderSize < size)
+				return false;
+
+			message.Type = (DialogMessageType)_buffer[offset];
+			message.Payload.assign(_buffer, _offset + HeaderSize, size);
+			_offset += HeaderSize + size;
+
+			// Compact once everything buffered has been consumed, or the dead prefix dominates
+			if (_offset == _buffer.size())
+			{
+				_buffer.clear();
+				_offset = 0;
+			}
+			else if (_offset > _buffer.size() / 2)
+			{
+				_buffer.erase(0, _offset);
+				_offset = 0;
+			}
+
+			return true;
+		}
+
+		bool IsCorrupt() const
+		{
+			return _corrupt;
+		}
+
+	private:
+		std::string _buffer;
+		std::size_t _offset = 0;
+		bool _corrupt = false;
+	};
+}
@@ -0,0 +1,473 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  What the host has configured on an open or save dialog and what the dialog
+//  answers it, driven by the host's calls rather than by COM.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DialogControls.h"
+
+namespace Files::Native
+{
+	enum class DialogKind : std::uint8_t
+	{
+		Open,
+		Save,
+	};
+
+	// Stored in traces, only ever append
+	enum class DialogCallKind : std::uint8_t
+	{
+		SetOptions,
+		GetOptions,
+		SetFolder,
+		SetDefaultFolder,
+		GetFolder,
+		SetFileName,
+		GetFileName,
+		SetFileTypes,
+		SetFileTypeIndex,
+		GetFileTypeIndex,
+		Advise,
+		Unadvise,
+		SetClientGuid,
+		ClearClientData,
+		SetFilter,
+		SetTitle,
+		SetOkButtonLabel,
+		SetFileNameLabel,
+		SetDefaultExtension,
+		AddControlItem,
+		RemoveControlItem,
+		SetSelectedControlItem,
+		GetSelectedControlItem,
+		SetSaveAsItem,
+		Show,
+		Close,
+		GetResult,
+		GetResults,
+		GetCurrentSelection,
+		GetSelectedItems,
+		// Not called by the host: what Files reports while the picker is open, and what
+		// Show() ends with
+		FolderChanged,
+		SelectionChanged,
+		Completed,
+		// The rest of IFileDialogCustomize
+		AddControl,
+		SetControlLabel,
+		SetControlState,
+		GetControlState,
+		SetEditBoxText,
+		GetEditBoxText,
+		SetCheckButtonState,
+		GetCheckButtonState,
+		RemoveAllControlItems,
+		SetControlItemState,
+		GetControlItemState,
+		SetControlItemText,
+		EndVisualGroup,
+		MakeProminent,
+		// Not called by the host: what the user did to a control in Files
+		ControlChanged,
+		Count,
+	};
+
+	// One call of the host, with the arguments that matter to the state. Strings are UTF-8.
+	//  SetOptions: Value is the FOS_* options
+	//  SetFolder, SetDefaultFolder: Value is 1 when an item is set, Text its parsing name
+	//  SetFileName: Text is the name, of which only what follows the last separator is kept
+	//  SetFileTypes: Value is the number of types
+	//  SetFileTypeIndex: Value is the one-based index
+	//  SetClientGuid, SetFilter: Value is 1 when set
+	//  SetTitle, SetOkButtonLabel, SetFileNameLabel, SetDefaultExtension: Text is the string
+	//  AddControl: Value is the DialogControlKind, with 0x100 for a check button that starts
+	//   checked, Text the label or the text of an edit box; StartVisualGroup and
+	//   EnableOpenDropDown add controls too
+	//  SetControlLabel, SetEditBoxText, SetControlItemText, AddControlItem: Text is the string
+	//  SetControlState, SetControlItemState: Value is the CDCS_* state
+	//  SetCheckButtonState: Value is 1 when checked
+	//  IFileDialogCustomize calls take the control in Control and the item in Item
+	//  SetSaveAsItem: Value is 1 when the item has a parent, Text the parent's parsing name
+	//   and the item's name separated by a backslash
+	//  FolderChanged: Text is the folder
+	//  SelectionChanged, Completed: Text is the items, one per line
+	//  ControlChanged: Text is one DialogControlChange
+	//  Close: Value is the HRESULT
+	struct DialogCall
+	{
+		DialogCallKind Kind = DialogCallKind::GetOptions;
+		std::uint32_t Value = 0;
+		std::string Text;
+		std::uint32_t Control = 0;
+		std::uint32_t Item = 0;
+	};
+
+	// The calls that take a control, and an item
+	inline bool IsControlCall(DialogCallKind kind)
+	{
+		return (kind >= DialogCallKind::AddControlItem && kind <= DialogCallKind::GetSelectedControlItem) ||
+			(kind >= DialogCallKind::AddControl && kind <= DialogCallKind::MakeProminent);
+	}
+
+	// Which folder GetFolder() answers with
+	enum class DialogFolderSource : std::uint32_t
+	{
+		None,
+		// Where the picker is, as reported by Files
+		Current,
+		// Set by SetFolder or SetSaveAsItem
+		Folder,
+		// Set by SetDefaultFolder
+		Default,
+	};
+
+	struct DialogReply
+	{
+		// False where the dialog answers E_NOTIMPL, or E_INVALIDARG for controls and items
+		// it doesn't have
+		bool Succeeded = true;
+		std::uint32_t Value = 0;
+		// Points into the state, valid until the next call
+		std::string_view Text;
+	};
+
+	// Shell items stay with the COM object, which hands the state their parsing names. The
+	// state decides what every call answers, so that a recorded call sequence can be replayed
+	// against it anywhere.
+	class DialogState
+	{
+	public:
+		// FOS_* values of shobjidl_core.h, repeated here so that this header builds anywhere
+		static constexpr std::uint32_t PathMustExist = 0x800;
+		static constexpr std::uint32_t FileMustExist = 0x1000;
+
+		explicit DialogState(DialogKind kind) :
+			_kind(kind),
+			_options(kind == DialogKind::Open ? FileMustExist | PathMustExist : PathMustExist)
+		{
+		}
+
+		DialogReply Apply(const DialogCall& call)
+		{
+			DialogReply reply;
+			switch (call.Kind)
+			{
+			case DialogCallKind::SetOptions:
+				_options = call.Value;
+				break;
+			case DialogCallKind::GetOptions:
+				reply.Value = _options;
+				break;
+			case DialogCallKind::SetFolder:
+				SetOptional(_folder, call);
+				break;
+			case DialogCallKind::SetDefaultFolder:
+				SetOptional(_defaultFolder, call);
+				break;
+			case DialogCallKind::GetFolder:
+				reply = GetFolder();
+				break;
+			case DialogCallKind::SetFileName:
+				_fileName = GetName(call.Text);
+				break;
+			case DialogCallKind::GetFileName:
+				reply.Text = _results.empty() ? std::string_view() : std::string_view(_results.front());
+				break;
+			case DialogCallKind::SetFileTypes:
+				_fileTypeCount = call.Value;
+				break;
+			case DialogCallKind::SetFileTypeIndex:
+				_fileTypeIndex = call.Value;
+				break;
+			case DialogCallKind::GetFileTypeIndex:
+				reply.Value = _fileTypeIndex;
+				break;
+			case DialogCallKind::Advise:
+				// Only one handler is kept, so the cookie never changes
+				_advised = true;
+				reply.Value = _kind == DialogKind::Open ? 1 : 4;
+				break;
+			case DialogCallKind::Unadvise:
+				_advised = false;
+				break;
+			case DialogCallKind::SetClientGuid:
+				_hasClientGuid = call.Value != 0;
+				break;
+			case DialogCallKind::SetFilter:
+				_hasFilter = call.Value != 0;
+				break;
+			case DialogCallKind::SetTitle:
+				_title = call.Text;
+				break;
+			case DialogCallKind::SetOkButtonLabel:
+				_okButtonLabel = call.Text;
+				break;
+			case DialogCallKind::SetFileNameLabel:
+				_fileNameLabel = call.Text;
+				break;
+			case DialogCallKind::SetDefaultExtension:
+				_defaultExtension = call.Text;
+				break;
+			case DialogCallKind::AddControlItem:
+			case DialogCallKind::RemoveControlItem:
+			case DialogCallKind::SetSelectedControlItem:
+			case DialogCallKind::GetSelectedControlItem:
+			case DialogCallKind::AddControl:
+			case DialogCallKind::SetControlLabel:
+			case DialogCallKind::SetControlState:
+			case DialogCallKind::GetControlState:
+			case DialogCallKind::SetEditBoxText:
+			case DialogCallKind::GetEditBoxText:
+			case DialogCallKind::SetCheckButtonState:
+			case DialogCallKind::GetCheckButtonState:
+			case DialogCallKind::RemoveAllControlItems:
+			case DialogCallKind::SetControlItemState:
+			case DialogCallKind::GetControlItemState:
+			case DialogCallKind::SetControlItemText:
+			case DialogCallKind::EndVisualGroup:
+			case DialogCallKind::MakeProminent:
+			case DialogCallKind::ControlChanged:
+				reply = ApplyControlCall(call);
+				break;
+			case DialogCallKind::SetSaveAsItem:
+				SetSaveAsItem(call);
+				break;
+			case DialogCallKind::Show:
+				_results.clear();
+				_currentFolder.clear();
+				_currentSelection.clear();
+				break;
+			case DialogCallKind::FolderChanged:
+				_currentFolder = call.Text;
+				_currentSelection.clear();
+				break;
+			case DialogCallKind::SelectionChanged:
+				Split(call.Text, _currentSelection);
+				break;
+			case DialogCallKind::Completed:
+				Split(call.Text, _results);
+				reply.Value = (std::uint32_t)_results.size();
+				break;
+			case DialogCallKind::GetResult:
+			case DialogCallKind::GetResults:
+				reply = GetFirst(_results);
+				break;
+			case DialogCallKind::GetCurrentSelection:
+			case DialogCallKind::GetSelectedItems:
+				reply = _currentSelection.empty() ? GetFirst(_results) : GetFirst(_currentSelection);
+				break;
+			default:
+				// Recorded, but nothing the dialog answers depends on them
+				break;
+			}
+
+			return reply;
+		}
+
+		DialogKind GetKind() const { return _kind; }
+		std::uint32_t GetOptions() const { return _options; }
+		std::uint32_t GetFileTypeIndex() const { return _fileTypeIndex; }
+		std::uint32_t GetFileTypeCount() const { return _fileTypeCount; }
+		const std::optional<std::string>& GetFolderName() const { return _folder; }
+		const std::optional<std::string>& GetDefaultFolderName() const { return _defaultFolder; }
+		// The name the save dialog starts with
+		const std::string& GetFileName() const { return _fileName; }
+		// Empty until the host sets them, the system dialog then keeps its own
+		const std::string& GetTitle() const { return _title; }
+		const std::string& GetOkButtonLabel() const { return _okButtonLabel; }
+		const std::string& GetFileNameLabel() const { return _fileNameLabel; }
+		const std::string& GetDefaultExtension() const { return _defaultExtension; }
+		bool IsAdvised() const { return _advised; }
+		bool HasClientGuid() const { return _hasClientGuid; }
+		bool HasFilter() const { return _hasFilter; }
+		const std::string& GetCurrentFolder() const { return _currentFolder; }
+		const std::vector<std::string>& GetCurrentSelection() const { return _currentSelection; }
+		const std::vector<std::string>& GetResults() const { return _results; }
+		// Sent to Files along with the picker
+		const DialogControls& GetControls() const { return _controls; }
+
+	private:
+		DialogKind _kind;
+		std::uint32_t _options;
+		std::uint32_t _fileTypeIndex = 1;
+		std::uint32_t _fileTypeCount = 0;
+		std::optional<std::string> _folder;
+		std::optional<std::string> _defaultFolder;
+		std::string _fileName;
+		std::string _title;
+		std::string _okButtonLabel;
+		std::string _fileNameLabel;
+		std::string _defaultExtension;
+		DialogControls _controls;
+		bool _advised = false;
+		bool _hasClientGuid = false;
+		bool _hasFilter = false;
+		std::string _currentFolder;
+		std::vector<std::string> _currentSelection;
+		std::vector<std::string> _results;
+
+		DialogReply GetFolder() const
+		{
+			DialogReply reply;
+			if (!_currentFolder.empty())
+			{
+				reply.Value = (std::uint32_t)DialogFolderSource::Current;
+				reply.Text = _currentFolder;
+			}
+			else if (_folder)
+			{
+				reply.Value = (std::uint32_t)DialogFolderSource::Folder;
+				reply.Text = *_folder;
+			}
+			else if (_defaultFolder)
+			{
+				reply.Value = (std::uint32_t)DialogFolderSource::Default;
+				reply.Text = *_defaultFolder;
+			}
+			else
+			{
+				reply.Succeeded = false;
+			}
+
+			return reply;
+		}
+
+		DialogReply ApplyControlCall(const DialogCall& call)
+		{
+			DialogReply reply;
+			switch (call.Kind)
+			{
+			case DialogCallKind::AddControl:
+				reply.Succeeded = _controls.Add(call.Control, (DialogControlKind)(call.Value & 0xFF), call.Text, (call.Value & 0x100) != 0);
+				break;
+			case DialogCallKind::SetControlLabel:
+				reply.Succeeded = _controls.SetLabel(call.Control, call.Text);
+				break;
+			case DialogCallKind::SetControlState:
+				reply.Succeeded = _controls.SetState(call.Control, call.Value);
+				break;
+			case DialogCallKind::GetControlState:
+				reply.Succeeded = _controls.GetState(call.Control, reply.Value);
+				break;
+			case DialogCallKind::SetEditBoxText:
+				reply.Succeeded = _controls.SetText(call.Control, call.Text);
+				break;
+			case DialogCallKind::GetEditBoxText:
+				reply.Succeeded = _controls.GetText(call.Control, reply.Text);
+				break;
+			case DialogCallKind::SetCheckButtonState:
+				reply.Succeeded = _controls.SetChecked(call.Control, call.Value != 0);
+				break;
+			case DialogCallKind::GetCheckButtonState:
+			{
+				bool checked;
+				reply.Succeeded = _controls.GetChecked(call.Control, checked);
+				reply.Value = checked;
+				break;
+			}
+			case DialogCallKind::AddControlItem:
+				reply.Succeeded = _controls.AddItem(call.Control, call.Item, call.Text);
+				break;
+			case DialogCallKind::RemoveControlItem:
+				reply.Succeeded = _controls.RemoveItem(call.Control, call.Item);
+				break;
+			case DialogCallKind::RemoveAllControlItems:
+				reply.Succeeded = _controls.RemoveAllItems(call.Control);
+				break;
+			case DialogCallKind::SetControlItemState:
+				reply.Succeeded = _controls.SetItemState(call.Control, call.Item, call.Value);
+				break;
+			case DialogCallKind::GetControlItemState:
+				reply.Succeeded = _controls.GetItemState(call.Control, call.Item, reply.Value);
+				break;
+			case DialogCallKind::SetControlItemText:
+				reply.Succeeded = _controls.SetItemLabel(call.Control, call.Item, call.Text);
+				break;
+			case DialogCallKind::SetSelectedControlItem:
+				reply.Succeeded = _controls.SelectItem(call.Control, call.Item);
+				break;
+			case DialogCallKind::GetSelectedControlItem:
+				reply.Succeeded = _controls.GetSelectedItem(call.Control, reply.Value);
+				break;
+			case DialogCallKind::EndVisualGroup:
+				_controls.EndGroup();
+				break;
+			case DialogCallKind::MakeProminent:
+				reply.Succeeded = _controls.MakeProminent(call.Control);
+				break;
+			case DialogCallKind::ControlChanged:
+			{
+				DialogControlChange change;
+				std::size_t offset = 0;
+				reply.Succeeded = DialogControlChange::Read(call.Text, offset, change) && offset == call.Text.size() && _controls.Apply(change);
+				break;
+			}
+			default:
+				break;
+			}
+
+			return reply;
+		}
+
+		void SetSaveAsItem(const DialogCall& call)
+		{
+			std::size_t separator = call.Text.find_last_of("/\\");
+			if (call.Value && separator != std::string::npos)
+				_folder = call.Text.substr(0, separator);
+			else
+				_folder.reset();
+
+			_fileName = GetName(call.Text);
+		}
+
+		static void SetOptional(std::optional<std::string>& value, const DialogCall& call)
+		{
+			if (call.Value)
+				value = call.Text;
+			else
+				value.reset();
+		}
+
+		static std::string GetName(std::string_view path)
+		{
+			std::size_t separator = path.find_last_of("/\\");
+			return std::string(separator == std::string_view::npos ? path : path.substr(separator + 1));
+		}
+
+		// Value is the number of items, Text the first
+		static DialogReply GetFirst(const std::vector<std::string>& items)
+		{
+			DialogReply reply;
+			reply.Succeeded = !items.empty();
+			reply.Value = (std::uint32_t)items.size();
+			if (reply.Succeeded)
+				reply.Text = items.front();
+
+			return reply;
+		}
+
+		// Empty lines are skipped
+		static void Split(std::string_view text, std::vector<std::string>& items)
+		{
+			items.clear();
+			for (std::size_t start = 0; start < text.size();)
+			{
+				std::size_t end = text.find('\n', start);
+				if (end == std::string_view::npos)
+					end = text.size();
+				if (end > start)
+					items.emplace_back(text.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+	};
+}
@@ -0,0 +1,134 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Recorded sequences of the calls a host made on a dialog, with their timings,
+//  to replay against DialogState.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DialogState.h"
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	struct DialogTraceRecord
+	{
+		// Microseconds since the previous call, or since the dialog was created
+		std::uint64_t Delay = 0;
+		DialogCall Call;
+	};
+
+	// Layout: magic, version, dialog kind, host, then records up to the end of the trace,
+	// each its delay, call kind, value and text, then the control and the item for the
+	// calls of IFileDialogCustomize. The header is little-endian, the records are made of
+	// variable length integers, most calls take four bytes. Version 1 had no control and
+	// put the item in the value.
+	struct DialogTrace
+	{
+		static constexpr std::uint32_t Magic = 0x52544446; // "FDTR"
+		static constexpr std::uint32_t Version = 2;
+
+		static constexpr std::size_t MaxHostSize = 260;
+		static constexpr std::size_t MaxTextSize = 1024 * 1024;
+
+		DialogKind Kind = DialogKind::Open;
+		// Executable name of the host, e.g. "winword.exe"
+		std::string Host;
+		std::vector<DialogTraceRecord> Records;
+
+		static void AppendHeader(std::string& output, DialogKind kind, std::string_view host)
+		{
+			Detail::AppendUInt32(output, Magic);
+			Detail::AppendUInt32(output, Version);
+			output.push_back((char)kind);
+			Detail::AppendUInt32(output, (std::uint32_t)host.size());
+			output.append(host);
+		}
+
+		// Lets a recorder write records as they come
+		static void AppendRecord(std::string& output, std::uint64_t delay, const DialogCall& call)
+		{
+			Detail::AppendVarUInt(output, delay);
+			output.push_back((char)call.Kind);
+			Detail::AppendVarUInt(output, call.Value);
+			Detail::AppendVarUInt(output, call.Text.size());
+			output.append(call.Text);
+			if (IsControlCall(call.Kind))
+			{
+				Detail::AppendVarUInt(output, call.Control);
+				Detail::AppendVarUInt(output, call.Item);
+			}
+		}
+
+		std::string Encode() const
+		{
+			std::string output;
+			AppendHeader(output, Kind, Host);
+			for (const DialogTraceRecord& record : Records)
+				AppendRecord(output, record.Delay, record.Call);
+
+			return output;
+		}
+
+		static bool Decode(std::string_view input, DialogTrace& trace)
+		{
+			std::size_t offset = 0;
+			std::uint32_t magic, version;
+			std::string_view host;
+			if (!Detail::ReadUInt32(input, offset, magic) || magic != Magic ||
+				!Detail::ReadUInt32(input, offset, version) || version < 1 || version > Version ||
+				offset >= input.size() || (unsigned char)input[offset] > (unsigned char)DialogKind::Save)
+				return false;
+
+			trace.Kind = (DialogKind)input[offset++];
+			if (!Detail::ReadStringView(input, offset, host) || host.size() > MaxHostSize)
+				return false;
+
+			trace.Host = std::string(host);
+			trace.Records.clear();
+			while (offset < input.size())
+			{
+				DialogTraceRecord& record = trace.Records.emplace_back();
+				std::uint64_t value, textSize;
+				if (!Detail::ReadVarUInt(input, offset, record.Delay) ||
+					offset >= input.size() || (unsigned char)input[offset] >= (unsigned char)DialogCallKind::Count)
+					return false;
+
+				record.Call.Kind = (DialogCallKind)input[offset++];
+				if (!Detail::ReadVarUInt(input, offset, value) || value > UINT32_MAX ||
+					!Detail::ReadVarUInt(input, offset, textSize) || textSize > MaxTextSize || textSize > input.size() - offset)
+					return false;
+
+				record.Call.Value = (std::uint32_t)value;
+				record.Call.Text.assign(input.substr(offset, (std::size_t)textSize));
+				offset += (std::size_t)textSize;
+				if (!IsControlCall(record.Call.Kind))
+					continue;
+
+				if (version == 1)
+				{
+					// Item calls knew nothing of the control, and nothing else was recorded
+					record.Call.Item = record.Call.Value;
+					record.Call.Value = 0;
+					continue;
+				}
+
+				std::uint64_t control, item;
+				if (!Detail::ReadVarUInt(input, offset, control) || control > UINT32_MAX ||
+					!Detail::ReadVarUInt(input, offset, item) || item > UINT32_MAX)
+					return false;
+
+				record.Call.Control = (std::uint32_t)control;
+				record.Call.Item = (std::uint32_t)item;
+			}
+
+			return true;
+		}
+	};
+}
@@ -0,0 +1,277 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Compiled form of a file dialog file type spec such as "*.png;*.jpg".
+
+#pragma once
+
+#include <cstddef>
+#include <cwctype>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace Files::Native
+{
+	// A spec is compiled once when the host calls SetFileTypes and then matched against
+	// every file name of a folder. Almost all specs are lists of "*.ext" patterns, which
+	// become a single hash lookup on the name's extension; anything else is compiled to
+	// a glob of literal runs separated by '*', matched left to right without backtracking.
+	// Matching is case-insensitive like the shell's.
+	class FileTypeFilter
+	{
+		struct Glob
+		{
+			// Literal runs, '?' matches any one character
+			std::vector<std::wstring> Runs;
+			bool AnchoredStart = true;
+			bool AnchoredEnd = true;
+		};
+
+		std::unordered_set<std::wstring> _extensions;
+		std::vector<Glob> _globs;
+		std::vector<std::wstring> _globSources;
+		bool _matchAll = false;
+
+	public:
+		static FileTypeFilter Compile(std::wstring_view spec)
+		{
+			FileTypeFilter filter;
+
+			std::size_t start = 0;
+			while (start <= spec.size())
+			{
+				std::size_t end = spec.find(L';', start);
+				if (end == std::wstring_view::npos)
+					end = spec.size();
+
+				filter.AddPattern(Normalize(spec.substr(start, end - start)));
+				start = end + 1;
+			}
+
+			// No usable pattern at all, like the shell, show everything
+			if (filter._extensions.empty() && filter._globs.empty())
+				filter._matchAll = true;
+
+			return filter;
+		}
+
+		// Parses the form produced by Serialize
+		static FileTypeFilter Deserialize(std::wstring_view compiled)
+		{
+			std::wstring spec;
+			std::wstring_view patterns;
+
+			if (compiled.substr(0, 4) == L"ext:")
+				patterns = compiled.substr(4);
+			else if (compiled.substr(0, 5) == L"glob:")
+				patterns = compiled.substr(5);
+			else
+				return Compile(L"*");
+
+			for (std::size_t start = 0; start <= patterns.size();)
+			{
+				std::size_t end = patterns.find(L'|', start);
+				if (end == std::wstring_view::npos)
+					end = patterns.size();
+
+				if (!spec.empty())
+					spec += L';';
+				if (compiled[0] == L'e')
+					spec += L"*.";
+				spec.append(patterns.substr(start, end - start));
+				start = end + 1;
+			}
+
+			return Compile(spec);
+		}
+
+		bool MatchesAll() const
+		{
+			return _matchAll;
+		}
+
+		bool IsExtensionSet() const
+		{
+			return !_matchAll && _globs.empty();
+		}
+
+		bool Matches(std::wstring_view name) const
+		{
+			if (_matchAll)
+				return true;
+
+			if (!_extensions.empty())
+			{
+				std::size_t dot = name.rfind(L'.');
+				if (dot != std::wstring_view::npos && _extensions.count(Normalize(name.substr(dot + 1))) != 0)
+					return true;
+			}
+
+			if (_globs.empty())
+				return false;
+
+			std::wstring lowered = Normalize(name);
+			for (const Glob& glob : _globs)
+			{
+				if (MatchGlob(glob, lowered))
+					return true;
+			}
+
+			return false;
+		}
+
+		// Compact form passed to Files with -filetypes: "ext:png|jpg" for extension sets,
+		// "glob:report-??.*|*.png" otherwise. Empty when every file matches.
+		std::wstring Serialize() const
+		{
+			if (_matchAll)
+				return std::wstring();
+
+			std::wstring result = IsExtensionSet() ? L"ext:" : L"glob:";
+			bool first = true;
+			auto append = [&](const std::wstring& pattern)
+			{
+				if (!first)
+					result += L'|';
+				result += pattern;
+				first = false;
+			};
+
+			for (const std::wstring& extension : _extensions)
+				append(IsExtensionSet() ? extension : L"*." + extension);
+			for (const std::wstring& source : _globSources)
+				append(source);
+
+			return result;
+		}
+
+	private:
+		void AddPattern(const std::wstring& pattern)
+		{
+			if (pattern.empty())
+				return;
+
+			// "*" and "*.*" match every file, including names without an extension
+			if (pattern == L"*" || pattern == L"*.*")
+			{
+				_extensions.clear();
+				_globs.clear();
+				_globSources.clear();
+				_matchAll = true;
+				return;
+			}
+
+			if (_matchAll)
+				return;
+
+			if (pattern.size() > 2 && pattern[0] == L'*' && pattern[1] == L'.' &&
+				pattern.find_first_of(L"*?.", 2) == std::wstring::npos)
+			{
+				_extensions.insert(pattern.substr(2));
+				return;
+			}
+
+			Glob glob;
+			glob.AnchoredStart = pattern.front() != L'*';
+			glob.AnchoredEnd = pattern.back() != L'*';
+
+			std::size_t start = 0;
+			while (start < pattern.size())
+			{
+				std::size_t end = pattern.find(L'*', start);
+				if (end == std::wstring::npos)
+					end = pattern.size();
+				if (end > start)
+					glob.Runs.push_back(pattern.substr(start, end - start));
+				start = end + 1;
+			}
+
+			_globs.push_back(std::move(glob));
+			_globSources.push_back(pattern);
+		}
+
+		static std::wstring Normalize(std::wstring_view text)
+		{
+			std::wstring result;
+			result.reserve(text.size());
+
+			for (wchar_t c : text)
+			{
+				if (c == L' ' && result.empty())
+					continue;
+				if (c == L'"' || c == L'|')
+					continue;
+
+				result += c < 0x80 ? (wchar_t)(c >= L'A' && c <= L'Z' ? c + (L'a' - L'A') : c) : (wchar_t)std::towlower(c);
+			}
+
+			while (!result.empty() && result.back() == L' ')
+				result.pop_back();
+
+			return result;
+		}
+
+		static bool MatchRun(const std::wstring& run, std::wstring_view text, std::size_t at)
+		{
+			if (at + run.size() > text.size())
+				return false;
+
+			for (std::size_t i = 0; i < run.size(); i++)
+			{
+				if (run[i] != L'?' && run[i] != text[at + i])
+					return false;
+			}
+
+			return true;
+		}
+
+		// Without '*' between them runs must line up exactly; with '*' the earliest match
+		// of each run is always the best one, so a single left to right pass decides.
+		static bool MatchGlob(const Glob& glob, std::wstring_view text)
+		{
+			const std::vector<std::wstring>& runs = glob.Runs;
+			if (runs.empty())
+				return !glob.AnchoredStart || text.empty();
+
+			if (runs.size() == 1 && glob.AnchoredStart && glob.AnchoredEnd)
+				return runs[0].size() == text.size() && MatchRun(runs[0], text, 0);
+
+			std::size_t first = 0;
+			std::size_t last = runs.size();
+			std::size_t begin = 0;
+			std::size_t end = text.size();
+
+			if (glob.AnchoredStart)
+			{
+				if (!MatchRun(runs[0], text, 0))
+					return false;
+				begin = runs[0].size();
+				first++;
+			}
+
+			if (glob.AnchoredEnd)
+			{
+				const std::wstring& tail = runs[last - 1];
+				if (tail.size() > end - begin || !MatchRun(tail, text, end - tail.size()))
+					return false;
+				end -= tail.size();
+				last--;
+			}
+
+			for (std::size_t i = first; i < last; i++)
+			{
+				const std::wstring& run = runs[i];
+				while (begin + run.size() <= end && !MatchRun(run, text, begin))
+					begin++;
+				if (begin + run.size() > end)
+					return false;
+				begin += run.size();
+			}
+
+			return true;
+		}
+	};
+}
@@ -0,0 +1,348 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Last folder used by each dialog client, in a fixed layout meant to be mapped
+//  into every process that shows a dialog.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Files::Native
+{
+	// The region is a hash table of fixed size slots. A client hashes to a window of
+	// ProbeLength slots, so lookups and updates touch a bounded number of slots whatever
+	// the number of clients; a full window gives up its least recently used slot.
+	// Writers claim a slot by making its sequence odd and readers retry when the sequence
+	// changed under them, so processes can share the region without a lock. A claim held
+	// past StaleClaimTimeout is taken for that of a process that died mid-write, and the
+	// slot is freed by the next writer of its window. Processes remembering a new client at
+	// once may each give it a slot: lookups take the most recent, and writers free the rest.
+	// An all-zero region is an empty store.
+	class FolderMruStore
+	{
+	public:
+		static constexpr std::uint32_t Magic = 0x55524D46; // "FMRU"
+		static constexpr std::uint32_t Version = 2;
+		static constexpr std::uint32_t SlotCount = 256;
+		static constexpr std::uint32_t ProbeLength = 8;
+		static constexpr std::size_t MaxPathBytes = 992;
+		// Writes take microseconds, a writer still holding its slot after this is gone
+		static constexpr std::chrono::milliseconds StaleClaimTimeout{ 5000 };
+
+		struct Header
+		{
+			std::uint32_t Magic;
+			std::uint32_t Version;
+			std::uint32_t SlotCount;
+			std::uint32_t SlotSize;
+			// Orders the slots by use
+			std::uint64_t Clock;
+			std::uint8_t Reserved[40];
+		};
+
+		struct Slot
+		{
+			std::uint32_t Sequence;
+			std::uint16_t Length;
+			std::uint16_t Reserved;
+			// 0 for a free slot
+			std::uint64_t KeyHash;
+			std::uint64_t LastUsed;
+			// Now() when the slot was last claimed
+			std::uint64_t ClaimTime;
+			// UTF-8, not terminated
+			char Path[MaxPathBytes];
+		};
+
+		static_assert(sizeof(Header) == 64, "Header layout changed");
+		static_assert(sizeof(Slot) == 1024, "Slot layout changed");
+
+		static constexpr std::size_t RequiredSize = sizeof(Header) + SlotCount * sizeof(Slot);
+
+		FolderMruStore() = default;
+
+		// Attaches to a region of at least RequiredSize bytes, zeroed the first time
+		FolderMruStore(void* region, std::size_t size)
+		{
+			if (!region || size < RequiredSize)
+				return;
+
+			Header* header = (Header*)region;
+			std::uint32_t magic = 0;
+			if (!std::atomic_ref<std::uint32_t>(header->Magic).compare_exchange_strong(magic, Magic) && magic != Magic)
+				return;
+
+			// Constants, racing initializers write the same values
+			std::atomic_ref<std::uint32_t>(header->Version).store(Version, std::memory_order_relaxed);
+			std::atomic_ref<std::uint32_t>(header->SlotCount).store(SlotCount, std::memory_order_relaxed);
+			std::atomic_ref<std::uint32_t>(header->SlotSize).store((std::uint32_t)sizeof(Slot), std::memory_order_relaxed);
+
+			_header = header;
+			_slots = (Slot*)((char*)region + sizeof(Header));
+		}
+
+		bool IsValid() const
+		{
+			return _header != nullptr;
+		}
+
+		std::optional<std::string> Lookup(std::string_view key) const
+		{
+			if (!IsValid())
+				return std::nullopt;
+
+			// The most recent of the slots racing writers gave the key
+			std::uint64_t hash = Hash(key);
+			std::optional<std::string> path;
+			std::uint64_t lastUsed = 0;
+			for (std::uint32_t i = 0; i < ProbeLength; i++)
+			{
+				Snapshot snapshot;
+				if (Read(SlotAt(hash, i), snapshot) && snapshot.KeyHash == hash && (!path || snapshot.LastUsed > lastUsed))
+				{
+					path.emplace(snapshot.Path, snapshot.Length);
+					lastUsed = snapshot.LastUsed;
+				}
+			}
+
+			return path;
+		}
+
+		// Returns false when the path is too long or every candidate slot is busy
+		bool Remember(std::string_view key, std::string_view path)
+		{
+			if (!IsValid() || path.empty() || path.size() > MaxPathBytes)
+				return false;
+
+			std::uint64_t hash = Hash(key);
+			std::uint32_t claimed;
+			Slot* slot = Claim(hash, claimed);
+			if (!slot)
+				return false;
+
+			std::uint64_t lastUsed = Tick();
+			std::atomic_ref<std::uint64_t>(slot->KeyHash).store(hash, std::memory_order_relaxed);
+			std::atomic_ref<std::uint64_t>(slot->LastUsed).store(lastUsed, std::memory_order_relaxed);
+			slot->Length = (std::uint16_t)path.size();
+			std::memcpy(slot->Path, path.data(), path.size());
+			Release(slot, claimed);
+
+			// Older slots another writer gave the key
+			Free(hash, lastUsed, slot);
+			return true;
+		}
+
+		// Frees every slot of the key, but those writers hold at the time
+		void Forget(std::string_view key)
+		{
+			if (!IsValid())
+				return;
+
+			Free(Hash(key), UINT64_MAX, nullptr);
+		}
+
+		static std::uint64_t Hash(std::string_view key)
+		{
+			// FNV-1a, 0 marks free slots
+			std::uint64_t hash = 14695981039346656037ULL;
+			for (char c : key)
+			{
+				hash ^= (unsigned char)c;
+				hash *= 1099511628211ULL;
+			}
+
+			return hash ? hash : 1;
+		}
+
+		// Milliseconds of the wall clock. The claim times outlive a reboot in the file, where
+		// the steady clock would start over below them.
+		static std::uint64_t Now()
+		{
+			return (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+
+	private:
+		Header* _header = nullptr;
+		Slot* _slots = nullptr;
+
+		struct Snapshot
+		{
+			std::uint64_t KeyHash;
+			std::uint64_t LastUsed;
+			std::uint16_t Length;
+			char Path[MaxPathBytes];
+		};
+
+		Slot* SlotAt(std::uint64_t hash, std::uint32_t probe) const
+		{
+			return &_slots[(hash + probe) % SlotCount];
+		}
+
+		std::uint64_t Tick()
+		{
+			return std::atomic_ref<std::uint64_t>(_header->Clock).fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+
+		// Consistent copy of the slot, false while a writer holds it
+		static bool Read(Slot* slot, Snapshot& snapshot)
+		{
+			std::atomic_ref<std::uint32_t> sequence(slot->Sequence);
+			for (int attempt = 0; attempt < 4; attempt++)
+			{
+				std::uint32_t before = sequence.load(std::memory_order_acquire);
+				if (before & 1)
+					continue;
+
+				snapshot.KeyHash = std::atomic_ref<std::uint64_t>(slot->KeyHash).load(std::memory_order_relaxed);
+				snapshot.LastUsed = std::atomic_ref<std::uint64_t>(slot->LastUsed).load(std::memory_order_relaxed);
+				snapshot.Length = slot->Length;
+				if (snapshot.Length > MaxPathBytes)
+					snapshot.Length = 0;
+				std::memcpy(snapshot.Path, slot->Path, snapshot.Length);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (sequence.load(std::memory_order_relaxed) == before)
+					return true;
+			}
+
+			return false;
+		}
+
+		// Claims the slot of the key, or else a free or the least recently used slot of its
+		// window. Candidates taken by another writer meanwhile are retried.
+		Slot* Claim(std::uint64_t hash, std::uint32_t& claimed)
+		{
+			for (int attempt = 0; attempt < 4; attempt++)
+			{
+				Slot* candidate = nullptr;
+				std::uint64_t oldest = UINT64_MAX;
+				for (std::uint32_t i = 0; i < ProbeLength; i++)
+				{
+					Slot* slot = SlotAt(hash, i);
+					Snapshot snapshot;
+					if (!Read(slot, snapshot) && !(Recover(slot) && Read(slot, snapshot)))
+						continue;
+
+					if (snapshot.KeyHash == hash)
+					{
+						candidate = slot;
+						break;
+					}
+
+					std::uint64_t age = snapshot.KeyHash ? snapshot.LastUsed : 0;
+					if (age < oldest)
+					{
+						candidate = slot;
+						oldest = age;
+					}
+				}
+
+				if (!candidate || !TryClaim(candidate, claimed))
+					continue;
+
+				// Another writer may have given the slot to another key since it was read
+				std::uint64_t current = std::atomic_ref<std::uint64_t>(candidate->KeyHash).load(std::memory_order_relaxed);
+				std::uint64_t lastUsed = std::atomic_ref<std::uint64_t>(candidate->LastUsed).load(std::memory_order_relaxed);
+				if (current == hash || current == 0 || lastUsed <= oldest)
+					return candidate;
+
+				Release(candidate, claimed);
+			}
+
+			return nullptr;
+		}
+
+		// Frees the slots of the window other than keep that hold the key and were last used
+		// before the given tick
+		void Free(std::uint64_t hash, std::uint64_t before, const Slot* keep)
+		{
+			for (std::uint32_t i = 0; i < ProbeLength; i++)
+			{
+				Slot* slot = SlotAt(hash, i);
+				if (slot == keep)
+					continue;
+
+				for (int attempt = 0; attempt < 4; attempt++)
+				{
+					Snapshot snapshot;
+					if (!Read(slot, snapshot) && !(Recover(slot) && Read(slot, snapshot)))
+						continue;
+					if (snapshot.KeyHash != hash || snapshot.LastUsed >= before)
+						break;
+
+					std::uint32_t claimed;
+					if (!TryClaim(slot, claimed))
+						continue;
+
+					if (std::atomic_ref<std::uint64_t>(slot->KeyHash).load(std::memory_order_relaxed) == hash &&
+						std::atomic_ref<std::uint64_t>(slot->LastUsed).load(std::memory_order_relaxed) < before)
+						Clear(slot);
+
+					Release(slot, claimed);
+					break;
+				}
+			}
+		}
+
+		static void Clear(Slot* slot)
+		{
+			std::atomic_ref<std::uint64_t>(slot->KeyHash).store(0, std::memory_order_relaxed);
+			slot->Length = 0;
+		}
+
+		// Makes the sequence odd from the given value, even or that of a stale claim
+		static bool Acquire(Slot* slot, std::uint32_t expected, std::uint32_t& claimed)
+		{
+			// Stamped first so that the claim is never seen with the time of the previous one,
+			// a writer losing the race only makes the slot look recently claimed
+			std::atomic_ref<std::uint64_t> claimTime(slot->ClaimTime);
+			claimTime.store(Now(), std::memory_order_relaxed);
+
+			claimed = expected + 1 + (expected & 1);
+			if (!std::atomic_ref<std::uint32_t>(slot->Sequence).compare_exchange_strong(expected, claimed, std::memory_order_acq_rel))
+				return false;
+
+			claimTime.store(Now(), std::memory_order_relaxed);
+			return true;
+		}
+
+		static bool TryClaim(Slot* slot, std::uint32_t& claimed)
+		{
+			std::uint32_t expected = std::atomic_ref<std::uint32_t>(slot->Sequence).load(std::memory_order_relaxed);
+			return !(expected & 1) && Acquire(slot, expected, claimed);
+		}
+
+		// Frees the slot of a writer that died holding it, true once it is free. A claim from
+		// the future was made before the clock was set back, and is as stale.
+		static bool Recover(Slot* slot)
+		{
+			std::uint32_t expected = std::atomic_ref<std::uint32_t>(slot->Sequence).load(std::memory_order_acquire);
+			std::uint64_t claimTime = std::atomic_ref<std::uint64_t>(slot->ClaimTime).load(std::memory_order_relaxed);
+			std::uint64_t now = Now();
+			bool stale = claimTime > now || now - claimTime > (std::uint64_t)StaleClaimTimeout.count();
+			std::uint32_t claimed;
+			if (!(expected & 1) || !stale || !Acquire(slot, expected, claimed))
+				return false;
+
+			// What it was writing is torn
+			Clear(slot);
+			Release(slot, claimed);
+			return true;
+		}
+
+		// Leaves the slot as is if it was recovered from this writer meanwhile
+		static void Release(Slot* slot, std::uint32_t claimed)
+		{
+			std::atomic_ref<std::uint32_t>(slot->Sequence).compare_exchange_strong(claimed, claimed + 1, std::memory_order_release);
+		}
+	};
+}
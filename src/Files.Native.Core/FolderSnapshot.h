@@ -0,0 +1,148 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Listing of the folder a dialog opens in, taken while Files starts so that
+//  Files can show it without enumerating the folder again.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	namespace Detail
+	{
+		inline void AppendUInt64(std::string& output, std::uint64_t value)
+		{
+			AppendUInt32(output, (std::uint32_t)value);
+			AppendUInt32(output, (std::uint32_t)(value >> 32));
+		}
+
+		inline bool ReadUInt64(std::string_view input, std::size_t& offset, std::uint64_t& value)
+		{
+			std::uint32_t low, high;
+			if (!ReadUInt32(input, offset, low) || !ReadUInt32(input, offset, high))
+				return false;
+
+			value = (std::uint64_t)low | ((std::uint64_t)high << 32);
+			return true;
+		}
+	}
+
+	// What a find handle returns for an entry. Times are FILETIME ticks, the
+	// attributes are FILE_ATTRIBUTE_* flags.
+	struct FolderSnapshotEntry
+	{
+		std::string Name;
+		std::uint32_t Attributes = 0;
+		std::uint64_t Size = 0;
+		std::uint64_t CreationTime = 0;
+		std::uint64_t LastAccessTime = 0;
+		std::uint64_t LastWriteTime = 0;
+	};
+
+	// Keep in sync with DialogFolderSnapshot in Files.App.
+	// Layout: magic, version, folder, folder last write time, capture time, count, then
+	// per entry its attributes, size, three times and name. Little-endian, strings are
+	// UTF-8 prefixed with their byte length.
+	struct FolderSnapshot
+	{
+		static constexpr std::uint32_t Magic = 0x504E5346; // "FSNP"
+		static constexpr std::uint32_t Version = 1;
+
+		// Larger folders are enumerated by Files as usual
+		static constexpr std::size_t MaxEntries = 100000;
+
+		std::string Folder;
+		// Files uses the snapshot only if the folder was not written since
+		std::uint64_t FolderLastWriteTime = 0;
+		std::uint64_t CaptureTime = 0;
+		std::vector<FolderSnapshotEntry> Entries;
+
+		// Lists the folder through source, which provides
+		//  bool Next(FolderSnapshotEntry& entry), false past the last entry
+		// and returns false if cancelled or past MaxEntries
+		template <typename TSource>
+		bool Capture(TSource& source, const std::atomic<bool>& cancelled)
+		{
+			Entries.clear();
+
+			FolderSnapshotEntry entry;
+			while (source.Next(entry))
+			{
+				if (cancelled.load(std::memory_order_relaxed) || Entries.size() == MaxEntries)
+					return false;
+				if (entry.Name == "." || entry.Name == "..")
+					continue;
+
+				Entries.push_back(std::move(entry));
+				entry = FolderSnapshotEntry();
+			}
+
+			return true;
+		}
+
+		std::string Encode() const
+		{
+			std::string output;
+			output.reserve(64 + Folder.size() + Entries.size() * 64);
+			Detail::AppendUInt32(output, Magic);
+			Detail::AppendUInt32(output, Version);
+			Detail::AppendUInt32(output, (std::uint32_t)Folder.size());
+			output.append(Folder);
+			Detail::AppendUInt64(output, FolderLastWriteTime);
+			Detail::AppendUInt64(output, CaptureTime);
+			Detail::AppendUInt32(output, (std::uint32_t)Entries.size());
+			for (const FolderSnapshotEntry& entry : Entries)
+			{
+				Detail::AppendUInt32(output, entry.Attributes);
+				Detail::AppendUInt64(output, entry.Size);
+				Detail::AppendUInt64(output, entry.CreationTime);
+				Detail::AppendUInt64(output, entry.LastAccessTime);
+				Detail::AppendUInt64(output, entry.LastWriteTime);
+				Detail::AppendUInt32(output, (std::uint32_t)entry.Name.size());
+				output.append(entry.Name);
+			}
+
+			return output;
+		}
+
+		static bool Decode(const std::string& input, FolderSnapshot& snapshot)
+		{
+			std::size_t offset = 0;
+			std::uint32_t magic, version, count;
+			if (!Detail::ReadUInt32(input, offset, magic) || magic != Magic ||
+				!Detail::ReadUInt32(input, offset, version) || version != Version ||
+				!Detail::ReadString(input, offset, snapshot.Folder) ||
+				!Detail::ReadUInt64(input, offset, snapshot.FolderLastWriteTime) ||
+				!Detail::ReadUInt64(input, offset, snapshot.CaptureTime) ||
+				!Detail::ReadUInt32(input, offset, count))
+				return false;
+
+			// Every entry takes at least its fixed fields, a larger count is a lie
+			if (count > MaxEntries || count > (input.size() - offset) / 40)
+				return false;
+
+			snapshot.Entries.resize(count);
+			for (FolderSnapshotEntry& entry : snapshot.Entries)
+			{
+				if (!Detail::ReadUInt32(input, offset, entry.Attributes) ||
+					!Detail::ReadUInt64(input, offset, entry.Size) ||
+					!Detail::ReadUInt64(input, offset, entry.CreationTime) ||
+					!Detail::ReadUInt64(input, offset, entry.LastAccessTime) ||
+					!Detail::ReadUInt64(input, offset, entry.LastWriteTime) ||
+					!Detail::ReadString(input, offset, entry.Name))
+					return false;
+			}
+
+			return offset == input.size();
+		}
+	};
+}
@@ -0,0 +1,210 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Batched evaluation of the host's IShellItemFilter. Files sends the names it
+//  lists in batches, the dialog answers each batch with one bit per name.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	// One bit per item, in the order the items were queried
+	class VerdictBitmap
+	{
+		std::vector<std::uint64_t> _words;
+		std::size_t _size = 0;
+
+	public:
+		VerdictBitmap() = default;
+
+		explicit VerdictBitmap(std::size_t size) : _words((size + 63) / 64), _size(size)
+		{
+		}
+
+		std::size_t Size() const
+		{
+			return _size;
+		}
+
+		bool Test(std::size_t index) const
+		{
+			return (_words[index / 64] >> (index % 64)) & 1;
+		}
+
+		void Set(std::size_t index, bool value)
+		{
+			std::uint64_t mask = (std::uint64_t)1 << (index % 64);
+			if (value)
+				_words[index / 64] |= mask;
+			else
+				_words[index / 64] &= ~mask;
+		}
+
+		void Resize(std::size_t size)
+		{
+			_words.resize((size + 63) / 64);
+			_size = size;
+		}
+
+		// Least significant bit first, (size + 7) / 8 bytes
+		void AppendTo(std::string& output) const
+		{
+			for (std::size_t i = 0; i < (_size + 7) / 8; i++)
+				output.push_back((char)((_words[i / 8] >> (i % 8 * 8)) & 0xFF));
+		}
+
+		static bool Read(const std::string& input, std::size_t offset, std::size_t size, VerdictBitmap& bitmap)
+		{
+			if (offset > input.size() || input.size() - offset < (size + 7) / 8)
+				return false;
+
+			bitmap = VerdictBitmap(size);
+			for (std::size_t i = 0; i < (size + 7) / 8; i++)
+				bitmap._words[i / 8] |= (std::uint64_t)(unsigned char)input[offset + i] << (i % 8 * 8);
+
+			// Don't let padding bits of the last byte leak past the end
+			if (size % 64)
+				bitmap._words.back() &= ((std::uint64_t)1 << (size % 64)) - 1;
+
+			return true;
+		}
+	};
+
+	// Files -> dialog: names (UTF-8) listed in a folder, to be run through the host's filter.
+	// Payload: id, folder, count, then count names, strings prefixed with their byte length.
+	struct FilterQuery
+	{
+		// Passed to Files with -itemfilter, larger batches are rejected
+		static constexpr std::uint32_t MaxNames = 512;
+
+		std::uint32_t Id = 0;
+		std::string Folder;
+		std::vector<std::string> Names;
+
+		std::string Encode() const
+		{
+			std::string payload;
+			Detail::AppendUInt32(payload, Id);
+			Detail::AppendUInt32(payload, (std::uint32_t)Folder.size());
+			payload.append(Folder);
+			Detail::AppendUInt32(payload, (std::uint32_t)Names.size());
+			for (const std::string& name : Names)
+			{
+				Detail::AppendUInt32(payload, (std::uint32_t)name.size());
+				payload.append(name);
+			}
+
+			return payload;
+		}
+
+		static bool Decode(const std::string& payload, FilterQuery& query)
+		{
+			std::size_t offset = 0;
+			std::uint32_t count;
+			if (!Detail::ReadUInt32(payload, offset, query.Id) ||
+				!Detail::ReadString(payload, offset, query.Folder) ||
+				!Detail::ReadUInt32(payload, offset, count))
+				return false;
+
+			// Every name takes at least its length prefix, a larger count is a lie
+			if (count > MaxNames || count > (payload.size() - offset) / 4)
+				return false;
+
+			query.Names.resize(count);
+			for (std::string& name : query.Names)
+			{
+				if (!Detail::ReadString(payload, offset, name))
+					return false;
+			}
+
+			return offset == payload.size();
+		}
+	};
+
+	// Dialog -> Files: whether each name of the query with the same id is to be listed.
+	// Payload: id, count, then the bitmap.
+	struct FilterVerdicts
+	{
+		std::uint32_t Id = 0;
+		VerdictBitmap Included;
+
+		std::string Encode() const
+		{
+			std::string payload;
+			Detail::AppendUInt32(payload, Id);
+			Detail::AppendUInt32(payload, (std::uint32_t)Included.Size());
+			Included.AppendTo(payload);
+			return payload;
+		}
+
+		static bool Decode(const std::string& payload, FilterVerdicts& verdicts)
+		{
+			std::size_t offset = 0;
+			std::uint32_t count;
+			return Detail::ReadUInt32(payload, offset, verdicts.Id) &&
+				Detail::ReadUInt32(payload, offset, count) &&
+				VerdictBitmap::Read(payload, offset, count, verdicts.Included) &&
+				offset + (count + 7) / 8 == payload.size();
+		}
+	};
+
+	// Verdicts already given, per folder, so that going back to a folder or listing it
+	// again after a change only calls the host for the names it has not seen yet.
+	class FilterVerdictCache
+	{
+		// Plenty for one dialog; past that the cache starts over rather than growing
+		static constexpr std::size_t MaxFolders = 64;
+
+		struct FolderVerdicts
+		{
+			std::unordered_map<std::string, std::uint32_t> Slots;
+			VerdictBitmap Included;
+		};
+
+		std::unordered_map<std::string, FolderVerdicts> _folders;
+
+	public:
+		// Answers the query, calling evaluate(folder, name) -> bool for names not cached
+		template <typename TEvaluate>
+		FilterVerdicts Evaluate(const FilterQuery& query, TEvaluate evaluate)
+		{
+			if (_folders.size() >= MaxFolders && _folders.find(query.Folder) == _folders.end())
+				_folders.clear();
+
+			FolderVerdicts& folder = _folders[query.Folder];
+			FilterVerdicts verdicts;
+			verdicts.Id = query.Id;
+			verdicts.Included = VerdictBitmap(query.Names.size());
+
+			for (std::size_t i = 0; i < query.Names.size(); i++)
+			{
+				auto slot = folder.Slots.find(query.Names[i]);
+				if (slot == folder.Slots.end())
+				{
+					std::uint32_t index = (std::uint32_t)folder.Slots.size();
+					folder.Included.Resize(index + 1);
+					folder.Included.Set(index, evaluate(query.Folder, query.Names[i]));
+					slot = folder.Slots.emplace(query.Names[i], index).first;
+				}
+
+				verdicts.Included.Set(i, folder.Included.Test(slot->second));
+			}
+
+			return verdicts;
+		}
+
+		void Clear()
+		{
+			_folders.clear();
+		}
+	};
+}
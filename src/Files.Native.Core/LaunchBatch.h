@@ -0,0 +1,199 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Lists of folders and items the launcher opens in one invocation.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "LaunchRules.h"
+
+namespace Files::Native
+{
+	struct LaunchTarget
+	{
+		// UTF-8
+		std::string Path;
+		// The item is selected in its folder rather than opened
+		bool Select = false;
+	};
+
+	// Locations File Explorer opens in one window: a folder, or items selected in their folder
+	struct ExplorerGroup
+	{
+		// UTF-8
+		std::string Folder;
+		// Empty to open the folder itself
+		std::vector<std::string> Items;
+	};
+
+	// A list has one location per line, optionally prefixed with -directory or -select
+	// and quoted. Blank lines and lines starting with # are skipped.
+	//  # Projects
+	//  C:\Projects
+	//  -select "C:\Projects\readme.md"
+	class LaunchBatch
+	{
+	public:
+		std::vector<LaunchTarget> FilesTargets;
+		std::vector<LaunchTarget> ExplorerTargets;
+		// Lines that are not a location Files can take on its command line
+		std::size_t Skipped = 0;
+
+		// Parses the list and routes each location under the user's rules, if any, dropping
+		// duplicates
+		static LaunchBatch Parse(std::string_view text, const LaunchRuleSet* rules = nullptr)
+		{
+			LaunchBatch batch;
+			std::unordered_set<std::string> seen;
+
+			if (text.substr(0, 3) == "\xEF\xBB\xBF")
+				text.remove_prefix(3);
+
+			while (!text.empty())
+			{
+				std::size_t end = text.find('\n');
+				std::string_view line = Trim(text.substr(0, end));
+				text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				LaunchTarget target;
+				if (ConsumeVerb(line, "-select"))
+					target.Select = true;
+				else
+					ConsumeVerb(line, "-directory");
+
+				if (line.size() >= 2 && line.front() == '"' && line.back() == '"')
+					line = line.substr(1, line.size() - 2);
+
+				// Files' command line takes anything after a dash or slash for an option, and
+				// can't quote a quote
+				if (line.empty() || line[0] == '-' || line[0] == '/' || line.find('"') != std::string_view::npos)
+				{
+					batch.Skipped++;
+					continue;
+				}
+
+				if (!seen.insert(GetKey(line, target.Select)).second)
+					continue;
+
+				target.Path = std::string(line);
+				if (GetLaunchRoute(line, rules) == LaunchRoute::Explorer)
+					batch.ExplorerTargets.push_back(std::move(target));
+				else
+					batch.FilesTargets.push_back(std::move(target));
+			}
+
+			return batch;
+		}
+
+		// Files activation command lines for the Files targets, as few as fit in maxLength
+		// bytes each. Folders are opened in the order of the list, then the selections. The two
+		// never share a command line, where Files would select an item of one folder in another.
+		std::vector<std::string> BuildCommandLines(std::string_view executable, std::size_t maxLength) const
+		{
+			std::vector<std::string> commandLines;
+			std::string prefix = "\"";
+			prefix.append(executable).push_back('"');
+
+			for (bool select : { false, true })
+			{
+				std::string commandLine;
+				for (const LaunchTarget& target : FilesTargets)
+				{
+					if (target.Select != select)
+						continue;
+
+					if (!commandLine.empty() && commandLine.size() + target.Path.size() + 3 > maxLength)
+					{
+						commandLines.push_back(std::move(commandLine));
+						commandLine.clear();
+					}
+
+					if (commandLine.empty())
+						commandLine.append(prefix).append(select ? " -select" : " -directory");
+					commandLine.append(" \"").append(target.Path).append("\"");
+				}
+
+				if (!commandLine.empty())
+					commandLines.push_back(std::move(commandLine));
+			}
+
+			return commandLines;
+		}
+
+		// The Explorer targets by the window they open in, in the order of the list. Items
+		// selected in the same folder share a window, an item without a folder opens alone.
+		std::vector<ExplorerGroup> GroupExplorerTargets() const
+		{
+			std::vector<ExplorerGroup> groups;
+			std::unordered_map<std::string, std::size_t> selections;
+			for (const LaunchTarget& target : ExplorerTargets)
+			{
+				std::size_t separator = target.Path.find_last_of("\\/");
+				if (!target.Select || separator == std::string::npos || separator + 1 == target.Path.size())
+				{
+					groups.push_back({ target.Path, {} });
+					continue;
+				}
+
+				std::string_view folder = std::string_view(target.Path).substr(0, separator == 2 ? 3 : separator);
+				auto [group, added] = selections.emplace(GetKey(folder, true), groups.size());
+				if (added)
+					groups.push_back({ std::string(folder), {} });
+
+				groups[group->second].Items.push_back(target.Path);
+			}
+
+			return groups;
+		}
+
+	private:
+		static std::string_view Trim(std::string_view value)
+		{
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+				value.remove_prefix(1);
+			while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r'))
+				value.remove_suffix(1);
+
+			return value;
+		}
+
+		static bool ConsumeVerb(std::string_view& line, std::string_view verb)
+		{
+			if (line.size() <= verb.size() || (line[verb.size()] != ' ' && line[verb.size()] != '\t'))
+				return false;
+
+			for (std::size_t i = 0; i < verb.size(); i++)
+			{
+				char c = line[i];
+				if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != verb[i])
+					return false;
+			}
+
+			line = Trim(line.substr(verb.size()));
+			return true;
+		}
+
+		// Paths are case-insensitive and a trailing separator names the same folder
+		static std::string GetKey(std::string_view path, bool select)
+		{
+			while (path.size() > 3 && (path.back() == '\\' || path.back() == '/'))
+				path.remove_suffix(1);
+
+			std::string key(select ? "s:" : "d:");
+			for (char c : path)
+				key.push_back(c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+
+			return key;
+		}
+	};
+}
@@ -0,0 +1,292 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Histograms of the time launches take to activate, one per outcome, in a fixed
+//  layout meant to be mapped into every launcher and merged across machines.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace Files::Native
+{
+	// Where a launch ended up. The values are stored, add new ones before Count.
+	enum class LaunchOutcome : std::uint8_t
+	{
+		// A File Explorer window already showing a parent navigated to the location
+		ExplorerWindow,
+		FilesDirectory,
+		FilesSelect,
+		// A location Files can't show, or that the rules send to File Explorer, in a new window
+		ExplorerFallback,
+		// Files was uninstalled and File Explorer restored
+		Uninstall,
+		// An open or save dialog's activation, until Files acknowledged it
+		DialogAcknowledged,
+		// An open or save dialog's activation that Files didn't acknowledge in time, the
+		// system dialog was shown instead
+		DialogTimedOut,
+		Count,
+	};
+
+	inline std::string_view GetLaunchOutcomeName(LaunchOutcome outcome)
+	{
+		switch (outcome)
+		{
+		case LaunchOutcome::ExplorerWindow:
+			return "explorer-window";
+		case LaunchOutcome::FilesDirectory:
+			return "files-directory";
+		case LaunchOutcome::FilesSelect:
+			return "files-select";
+		case LaunchOutcome::ExplorerFallback:
+			return "explorer-fallback";
+		case LaunchOutcome::Uninstall:
+			return "uninstall";
+		case LaunchOutcome::DialogAcknowledged:
+			return "dialog-acknowledged";
+		case LaunchOutcome::DialogTimedOut:
+			return "dialog-timed-out";
+		default:
+			return "unknown";
+		}
+	}
+
+	// Log-linear buckets in microseconds: exact below 64, then 32 buckets for every power
+	// of two, so a bucket is never wider than 1/32 of its values. The last bucket takes
+	// everything from 36 hours on.
+	class LatencyHistogram
+	{
+	public:
+		static constexpr std::uint32_t SubBucketBits = 5;
+		static constexpr std::uint32_t SubBucketCount = 1 << SubBucketBits;
+		static constexpr std::uint32_t BucketCount = 1024;
+
+		static constexpr std::uint32_t GetBucket(std::uint64_t value)
+		{
+			if (value < 2 * SubBucketCount)
+				return (std::uint32_t)value;
+
+			std::uint32_t shift = (std::uint32_t)std::bit_width(value) - SubBucketBits - 1;
+			std::uint64_t bucket = (std::uint64_t)(shift + 1) * SubBucketCount + ((value >> shift) - SubBucketCount);
+			return bucket < BucketCount ? (std::uint32_t)bucket : BucketCount - 1;
+		}
+
+		static constexpr std::uint64_t GetLowestValue(std::uint32_t bucket)
+		{
+			if (bucket < 2 * SubBucketCount)
+				return bucket;
+
+			std::uint32_t shift = bucket / SubBucketCount - 1;
+			return (std::uint64_t)(bucket % SubBucketCount + SubBucketCount) << shift;
+		}
+
+		static constexpr std::uint64_t GetHighestValue(std::uint32_t bucket)
+		{
+			return bucket + 1 < BucketCount ? GetLowestValue(bucket + 1) - 1 : UINT64_MAX;
+		}
+
+		void Record(std::uint64_t value, std::uint64_t count = 1)
+		{
+			_buckets[GetBucket(value)] += count;
+			_count += count;
+			_total += value * count;
+			if (value > _max)
+				_max = value;
+		}
+
+		void Merge(const LatencyHistogram& other)
+		{
+			for (std::uint32_t i = 0; i < BucketCount; i++)
+				_buckets[i] += other._buckets[i];
+
+			_count += other._count;
+			_total += other._total;
+			if (other._max > _max)
+				_max = other._max;
+		}
+
+		std::uint64_t GetCount() const
+		{
+			return _count;
+		}
+
+		std::uint64_t GetTotal() const
+		{
+			return _total;
+		}
+
+		std::uint64_t GetMax() const
+		{
+			return _max;
+		}
+
+		std::uint64_t GetBucketCount(std::uint32_t bucket) const
+		{
+			return _buckets[bucket];
+		}
+
+		double GetMean() const
+		{
+			return _count ? (double)_total / _count : 0;
+		}
+
+		// Highest value of the bucket holding the percentile, never more than the maximum
+		std::uint64_t GetPercentile(double percentile) const
+		{
+			if (!_count)
+				return 0;
+
+			std::uint64_t rank = (std::uint64_t)(percentile / 100 * _count + 0.5);
+			if (rank < 1)
+				rank = 1;
+			if (rank > _count)
+				rank = _count;
+
+			std::uint64_t seen = 0;
+			for (std::uint32_t i = 0; i < BucketCount; i++)
+			{
+				seen += _buckets[i];
+				if (seen >= rank)
+					return GetHighestValue(i) < _max ? GetHighestValue(i) : _max;
+			}
+
+			return _max;
+		}
+
+	private:
+		friend class LaunchLatencyStore;
+
+		std::array<std::uint64_t, BucketCount> _buckets{};
+		std::uint64_t _count = 0;
+		std::uint64_t _total = 0;
+		std::uint64_t _max = 0;
+	};
+
+	// The region holds a header and a histogram per outcome. Unlike FolderMruStore it
+	// takes no lock of its own: an update touches a bucket and the totals, which only
+	// make sense together, so callers serialize their access to the region. An all-zero
+	// region is an empty store, the same layout read from another machine merges as is.
+	class LaunchLatencyStore
+	{
+	public:
+		static constexpr std::uint32_t Magic = 0x484C4C46; // "FLLH"
+		static constexpr std::uint32_t Version = 2;
+
+		struct Header
+		{
+			std::uint32_t Magic;
+			std::uint32_t Version;
+			std::uint32_t OutcomeCount;
+			std::uint32_t BucketCount;
+			std::uint32_t SubBucketBits;
+			std::uint8_t Reserved[44];
+		};
+
+		struct Histogram
+		{
+			std::uint64_t Count;
+			// Microseconds
+			std::uint64_t Total;
+			std::uint64_t Max;
+			std::uint64_t Reserved;
+			std::uint64_t Buckets[LatencyHistogram::BucketCount];
+		};
+
+		static_assert(sizeof(Header) == 64, "Header layout changed");
+		static_assert(sizeof(Histogram) == 32 + 8 * LatencyHistogram::BucketCount, "Histogram layout changed");
+
+		static constexpr std::size_t RequiredSize = sizeof(Header) + (std::size_t)LaunchOutcome::Count * sizeof(Histogram);
+
+		LaunchLatencyStore() = default;
+
+		// Attaches to a region of at least RequiredSize bytes, zeroed the first time. A region
+		// of another layout is left alone.
+		LaunchLatencyStore(void* region, std::size_t size)
+		{
+			if (!region || size < RequiredSize)
+				return;
+
+			Header* header = (Header*)region;
+			if (header->Magic == 0)
+			{
+				header->Version = Version;
+				header->OutcomeCount = (std::uint32_t)LaunchOutcome::Count;
+				header->BucketCount = LatencyHistogram::BucketCount;
+				header->SubBucketBits = LatencyHistogram::SubBucketBits;
+				header->Magic = Magic;
+			}
+			else if (header->Magic != Magic || header->Version != Version ||
+				header->OutcomeCount != (std::uint32_t)LaunchOutcome::Count ||
+				header->BucketCount != LatencyHistogram::BucketCount ||
+				header->SubBucketBits != LatencyHistogram::SubBucketBits)
+			{
+				return;
+			}
+
+			_histograms = (Histogram*)((char*)region + sizeof(Header));
+		}
+
+		bool IsValid() const
+		{
+			return _histograms != nullptr;
+		}
+
+		void Record(LaunchOutcome outcome, std::uint64_t microseconds)
+		{
+			if (!IsValid() || outcome >= LaunchOutcome::Count)
+				return;
+
+			Histogram& histogram = _histograms[(std::size_t)outcome];
+			histogram.Buckets[LatencyHistogram::GetBucket(microseconds)]++;
+			histogram.Count++;
+			histogram.Total += microseconds;
+			if (microseconds > histogram.Max)
+				histogram.Max = microseconds;
+		}
+
+		LatencyHistogram Read(LaunchOutcome outcome) const
+		{
+			LatencyHistogram result;
+			if (!IsValid() || outcome >= LaunchOutcome::Count)
+				return result;
+
+			const Histogram& histogram = _histograms[(std::size_t)outcome];
+			std::copy(std::begin(histogram.Buckets), std::end(histogram.Buckets), result._buckets.begin());
+			result._count = histogram.Count;
+			result._total = histogram.Total;
+			result._max = histogram.Max;
+			return result;
+		}
+
+		// Adds another store, e.g. the file of another machine
+		void Merge(const LaunchLatencyStore& other)
+		{
+			if (!IsValid() || !other.IsValid())
+				return;
+
+			for (std::size_t outcome = 0; outcome < (std::size_t)LaunchOutcome::Count; outcome++)
+			{
+				Histogram& into = _histograms[outcome];
+				const Histogram& from = other._histograms[outcome];
+				for (std::uint32_t i = 0; i < LatencyHistogram::BucketCount; i++)
+					into.Buckets[i] += from.Buckets[i];
+
+				into.Count += from.Count;
+				into.Total += from.Total;
+				if (from.Max > into.Max)
+					into.Max = from.Max;
+			}
+		}
+
+	private:
+		Histogram* _histograms = nullptr;
+	};
+}
@@ -0,0 +1,120 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Request a launcher hands straight to a running Files instance, instead of
+//  going through protocol activation.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "WireFormat.h"
+
+namespace Files::Native
+{
+	// Keep in sync with LaunchRequestHelper.LaunchStatus in Files.App
+	enum class LaunchStatus : std::uint8_t
+	{
+		// Nobody answered, the launcher activates Files through the protocol
+		Unreachable = 0,
+		// The instance took the request and shows its window
+		Accepted = 1,
+		// The instance is running but won't take it, e.g. while it serves a file dialog
+		// or when the user wants a new window for each launch
+		Declined = 2,
+	};
+
+	// Keep in sync with LaunchRequestHelper.LaunchRequestKind in Files.App
+	enum class LaunchRequestKind : std::uint32_t
+	{
+		// Payload is an activation command line, as protocol activation would pass it
+		Activate = 1,
+		// Payload is the path of an item to select in the folder an earlier Activate
+		// opened. Files selects it there without navigating again, even when that
+		// folder is still loading.
+		AmendSelection = 2,
+	};
+
+	// One request per connection: magic, version, kind and the payload as a UTF-8
+	// string prefixed with its byte length, answered with a single LaunchStatus byte.
+	// Little-endian.
+	struct LaunchProtocol
+	{
+		static constexpr std::uint32_t Magic = 0x48434C46; // "FLCH"
+		static constexpr std::uint32_t Version = 2;
+		static constexpr std::size_t HeaderSize = 16;
+
+		// A command line is a verb and a path or two, this is plenty
+		static constexpr std::uint32_t MaxPayloadSize = 32 * 1024;
+
+		static std::string EncodeRequest(LaunchRequestKind kind, std::string_view payload)
+		{
+			std::string output;
+			output.reserve(HeaderSize + payload.size());
+			Detail::AppendUInt32(output, Magic);
+			Detail::AppendUInt32(output, Version);
+			Detail::AppendUInt32(output, (std::uint32_t)kind);
+			Detail::AppendUInt32(output, (std::uint32_t)payload.size());
+			output.append(payload);
+			return output;
+		}
+
+		// Kind and size of the payload following the header, false for anything else
+		// than a request of this version
+		static bool DecodeHeader(const std::string& header, LaunchRequestKind& kind, std::uint32_t& payloadSize)
+		{
+			std::size_t offset = 0;
+			std::uint32_t magic, version, rawKind;
+			if (!Detail::ReadUInt32(header, offset, magic) || magic != Magic ||
+				!Detail::ReadUInt32(header, offset, version) || version != Version ||
+				!Detail::ReadUInt32(header, offset, rawKind) ||
+				!Detail::ReadUInt32(header, offset, payloadSize) || payloadSize > MaxPayloadSize)
+				return false;
+
+			kind = (LaunchRequestKind)rawKind;
+			return kind == LaunchRequestKind::Activate || kind == LaunchRequestKind::AmendSelection;
+		}
+
+		// Sends the request through transport, which provides
+		//  bool Write(const char* data, std::size_t size)
+		//  bool Read(char* data, std::size_t size), all of it or false
+		// and is in charge of the deadline
+		template <typename TTransport>
+		static LaunchStatus Send(TTransport& transport, LaunchRequestKind kind, std::string_view payload)
+		{
+			if (payload.size() > MaxPayloadSize)
+				return LaunchStatus::Unreachable;
+
+			std::string request = EncodeRequest(kind, payload);
+			char reply;
+			if (!transport.Write(request.data(), request.size()) || !transport.Read(&reply, 1))
+				return LaunchStatus::Unreachable;
+
+			LaunchStatus status = (LaunchStatus)reply;
+			return status == LaunchStatus::Accepted || status == LaunchStatus::Declined ? status : LaunchStatus::Unreachable;
+		}
+
+		// Server side of Send, the reply is up to the caller
+		template <typename TTransport>
+		static bool Receive(TTransport& transport, LaunchRequestKind& kind, std::string& payload)
+		{
+			std::string header(HeaderSize, '\0');
+			std::uint32_t payloadSize;
+			if (!transport.Read(header.data(), header.size()) || !DecodeHeader(header, kind, payloadSize))
+				return false;
+
+			payload.assign(payloadSize, '\0');
+			return payloadSize == 0 || transport.Read(payload.data(), payload.size());
+		}
+
+		template <typename TTransport>
+		static bool Reply(TTransport& transport, LaunchStatus status)
+		{
+			char reply = (char)status;
+			return transport.Write(&reply, 1);
+		}
+	};
+}
@@ -0,0 +1,475 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Routing that decides whether a location opens in Files or File Explorer,
+//  and the user's own rules, compiled into a prefix trie the launcher maps.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "FolderSnapshot.h"
+
+namespace Files::Native
+{
+	enum class LaunchRoute
+	{
+		Files,
+		// Shell locations Files can't show, e.g. Control Panel pages
+		Explorer,
+	};
+
+	// Where a location given to the launcher opens. Works on UTF-8 and UTF-16 paths,
+	// every location compared against is ASCII.
+	template <typename TChar>
+	LaunchRoute GetLaunchRoute(std::basic_string_view<TChar> path)
+	{
+		auto toLower = [](TChar c) { return c >= 'A' && c <= 'Z' ? (TChar)(c - 'A' + 'a') : c; };
+		auto startsWith = [&](std::basic_string_view<TChar> value, std::string_view prefix)
+		{
+			if (value.size() < prefix.size())
+				return false;
+
+			for (std::size_t i = 0; i < prefix.size(); i++)
+			{
+				if (toLower(value[i]) != toLower((TChar)prefix[i]))
+					return false;
+			}
+
+			return true;
+		};
+		auto contains = [&](std::basic_string_view<TChar> value, std::string_view needle)
+		{
+			for (std::size_t i = 0; i + needle.size() <= value.size(); i++)
+			{
+				if (startsWith(value.substr(i), needle))
+					return true;
+			}
+
+			return false;
+		};
+
+		// God mode opens in File Explorer
+		if (contains(path, "{ED7BA470-8E54-465E-825C-99712043E01C}"))
+			return LaunchRoute::Explorer;
+
+		// A bare CLSID path is a shell: location without the prefix
+		std::string_view shellPrefix = startsWith(path, "::{") ? "" : "shell:";
+		if (!shellPrefix.empty() && !startsWith(path, shellPrefix))
+			return LaunchRoute::Files;
+
+		static constexpr std::string_view supportedShellFolders[] =
+		{
+			"shell:::{645FF040-5081-101B-9F08-00AA002F954E}",
+			"shell:::{5E5F29CE-E0A8-49D3-AF32-7A7BDC173478}",
+			"shell:::{20D04FE0-3AEA-1069-A2D8-08002B30309D}",
+			"shell:::{F02C1A0D-BE21-4350-88B0-7367FC96EF3C}",
+			"shell:::{208D2C60-3AEA-1069-A2D7-08002B30309D}",
+			"Shell:RecycleBinFolder", "Shell:NetworkPlacesFolder", "Shell:MyComputerFolder",
+		};
+
+		for (std::string_view folder : supportedShellFolders)
+		{
+			// Compares "::{...}" against the folder without its "shell:"
+			std::string_view expected = shellPrefix.empty() ? folder.substr(6) : folder;
+			if (path.size() == expected.size() && startsWith(path, expected))
+				return LaunchRoute::Files;
+		}
+
+		return LaunchRoute::Explorer;
+	}
+
+	// Rules the user keeps in a text file, one per line, the route and a location:
+	//  # WSL and the media share open in File Explorer
+	//  explorer \\wsl.localhost*
+	//  explorer \\nas\media
+	//  files ::{20D04FE0-3AEA-1069-A2D8-08002B30309D}
+	// A rule matches its location and everything under it, one ending with * or a
+	// separator matches any path starting with what precedes it. The longest matching rule wins over
+	// the others and over GetLaunchRoute. Case-insensitive for ASCII, / and \ are the
+	// same, and "shell:::{" the same as "::{".
+	//
+	// The rules are compiled into a trie over the UTF-8 bytes of the locations, laid out
+	// to be used straight from a mapped file: a header, then per node its first edge,
+	// edge count and routes, then the byte of every edge. Nodes are numbered breadth
+	// first with the edges of a node contiguous and sorted by byte, so that edge n leads
+	// to node n + 1 and needs no target. Little-endian.
+	class LaunchRuleSet
+	{
+	public:
+		static constexpr std::uint32_t Magic = 0x54524C46; // "FLRT"
+		static constexpr std::uint32_t Version = 1;
+		static constexpr std::size_t HeaderSize = 40;
+		static constexpr std::size_t NodeSize = 8;
+
+		// Bounds the compiled size to some 200 MB
+		static constexpr std::uint32_t MaxNodes = 1u << 24;
+		static constexpr std::size_t MaxRuleLength = 2048;
+
+		LaunchRuleSet() = default;
+
+		// Uses a compiled image, which must outlive the set, if it was compiled from the
+		// rules file with the given write time and size. False leaves the set empty.
+		bool Attach(std::string_view image, std::uint64_t sourceWriteTime, std::uint64_t sourceSize)
+		{
+			*this = LaunchRuleSet();
+
+			std::size_t offset = 0;
+			std::uint32_t magic, version, nodeCount, edgeCount, ruleCount, reserved;
+			std::uint64_t writeTime, size;
+			if (!Detail::ReadUInt32(image, offset, magic) || magic != Magic ||
+				!Detail::ReadUInt32(image, offset, version) || version != Version ||
+				!Detail::ReadUInt64(image, offset, writeTime) || writeTime != sourceWriteTime ||
+				!Detail::ReadUInt64(image, offset, size) || size != sourceSize ||
+				!Detail::ReadUInt32(image, offset, nodeCount) ||
+				!Detail::ReadUInt32(image, offset, edgeCount) ||
+				!Detail::ReadUInt32(image, offset, ruleCount) ||
+				!Detail::ReadUInt32(image, offset, reserved) ||
+				nodeCount == 0 || nodeCount > MaxNodes || edgeCount != nodeCount - 1 ||
+				image.size() != GetImageSize(nodeCount, edgeCount))
+				return false;
+
+			// Match checks the nodes it walks through, so that attaching maps no more than the
+			// header and a match no more than its path through the trie
+			_nodes = image.data() + HeaderSize;
+			_edgeBytes = _nodes + (std::size_t)nodeCount * NodeSize;
+			_edgeCount = edgeCount;
+			_ruleCount = ruleCount;
+			return true;
+		}
+
+		std::uint32_t GetRuleCount() const
+		{
+			return _ruleCount;
+		}
+
+		// Route of the longest rule matching path, nothing when none does. Takes UTF-8 and
+		// UTF-16 paths, in time linear in their length and without allocating.
+		template <typename TChar>
+		std::optional<LaunchRoute> Match(std::basic_string_view<TChar> path) const
+		{
+			if (!_nodes)
+				return std::nullopt;
+
+			if (StartsWithShellClsid(path))
+				path.remove_prefix(6);
+
+			std::uint32_t node = 0;
+			std::uint8_t matched = RouteNone;
+			std::size_t index = 0;
+			char bytes[4];
+			std::size_t byteCount = 0, byteIndex = 0;
+			while (true)
+			{
+				const char* entry = _nodes + (std::size_t)node * NodeSize;
+				if (IsRoute(entry[7]))
+					matched = (unsigned char)entry[7];
+
+				if (byteIndex == byteCount)
+				{
+					byteIndex = 0;
+					byteCount = index < path.size() ? EncodeNext(path, index, bytes) : 0;
+				}
+
+				// A location matches up to a separator or the end of the path
+				if (IsRoute(entry[6]) && (byteCount == 0 || bytes[byteIndex] == '\\'))
+					matched = (unsigned char)entry[6];
+
+				if (byteCount == 0)
+					break;
+
+				std::uint32_t next = FindEdge(entry, (unsigned char)bytes[byteIndex++]);
+				if (next == 0)
+					break;
+
+				node = next;
+			}
+
+			if (matched == RouteNone)
+				return std::nullopt;
+
+			return matched == RouteExplorer ? LaunchRoute::Explorer : LaunchRoute::Files;
+		}
+
+		// Compiles a rules file for Attach. Lines that are not a rule are skipped and
+		// counted in skipped.
+		static std::string Compile(std::string_view text, std::uint64_t sourceWriteTime, std::uint64_t sourceSize, std::size_t& skipped)
+		{
+			struct Node
+			{
+				// Sorted by byte
+				std::vector<std::pair<unsigned char, std::uint32_t>> Children;
+				std::uint8_t LocationRoute = RouteNone;
+				std::uint8_t PrefixRoute = RouteNone;
+			};
+
+			std::vector<Node> nodes(1);
+			std::uint32_t ruleCount = 0;
+			skipped = 0;
+
+			if (text.substr(0, 3) == "\xEF\xBB\xBF")
+				text.remove_prefix(3);
+
+			while (!text.empty())
+			{
+				std::size_t end = text.find('\n');
+				std::string_view line = Trim(text.substr(0, end));
+				text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				std::uint8_t route = ConsumeRoute(line);
+				if (line.size() >= 2 && line.front() == '"' && line.back() == '"')
+					line = line.substr(1, line.size() - 2);
+
+				bool prefix = !line.empty() && line.back() == '*';
+				if (prefix)
+					line.remove_suffix(1);
+				if (StartsWithShellClsid(line))
+					line.remove_prefix(6);
+
+				// A rule for everything is not a rule
+				if (route == RouteNone || line.empty() || line.size() > MaxRuleLength ||
+					nodes.size() + line.size() > MaxNodes)
+				{
+					skipped++;
+					continue;
+				}
+
+				std::uint32_t node = 0;
+				for (char c : line)
+				{
+					unsigned char value = (unsigned char)Normalize(c);
+					auto& children = nodes[node].Children;
+					auto child = children.begin();
+					while (child != children.end() && child->first < value)
+						++child;
+
+					if (child == children.end() || child->first != value)
+					{
+						child = children.insert(child, { value, (std::uint32_t)nodes.size() });
+						std::uint32_t created = child->second;
+						nodes.emplace_back();
+						node = created;
+					}
+					else
+					{
+						node = child->second;
+					}
+				}
+
+				// A location ending with a separator covers whatever follows it
+				bool endsWithSeparator = line.back() == '\\' || line.back() == '/';
+				(prefix || endsWithSeparator ? nodes[node].PrefixRoute : nodes[node].LocationRoute) = route;
+				ruleCount++;
+			}
+
+			// Numbers the nodes breadth first, see the layout above
+			std::vector<std::uint32_t> order(1, 0);
+			order.reserve(nodes.size());
+			for (std::size_t i = 0; i < order.size(); i++)
+			{
+				for (const auto& child : nodes[order[i]].Children)
+					order.push_back(child.second);
+			}
+
+			std::uint32_t nodeCount = (std::uint32_t)nodes.size();
+			std::uint32_t edgeCount = nodeCount - 1;
+			std::string image;
+			image.reserve(GetImageSize(nodeCount, edgeCount));
+			Detail::AppendUInt32(image, Magic);
+			Detail::AppendUInt32(image, Version);
+			Detail::AppendUInt64(image, sourceWriteTime);
+			Detail::AppendUInt64(image, sourceSize);
+			Detail::AppendUInt32(image, nodeCount);
+			Detail::AppendUInt32(image, edgeCount);
+			Detail::AppendUInt32(image, ruleCount);
+			Detail::AppendUInt32(image, 0);
+
+			std::string edgeBytes;
+			edgeBytes.reserve(edgeCount);
+			for (std::uint32_t index : order)
+			{
+				const Node& node = nodes[index];
+				Detail::AppendUInt32(image, (std::uint32_t)edgeBytes.size());
+				image.push_back((char)(node.Children.size() & 0xFF));
+				image.push_back((char)(node.Children.size() >> 8));
+				image.push_back((char)node.LocationRoute);
+				image.push_back((char)node.PrefixRoute);
+
+				for (const auto& child : node.Children)
+					edgeBytes.push_back((char)child.first);
+			}
+
+			image.append(edgeBytes);
+			return image;
+		}
+
+	private:
+		static constexpr std::uint8_t RouteNone = 0;
+		static constexpr std::uint8_t RouteFiles = 1;
+		static constexpr std::uint8_t RouteExplorer = 2;
+
+		const char* _nodes = nullptr;
+		const char* _edgeBytes = nullptr;
+		std::uint32_t _edgeCount = 0;
+		std::uint32_t _ruleCount = 0;
+
+		// Target of the edge of the node for value, 0 when there is none or the node is
+		// damaged. Node n + 1 exists for every edge n.
+		std::uint32_t FindEdge(const char* entry, unsigned char value) const
+		{
+			std::uint32_t low = Load32(entry), high = low + Load16(entry + 4);
+			if (low > _edgeCount || high > _edgeCount)
+				return 0;
+
+			while (low < high)
+			{
+				std::uint32_t middle = low + (high - low) / 2;
+				unsigned char edge = (unsigned char)_edgeBytes[middle];
+				if (edge == value)
+					return middle + 1;
+				if (edge < value)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			return 0;
+		}
+
+		static bool IsRoute(char value)
+		{
+			return value == RouteFiles || value == RouteExplorer;
+		}
+
+		static char Normalize(char c)
+		{
+			return c == '/' ? '\\' : c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+		}
+
+		// Normalized UTF-8 bytes of the character at index, which it moves past
+		template <typename TChar>
+		static std::size_t EncodeNext(std::basic_string_view<TChar> path, std::size_t& index, char (&bytes)[4])
+		{
+			std::uint32_t c = (std::make_unsigned_t<TChar>)path[index++];
+			if constexpr (sizeof(TChar) == 1)
+			{
+				bytes[0] = Normalize((char)c);
+				return 1;
+			}
+			else
+			{
+				if constexpr (sizeof(TChar) == 2)
+				{
+					if (c >= 0xD800 && c < 0xDC00 && index < path.size() &&
+						(std::uint32_t)path[index] >= 0xDC00 && (std::uint32_t)path[index] < 0xE000)
+						c = 0x10000 + ((c - 0xD800) << 10) + ((std::uint32_t)path[index++] - 0xDC00);
+					else if (c >= 0xD800 && c < 0xE000)
+						c = 0xFFFD;
+				}
+
+				if (c < 0x80)
+				{
+					bytes[0] = Normalize((char)c);
+					return 1;
+				}
+				if (c < 0x800)
+				{
+					bytes[0] = (char)(0xC0 | (c >> 6));
+					bytes[1] = (char)(0x80 | (c & 0x3F));
+					return 2;
+				}
+				if (c < 0x10000)
+				{
+					bytes[0] = (char)(0xE0 | (c >> 12));
+					bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+					bytes[2] = (char)(0x80 | (c & 0x3F));
+					return 3;
+				}
+
+				bytes[0] = (char)(0xF0 | ((c >> 18) & 0x07));
+				bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+				bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+				bytes[3] = (char)(0x80 | (c & 0x3F));
+				return 4;
+			}
+		}
+
+		template <typename TChar>
+		static bool StartsWithShellClsid(std::basic_string_view<TChar> path)
+		{
+			constexpr std::string_view prefix = "shell:::{";
+			if (path.size() < prefix.size())
+				return false;
+
+			for (std::size_t i = 0; i < prefix.size(); i++)
+			{
+				TChar c = path[i];
+				if ((c >= 'A' && c <= 'Z' ? (TChar)(c - 'A' + 'a') : c) != (TChar)prefix[i])
+					return false;
+			}
+
+			return true;
+		}
+
+		static std::uint8_t ConsumeRoute(std::string_view& line)
+		{
+			std::size_t end = line.find_first_of(" \t");
+			std::string verb(line.substr(0, end));
+			for (char& c : verb)
+				c = Normalize(c);
+
+			line = end == std::string_view::npos ? std::string_view() : Trim(line.substr(end));
+			return verb == "explorer" ? RouteExplorer : verb == "files" ? RouteFiles : RouteNone;
+		}
+
+		static std::string_view Trim(std::string_view value)
+		{
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+				value.remove_prefix(1);
+			while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r'))
+				value.remove_suffix(1);
+
+			return value;
+		}
+
+		static std::size_t GetImageSize(std::uint32_t nodeCount, std::uint32_t edgeCount)
+		{
+			return HeaderSize + (std::size_t)nodeCount * NodeSize + edgeCount;
+		}
+
+		static std::uint32_t Load16(const char* data)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			return (std::uint32_t)bytes[0] | ((std::uint32_t)bytes[1] << 8);
+		}
+
+		static std::uint32_t Load32(const char* data)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			return (std::uint32_t)bytes[0] | ((std::uint32_t)bytes[1] << 8) |
+				((std::uint32_t)bytes[2] << 16) | ((std::uint32_t)bytes[3] << 24);
+		}
+	};
+
+	// Route of a location under the user's rules, or GetLaunchRoute when none matches
+	template <typename TChar>
+	LaunchRoute GetLaunchRoute(std::basic_string_view<TChar> path, const LaunchRuleSet* rules)
+	{
+		if (rules)
+		{
+			if (auto route = rules->Match(path))
+				return *route;
+		}
+
+		return GetLaunchRoute(path);
+	}
+}
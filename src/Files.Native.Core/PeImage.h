@@ -0,0 +1,258 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Sizes, sections and imports of a PE image read from its file, to track what the
+//  dialogs cost the processes they are loaded into.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Files::Native
+{
+	namespace Detail
+	{
+		template <typename T>
+		bool ReadPeField(std::string_view file, std::size_t offset, T& value)
+		{
+			if (offset > file.size() || file.size() - offset < sizeof(T))
+				return false;
+
+			value = 0;
+			for (std::size_t i = 0; i < sizeof(T); i++)
+				value |= (T)((T)(unsigned char)file[offset + i] << (8 * i));
+
+			return true;
+		}
+	}
+
+	struct PeSection
+	{
+		std::string Name;
+		std::uint32_t VirtualAddress = 0;
+		std::uint32_t VirtualSize = 0;
+		std::uint32_t RawOffset = 0;
+		std::uint32_t RawSize = 0;
+	};
+
+	struct PeImport
+	{
+		std::string Library;
+		std::size_t FunctionCount = 0;
+		// Listed in the delay import table, loaded on first call rather than with the image
+		bool Delayed = false;
+	};
+
+	struct PeImage
+	{
+		static constexpr std::uint16_t Pe32Magic = 0x10B;
+		static constexpr std::uint16_t Pe32PlusMagic = 0x20B;
+
+		// Descriptors and thunks past these are taken for a damaged file
+		static constexpr std::size_t MaxImportedLibraries = 4096;
+		static constexpr std::size_t MaxImportedFunctions = 65536;
+
+		std::uint16_t Machine = 0;
+		bool Is64Bit = false;
+		std::uint64_t ImageBase = 0;
+		// Address space the loader reserves for the image
+		std::uint32_t SizeOfImage = 0;
+		std::uint64_t FileSize = 0;
+		std::vector<PeSection> Sections;
+		std::vector<PeImport> Imports;
+
+		std::size_t GetLibraryCount(bool delayed) const
+		{
+			std::size_t count = 0;
+			for (const PeImport& import : Imports)
+				count += import.Delayed == delayed;
+
+			return count;
+		}
+
+		std::size_t GetFunctionCount(bool delayed) const
+		{
+			std::size_t count = 0;
+			for (const PeImport& import : Imports)
+				count += import.Delayed == delayed ? import.FunctionCount : 0;
+
+			return count;
+		}
+
+		static bool Parse(std::string_view file, PeImage& image)
+		{
+			image = PeImage();
+			image.FileSize = file.size();
+
+			std::uint16_t dosMagic, optionalSize, sectionCount, magic;
+			std::uint32_t peOffset, signature;
+			if (!Detail::ReadPeField(file, 0, dosMagic) || dosMagic != 0x5A4D ||
+				!Detail::ReadPeField(file, 0x3C, peOffset) ||
+				!Detail::ReadPeField(file, peOffset, signature) || signature != 0x00004550 ||
+				!Detail::ReadPeField(file, (std::size_t)peOffset + 4, image.Machine) ||
+				!Detail::ReadPeField(file, (std::size_t)peOffset + 6, sectionCount) ||
+				!Detail::ReadPeField(file, (std::size_t)peOffset + 20, optionalSize))
+				return false;
+
+			std::size_t optional = (std::size_t)peOffset + 24;
+			if (!Detail::ReadPeField(file, optional, magic) || (magic != Pe32Magic && magic != Pe32PlusMagic))
+				return false;
+
+			image.Is64Bit = magic == Pe32PlusMagic;
+			std::uint32_t directoryCount;
+			std::size_t directories = optional + (image.Is64Bit ? 112 : 96);
+			if (!Detail::ReadPeField(file, optional + 56, image.SizeOfImage) ||
+				!Detail::ReadPeField(file, optional + (image.Is64Bit ? 108 : 92), directoryCount))
+				return false;
+
+			if (image.Is64Bit)
+			{
+				if (!Detail::ReadPeField(file, optional + 24, image.ImageBase))
+					return false;
+			}
+			else
+			{
+				std::uint32_t imageBase;
+				if (!Detail::ReadPeField(file, optional + 28, imageBase))
+					return false;
+
+				image.ImageBase = imageBase;
+			}
+
+			std::size_t sections = optional + optionalSize;
+			for (std::uint16_t i = 0; i < sectionCount; i++)
+			{
+				std::size_t header = sections + (std::size_t)i * 40;
+				if (header > file.size() || file.size() - header < 40)
+					return false;
+
+				PeSection& section = image.Sections.emplace_back();
+				std::string_view name = file.substr(header, 8);
+				section.Name = std::string(name.substr(0, name.find('\0')));
+				Detail::ReadPeField(file, header + 8, section.VirtualSize);
+				Detail::ReadPeField(file, header + 12, section.VirtualAddress);
+				Detail::ReadPeField(file, header + 16, section.RawSize);
+				Detail::ReadPeField(file, header + 20, section.RawOffset);
+			}
+
+			std::uint32_t importRva = 0, delayImportRva = 0;
+			if (directoryCount > 1)
+				Detail::ReadPeField(file, directories + 1 * 8, importRva);
+			if (directoryCount > 13)
+				Detail::ReadPeField(file, directories + 13 * 8, delayImportRva);
+
+			return (!importRva || image.ReadImports(file, importRva)) &&
+				(!delayImportRva || image.ReadDelayImports(file, delayImportRva));
+		}
+
+	private:
+		bool ToOffset(std::uint64_t rva, std::size_t& offset) const
+		{
+			for (const PeSection& section : Sections)
+			{
+				// Past the raw data, a section is zero filled and holds nothing to read
+				if (rva >= section.VirtualAddress && rva - section.VirtualAddress < section.RawSize)
+				{
+					offset = (std::size_t)(section.RawOffset + (rva - section.VirtualAddress));
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool ReadName(std::string_view file, std::uint64_t rva, std::string& name) const
+		{
+			std::size_t offset;
+			if (!ToOffset(rva, offset) || offset >= file.size())
+				return false;
+
+			std::size_t end = file.find('\0', offset);
+			if (end == std::string_view::npos || end - offset > 260)
+				return false;
+
+			name = std::string(file.substr(offset, end - offset));
+			return true;
+		}
+
+		// Entries of a name table up to the terminating zero
+		bool CountThunks(std::string_view file, std::uint64_t rva, std::size_t& count) const
+		{
+			std::size_t offset;
+			if (!ToOffset(rva, offset))
+				return false;
+
+			std::size_t size = Is64Bit ? 8 : 4;
+			for (count = 0; count < MaxImportedFunctions; count++, offset += size)
+			{
+				std::uint64_t thunk = 0;
+				std::uint32_t thunk32 = 0;
+				bool read = Is64Bit ? Detail::ReadPeField(file, offset, thunk) : Detail::ReadPeField(file, offset, thunk32);
+				if (!read)
+					return false;
+				if ((Is64Bit ? thunk : thunk32) == 0)
+					return true;
+			}
+
+			return false;
+		}
+
+		bool ReadImports(std::string_view file, std::uint32_t rva)
+		{
+			std::size_t offset;
+			if (!ToOffset(rva, offset))
+				return false;
+
+			for (std::size_t i = 0; i < MaxImportedLibraries; i++, offset += 20)
+			{
+				std::uint32_t names, nameRva, addresses;
+				if (!Detail::ReadPeField(file, offset, names) ||
+					!Detail::ReadPeField(file, offset + 12, nameRva) ||
+					!Detail::ReadPeField(file, offset + 16, addresses))
+					return false;
+				if (!nameRva)
+					return true;
+
+				PeImport& import = Imports.emplace_back();
+				if (!ReadName(file, nameRva, import.Library) ||
+					!CountThunks(file, names ? names : addresses, import.FunctionCount))
+					return false;
+			}
+
+			return false;
+		}
+
+		bool ReadDelayImports(std::string_view file, std::uint32_t rva)
+		{
+			std::size_t offset;
+			if (!ToOffset(rva, offset))
+				return false;
+
+			for (std::size_t i = 0; i < MaxImportedLibraries; i++, offset += 32)
+			{
+				std::uint32_t attributes, nameRva, names;
+				if (!Detail::ReadPeField(file, offset, attributes) ||
+					!Detail::ReadPeField(file, offset + 4, nameRva) ||
+					!Detail::ReadPeField(file, offset + 16, names))
+					return false;
+				if (!nameRva)
+					return true;
+
+				// Linkers before Visual C++ 7 wrote addresses instead of RVAs
+				std::uint64_t base = attributes & 1 ? 0 : ImageBase;
+				PeImport& import = Imports.emplace_back();
+				import.Delayed = true;
+				if (!ReadName(file, nameRva - base, import.Library) ||
+					!CountThunks(file, names - base, import.FunctionCount))
+					return false;
+			}
+
+			return false;
+		}
+	};
+}
@@ -0,0 +1,128 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Checks run on the target the user picked in the save dialog before it is
+//  handed to the host: existence, writability and free space, in one pass.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "DialogOptions.h"
+
+namespace Files::Native
+{
+	enum class SavePreflightStatus
+	{
+		Ready,
+		// The folder of the target does not exist
+		ParentMissing,
+		// The target is an existing folder
+		IsFolder,
+		// The target is read-only and the host set FOS_NOREADONLYRETURN
+		ReadOnly,
+		// The target can't be created or opened for writing
+		AccessDenied,
+		// The target does not exist and its volume is full
+		DiskFull,
+	};
+
+	struct SaveTargetFacts
+	{
+		bool Exists = false;
+		bool IsDirectory = false;
+		bool ReadOnly = false;
+	};
+
+	struct SavePreflightOptions
+	{
+		// Create or open the target to find out whether the host will be able to
+		bool TestCreate = true;
+		// Leave the created target behind for the host
+		bool KeepPlaceholder = false;
+		bool RejectReadOnly = false;
+
+		static SavePreflightOptions FromDialogOptions(std::uint32_t fos)
+		{
+			SavePreflightOptions options;
+			options.TestCreate = !(fos & DialogOptions::NoTestFileCreate);
+			// The host expects the item to be there once the user agreed to create it
+			options.KeepPlaceholder = (fos & DialogOptions::CreatePrompt) != 0;
+			options.RejectReadOnly = (fos & DialogOptions::NoReadOnlyReturn) != 0;
+			return options;
+		}
+	};
+
+	struct SavePreflightReport
+	{
+		SavePreflightStatus Status = SavePreflightStatus::Ready;
+		bool Existed = false;
+		// Free bytes on the volume of the target, if its folder exists
+		std::optional<std::uint64_t> FreeBytes;
+		// Platform error of the test creation, if any
+		std::uint32_t Error = 0;
+	};
+
+	class SavePreflight
+	{
+	public:
+		// Runs the checks through storage, which provides:
+		//  SaveTargetFacts Stat(const std::wstring& path)
+		//  std::optional<std::uint64_t> FreeBytes(const std::wstring& folder), nullopt when missing
+		//  std::uint32_t OpenForWrite(const std::wstring& path), 0 or the error
+		//  std::uint32_t Create(const std::wstring& path, bool keep), 0 or the error
+		// Each is called at most once; storage that is slow is slow once.
+		template <typename TStorage>
+		static SavePreflightReport Run(TStorage& storage, const std::wstring& path, const SavePreflightOptions& options)
+		{
+			SavePreflightReport report;
+
+			SaveTargetFacts facts = storage.Stat(path);
+			report.Existed = facts.Exists;
+			if (facts.IsDirectory)
+				return Fail(report, SavePreflightStatus::IsFolder);
+			if (facts.ReadOnly && options.RejectReadOnly)
+				return Fail(report, SavePreflightStatus::ReadOnly);
+
+			if (!facts.Exists)
+			{
+				report.FreeBytes = storage.FreeBytes(GetParent(path));
+				if (!report.FreeBytes)
+					return Fail(report, SavePreflightStatus::ParentMissing);
+				if (*report.FreeBytes == 0)
+					return Fail(report, SavePreflightStatus::DiskFull);
+			}
+
+			if (facts.Exists && options.TestCreate)
+				report.Error = storage.OpenForWrite(path);
+			else if (!facts.Exists && (options.TestCreate || options.KeepPlaceholder))
+				report.Error = storage.Create(path, options.KeepPlaceholder);
+
+			if (report.Error)
+				report.Status = SavePreflightStatus::AccessDenied;
+
+			return report;
+		}
+
+		// Folder of the path, keeping the separator of a drive root
+		static std::wstring GetParent(const std::wstring& path)
+		{
+			std::size_t separator = path.find_last_of(L"\\/");
+			if (separator == std::wstring::npos)
+				return std::wstring();
+			if (separator == 2 && path[1] == L':')
+				return path.substr(0, 3);
+
+			return path.substr(0, separator);
+		}
+
+	private:
+		static SavePreflightReport& Fail(SavePreflightReport& report, SavePreflightStatus status)
+		{
+			report.Status = status;
+			return report;
+		}
+	};
+}
@@ -0,0 +1,103 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Per-Show() property store of the save dialog's result, so that hosts
+//  round-tripping metadata get the same store back on every call.
+
+#pragma once
+
+#include <utility>
+
+namespace Files::Native
+{
+	// Holds the defaults the host passes with SetProperties, restricted to the list of
+	// SetCollectedProperties, in a store that is created once per Show() and handed out
+	// by every GetProperties call. The store starts with what the picked item already has,
+	// under the defaults. What the host sets there stays until the next Show().
+	//
+	// TStores provides the property stores of the platform, see Windows/SavePropertyCache.h:
+	//  Store, KeyList: shared handles, false when empty
+	//  Status: what the calls end with, success when value-initialized
+	//  Status Create(Store& store)
+	//  Status Copy(const Store& source, const Store& target, const KeyList& keys): every
+	//   value of the source, or only those of the keys when there are some
+	//  static bool Failed(Status status)
+	template <typename TStores>
+	class BasicSavePropertyCache
+	{
+	public:
+		using Store = typename TStores::Store;
+		using KeyList = typename TStores::KeyList;
+		using Status = typename TStores::Status;
+
+		explicit BasicSavePropertyCache(TStores stores = TStores()) : _stores(std::move(stores))
+		{
+		}
+
+		// Copied, the host may keep changing its own store
+		Status SetDefaults(const Store& store)
+		{
+			Store defaults;
+			Status status = _stores.Create(defaults);
+			if (!TStores::Failed(status) && store)
+				status = _stores.Copy(store, defaults, KeyList());
+			if (TStores::Failed(status))
+				return status;
+
+			_defaults = std::move(defaults);
+			_store = Store();
+			return status;
+		}
+
+		void SetCollected(KeyList keys)
+		{
+			_collected = std::move(keys);
+			_store = Store();
+		}
+
+		// Starts over for the next Show()
+		void Reset()
+		{
+			_store = Store();
+		}
+
+		// The store of this Show(), the same one on every call
+		Status Get(Store& store)
+		{
+			return Get(store, []() { return Store(); });
+		}
+
+		// loadItem() -> Store gives the properties of the picked item, an empty store for
+		// an item that doesn't exist yet. It is called when the store is created, not on
+		// every call.
+		template <typename TLoadItem>
+		Status Get(Store& store, TLoadItem loadItem)
+		{
+			Status status = Status();
+			if (!_store)
+			{
+				Store created;
+				status = _stores.Create(created);
+				Store item = TStores::Failed(status) ? Store() : loadItem();
+				if (item)
+					status = _stores.Copy(item, created, _collected);
+				if (!TStores::Failed(status) && _defaults)
+					status = _stores.Copy(_defaults, created, _collected);
+				if (TStores::Failed(status))
+					return status;
+
+				_store = std::move(created);
+			}
+
+			store = _store;
+			return status;
+		}
+
+	private:
+		TStores _stores;
+		Store _defaults;
+		KeyList _collected;
+		Store _store;
+	};
+}
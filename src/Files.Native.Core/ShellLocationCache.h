@@ -0,0 +1,260 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Item ID lists of shell locations that don't move, e.g. CLSID folders, kept
+//  in a file the launcher maps instead of asking the shell to parse them again.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "FolderSnapshot.h"
+
+namespace Files::Native
+{
+	struct ShellLocationCacheEntry
+	{
+		// See ShellLocationCache::GetKey
+		std::string Key;
+		// ITEMIDLIST bytes, terminator included
+		std::string IdList;
+	};
+
+	// Only virtual locations are cached: their item IDs are the same for every parse until
+	// Windows is updated, unlike those of a file system folder, which carry its times and
+	// move with it. A cache is only valid for the build and the user it was written for.
+	// Layout: magic, version, OS build, OS revision, user, count, then per entry its key
+	// and its item ID list. Little-endian, strings are prefixed with their byte length.
+	struct ShellLocationCache
+	{
+		static constexpr std::uint32_t Magic = 0x434C5346; // "FSLC"
+		static constexpr std::uint32_t Version = 1;
+
+		// The launcher only ever sees a handful of these, the oldest make room
+		static constexpr std::size_t MaxEntries = 64;
+		static constexpr std::size_t MaxKeySize = 1024;
+		static constexpr std::size_t MaxIdListSize = 4096;
+
+		std::uint32_t OsBuild = 0;
+		std::uint32_t OsRevision = 0;
+		// SID string of the user
+		std::string User;
+		std::vector<ShellLocationCacheEntry> Entries;
+
+		// Cache key of a location, empty for one that isn't cached. CLSID paths, with or
+		// without "shell:", share a key. Works on UTF-8 and UTF-16 locations, every cached
+		// location is ASCII.
+		template <typename TChar>
+		static std::string GetKey(std::basic_string_view<TChar> location)
+		{
+			// Anything but ASCII becomes a NUL, which no cached location has
+			auto toLower = [](TChar c)
+			{
+				auto value = (std::make_unsigned_t<TChar>)c;
+				return value > 0x7F ? '\0' : (char)(value >= 'A' && value <= 'Z' ? value - 'A' + 'a' : value);
+			};
+			auto startsWith = [&](std::basic_string_view<TChar> value, std::string_view prefix)
+			{
+				if (value.size() < prefix.size())
+					return false;
+
+				for (std::size_t i = 0; i < prefix.size(); i++)
+				{
+					if (toLower(value[i]) != prefix[i])
+						return false;
+				}
+
+				return true;
+			};
+
+			static constexpr std::string_view virtualFolders[] =
+			{
+				"shell:appsfolder", "shell:connectionsfolder", "shell:controlpanelfolder",
+				"shell:mycomputerfolder", "shell:networkplacesfolder", "shell:printersfolder",
+				"shell:recyclebinfolder",
+			};
+
+			for (std::string_view folder : virtualFolders)
+			{
+				if (location.size() == folder.size() && startsWith(location, folder))
+					return std::string(folder);
+			}
+
+			if (startsWith(location, "shell:::{"))
+				location.remove_prefix(6);
+
+			// "::{GUID}" segments separated by backslashes, e.g. a Control Panel page
+			constexpr std::size_t segmentSize = sizeof("::{00000000-0000-0000-0000-000000000000}") - 1;
+			if (location.empty() || location.size() > MaxKeySize || (location.size() + 1) % (segmentSize + 1) != 0)
+				return std::string();
+
+			std::string key;
+			key.reserve(location.size());
+			for (std::size_t i = 0; i < location.size(); i++)
+			{
+				std::size_t position = i % (segmentSize + 1);
+				char c = toLower(location[i]);
+				bool valid =
+					position == segmentSize ? c == '\\' :
+					position < 3 ? c == "::{"[position] :
+					position == segmentSize - 1 ? c == '}' :
+					position == 11 || position == 16 || position == 21 || position == 26 ? c == '-' :
+					(c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+				if (!valid)
+					return std::string();
+
+				key.push_back(c);
+			}
+
+			return key;
+		}
+
+		// Whether value is a whole ITEMIDLIST: item IDs prefixed with their 16-bit size,
+		// ending with an empty one
+		static bool IsValidIdList(std::string_view value)
+		{
+			std::size_t offset = 0;
+			while (value.size() - offset >= 2)
+			{
+				std::size_t size = (unsigned char)value[offset] | ((std::size_t)(unsigned char)value[offset + 1] << 8);
+				if (size == 0)
+					return offset + 2 == value.size();
+				if (size < 2 || size > value.size() - offset)
+					return false;
+
+				offset += size;
+			}
+
+			return false;
+		}
+
+		// Adds or replaces the item ID list of key
+		bool Add(std::string_view key, std::string_view idList)
+		{
+			if (key.empty() || key.size() > MaxKeySize || idList.size() > MaxIdListSize || !IsValidIdList(idList))
+				return false;
+
+			for (ShellLocationCacheEntry& entry : Entries)
+			{
+				if (entry.Key == key)
+				{
+					entry.IdList = std::string(idList);
+					return true;
+				}
+			}
+
+			if (Entries.size() >= MaxEntries)
+				Entries.erase(Entries.begin(), Entries.begin() + (Entries.size() - MaxEntries + 1));
+
+			Entries.push_back({ std::string(key), std::string(idList) });
+			return true;
+		}
+
+		bool IsFor(std::uint32_t osBuild, std::uint32_t osRevision, std::string_view user) const
+		{
+			return OsBuild == osBuild && OsRevision == osRevision && User == user;
+		}
+
+		std::string Encode() const
+		{
+			std::string output;
+			output.reserve(32 + User.size() + Entries.size() * 64);
+			Detail::AppendUInt32(output, Magic);
+			Detail::AppendUInt32(output, Version);
+			Detail::AppendUInt32(output, OsBuild);
+			Detail::AppendUInt32(output, OsRevision);
+			Detail::AppendUInt32(output, (std::uint32_t)User.size());
+			output.append(User);
+			Detail::AppendUInt32(output, (std::uint32_t)Entries.size());
+			for (const ShellLocationCacheEntry& entry : Entries)
+			{
+				Detail::AppendUInt32(output, (std::uint32_t)entry.Key.size());
+				output.append(entry.Key);
+				Detail::AppendUInt32(output, (std::uint32_t)entry.IdList.size());
+				output.append(entry.IdList);
+			}
+
+			return output;
+		}
+
+		static bool Decode(std::string_view input, ShellLocationCache& cache)
+		{
+			std::size_t offset = 0;
+			std::uint32_t count;
+			if (!DecodeHeader(input, offset, cache.OsBuild, cache.OsRevision, cache.User, count))
+				return false;
+
+			cache.Entries.resize(count);
+			for (ShellLocationCacheEntry& entry : cache.Entries)
+			{
+				std::string_view key, idList;
+				if (!DecodeEntry(input, offset, key, idList))
+					return false;
+
+				entry.Key = std::string(key);
+				entry.IdList = std::string(idList);
+			}
+
+			return offset == input.size();
+		}
+
+		// Item ID list of key in an encoded cache, pointing into input so that it can be
+		// read straight from a mapped file. Empty when the cache is for another build or
+		// user, is damaged or lacks the key.
+		static std::string_view Find(std::string_view input, std::uint32_t osBuild, std::uint32_t osRevision,
+			std::string_view user, std::string_view key)
+		{
+			std::size_t offset = 0;
+			std::uint32_t cacheOsBuild, cacheOsRevision, count;
+			std::string_view cacheUser;
+			if (key.empty() ||
+				!DecodeHeader(input, offset, cacheOsBuild, cacheOsRevision, cacheUser, count) ||
+				cacheOsBuild != osBuild || cacheOsRevision != osRevision || cacheUser != user)
+				return std::string_view();
+
+			for (std::uint32_t i = 0; i < count; i++)
+			{
+				std::string_view entryKey, idList;
+				if (!DecodeEntry(input, offset, entryKey, idList))
+					break;
+				if (entryKey == key)
+					return idList;
+			}
+
+			return std::string_view();
+		}
+
+	private:
+		template <typename TUser>
+		static bool DecodeHeader(std::string_view input, std::size_t& offset, std::uint32_t& osBuild, std::uint32_t& osRevision,
+			TUser& user, std::uint32_t& count)
+		{
+			std::uint32_t magic, version;
+			std::string_view userView;
+			if (!Detail::ReadUInt32(input, offset, magic) || magic != Magic ||
+				!Detail::ReadUInt32(input, offset, version) || version != Version ||
+				!Detail::ReadUInt32(input, offset, osBuild) ||
+				!Detail::ReadUInt32(input, offset, osRevision) ||
+				!Detail::ReadStringView(input, offset, userView) ||
+				!Detail::ReadUInt32(input, offset, count))
+				return false;
+
+			user = TUser(userView);
+
+			// Every entry takes at least its two sizes and an item ID list terminator
+			return count <= MaxEntries && count <= (input.size() - offset) / 10;
+		}
+
+		static bool DecodeEntry(std::string_view input, std::size_t& offset, std::string_view& key, std::string_view& idList)
+		{
+			return
+				Detail::ReadStringView(input, offset, key) && !key.empty() && key.size() <= MaxKeySize &&
+				Detail::ReadStringView(input, offset, idList) && idList.size() <= MaxIdListSize && IsValidIdList(idList);
+		}
+	};
+}
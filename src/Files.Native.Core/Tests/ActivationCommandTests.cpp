@@ -0,0 +1,81 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <string>
+#include "ActivationCommand.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(ActivationCommand, QuotesExecutableAndValues)
+{
+	ActivationCommand command(L"C:\\Program Files\\Files.exe");
+	command.AppendQuoted(L"-directory", L"C:\\Users\\Me").AppendQuoted(L"-outputpath", L"C:\\Temp\\out.txt").Append(L"-dialogchannel", L"12_3");
+	command.Append(L"-itemfilter");
+
+	CHECK(command.GetCommandLine() == L"\"C:\\Program Files\\Files.exe\" -directory \"C:\\Users\\Me\" -outputpath \"C:\\Temp\\out.txt\" -dialogchannel 12_3 -itemfilter");
+}
+
+TEST(ActivationCommand, KeepsLongPaths)
+{
+	// Past the 1024 characters the command lines used to be cut at
+	std::wstring path = L"\\\\?\\C:";
+	while (path.size() < 32000)
+		path += L"\\folder";
+
+	ActivationCommand command(L"Files.exe");
+	command.AppendQuoted(L"-select", path);
+
+	CHECK(command.GetCommandLine().size() == path.size() + sizeof("\"Files.exe\" -select \"\"") - 1);
+	CHECK(command.GetCommandLine().ends_with(L"\\folder\""));
+}
+
+TEST(ActivationCommand, PercentEncodesUtf8)
+{
+	CHECK(ActivationCommand::ToUri(L"") == L"files-dev:?cmd=");
+	CHECK(ActivationCommand::ToUri(L"\"a b\"") == L"files-dev:?cmd=%22%61%20%62%22");
+	// Two, three and four byte sequences
+	CHECK(ActivationCommand::ToUri(L"\u00E9\u6587") == L"files-dev:?cmd=%C3%A9%E6%96%87");
+	CHECK(ActivationCommand::ToUri(L"\U0001F600") == L"files-dev:?cmd=%F0%9F%98%80");
+
+	ActivationCommand command(L"F");
+	CHECK(command.ToUri() == L"files-dev:?cmd=%22%46%22");
+}
+
+TEST(ActivationCommand, ReplacesUnpairedSurrogates)
+{
+	// Only wide strings of UTF-16 can hold them
+	if constexpr (sizeof(wchar_t) == 2)
+	{
+		std::wstring high(1, (wchar_t)0xD83D), low(1, (wchar_t)0xDE00);
+		CHECK(ActivationCommand::ToUri(high) == L"files-dev:?cmd=%EF%BF%BD");
+		CHECK(ActivationCommand::ToUri(low + L"a") == L"files-dev:?cmd=%EF%BF%BD%61");
+		CHECK(ActivationCommand::ToUri(high + L"a") == L"files-dev:?cmd=%EF%BF%BD%61");
+	}
+
+	std::u16string units = u"a";
+	units.push_back(0xDC00);
+	units.push_back(0xD800);
+	CHECK(ToUtf8(std::u16string_view(units)) == "a\xEF\xBF\xBD\xEF\xBF\xBD");
+}
+
+TEST(ActivationCommand, ConvertsToUtf8)
+{
+	CHECK(ToUtf8(std::wstring_view(L"C:\\\u00DCber\\\u65E5\u672C\\\U0001F4C1")) == "C:\\\xC3\x9C" "ber\\\xE6\x97\xA5\xE6\x9C\xAC\\\xF0\x9F\x93\x81");
+	CHECK(ToUtf8(std::u16string_view(u"\U0001F4C1")) == "\xF0\x9F\x93\x81");
+	CHECK(ToUtf8(std::u32string_view(std::u32string(1, (char32_t)0x110000))) == "\xEF\xBF\xBD");
+	CHECK(ToUtf8(std::wstring_view()).empty());
+}
+
+TEST(ActivationCommand, ParsesResultLines)
+{
+	auto lines = ParseResultLines("C:\\a.txt\r\n\r\nC:\\b c.txt\nC:\\\xE6\x96\x87.txt");
+	REQUIRE(lines.size() == 3);
+	CHECK(lines[0] == "C:\\a.txt");
+	CHECK(lines[1] == "C:\\b c.txt");
+	CHECK(lines[2] == "C:\\\xE6\x96\x87.txt");
+
+	CHECK(ParseResultLines("").empty());
+	CHECK(ParseResultLines("\r\n\n").empty());
+	CHECK(ParseResultLines("x\r").size() == 1 && ParseResultLines("x\r")[0] == "x");
+}
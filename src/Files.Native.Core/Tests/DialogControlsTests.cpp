@@ -0,0 +1,257 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <random>
+#include <string>
+#include "DialogControls.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	// What Word adds to its Save As dialog, give or take
+	DialogControls GetControls()
+	{
+		DialogControls controls;
+		controls.Add(1, DialogControlKind::VisualGroup, "Options");
+		controls.Add(2, DialogControlKind::CheckButton, "Save Thumbnail", true);
+		controls.Add(3, DialogControlKind::ComboBox, "");
+		controls.EndGroup();
+		controls.Add(4, DialogControlKind::EditBox, "Tags");
+		controls.Add(5, DialogControlKind::PushButton, "Tools");
+		controls.AddItem(3, 10, "Web Options");
+		controls.AddItem(3, 11, "General Options");
+		controls.SelectItem(3, 11);
+		controls.MakeProminent(5);
+		return controls;
+	}
+}
+
+TEST(DialogControls, AddsControls)
+{
+	DialogControls controls = GetControls();
+	REQUIRE(controls.GetControls().size() == 5);
+
+	const DialogControl* check = controls.Find(2);
+	REQUIRE(check);
+	CHECK(check->Kind == DialogControlKind::CheckButton);
+	CHECK(check->Checked);
+	CHECK(check->Group == 1);
+	CHECK(controls.GetString(check->Label) == "Save Thumbnail");
+	CHECK(controls.Find(4)->Group == 0);
+	CHECK(controls.Find(5)->Prominent);
+	CHECK(!controls.Find(6));
+
+	// Ids are unique, groups don't nest, kinds are known
+	CHECK(!controls.Add(2, DialogControlKind::PushButton, "Again"));
+	CHECK(controls.Add(7, DialogControlKind::VisualGroup, "Outer"));
+	CHECK(!controls.Add(8, DialogControlKind::VisualGroup, "Inner"));
+	CHECK(!controls.Add(9, DialogControlKind::Count, ""));
+}
+
+TEST(DialogControls, ChangesControls)
+{
+	DialogControls controls = GetControls();
+	std::uint32_t state;
+	REQUIRE(controls.GetState(2, state));
+	CHECK(state == (DialogControls::Enabled | DialogControls::Visible));
+	CHECK(controls.SetState(2, DialogControls::Visible));
+	CHECK(controls.GetState(2, state) && state == DialogControls::Visible);
+	CHECK(!controls.GetState(99, state));
+
+	std::string_view text;
+	CHECK(controls.GetText(4, text) && text == "Tags");
+	CHECK(controls.SetText(4, "Draft"));
+	CHECK(controls.GetText(4, text) && text == "Draft");
+	CHECK(!controls.SetText(5, "Not an edit box"));
+
+	bool checked;
+	CHECK(controls.SetChecked(2, false));
+	CHECK(controls.GetChecked(2, checked) && !checked);
+	CHECK(!controls.SetChecked(3, true));
+
+	CHECK(controls.SetLabel(5, "More Tools"));
+	CHECK(controls.GetString(controls.Find(5)->Label) == "More Tools");
+	CHECK(!controls.MakeProminent(4));
+	CHECK(controls.MakeProminent(2));
+	CHECK(!controls.Find(5)->Prominent);
+}
+
+TEST(DialogControls, TracksItems)
+{
+	DialogControls controls = GetControls();
+	std::uint32_t item;
+	CHECK(controls.GetSelectedItem(3, item) && item == 11);
+	CHECK(!controls.AddItem(3, 10, "Twice"));
+	CHECK(!controls.AddItem(5, 1, "Buttons have none"));
+
+	CHECK(controls.SetItemLabel(3, 10, "Web"));
+	CHECK(controls.SetItemState(3, 10, 0));
+	std::uint32_t state;
+	CHECK(controls.GetItemState(3, 10, state) && state == 0);
+
+	CHECK(controls.RemoveItem(3, 11));
+	CHECK(!controls.GetSelectedItem(3, item));
+	CHECK(!controls.RemoveItem(3, 11));
+	CHECK(controls.GetItems().size() == 1);
+
+	CHECK(controls.RemoveAllItems(3));
+	CHECK(controls.GetItems().empty());
+	CHECK(!controls.SelectItem(3, 10));
+
+	// Menus pick an item without keeping it
+	controls.Add(20, DialogControlKind::Menu, "Menu");
+	controls.AddItem(20, 1, "One");
+	CHECK(controls.SelectItem(20, 1));
+	CHECK(!controls.GetSelectedItem(20, item));
+}
+
+TEST(DialogControls, CompactsStrings)
+{
+	DialogControls controls;
+	controls.Add(1, DialogControlKind::EditBox, "");
+	controls.Add(2, DialogControlKind::PushButton, "Kept");
+	for (int i = 0; i < 2000; i++)
+		REQUIRE(controls.SetText(1, std::string(100, (char)('a' + i % 26))));
+
+	CHECK(controls.GetGarbageSize() < 8192);
+	CHECK(controls.GetString(controls.Find(2)->Label) == "Kept");
+	std::string_view text;
+	CHECK(controls.GetText(1, text) && text == std::string(100, (char)('a' + 1999 % 26)));
+}
+
+TEST(DialogControls, EnforcesLimits)
+{
+	DialogControls controls;
+	CHECK(!controls.Add(1, DialogControlKind::PushButton, std::string(DialogControls::MaxTextSize + 1, 'x')));
+	for (std::uint32_t id = 0; id < DialogControls::MaxControls; id++)
+		REQUIRE(controls.Add(id, DialogControlKind::Text, std::string(100, 'x')));
+	CHECK(!controls.Add(5000, DialogControlKind::PushButton, ""));
+
+	// Live strings are capped, replaced ones don't count
+	std::string large(DialogControls::MaxTextSize, 'y');
+	std::uint32_t id = 0;
+	while (controls.SetLabel(id, large))
+		id++;
+	CHECK(id > 0 && id < DialogControls::MaxControls);
+	CHECK(controls.SetLabel(0, large));
+	CHECK(controls.SetLabel(id, ""));
+}
+
+TEST(DialogControls, RoundTripsSnapshots)
+{
+	DialogControls controls = GetControls();
+	controls.SetText(4, "Draft");
+
+	std::string snapshot = controls.Encode();
+	DialogControls decoded;
+	REQUIRE(DialogControls::Decode(snapshot, decoded));
+	REQUIRE(decoded.GetControls().size() == 5);
+	REQUIRE(decoded.GetItems().size() == 2);
+	// The replaced text isn't sent
+	CHECK(decoded.GetGarbageSize() == 0);
+	CHECK(snapshot.size() == 12 + 5 * DialogControls::ControlRecordSize + 2 * DialogControls::ItemRecordSize + 57);
+
+	std::string_view text;
+	std::uint32_t item;
+	bool checked;
+	CHECK(decoded.GetText(4, text) && text == "Draft");
+	CHECK(decoded.GetSelectedItem(3, item) && item == 11);
+	CHECK(decoded.GetChecked(2, checked) && checked);
+	CHECK(decoded.Find(2)->Group == 1);
+	CHECK(decoded.Find(5)->Prominent);
+	CHECK(decoded.GetString(decoded.GetItems()[1].Label) == "General Options");
+	CHECK(decoded.Encode() == snapshot);
+
+	// Looked up like the original
+	CHECK(decoded.SetLabel(5, "Tools"));
+	CHECK(decoded.AddItem(3, 12, "Compress Pictures"));
+
+	DialogControls empty;
+	REQUIRE(DialogControls::Decode(empty.Encode(), decoded));
+	CHECK(decoded.IsEmpty());
+}
+
+TEST(DialogControls, RejectsDamagedSnapshots)
+{
+	std::string snapshot = GetControls().Encode();
+	DialogControls decoded;
+	for (std::size_t size = 0; size < snapshot.size(); size++)
+		CHECK(!DialogControls::Decode(snapshot.substr(0, size), decoded));
+
+	// Duplicate ids
+	std::string duplicate = snapshot;
+	duplicate[12 + DialogControls::ControlRecordSize] = 1;
+	CHECK(!DialogControls::Decode(duplicate, decoded));
+
+	// A group after what it holds
+	std::string group = snapshot;
+	group[12 + 8] = 2;
+	CHECK(!DialogControls::Decode(group, decoded));
+
+	std::mt19937 random(1);
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string damaged = snapshot;
+		damaged[random() % damaged.size()] ^= (char)(1 << (random() % 8));
+		if (!DialogControls::Decode(damaged, decoded))
+			continue;
+
+		for (const DialogControl& control : decoded.GetControls())
+			CHECK(decoded.GetString(control.Label).size() == control.Label.Size);
+		decoded.Encode();
+	}
+}
+
+TEST(DialogControls, AppliesChanges)
+{
+	DialogControls controls = GetControls();
+	CHECK(controls.Apply({ DialogControlChangeKind::ItemSelected, 3, 10 }));
+	std::uint32_t item;
+	CHECK(controls.GetSelectedItem(3, item) && item == 10);
+	CHECK(!controls.Apply({ DialogControlChangeKind::ItemSelected, 3, 99 }));
+
+	CHECK(controls.Apply({ DialogControlChangeKind::CheckToggled, 2, 0 }));
+	bool checked;
+	CHECK(controls.GetChecked(2, checked) && !checked);
+	CHECK(controls.Apply({ DialogControlChangeKind::TextChanged, 4, 0, "Final" }));
+	std::string_view text;
+	CHECK(controls.GetText(4, text) && text == "Final");
+	CHECK(controls.Apply({ DialogControlChangeKind::ButtonClicked, 5 }));
+
+	// Nothing the user could have done
+	CHECK(!controls.Apply({ DialogControlChangeKind::ButtonClicked, 2 }));
+	CHECK(!controls.Apply({ DialogControlChangeKind::TextChanged, 5, 0, "x" }));
+	controls.SetState(5, DialogControls::Visible);
+	CHECK(!controls.Apply({ DialogControlChangeKind::ButtonClicked, 5 }));
+	controls.SetItemState(3, 11, DialogControls::Visible);
+	CHECK(!controls.Apply({ DialogControlChangeKind::ItemSelected, 3, 11 }));
+}
+
+TEST(DialogControls, RoundTripsChanges)
+{
+	DialogControlChanges changes;
+	changes.Changes.push_back({ DialogControlChangeKind::ItemSelected, 3, 10 });
+	changes.Changes.push_back({ DialogControlChangeKind::TextChanged, 4, 0, "Final" });
+
+	std::string payload = changes.Encode();
+	DialogControlChanges decoded;
+	REQUIRE(DialogControlChanges::Decode(payload, decoded));
+	REQUIRE(decoded.Changes.size() == 2);
+	CHECK(decoded.Changes[0].Kind == DialogControlChangeKind::ItemSelected);
+	CHECK(decoded.Changes[0].Value == 10);
+	CHECK(decoded.Changes[1].Text == "Final");
+
+	for (std::size_t size = 0; size < payload.size(); size++)
+		CHECK(!DialogControlChanges::Decode(payload.substr(0, size), decoded));
+	CHECK(!DialogControlChanges::Decode(payload + "x", decoded));
+
+	// Unknown kinds and counts no payload could hold
+	std::string kind = payload;
+	kind[4] = (char)DialogControlChangeKind::Count;
+	CHECK(!DialogControlChanges::Decode(kind, decoded));
+	std::string count = payload;
+	count[1] = 1;
+	CHECK(!DialogControlChanges::Decode(count, decoded));
+}
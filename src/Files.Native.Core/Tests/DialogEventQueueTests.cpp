@@ -0,0 +1,63 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "DialogEventQueue.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+using namespace std::chrono;
+
+TEST(DialogEventQueue, DeliversFolderChangesFirst)
+{
+	DialogEventQueue queue;
+	DialogEventQueue::Clock::time_point now = DialogEventQueue::Clock::now();
+	queue.Push(DialogEventKind::SelectionChange, "C:\\a\\1");
+	queue.Push(DialogEventKind::FolderChange, "C:\\b");
+	queue.Push(DialogEventKind::SelectionChange, "C:\\b\\2");
+
+	DialogEvent event;
+	REQUIRE(queue.Pop(now, event));
+	CHECK(event.Kind == DialogEventKind::FolderChange && event.Payload == "C:\\b");
+	REQUIRE(queue.Pop(now, event));
+	CHECK(event.Kind == DialogEventKind::SelectionChange && event.Payload == "C:\\b\\2");
+	CHECK(!queue.Pop(now, event));
+	CHECK(queue.Pushed() == 3 && queue.Delivered() == 2);
+}
+
+TEST(DialogEventQueue, CoalescesSelectionChanges)
+{
+	DialogEventQueue queue(milliseconds(100));
+	DialogEventQueue::Clock::time_point now = DialogEventQueue::Clock::now();
+
+	DialogEvent event;
+	queue.Push(DialogEventKind::SelectionChange, "1");
+	CHECK(queue.NextDue(now) == milliseconds(0));
+	REQUIRE(queue.Pop(now, event));
+
+	// Only the last of a burst is delivered, once the interval has passed
+	for (int i = 2; i <= 50; i++)
+		queue.Push(DialogEventKind::SelectionChange, std::to_string(i));
+	CHECK(!queue.Pop(now + milliseconds(40), event));
+	CHECK(queue.NextDue(now + milliseconds(40)) == milliseconds(60));
+	REQUIRE(queue.Pop(now + milliseconds(100), event));
+	CHECK(event.Payload == "50");
+	CHECK(!queue.NextDue(now + milliseconds(100)).has_value());
+}
+
+TEST(DialogEventQueue, DropsSelectionOfPreviousFolder)
+{
+	DialogEventQueue queue;
+	DialogEventQueue::Clock::time_point now = DialogEventQueue::Clock::now();
+	queue.Push(DialogEventKind::SelectionChange, "C:\\a\\1");
+	queue.Push(DialogEventKind::FolderChange, "C:\\b");
+
+	DialogEvent event;
+	REQUIRE(queue.Pop(now, event));
+	CHECK(event.Kind == DialogEventKind::FolderChange);
+	CHECK(!queue.Pop(now, event));
+
+	queue.Push(DialogEventKind::FolderChange, "C:\\c");
+	queue.Reset();
+	CHECK(!queue.Pop(now, event));
+	CHECK(!queue.NextDue(now).has_value());
+}
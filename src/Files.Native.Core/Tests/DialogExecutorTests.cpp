@@ -0,0 +1,188 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <thread>
+#include "DialogExecutor.h"
+#include "Tests/Test.h"
+#include "Tests/TestExecutorHost.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Tests;
+using namespace std::chrono;
+
+namespace
+{
+	Task<int> AddOne(DialogExecutor& executor, int value)
+	{
+		co_await executor.Schedule();
+		co_return value + 1;
+	}
+
+	Task<int> Delayed(DialogExecutor& executor, milliseconds delay, int value)
+	{
+		co_await executor.Delay(delay);
+		co_return value;
+	}
+
+	Task<WaitResult> WaitFor(DialogExecutor& executor, TestEvent& event, milliseconds timeout)
+	{
+		co_return co_await executor.Wait(&event, timeout);
+	}
+
+	Task<void> Throw()
+	{
+		throw 42;
+		co_return;
+	}
+}
+
+TEST(DialogExecutor, RunsNestedTasks)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	CHECK(executor.Run(AddOne(executor, 1)) == 2);
+}
+
+TEST(DialogExecutor, RunsSpawnedTasksConcurrently)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	steady_clock::time_point start = steady_clock::now();
+	int sum = executor.Run([](DialogExecutor& executor) -> Task<int>
+	{
+		auto first = executor.Spawn(Delayed(executor, milliseconds(50), 5));
+		auto second = executor.Spawn(Delayed(executor, milliseconds(50), 6));
+		co_return co_await first + co_await second;
+	}(executor));
+
+	CHECK(sum == 11);
+	// Both delays overlap
+	CHECK(steady_clock::now() - start < milliseconds(95));
+}
+
+TEST(DialogExecutor, WaitsForHandles)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	TestEvent event;
+
+	CHECK(executor.Run(WaitFor(executor, event, milliseconds(20))) == WaitResult::TimedOut);
+
+	std::thread setter([&]()
+	{
+		std::this_thread::sleep_for(milliseconds(10));
+		event.IsSet = true;
+	});
+	auto results = executor.Run([](DialogExecutor& executor, TestEvent& event) -> Task<std::pair<WaitResult, WaitResult>>
+	{
+		// Two waiters on the same handle
+		auto first = executor.Spawn(WaitFor(executor, event, seconds(5)));
+		auto second = executor.Spawn(WaitFor(executor, event, seconds(5)));
+		co_return std::pair(co_await first, co_await second);
+	}(executor, event));
+	setter.join();
+
+	CHECK(results.first == WaitResult::Signalled);
+	CHECK(results.second == WaitResult::Signalled);
+}
+
+TEST(DialogExecutor, OffloadsWork)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	std::thread::id hostThread = std::this_thread::get_id();
+	bool offThread = executor.Run([](DialogExecutor& executor, std::thread::id hostThread) -> Task<bool>
+	{
+		std::thread::id worker = co_await executor.Offload([]() { return std::this_thread::get_id(); });
+		co_await executor.Offload([]() {});
+		co_return worker != hostThread && std::this_thread::get_id() == hostThread;
+	}(executor, hostThread));
+
+	CHECK(offThread);
+}
+
+TEST(DialogExecutor, OffloadsWithDeadline)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	auto run = [&](milliseconds work)
+	{
+		return executor.Run([](DialogExecutor& executor, milliseconds work) -> Task<std::optional<int>>
+		{
+			co_return co_await executor.OffloadFor([work]()
+			{
+				std::this_thread::sleep_for(work);
+				return 7;
+			}, milliseconds(100));
+		}(executor, work));
+	};
+
+	CHECK(run(milliseconds(0)) == 7);
+
+	steady_clock::time_point start = steady_clock::now();
+	CHECK(!run(milliseconds(300)).has_value());
+	CHECK(steady_clock::now() - start < milliseconds(250));
+	// Lets the abandoned work finish before the host goes away
+	std::this_thread::sleep_for(milliseconds(300));
+}
+
+TEST(DialogExecutor, CancelsWaits)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	WaitResult result = executor.Run([](DialogExecutor& executor) -> Task<WaitResult>
+	{
+		std::stop_source source;
+		auto delay = executor.Spawn([](DialogExecutor& executor, std::stop_token token) -> Task<WaitResult>
+		{
+			co_return co_await executor.Delay(hours(1), token);
+		}(executor, source.get_token()));
+
+		co_await executor.Schedule();
+		source.request_stop();
+		co_return co_await delay;
+	}(executor));
+	CHECK(result == WaitResult::Cancelled);
+
+	DialogExecutor other(host);
+	std::thread canceller([&]()
+	{
+		std::this_thread::sleep_for(milliseconds(20));
+		other.Cancel();
+	});
+	WaitResult otherResult = other.Run([](DialogExecutor& executor) -> Task<WaitResult>
+	{
+		co_return co_await executor.Delay(hours(1));
+	}(other));
+	CHECK(otherResult == WaitResult::Cancelled);
+	canceller.join();
+
+	// Close() may reach the executor before Show() runs it
+	DialogExecutor early(host);
+	early.Cancel();
+	CHECK(early.Run([](DialogExecutor& executor) -> Task<WaitResult>
+	{
+		co_return co_await executor.Delay(hours(1));
+	}(early)) == WaitResult::Cancelled);
+}
+
+TEST(DialogExecutor, PropagatesExceptions)
+{
+	TestExecutorHost host;
+	DialogExecutor executor(host);
+	bool caught = executor.Run([]() -> Task<bool>
+	{
+		try
+		{
+			co_await Throw();
+		}
+		catch (int value)
+		{
+			co_return value == 42;
+		}
+
+		co_return false;
+	}());
+
+	CHECK(caught);
+}
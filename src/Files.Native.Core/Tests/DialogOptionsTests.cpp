@@ -0,0 +1,26 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "DialogOptions.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(DialogOptions, MapsOptionsToEnumerationMode)
+{
+	CHECK(DialogOptions::GetEnumerationMode(DialogOptions::AllowMultiSelect) == EnumerationMode::None);
+	CHECK(DialogOptions::GetEnumerationMode(0) == EnumerationMode::SingleSelect);
+
+	EnumerationMode mode = DialogOptions::GetEnumerationMode(DialogOptions::PickFolders | DialogOptions::ForceFileSystem | DialogOptions::NoDereferenceLinks);
+	CHECK(HasFlag(mode, EnumerationMode::FoldersOnly));
+	CHECK(HasFlag(mode, EnumerationMode::FileSystemOnly));
+	CHECK(HasFlag(mode, EnumerationMode::SingleSelect));
+	CHECK(HasFlag(mode, EnumerationMode::NoDereferenceLinks));
+}
+
+TEST(DialogOptions, SerializesEnumerationMode)
+{
+	CHECK(DialogOptions::Serialize(EnumerationMode::None) == L"None");
+	CHECK(DialogOptions::Serialize(EnumerationMode::SingleSelect) == L"SingleSelect");
+	CHECK(DialogOptions::Serialize(EnumerationMode::NoDereferenceLinks | EnumerationMode::FoldersOnly) == L"FoldersOnly,NoDereferenceLinks");
+}
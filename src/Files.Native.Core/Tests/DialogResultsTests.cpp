@@ -0,0 +1,99 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DialogResults.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(DialogResults, PublishesAndClears)
+{
+	DialogResults results;
+	CHECK(results.Get() == nullptr);
+
+	results.Publish({ "C:\\a.txt", "C:\\b.txt" });
+	REQUIRE(results.Get() != nullptr);
+	CHECK(results.Get()->Items.size() == 2);
+	CHECK(results.Get()->Items[1] == "C:\\b.txt");
+
+	results.Clear();
+	CHECK(results.Get() == nullptr);
+
+	// A cancelled Show() publishes nothing
+	results.Publish({});
+	CHECK(results.Get() == nullptr);
+}
+
+TEST(DialogResults, ReleasesSetsNoLongerHeld)
+{
+	DialogResults results;
+	results.Publish({ "C:\\first.txt" });
+	std::shared_ptr<const DialogResultSet> first = results.Get();
+	std::weak_ptr<const DialogResultSet> watch = first;
+
+	// Held by a reader, the set outlives the next Show()
+	results.Clear();
+	results.Publish({ "C:\\second.txt" });
+	CHECK(results.Get() != first);
+	CHECK(results.Get()->Items.front() == "C:\\second.txt");
+	CHECK(first->Items.front() == "C:\\first.txt");
+
+	first.reset();
+	CHECK(watch.expired());
+
+	watch = results.Get();
+	results.Clear();
+	CHECK(watch.expired());
+}
+
+TEST(DialogResults, ReadersSeeWholeSets)
+{
+	DialogResults results;
+	std::atomic<bool> done{ false };
+	std::atomic<int> torn{ 0 };
+
+	// Every item of a set names the Show() it came from. The readers get their sets from
+	// the dialog's thread, as the results objects handed to a host's workers do.
+	std::mutex lock;
+	std::shared_ptr<const DialogResultSet> handed;
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++)
+	{
+		readers.emplace_back([&]()
+		{
+			while (!done.load())
+			{
+				std::shared_ptr<const DialogResultSet> set;
+				{
+					std::lock_guard guard(lock);
+					set = handed;
+				}
+				if (!set)
+					continue;
+
+				for (const std::string& item : set->Items)
+					torn += item != set->Items.front();
+			}
+		});
+	}
+
+	for (int show = 0; show < 500; show++)
+	{
+		results.Clear();
+		results.Publish(std::vector<std::string>(16, "C:\\show" + std::to_string(show) + ".txt"));
+		std::lock_guard guard(lock);
+		handed = results.Get();
+	}
+
+	done = true;
+	for (std::thread& reader : readers)
+		reader.join();
+
+	CHECK(torn == 0);
+	CHECK(results.Get()->Items.front() == "C:\\show499.txt");
+}
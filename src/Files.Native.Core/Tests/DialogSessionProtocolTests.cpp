@@ -0,0 +1,63 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "DialogSessionProtocol.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(DialogSessionProtocol, DecodesFramesFedByteByByte)
+{
+	std::string stream = DialogMessageCodec::Encode(DialogMessageType::Hello) +
+		DialogMessageCodec::Encode(DialogMessageType::Show, "\"Files.exe\" -directory \"C:\\\"") +
+		DialogMessageCodec::Encode(DialogMessageType::Close, std::string("\0\x01", 2));
+
+	DialogMessageCodec codec;
+	std::vector<DialogMessage> messages;
+	for (char byte : stream)
+	{
+		codec.Feed(&byte, 1);
+		DialogMessage message;
+		while (codec.Next(message))
+			messages.push_back(message);
+	}
+
+	REQUIRE(messages.size() == 3);
+	CHECK(messages[0].Type == DialogMessageType::Hello && messages[0].Payload.empty());
+	CHECK(messages[1].Type == DialogMessageType::Show && messages[1].Payload == "\"Files.exe\" -directory \"C:\\\"");
+	CHECK(messages[2].Type == DialogMessageType::Close && messages[2].Payload == std::string("\0\x01", 2));
+	CHECK(!codec.IsCorrupt());
+}
+
+TEST(DialogSessionProtocol, DecodesFramesFedAtOnce)
+{
+	std::string stream;
+	for (int i = 0; i < 1000; i++)
+		stream += DialogMessageCodec::Encode(DialogMessageType::SelectionChanged, "C:\\" + std::to_string(i));
+
+	DialogMessageCodec codec;
+	codec.Feed(stream.data(), stream.size());
+	DialogMessage message;
+	int count = 0;
+	while (codec.Next(message))
+		CHECK(message.Payload == "C:\\" + std::to_string(count++));
+
+	CHECK(count == 1000);
+}
+
+TEST(DialogSessionProtocol, RejectsOversizedFrames)
+{
+	std::string frame = DialogMessageCodec::Encode(DialogMessageType::Show, "x");
+	frame[3] = 0x7F;
+
+	DialogMessageCodec codec;
+	codec.Feed(frame.data(), frame.size());
+	DialogMessage message;
+	CHECK(!codec.Next(message));
+	CHECK(codec.IsCorrupt());
+
+	// Stays corrupt, the stream can't be resynchronized
+	std::string next = DialogMessageCodec::Encode(DialogMessageType::Hello);
+	codec.Feed(next.data(), next.size());
+	CHECK(!codec.Next(message));
+}
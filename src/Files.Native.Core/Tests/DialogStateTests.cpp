@@ -0,0 +1,123 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "DialogState.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(DialogState, StartsWithDefaultOptions)
+{
+	CHECK(DialogState(DialogKind::Open).Apply({ DialogCallKind::GetOptions }).Value == (DialogState::FileMustExist | DialogState::PathMustExist));
+	CHECK(DialogState(DialogKind::Save).Apply({ DialogCallKind::GetOptions }).Value == DialogState::PathMustExist);
+	CHECK(DialogState(DialogKind::Open).Apply({ DialogCallKind::Advise }).Value == 1);
+	CHECK(DialogState(DialogKind::Save).Apply({ DialogCallKind::Advise }).Value == 4);
+}
+
+TEST(DialogState, AnswersFolderByPrecedence)
+{
+	DialogState state(DialogKind::Save);
+	CHECK(!state.Apply({ DialogCallKind::GetFolder }).Succeeded);
+
+	state.Apply({ DialogCallKind::SetDefaultFolder, 1, "C:\\Docs" });
+	DialogReply reply = state.Apply({ DialogCallKind::GetFolder });
+	CHECK(reply.Value == (std::uint32_t)DialogFolderSource::Default && reply.Text == "C:\\Docs");
+
+	state.Apply({ DialogCallKind::SetFolder, 1, "D:\\Work" });
+	reply = state.Apply({ DialogCallKind::GetFolder });
+	CHECK(reply.Value == (std::uint32_t)DialogFolderSource::Folder && reply.Text == "D:\\Work");
+
+	state.Apply({ DialogCallKind::Show });
+	state.Apply({ DialogCallKind::FolderChanged, 0, "E:\\" });
+	reply = state.Apply({ DialogCallKind::GetFolder });
+	CHECK(reply.Value == (std::uint32_t)DialogFolderSource::Current && reply.Text == "E:\\");
+
+	state.Apply({ DialogCallKind::Show });
+	state.Apply({ DialogCallKind::SetFolder, 0 });
+	CHECK(state.Apply({ DialogCallKind::GetFolder }).Value == (std::uint32_t)DialogFolderSource::Default);
+}
+
+TEST(DialogState, SplitsSaveAsItem)
+{
+	DialogState state(DialogKind::Save);
+	state.Apply({ DialogCallKind::SetSaveAsItem, 1, "C:\\\\a.txt" });
+	CHECK(*state.GetFolderName() == "C:\\");
+	CHECK(state.GetFileName() == "a.txt");
+
+	state.Apply({ DialogCallKind::SetSaveAsItem, 0, "b.txt" });
+	CHECK(!state.GetFolderName());
+	CHECK(state.GetFileName() == "b.txt");
+
+	state.Apply({ DialogCallKind::SetFileName, 0, "D:\\x\\c.doc" });
+	CHECK(state.GetFileName() == "c.doc");
+}
+
+TEST(DialogState, KeepsStringsForSystemDialog)
+{
+	DialogState state(DialogKind::Save);
+	CHECK(state.GetTitle().empty());
+	CHECK(state.GetDefaultExtension().empty());
+
+	state.Apply({ DialogCallKind::SetTitle, 0, "Export" });
+	state.Apply({ DialogCallKind::SetOkButtonLabel, 0, "Export" });
+	state.Apply({ DialogCallKind::SetFileNameLabel, 0, "Name:" });
+	state.Apply({ DialogCallKind::SetDefaultExtension, 0, "png" });
+	state.Apply({ DialogCallKind::SetDefaultExtension, 0, "jpg" });
+	CHECK(state.GetTitle() == "Export");
+	CHECK(state.GetOkButtonLabel() == "Export");
+	CHECK(state.GetFileNameLabel() == "Name:");
+	CHECK(state.GetDefaultExtension() == "jpg");
+}
+
+TEST(DialogState, TracksControls)
+{
+	DialogState state(DialogKind::Open);
+	CHECK(!state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", 7 }).Succeeded);
+	CHECK(!state.Apply({ DialogCallKind::AddControlItem, 0, "A", 7, 3 }).Succeeded);
+
+	REQUIRE(state.Apply({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::ComboBox, "", 7 }).Succeeded);
+	state.Apply({ DialogCallKind::AddControlItem, 0, "A", 7, 3 });
+	state.Apply({ DialogCallKind::AddControlItem, 0, "B", 7, 5 });
+	// Adding an item doesn't select it
+	CHECK(!state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", 7 }).Succeeded);
+	state.Apply({ DialogCallKind::SetSelectedControlItem, 0, "", 7, 3 });
+	CHECK(state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", 7 }).Value == 3);
+	state.Apply({ DialogCallKind::RemoveControlItem, 0, "", 7, 3 });
+	CHECK(!state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", 7 }).Succeeded);
+
+	state.Apply({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::CheckButton | 0x100, "Read only", 8 });
+	CHECK(state.Apply({ DialogCallKind::GetCheckButtonState, 0, "", 8 }).Value == 1);
+	state.Apply({ DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::EditBox, "x", 9 });
+	state.Apply({ DialogCallKind::SetEditBoxText, 0, "y", 9 });
+	CHECK(state.Apply({ DialogCallKind::GetEditBoxText, 0, "", 9 }).Text == "y");
+	CHECK(state.GetControls().GetControls().size() == 3);
+
+	// What the user did in Files
+	std::string change;
+	DialogControlChange{ DialogControlChangeKind::ItemSelected, 7, 5 }.AppendTo(change);
+	CHECK(state.Apply({ DialogCallKind::ControlChanged, 0, change }).Succeeded);
+	CHECK(state.Apply({ DialogCallKind::GetSelectedControlItem, 0, "", 7 }).Value == 5);
+	CHECK(!state.Apply({ DialogCallKind::ControlChanged, 0, "\x01" }).Succeeded);
+}
+
+TEST(DialogState, ReportsSelectionAndResults)
+{
+	DialogState state(DialogKind::Open);
+	state.Apply({ DialogCallKind::Show });
+	state.Apply({ DialogCallKind::FolderChanged, 0, "E:\\" });
+	state.Apply({ DialogCallKind::SelectionChanged, 0, "E:\\1\n\nE:\\2\n" });
+	CHECK(state.GetCurrentSelection().size() == 2);
+
+	DialogReply reply = state.Apply({ DialogCallKind::GetCurrentSelection });
+	CHECK(reply.Value == 2 && reply.Text == "E:\\1");
+	CHECK(!state.Apply({ DialogCallKind::GetResult }).Succeeded);
+
+	CHECK(state.Apply({ DialogCallKind::Completed, 0, "E:\\2\nE:\\3" }).Value == 2);
+	CHECK(state.Apply({ DialogCallKind::GetResults }).Text == "E:\\2");
+	CHECK(state.Apply({ DialogCallKind::GetFileName }).Text == "E:\\2");
+
+	// A new Show() forgets the last one
+	state.Apply({ DialogCallKind::Show });
+	CHECK(!state.Apply({ DialogCallKind::GetResult }).Succeeded);
+	CHECK(state.GetCurrentFolder().empty());
+}
@@ -0,0 +1,120 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <random>
+#include "DialogTrace.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	DialogTrace GetTrace()
+	{
+		DialogTrace trace;
+		trace.Kind = DialogKind::Save;
+		trace.Host = "winword.exe";
+		trace.Records.push_back({ 0, { DialogCallKind::SetOptions, 0x80000 } });
+		trace.Records.push_back({ 123456789, { DialogCallKind::SetFolder, 1, "C:\\Users\\x" } });
+		trace.Records.push_back({ 5, { DialogCallKind::Close, 0x800704C7 } });
+		return trace;
+	}
+}
+
+TEST(DialogTrace, RoundTrips)
+{
+	DialogTrace trace = GetTrace();
+	DialogTrace decoded;
+	REQUIRE(DialogTrace::Decode(trace.Encode(), decoded));
+	CHECK(decoded.Kind == DialogKind::Save);
+	CHECK(decoded.Host == "winword.exe");
+	REQUIRE(decoded.Records.size() == 3);
+	CHECK(decoded.Records[1].Delay == 123456789);
+	CHECK(decoded.Records[1].Call.Kind == DialogCallKind::SetFolder);
+	CHECK(decoded.Records[1].Call.Text == "C:\\Users\\x");
+	CHECK(decoded.Records[2].Call.Value == 0x800704C7);
+}
+
+TEST(DialogTrace, RoundTripsControlCalls)
+{
+	DialogTrace trace;
+	trace.Records.push_back({ 0, { DialogCallKind::AddControl, (std::uint32_t)DialogControlKind::ComboBox, "", 300 } });
+	trace.Records.push_back({ 0, { DialogCallKind::AddControlItem, 0, "Tools", 300, 70000 } });
+	trace.Records.push_back({ 0, { DialogCallKind::GetOptions } });
+
+	DialogTrace decoded;
+	REQUIRE(DialogTrace::Decode(trace.Encode(), decoded));
+	REQUIRE(decoded.Records.size() == 3);
+	CHECK(decoded.Records[0].Call.Control == 300);
+	CHECK(decoded.Records[1].Call.Control == 300);
+	CHECK(decoded.Records[1].Call.Item == 70000);
+	CHECK(decoded.Records[1].Call.Text == "Tools");
+	CHECK(decoded.Records[2].Call.Kind == DialogCallKind::GetOptions);
+}
+
+TEST(DialogTrace, ReadsVersion1)
+{
+	// The item of an item call was its value
+	std::string encoded;
+	Detail::AppendUInt32(encoded, DialogTrace::Magic);
+	Detail::AppendUInt32(encoded, 1);
+	encoded.push_back((char)DialogKind::Open);
+	Detail::AppendUInt32(encoded, 0);
+	encoded.append({ 0, (char)DialogCallKind::AddControlItem, 3, 0 });
+	encoded.append({ 0, (char)DialogCallKind::SetOptions, 0x40, 0 });
+
+	DialogTrace decoded;
+	REQUIRE(DialogTrace::Decode(encoded, decoded));
+	REQUIRE(decoded.Records.size() == 2);
+	CHECK(decoded.Records[0].Call.Item == 3);
+	CHECK(decoded.Records[0].Call.Value == 0);
+	CHECK(decoded.Records[1].Call.Value == 0x40);
+
+	// Versions to come are refused
+	encoded.replace(4, 4, std::string("\x03\0\0\0", 4));
+	CHECK(!DialogTrace::Decode(encoded, decoded));
+}
+
+TEST(DialogTrace, RejectsTruncatedTraces)
+{
+	DialogTrace trace = GetTrace();
+	std::string encoded = trace.Encode();
+
+	// A trace cut between records holds the records before the cut
+	std::vector<std::size_t> boundaries;
+	std::string prefix;
+	DialogTrace::AppendHeader(prefix, trace.Kind, trace.Host);
+	boundaries.push_back(prefix.size());
+	for (const DialogTraceRecord& record : trace.Records)
+	{
+		DialogTrace::AppendRecord(prefix, record.Delay, record.Call);
+		boundaries.push_back(prefix.size());
+	}
+
+	for (std::size_t size = 0; size < encoded.size(); size++)
+	{
+		DialogTrace decoded;
+		bool boundary = std::find(boundaries.begin(), boundaries.end(), size) != boundaries.end();
+		CHECK(DialogTrace::Decode(encoded.substr(0, size), decoded) == boundary);
+	}
+}
+
+TEST(DialogTrace, SurvivesDamagedTraces)
+{
+	std::string encoded = GetTrace().Encode();
+	std::mt19937 random(1);
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string damaged = encoded;
+		damaged[random() % damaged.size()] ^= (char)(1 << (random() % 8));
+
+		DialogTrace decoded;
+		if (!DialogTrace::Decode(damaged, decoded))
+			continue;
+
+		DialogState state(decoded.Kind);
+		for (const DialogTraceRecord& record : decoded.Records)
+			state.Apply(record.Call);
+	}
+}
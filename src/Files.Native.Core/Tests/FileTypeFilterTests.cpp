@@ -0,0 +1,51 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "FileTypeFilter.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(FileTypeFilter, MatchesExtensionSets)
+{
+	FileTypeFilter filter = FileTypeFilter::Compile(L"*.PNG; *.jpg");
+	CHECK(filter.IsExtensionSet());
+	CHECK(filter.Matches(L"a.png"));
+	CHECK(filter.Matches(L"B.JPG"));
+	CHECK(!filter.Matches(L"a.gif"));
+	CHECK(!filter.Matches(L"png"));
+}
+
+TEST(FileTypeFilter, MatchesWildcards)
+{
+	FileTypeFilter filter = FileTypeFilter::Compile(L"report-??.*;*.txt");
+	CHECK(!filter.IsExtensionSet());
+	CHECK(filter.Matches(L"Report-12.doc"));
+	CHECK(!filter.Matches(L"report-1.doc"));
+	CHECK(filter.Matches(L"x.TXT"));
+
+	FileTypeFilter stars = FileTypeFilter::Compile(L"a*b*c");
+	CHECK(stars.Matches(L"abc"));
+	CHECK(stars.Matches(L"axxbyyc"));
+	CHECK(!stars.Matches(L"acb"));
+	CHECK(!stars.Matches(L"abcx"));
+}
+
+TEST(FileTypeFilter, MatchesAll)
+{
+	CHECK(FileTypeFilter::Compile(L"*.png;*.*").MatchesAll());
+	CHECK(FileTypeFilter::Compile(L"").MatchesAll());
+	CHECK(!FileTypeFilter::Compile(L"*.png").MatchesAll());
+}
+
+TEST(FileTypeFilter, RoundTrips)
+{
+	FileTypeFilter wildcards = FileTypeFilter::Deserialize(FileTypeFilter::Compile(L"report-??.*;*.txt").Serialize());
+	CHECK(wildcards.Matches(L"Report-12.doc"));
+	CHECK(wildcards.Matches(L"x.txt"));
+	CHECK(!wildcards.Matches(L"x.doc"));
+
+	FileTypeFilter extensions = FileTypeFilter::Deserialize(FileTypeFilter::Compile(L"*.PNG; *.jpg").Serialize());
+	CHECK(extensions.IsExtensionSet());
+	CHECK(extensions.Matches(L"q.jpg"));
+}
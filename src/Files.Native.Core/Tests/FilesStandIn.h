@@ -0,0 +1,335 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Stand-in for the Files instance that serves a dialog session, for the portable
+//  benchmarks and tools. It greets the dialog after a simulated cold start and answers
+//  every Show on the session's own result channel, the way Files does on Windows.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DialogExecutor.h"
+#include "DialogSessionProtocol.h"
+#include "Tests/TestExecutorHost.h"
+#include "Tests/TestPipe.h"
+
+namespace Files::Native::Tests
+{
+	inline bool WriteMessage(TestPipe& pipe, DialogMessageType type, const std::string& payload = std::string())
+	{
+		std::string frame = DialogMessageCodec::Encode(type, payload);
+		return pipe.Write(frame.data(), frame.size());
+	}
+
+	// Blocks until a whole message is there, fails once the pipe is closed
+	inline bool ReadMessage(TestPipe& pipe, DialogMessage& message)
+	{
+		char header[DialogMessageCodec::HeaderSize];
+		if (!pipe.Read(header, sizeof(header)))
+			return false;
+
+		std::uint32_t size = (std::uint32_t)(unsigned char)header[0] | ((std::uint32_t)(unsigned char)header[1] << 8) |
+			((std::uint32_t)(unsigned char)header[2] << 16) | ((std::uint32_t)(unsigned char)header[3] << 24);
+		if (size > DialogMessageCodec::MaxPayloadSize)
+			return false;
+
+		message.Type = (DialogMessageType)header[4];
+		message.Payload.resize(size);
+		return pipe.Read(message.Payload.data(), size);
+	}
+
+	struct FilesStandInTimings
+	{
+		// From the activation to Files greeting the dialog, i.e. a cold start of the app
+		std::chrono::microseconds Startup{ 0 };
+		// From a Show message to the picker being on screen
+		std::chrono::microseconds Show{ 0 };
+		// From the picker being on screen to the user picking an item
+		std::chrono::microseconds Pick{ 0 };
+	};
+
+	// Plays Files on the other end of a dialog session, on its own thread. Each Show is
+	// answered with its command line, so that a dialog can tell its result from another's.
+	class FilesStandIn
+	{
+		using Clock = std::chrono::steady_clock;
+
+		TestPipe _pipe;
+		FilesStandInTimings _timings;
+		ExecutorHost& _host;
+		std::thread _thread;
+
+		std::mutex _mutex;
+		std::string _result;
+		Clock::time_point _visibleTime;
+
+	public:
+		// Set once the result of the last Show is there, see TakeResult
+		TestEvent Completed;
+
+		FilesStandIn(TestPipe pipe, FilesStandInTimings timings, ExecutorHost& host) :
+			_pipe(std::move(pipe)),
+			_timings(timings),
+			_host(host)
+		{
+			_thread = std::thread([this]() { Serve(); });
+		}
+
+		FilesStandIn(const FilesStandIn&) = delete;
+		FilesStandIn& operator=(const FilesStandIn&) = delete;
+
+		~FilesStandIn()
+		{
+			_pipe.Close();
+			_thread.join();
+		}
+
+		std::string TakeResult()
+		{
+			std::lock_guard lock(_mutex);
+			Completed.IsSet = false;
+			return std::move(_result);
+		}
+
+		// When the picker of the last Show came on screen
+		Clock::time_point GetVisibleTime()
+		{
+			std::lock_guard lock(_mutex);
+			return _visibleTime;
+		}
+
+	private:
+		void Serve()
+		{
+			std::this_thread::sleep_for(_timings.Startup);
+			if (!WriteMessage(_pipe, DialogMessageType::Hello))
+				return;
+
+			DialogMessage message;
+			while (ReadMessage(_pipe, message) && message.Type != DialogMessageType::Close)
+			{
+				if (message.Type != DialogMessageType::Show)
+					continue;
+
+				std::this_thread::sleep_for(_timings.Show);
+				{
+					std::lock_guard lock(_mutex);
+					_visibleTime = Clock::now();
+				}
+
+				std::this_thread::sleep_for(_timings.Pick);
+				{
+					std::lock_guard lock(_mutex);
+					_result = std::move(message.Payload);
+					Completed.IsSet = true;
+				}
+
+				_host.Wake();
+			}
+		}
+	};
+
+	// The dialog's end of a session with a FilesStandIn, which it starts the way the
+	// dialog's pre-activation starts Files. Mirrors DialogSession on Windows.
+	class StandInSession
+	{
+		ExecutorHost& _host;
+		TestPipe _pipe;
+		std::optional<FilesStandIn> _files;
+		std::thread _reader;
+
+		std::mutex _mutex;
+		std::deque<DialogMessage> _messages;
+		TestEvent _received;
+		bool _ready = false;
+
+		StandInSession(std::pair<TestPipe, TestPipe> pipe, FilesStandInTimings timings, ExecutorHost& host) :
+			_host(host),
+			_pipe(std::move(pipe.first))
+		{
+			_files.emplace(std::move(pipe.second), timings, host);
+			_reader = std::thread([this]() { Read(); });
+		}
+
+	public:
+		StandInSession(FilesStandInTimings timings, ExecutorHost& host) :
+			StandInSession(TestPipe::Create(), timings, host)
+		{
+		}
+
+		StandInSession(const StandInSession&) = delete;
+		StandInSession& operator=(const StandInSession&) = delete;
+
+		~StandInSession()
+		{
+			Close();
+		}
+
+		bool IsReady() const
+		{
+			return _ready;
+		}
+
+		// Waits until the stand-in has greeted the dialog
+		Task<bool> WaitReadyAsync(DialogExecutor& executor, std::chrono::milliseconds timeout)
+		{
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (!_ready)
+			{
+				std::optional<DialogMessage> message = TakeMessage();
+				if (message)
+				{
+					_ready = message->Type == DialogMessageType::Hello;
+					if (!_ready)
+						co_return false;
+				}
+				else
+				{
+					// Awaited apart from the condition, which GCC 12 doesn't always resume into
+					WaitResult result = co_await executor.Wait(&_received, std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()));
+					if (result != WaitResult::Signalled)
+						co_return false;
+				}
+			}
+
+			co_return true;
+		}
+
+		bool Show(const std::string& commandLine)
+		{
+			if (!_ready)
+				return false;
+
+			return WriteMessage(_pipe, DialogMessageType::Show, commandLine);
+		}
+
+		// Waits for what the last Show ended with on the session's own channel
+		Task<std::optional<std::string>> WaitResultAsync(DialogExecutor& executor, std::chrono::milliseconds timeout)
+		{
+			WaitResult result = co_await executor.Wait(&_files->Completed, timeout);
+			if (result != WaitResult::Signalled)
+				co_return std::nullopt;
+
+			co_return _files->TakeResult();
+		}
+
+		std::chrono::steady_clock::time_point GetVisibleTime()
+		{
+			return _files->GetVisibleTime();
+		}
+
+		void Close()
+		{
+			if (!_files)
+				return;
+
+			WriteMessage(_pipe, DialogMessageType::Close);
+			_pipe.Close();
+			_reader.join();
+			_files.reset();
+			_ready = false;
+		}
+
+	private:
+		std::optional<DialogMessage> TakeMessage()
+		{
+			std::lock_guard lock(_mutex);
+			if (_messages.empty())
+			{
+				_received.IsSet = false;
+				return std::nullopt;
+			}
+
+			DialogMessage message = std::move(_messages.front());
+			_messages.pop_front();
+			return message;
+		}
+
+		void Read()
+		{
+			DialogMessage message;
+			while (ReadMessage(_pipe, message))
+			{
+				{
+					std::lock_guard lock(_mutex);
+					_messages.push_back(std::move(message));
+					_received.IsSet = true;
+				}
+
+				_host.Wake();
+			}
+		}
+	};
+
+	// The session part of the dialog's Show(): waits for Files, hands it the command line and
+	// waits for the picker to close. Returns what the picker ended with.
+	inline Task<std::optional<std::string>> ShowAsync(DialogExecutor& executor, StandInSession& session, std::string commandLine)
+	{
+		bool ready = co_await session.WaitReadyAsync(executor, std::chrono::seconds(5));
+		if (!ready || !session.Show(commandLine))
+			co_return std::nullopt;
+
+		co_return co_await session.WaitResultAsync(executor, std::chrono::seconds(5));
+	}
+
+	struct ConcurrentDialogsResult
+	{
+		std::size_t Shows = 0;
+		// Shows that ended without a result, or with another dialog's
+		std::size_t Failures = 0;
+		std::chrono::steady_clock::duration Elapsed{};
+		// From the call of each Show() to its result
+		std::vector<std::chrono::steady_clock::duration> Latencies;
+	};
+
+	// Shows the given number of dialogs at once, each on its own thread with its own session,
+	// the given number of times each
+	inline ConcurrentDialogsResult RunConcurrentDialogs(std::size_t dialogs, std::size_t shows, FilesStandInTimings timings)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		std::vector<ConcurrentDialogsResult> results(dialogs);
+		std::vector<std::thread> threads;
+		Clock::time_point start = Clock::now();
+		for (std::size_t dialog = 0; dialog < dialogs; dialog++)
+		{
+			threads.emplace_back([&result = results[dialog], dialog, shows, timings]()
+			{
+				TestExecutorHost host;
+				DialogExecutor executor(host);
+				StandInSession session(timings, host);
+				for (std::size_t show = 0; show < shows; show++)
+				{
+					std::string commandLine = "-directory \"C:\\Dialog";
+					commandLine.append(std::to_string(dialog)).append("\\").append(std::to_string(show)).push_back('"');
+
+					Clock::time_point shown = Clock::now();
+					std::optional<std::string> picked = executor.Run(ShowAsync(executor, session, commandLine));
+					result.Latencies.push_back(Clock::now() - shown);
+					result.Failures += picked != commandLine;
+					result.Shows++;
+				}
+			});
+		}
+
+		ConcurrentDialogsResult total;
+		for (std::size_t dialog = 0; dialog < dialogs; dialog++)
+		{
+			threads[dialog].join();
+			total.Shows += results[dialog].Shows;
+			total.Failures += results[dialog].Failures;
+			total.Latencies.insert(total.Latencies.end(), results[dialog].Latencies.begin(), results[dialog].Latencies.end());
+		}
+
+		total.Elapsed = Clock::now() - start;
+		return total;
+	}
+}
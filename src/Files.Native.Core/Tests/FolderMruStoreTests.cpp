@@ -0,0 +1,170 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "FolderMruStore.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	FolderMruStore::Slot* WindowSlot(std::vector<char>& region, std::string_view key, std::uint32_t probe)
+	{
+		auto* slots = (FolderMruStore::Slot*)(region.data() + sizeof(FolderMruStore::Header));
+		return &slots[(FolderMruStore::Hash(key) + probe) % FolderMruStore::SlotCount];
+	}
+}
+
+TEST(FolderMruStore, RemembersAndForgets)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	FolderMruStore store(region.data(), region.size());
+	REQUIRE(store.IsValid());
+
+	CHECK(!store.Lookup("a"));
+	store.Remember("a", "C:\\A");
+	CHECK(store.Lookup("a") == "C:\\A");
+	store.Remember("a", "C:\\B");
+	CHECK(store.Lookup("a") == "C:\\B");
+	store.Forget("a");
+	CHECK(!store.Lookup("a"));
+}
+
+TEST(FolderMruStore, ForgetsEverySlotOfTheKey)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	FolderMruStore store(region.data(), region.size());
+	REQUIRE(store.Remember("a", "C:\\New"));
+
+	// What two processes remembering the client at once leave behind
+	auto duplicate = [&]()
+	{
+		FolderMruStore::Slot* slot = WindowSlot(region, "a", 1);
+		slot->KeyHash = FolderMruStore::Hash("a");
+		slot->LastUsed = 0;
+		slot->Length = 6;
+		std::memcpy(slot->Path, "C:\\Old", 6);
+		return slot;
+	};
+
+	FolderMruStore::Slot* slot = duplicate();
+	CHECK(store.Lookup("a") == "C:\\New");
+	store.Forget("a");
+	CHECK(!store.Lookup("a"));
+	CHECK(slot->KeyHash == 0);
+
+	REQUIRE(store.Remember("a", "C:\\New"));
+	slot = duplicate();
+	REQUIRE(store.Remember("a", "C:\\Newer"));
+	CHECK(slot->KeyHash == 0);
+	CHECK(store.Lookup("a") == "C:\\Newer");
+}
+
+TEST(FolderMruStore, RecoversStaleClaims)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	FolderMruStore store(region.data(), region.size());
+	REQUIRE(store.Remember("a", "C:\\A"));
+
+	// A writer in the middle of its write, then one that died there
+	FolderMruStore::Slot* slot = WindowSlot(region, "a", 0);
+	REQUIRE(slot->KeyHash == FolderMruStore::Hash("a"));
+	slot->Sequence |= 1;
+	slot->ClaimTime = FolderMruStore::Now();
+	store.Forget("a");
+	CHECK(slot->Sequence & 1);
+	CHECK(slot->KeyHash == FolderMruStore::Hash("a"));
+
+	slot->ClaimTime = FolderMruStore::Now() - FolderMruStore::StaleClaimTimeout.count() - 1;
+	store.Forget("a");
+	CHECK(!(slot->Sequence & 1));
+	CHECK(slot->KeyHash == 0);
+	CHECK(!store.Lookup("a"));
+
+	// Taken over by the next writer of the window as well
+	REQUIRE(store.Remember("a", "C:\\A"));
+	slot->Sequence |= 1;
+	slot->ClaimTime = FolderMruStore::Now() - FolderMruStore::StaleClaimTimeout.count() - 1;
+	REQUIRE(store.Remember("a", "C:\\B"));
+	CHECK(!(slot->Sequence & 1));
+	CHECK(store.Lookup("a") == "C:\\B");
+
+	// Claimed before the clock was set back
+	slot->Sequence |= 1;
+	slot->ClaimTime = FolderMruStore::Now() + 60 * 60 * 1000;
+	store.Forget("a");
+	CHECK(!(slot->Sequence & 1));
+	CHECK(!store.Lookup("a"));
+}
+
+TEST(FolderMruStore, KeepsRecentClients)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	FolderMruStore store(region.data(), region.size());
+	for (int i = 0; i < 5000; i++)
+		store.Remember(std::string("k").append(std::to_string(i)), std::string("p").append(std::to_string(i)));
+
+	int found = 0;
+	for (int i = 4900; i < 5000; i++)
+	{
+		auto folder = store.Lookup(std::string("k").append(std::to_string(i)));
+		if (!folder)
+			continue;
+
+		CHECK(*folder == std::string("p").append(std::to_string(i)));
+		found++;
+	}
+
+	CHECK(found > 50);
+}
+
+TEST(FolderMruStore, RejectsForeignRegions)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	region[0] = 1;
+	CHECK(!FolderMruStore(region.data(), region.size()).IsValid());
+
+	std::vector<char> small(FolderMruStore::RequiredSize / 2, 0);
+	CHECK(!FolderMruStore(small.data(), small.size()).IsValid());
+}
+
+TEST(FolderMruStore, NeverReadsTornEntries)
+{
+	std::vector<char> region(FolderMruStore::RequiredSize, 0);
+	std::atomic<bool> stop{ false };
+	std::atomic<int> torn{ 0 };
+
+	// One store per thread over the same region, as one per process over the mapping
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			FolderMruStore store(region.data(), region.size());
+			for (int i = 0; !stop; i++)
+			{
+				std::string key = "client" + std::to_string((i * 7 + t) % 64);
+				if (i % 4 == 0)
+				{
+					store.Remember(key, key + "\\folder" + std::to_string(i));
+				}
+				else
+				{
+					auto folder = store.Lookup(key);
+					if (folder && folder->rfind(key + "\\folder", 0) != 0)
+						torn++;
+				}
+			}
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	stop = true;
+	for (std::thread& thread : threads)
+		thread.join();
+
+	CHECK(torn == 0);
+}
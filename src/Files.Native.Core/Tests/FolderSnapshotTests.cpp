@@ -0,0 +1,76 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "FolderSnapshot.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	// Lists ".", ".." and three files
+	struct TestSource
+	{
+		int Index = 0;
+
+		bool Next(FolderSnapshotEntry& entry)
+		{
+			if (Index >= 5)
+				return false;
+
+			entry.Name = Index == 0 ? "." : Index == 1 ? ".." : std::string("f").append(std::to_string(Index));
+			entry.Size = 1ull << 40 | Index;
+			entry.LastWriteTime = 123456789012345ull;
+			Index++;
+			return true;
+		}
+	};
+}
+
+TEST(FolderSnapshot, CapturesAndRoundTrips)
+{
+	std::atomic<bool> cancelled{ false };
+	TestSource source;
+	FolderSnapshot snapshot;
+	snapshot.Folder = "C:\\x";
+	snapshot.FolderLastWriteTime = 7;
+	snapshot.CaptureTime = 9;
+	REQUIRE(snapshot.Capture(source, cancelled));
+	CHECK(snapshot.Entries.size() == 3);
+
+	FolderSnapshot decoded;
+	REQUIRE(FolderSnapshot::Decode(snapshot.Encode(), decoded));
+	CHECK(decoded.Folder == "C:\\x");
+	CHECK(decoded.FolderLastWriteTime == 7);
+	CHECK(decoded.CaptureTime == 9);
+	REQUIRE(decoded.Entries.size() == 3);
+	CHECK(decoded.Entries[0].Size == (1ull << 40 | 2));
+	CHECK(decoded.Entries[1].LastWriteTime == 123456789012345ull);
+	CHECK(decoded.Entries[2].Name == "f4");
+}
+
+TEST(FolderSnapshot, RejectsDamagedSnapshots)
+{
+	std::atomic<bool> cancelled{ false };
+	TestSource source;
+	FolderSnapshot snapshot;
+	snapshot.Folder = "C:\\x";
+	REQUIRE(snapshot.Capture(source, cancelled));
+
+	std::string encoded = snapshot.Encode();
+	FolderSnapshot decoded;
+	for (std::size_t size = 0; size < encoded.size(); size++)
+		CHECK(!FolderSnapshot::Decode(encoded.substr(0, size), decoded));
+
+	std::string version = encoded;
+	version[4] = 2;
+	CHECK(!FolderSnapshot::Decode(version, decoded));
+}
+
+TEST(FolderSnapshot, StopsWhenCancelled)
+{
+	std::atomic<bool> cancelled{ true };
+	TestSource source;
+	FolderSnapshot snapshot;
+	CHECK(!snapshot.Capture(source, cancelled));
+}
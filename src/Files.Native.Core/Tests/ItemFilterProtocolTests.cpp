@@ -0,0 +1,60 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "ItemFilterProtocol.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	FilterQuery GetQuery(std::uint32_t id, std::size_t count)
+	{
+		FilterQuery query;
+		query.Id = id;
+		query.Folder = "C:\\x";
+		for (std::size_t i = 0; i < count; i++)
+			query.Names.push_back(std::string("f").append(std::to_string(i)).append(".txt"));
+
+		return query;
+	}
+}
+
+TEST(ItemFilterProtocol, RoundTripsQueries)
+{
+	FilterQuery query = GetQuery(7, 130);
+	FilterQuery decoded;
+	REQUIRE(FilterQuery::Decode(query.Encode(), decoded));
+	CHECK(decoded.Id == 7);
+	CHECK(decoded.Folder == query.Folder);
+	CHECK(decoded.Names == query.Names);
+
+	std::string truncated = query.Encode();
+	truncated.pop_back();
+	CHECK(!FilterQuery::Decode(truncated, decoded));
+}
+
+TEST(ItemFilterProtocol, CachesVerdicts)
+{
+	FilterQuery query = GetQuery(7, 130);
+	FilterVerdictCache cache;
+	int calls = 0;
+	cache.Evaluate(query, [&](const std::string&, const std::string& name)
+	{
+		calls++;
+		return name.size() % 2 == 0;
+	});
+	FilterVerdicts verdicts = cache.Evaluate(query, [&](const std::string&, const std::string&)
+	{
+		calls++;
+		return false;
+	});
+	CHECK(calls == 130);
+
+	FilterVerdicts decoded;
+	REQUIRE(FilterVerdicts::Decode(verdicts.Encode(), decoded));
+	CHECK(decoded.Id == 7);
+	REQUIRE(decoded.Included.Size() == 130);
+	for (std::size_t i = 0; i < 130; i++)
+		CHECK(decoded.Included.Test(i) == (query.Names[i].size() % 2 == 0));
+}
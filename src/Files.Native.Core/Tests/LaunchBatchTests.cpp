@@ -0,0 +1,92 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include "LaunchBatch.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(LaunchBatch, ParsesLists)
+{
+	LaunchBatch batch = LaunchBatch::Parse(
+		"\xEF\xBB\xBF# comment\r\n"
+		"C:\\A\r\n"
+		"  -directory \"c:\\a\\\"\r\n"
+		"-select \"C:\\A\\f.txt\"\n"
+		"\n"
+		"shell:Downloads\n"
+		"-x\n"
+		"-SELECT C:\\B\\g\n"
+		"C:\\\"q");
+
+	REQUIRE(batch.FilesTargets.size() == 3);
+	CHECK(batch.ExplorerTargets.size() == 1);
+	CHECK(batch.Skipped == 2);
+	CHECK(!batch.FilesTargets[0].Select && batch.FilesTargets[0].Path == "C:\\A");
+	CHECK(batch.FilesTargets[1].Select && batch.FilesTargets[1].Path == "C:\\A\\f.txt");
+	CHECK(batch.FilesTargets[2].Select && batch.FilesTargets[2].Path == "C:\\B\\g");
+}
+
+TEST(LaunchBatch, GroupsCommandLines)
+{
+	LaunchBatch batch = LaunchBatch::Parse("C:\\A\n-select C:\\A\\f.txt\nC:\\B\n");
+	std::vector<std::string> commandLines = batch.BuildCommandLines("files.exe", 1000);
+	REQUIRE(commandLines.size() == 2);
+	CHECK(commandLines[0] == "\"files.exe\" -directory \"C:\\A\" \"C:\\B\"");
+	CHECK(commandLines[1] == "\"files.exe\" -select \"C:\\A\\f.txt\"");
+
+	// Every target still goes somewhere, even past the limit
+	commandLines = batch.BuildCommandLines("files.exe", 40);
+	std::size_t quotes = 0;
+	for (const std::string& commandLine : commandLines)
+		quotes += std::count(commandLine.begin(), commandLine.end(), '"');
+	CHECK(commandLines.size() > 1);
+	CHECK(quotes == commandLines.size() * 2 + 6);
+}
+
+TEST(LaunchBatch, SplitsLargeLists)
+{
+	std::string list;
+	for (int i = 0; i < 10000; i++)
+		list += (i % 3 ? "C:\\Data\\" : "-select C:\\Data\\f") + std::to_string(i) + "\n";
+
+	LaunchBatch batch = LaunchBatch::Parse(list);
+	CHECK(batch.FilesTargets.size() == 10000);
+
+	std::size_t targets = 0;
+	for (const std::string& commandLine : batch.BuildCommandLines("files.exe", 8000))
+	{
+		CHECK(commandLine.size() <= 8000);
+		targets += std::count(commandLine.begin(), commandLine.end(), '"') / 2 - 1;
+	}
+	CHECK(targets == 10000);
+}
+
+TEST(LaunchBatch, GroupsExplorerTargets)
+{
+	const std::string rules = "explorer \\\\nas\\media*\n";
+	std::size_t skipped;
+	std::string image = LaunchRuleSet::Compile(rules, 1, rules.size(), skipped);
+	LaunchRuleSet ruleSet;
+	REQUIRE(ruleSet.Attach(image, 1, rules.size()));
+
+	LaunchBatch batch = LaunchBatch::Parse(
+		"-select \\\\nas\\media\\a.mkv\n"
+		"\\\\nas\\media\\Shows\n"
+		"-select \\\\NAS\\Media\\b.mkv\n"
+		"-select \\\\nas\\media\\Shows\\c.mkv\n"
+		"shell:Downloads\n"
+		"C:\\A\n", &ruleSet);
+	REQUIRE(batch.ExplorerTargets.size() == 5);
+	CHECK(batch.FilesTargets.size() == 1);
+
+	std::vector<ExplorerGroup> groups = batch.GroupExplorerTargets();
+	REQUIRE(groups.size() == 4);
+	CHECK(groups[0].Folder == "\\\\nas\\media");
+	REQUIRE(groups[0].Items.size() == 2);
+	CHECK(groups[0].Items[1] == "\\\\NAS\\Media\\b.mkv");
+	CHECK(groups[1].Folder == "\\\\nas\\media\\Shows" && groups[1].Items.empty());
+	CHECK(groups[2].Folder == "\\\\nas\\media\\Shows" && groups[2].Items.size() == 1);
+	CHECK(groups[3].Folder == "shell:Downloads" && groups[3].Items.empty());
+}
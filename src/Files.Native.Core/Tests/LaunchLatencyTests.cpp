@@ -0,0 +1,190 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "LaunchLatency.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+TEST(LaunchLatency, BucketsAreContiguous)
+{
+	for (std::uint64_t value = 0; value < 64; value++)
+	{
+		CHECK(LatencyHistogram::GetBucket(value) == value);
+		CHECK(LatencyHistogram::GetLowestValue((std::uint32_t)value) == value);
+	}
+
+	for (std::uint32_t bucket = 1; bucket < LatencyHistogram::BucketCount; bucket++)
+	{
+		std::uint64_t lowest = LatencyHistogram::GetLowestValue(bucket);
+		CHECK(lowest == LatencyHistogram::GetHighestValue(bucket - 1) + 1);
+		CHECK(LatencyHistogram::GetBucket(lowest) == bucket);
+		CHECK(LatencyHistogram::GetBucket(lowest - 1) == bucket - 1);
+	}
+
+	CHECK(LatencyHistogram::GetBucket(UINT64_MAX) == LatencyHistogram::BucketCount - 1);
+}
+
+TEST(LaunchLatency, BucketsKeepTheRelativeError)
+{
+	for (std::uint32_t bucket = 64; bucket + 1 < LatencyHistogram::BucketCount; bucket++)
+	{
+		std::uint64_t lowest = LatencyHistogram::GetLowestValue(bucket);
+		std::uint64_t width = LatencyHistogram::GetHighestValue(bucket) - lowest + 1;
+		CHECK(width * LatencyHistogram::SubBucketCount <= lowest);
+	}
+}
+
+TEST(LaunchLatency, ReportsPercentiles)
+{
+	LatencyHistogram histogram;
+	CHECK(histogram.GetPercentile(50) == 0);
+
+	for (std::uint64_t value = 1; value <= 1000; value++)
+		histogram.Record(value * 1000);
+
+	CHECK(histogram.GetCount() == 1000);
+	CHECK(histogram.GetMax() == 1000000);
+	CHECK(histogram.GetMean() == 500500);
+
+	// Within a bucket of the exact value, and never under it
+	std::uint64_t p50 = histogram.GetPercentile(50);
+	std::uint64_t p99 = histogram.GetPercentile(99);
+	CHECK(p50 >= 500000 && p50 <= 500000 + 500000 / LatencyHistogram::SubBucketCount);
+	CHECK(p99 >= 990000 && p99 <= 990000 + 990000 / LatencyHistogram::SubBucketCount);
+	CHECK(histogram.GetPercentile(100) == 1000000);
+	CHECK(histogram.GetPercentile(0) <= 1000 + 1000 / LatencyHistogram::SubBucketCount);
+}
+
+TEST(LaunchLatency, MergesLikeOneHistogram)
+{
+	LatencyHistogram all, first, second;
+	for (std::uint64_t value = 0; value < 5000; value++)
+	{
+		std::uint64_t latency = value * value % 7919 * 131;
+		all.Record(latency);
+		(value % 3 ? first : second).Record(latency);
+	}
+
+	first.Merge(second);
+	CHECK(first.GetCount() == all.GetCount());
+	CHECK(first.GetTotal() == all.GetTotal());
+	CHECK(first.GetMax() == all.GetMax());
+	for (std::uint32_t bucket = 0; bucket < LatencyHistogram::BucketCount; bucket++)
+		CHECK(first.GetBucketCount(bucket) == all.GetBucketCount(bucket));
+}
+
+TEST(LaunchLatency, StoreKeepsOutcomesApart)
+{
+	std::vector<char> region(LaunchLatencyStore::RequiredSize, 0);
+	LaunchLatencyStore store(region.data(), region.size());
+	REQUIRE(store.IsValid());
+
+	store.Record(LaunchOutcome::FilesDirectory, 250000);
+	store.Record(LaunchOutcome::FilesDirectory, 350000);
+	store.Record(LaunchOutcome::ExplorerWindow, 40000);
+	store.Record(LaunchOutcome::Count, 1);
+
+	LatencyHistogram directory = store.Read(LaunchOutcome::FilesDirectory);
+	CHECK(directory.GetCount() == 2);
+	CHECK(directory.GetTotal() == 600000);
+	CHECK(directory.GetMax() == 350000);
+	CHECK(store.Read(LaunchOutcome::ExplorerWindow).GetCount() == 1);
+	CHECK(store.Read(LaunchOutcome::FilesSelect).GetCount() == 0);
+	CHECK(store.Read(LaunchOutcome::Uninstall).GetCount() == 0);
+
+	// The dialogs' activations go to the same store under their own outcomes
+	store.Record(LaunchOutcome::DialogAcknowledged, 1200000);
+	CHECK(store.Read(LaunchOutcome::DialogAcknowledged).GetMax() == 1200000);
+	CHECK(store.Read(LaunchOutcome::DialogTimedOut).GetCount() == 0);
+	for (int outcome = 0; outcome < (int)LaunchOutcome::Count; outcome++)
+		CHECK(GetLaunchOutcomeName((LaunchOutcome)outcome) != "unknown");
+
+	// Attaching again, as the next launcher does, keeps what is there
+	LaunchLatencyStore next(region.data(), region.size());
+	REQUIRE(next.IsValid());
+	CHECK(next.Read(LaunchOutcome::FilesDirectory).GetCount() == 2);
+}
+
+TEST(LaunchLatency, StoresMergeAcrossMachines)
+{
+	std::vector<char> first(LaunchLatencyStore::RequiredSize, 0), second(LaunchLatencyStore::RequiredSize, 0);
+	LaunchLatencyStore a(first.data(), first.size()), b(second.data(), second.size());
+	LatencyHistogram expected;
+	for (std::uint64_t i = 0; i < 300; i++)
+	{
+		std::uint64_t latency = 1000 + i * 997;
+		(i % 2 ? a : b).Record(LaunchOutcome::FilesSelect, latency);
+		expected.Record(latency);
+	}
+
+	b.Record(LaunchOutcome::Uninstall, 5000000);
+	a.Merge(b);
+
+	LatencyHistogram select = a.Read(LaunchOutcome::FilesSelect);
+	CHECK(select.GetCount() == expected.GetCount());
+	CHECK(select.GetTotal() == expected.GetTotal());
+	CHECK(select.GetPercentile(99) == expected.GetPercentile(99));
+	CHECK(a.Read(LaunchOutcome::Uninstall).GetMax() == 5000000);
+
+	// The merged store reads back from its bytes alone
+	std::vector<char> copy(first);
+	CHECK(LaunchLatencyStore(copy.data(), copy.size()).Read(LaunchOutcome::FilesSelect).GetPercentile(50) == expected.GetPercentile(50));
+}
+
+TEST(LaunchLatency, RejectsForeignRegions)
+{
+	std::vector<char> region(LaunchLatencyStore::RequiredSize, 0);
+	region[0] = 1;
+	CHECK(!LaunchLatencyStore(region.data(), region.size()).IsValid());
+
+	std::vector<char> other(LaunchLatencyStore::RequiredSize, 0);
+	REQUIRE(LaunchLatencyStore(other.data(), other.size()).IsValid());
+	((LaunchLatencyStore::Header*)other.data())->BucketCount = 512;
+	CHECK(!LaunchLatencyStore(other.data(), other.size()).IsValid());
+
+	std::vector<char> small(LaunchLatencyStore::RequiredSize - 1, 0);
+	CHECK(!LaunchLatencyStore(small.data(), small.size()).IsValid());
+}
+
+TEST(LaunchLatency, LockedUpdatesAddUp)
+{
+	std::vector<char> region(LaunchLatencyStore::RequiredSize, 0);
+	std::mutex lock;
+
+	// One store per thread over the same region, as one per launcher over the mapping
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (int i = 0; i < 2000; i++)
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				LaunchLatencyStore store(region.data(), region.size());
+				store.Record((LaunchOutcome)(t % (int)LaunchOutcome::Count), 100 + i);
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	LaunchLatencyStore store(region.data(), region.size());
+	std::uint64_t count = 0;
+	for (int outcome = 0; outcome < (int)LaunchOutcome::Count; outcome++)
+	{
+		LatencyHistogram histogram = store.Read((LaunchOutcome)outcome);
+		std::uint64_t buckets = 0;
+		for (std::uint32_t bucket = 0; bucket < LatencyHistogram::BucketCount; bucket++)
+			buckets += histogram.GetBucketCount(bucket);
+
+		CHECK(buckets == histogram.GetCount());
+		count += histogram.GetCount();
+	}
+
+	CHECK(count == 8 * 2000);
+}
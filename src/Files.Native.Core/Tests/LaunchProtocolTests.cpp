@@ -0,0 +1,69 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <thread>
+#include "LaunchProtocol.h"
+#include "Tests/Test.h"
+#include "Tests/TestPipe.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Tests;
+
+TEST(LaunchProtocol, RoundTripsRequests)
+{
+	auto [client, server] = TestPipe::Create();
+	std::thread instance([&server]()
+	{
+		// Stand-in for a running Files: takes activations, declines the rest
+		LaunchRequestKind kind;
+		std::string payload;
+		while (LaunchProtocol::Receive(server, kind, payload))
+			LaunchProtocol::Reply(server, kind == LaunchRequestKind::Activate && !payload.empty() ? LaunchStatus::Accepted : LaunchStatus::Declined);
+	});
+
+	CHECK(LaunchProtocol::Send(client, LaunchRequestKind::Activate, "\"Files.exe\" -directory \"C:\\\xE6\x96\x87\"") == LaunchStatus::Accepted);
+	CHECK(LaunchProtocol::Send(client, LaunchRequestKind::Activate, "") == LaunchStatus::Declined);
+	CHECK(LaunchProtocol::Send(client, LaunchRequestKind::AmendSelection, "C:\\a\\b.txt") == LaunchStatus::Declined);
+
+	client.Close();
+	instance.join();
+	CHECK(LaunchProtocol::Send(client, LaunchRequestKind::Activate, "x") == LaunchStatus::Unreachable);
+}
+
+TEST(LaunchProtocol, DecodesRequests)
+{
+	std::string request = LaunchProtocol::EncodeRequest(LaunchRequestKind::AmendSelection, "C:\\a\\b.txt");
+	CHECK(request.size() == LaunchProtocol::HeaderSize + 10);
+
+	LaunchRequestKind kind;
+	std::uint32_t payloadSize;
+	CHECK(LaunchProtocol::DecodeHeader(request.substr(0, LaunchProtocol::HeaderSize), kind, payloadSize));
+	CHECK(kind == LaunchRequestKind::AmendSelection && payloadSize == 10);
+}
+
+TEST(LaunchProtocol, RejectsForeignRequests)
+{
+	LaunchRequestKind kind;
+	std::uint32_t payloadSize;
+	std::string header = LaunchProtocol::EncodeRequest(LaunchRequestKind::Activate, "").substr(0, LaunchProtocol::HeaderSize);
+
+	std::string version = header;
+	version[4] = 1;
+	CHECK(!LaunchProtocol::DecodeHeader(version, kind, payloadSize));
+
+	std::string unknownKind = header;
+	unknownKind[8] = 9;
+	CHECK(!LaunchProtocol::DecodeHeader(unknownKind, kind, payloadSize));
+
+	std::string oversized = header;
+	oversized[14] = 0x7F;
+	CHECK(!LaunchProtocol::DecodeHeader(oversized, kind, payloadSize));
+
+	// A client gone before sending the whole payload
+	auto [client, server] = TestPipe::Create();
+	std::string request = LaunchProtocol::EncodeRequest(LaunchRequestKind::Activate, "\"Files.exe\"");
+	client.Write(request.data(), request.size() - 1);
+	client.Close();
+	std::string payload;
+	CHECK(!LaunchProtocol::Receive(server, kind, payload));
+}
@@ -0,0 +1,120 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "LaunchRules.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+using namespace std::literals;
+
+namespace
+{
+	const std::string Rules =
+		"\xEF\xBB\xBF# comment\n"
+		"explorer \\\\nas\\media\r\n"
+		"files \\\\nas\\media\\public\n"
+		"explorer \\\\wsl.localhost\\\n"
+		"explorer \\\\wsl$*\n"
+		"explorer shell:::{21EC2020-3AEA-1069-A2DD-08002B30309D}\n"
+		"files C:/Users/\xC3\x9Cn\xC3\xAF" "code\n"
+		"bogus line\n"
+		"explorer\n"
+		"files *\n";
+
+	// 'E' for File Explorer, 'F' for Files, '-' when no rule matches
+	template <typename Path>
+	char Match(const LaunchRuleSet& rules, Path path)
+	{
+		auto route = rules.Match(path);
+		return route ? (*route == LaunchRoute::Explorer ? 'E' : 'F') : '-';
+	}
+}
+
+TEST(LaunchRules, RoutesBuiltInLocations)
+{
+	CHECK(GetLaunchRoute("C:\\x"sv) == LaunchRoute::Files);
+	CHECK(GetLaunchRoute("shell:MyComputerFolder"sv) == LaunchRoute::Files);
+	CHECK(GetLaunchRoute("shell:mycomputerfolder"sv) == LaunchRoute::Files);
+	CHECK(GetLaunchRoute("shell:Downloads"sv) == LaunchRoute::Explorer);
+	CHECK(GetLaunchRoute("::{20D04FE0-3AEA-1069-A2D8-08002B30309D}"sv) == LaunchRoute::Files);
+	CHECK(GetLaunchRoute("::{26EE0668-A00A-44D7-9371-BEB064C98683}"sv) == LaunchRoute::Explorer);
+	CHECK(GetLaunchRoute("C:\\x.{ED7BA470-8E54-465E-825C-99712043E01C}"sv) == LaunchRoute::Explorer);
+	CHECK(GetLaunchRoute(L"shell:::{645FF040-5081-101B-9F08-00AA002F954E}"sv) == LaunchRoute::Files);
+}
+
+TEST(LaunchRules, CompilesRules)
+{
+	std::size_t skipped;
+	std::string image = LaunchRuleSet::Compile(Rules, 7, Rules.size(), skipped);
+	CHECK(skipped == 3);
+
+	LaunchRuleSet rules;
+	CHECK(!rules.Attach(image, 8, Rules.size()));
+	REQUIRE(rules.Attach(image, 7, Rules.size()));
+	CHECK(rules.GetRuleCount() == 6);
+}
+
+TEST(LaunchRules, MatchesLongestPrefix)
+{
+	std::size_t skipped;
+	std::string image = LaunchRuleSet::Compile(Rules, 7, Rules.size(), skipped);
+	LaunchRuleSet rules;
+	REQUIRE(rules.Attach(image, 7, Rules.size()));
+
+	CHECK(Match(rules, "\\\\NAS\\Media"sv) == 'E');
+	CHECK(Match(rules, L"\\\\nas\\media\\x"sv) == 'E');
+	CHECK(Match(rules, "//nas/media/"sv) == 'E');
+	CHECK(Match(rules, "\\\\nas\\mediaplayer"sv) == '-');
+	CHECK(Match(rules, "\\\\nas\\media\\public\\a"sv) == 'F');
+	CHECK(Match(rules, "\\\\nas\\media\\publicity"sv) == 'E');
+	CHECK(Match(rules, "\\\\wsl.localhost"sv) == '-');
+	CHECK(Match(rules, L"\\\\wsl.localhost\\Ubuntu"sv) == 'E');
+	CHECK(Match(rules, "\\\\wsl$\\Ubuntu"sv) == 'E');
+	CHECK(Match(rules, "\\\\wsl$"sv) == 'E');
+	CHECK(Match(rules, L"::{21EC2020-3AEA-1069-A2DD-08002B30309D}"sv) == 'E');
+	CHECK(Match(rules, L"shell:::{21ec2020-3aea-1069-a2dd-08002b30309d}\\x"sv) == 'E');
+	CHECK(Match(rules, L"c:\\users\\\u00DCn\u00EFcode\\Docs"sv) == 'F');
+	CHECK(Match(rules, u"c:\\users\\\u00DCn\u00EFcode"sv) == 'F');
+	CHECK(Match(rules, "c:\\users\\\xC3\x9Cn\xC3\xAF" "code"sv) == 'F');
+	// Only ASCII is case-insensitive
+	CHECK(Match(rules, L"c:\\users\\\u00FCn\u00EFcode"sv) == '-');
+	CHECK(Match(rules, L"C:\\Windows"sv) == '-');
+	CHECK(Match(rules, u"\xD800"sv) == '-');
+
+	CHECK(GetLaunchRoute("C:\\Windows"sv, &rules) == LaunchRoute::Files);
+	CHECK(GetLaunchRoute("\\\\nas\\media"sv, &rules) == LaunchRoute::Explorer);
+	CHECK(GetLaunchRoute("::{20D04FE0-3AEA-1069-A2D8-08002B30309D}"sv, (const LaunchRuleSet*)nullptr) == LaunchRoute::Files);
+}
+
+TEST(LaunchRules, AttachesEmptyRules)
+{
+	std::size_t skipped;
+	std::string image = LaunchRuleSet::Compile("# none\n", 0, 7, skipped);
+	LaunchRuleSet rules;
+	REQUIRE(rules.Attach(image, 0, 7));
+	CHECK(rules.GetRuleCount() == 0);
+	CHECK(!rules.Match("x"sv));
+}
+
+TEST(LaunchRules, SurvivesDamagedImages)
+{
+	std::size_t skipped;
+	std::string image = LaunchRuleSet::Compile(Rules, 7, Rules.size(), skipped);
+	for (std::size_t i = 0; i < image.size(); i++)
+	{
+		for (int bits : { 0x01, 0x80, 0xFF })
+		{
+			std::string damaged = image;
+			damaged[i] ^= (char)bits;
+			LaunchRuleSet rules;
+			if (rules.Attach(damaged, 7, Rules.size()))
+			{
+				rules.Match("\\\\nas\\media\\public\\a"sv);
+				rules.Match(L"\\\\wsl$\\x"sv);
+			}
+		}
+
+		LaunchRuleSet truncated;
+		CHECK(!truncated.Attach(std::string_view(image).substr(0, i), 7, Rules.size()));
+	}
+}
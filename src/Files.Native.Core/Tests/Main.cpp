@@ -0,0 +1,50 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Runs the tests of the suites named on the command line, or all of them.
+
+#include <cstring>
+#include <exception>
+#include "Tests/Test.h"
+
+using namespace Files::Native::Tests;
+
+int main(int argc, char** argv)
+{
+	int run = 0;
+	for (const TestCase& testCase : GetTestCases())
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc && !selected; i++)
+			selected = std::strcmp(argv[i], testCase.Suite) == 0;
+		if (!selected)
+			continue;
+
+		int failures = GetFailureCount();
+		try
+		{
+			testCase.Run();
+		}
+		catch (const RequireFailed&)
+		{
+		}
+		catch (const std::exception& ex)
+		{
+			std::fprintf(stderr, "%s.%s: unexpected exception: %s\n", testCase.Suite, testCase.Name, ex.what());
+			GetFailureCount()++;
+		}
+
+		std::printf("%s %s.%s\n", GetFailureCount() == failures ? "[ OK ]" : "[FAIL]", testCase.Suite, testCase.Name);
+		run++;
+	}
+
+	if (run == 0)
+	{
+		std::fprintf(stderr, "No tests selected\n");
+		return 1;
+	}
+
+	std::printf("%d tests, %d failed checks\n", run, GetFailureCount());
+	return GetFailureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <string>
+#include "PeImage.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	// A two section image: headers, then .text, then .idata holding the import and the
+	// delay import tables, laid out the way link.exe lays them out
+	class PeBuilder
+	{
+		std::string _file;
+		bool _is64Bit;
+
+	public:
+		static constexpr std::uint32_t PeOffset = 0x80;
+		static constexpr std::uint32_t TextRva = 0x1000;
+		static constexpr std::uint32_t DataRva = 0x2000;
+		static constexpr std::uint32_t DataOffset = 0x600;
+
+		explicit PeBuilder(bool is64Bit) :
+			_file(0x1000, '\0'),
+			_is64Bit(is64Bit)
+		{
+			std::uint32_t optional = PeOffset + 24;
+			std::uint16_t optionalSize = is64Bit ? 240 : 224;
+			std::uint32_t directories = optional + (is64Bit ? 112 : 96);
+
+			Put16(0, 0x5A4D);
+			Put32(0x3C, PeOffset);
+			Put32(PeOffset, 0x00004550);
+			Put16(PeOffset + 4, is64Bit ? 0x8664 : 0x14C);
+			Put16(PeOffset + 6, 2);
+			Put16(PeOffset + 20, optionalSize);
+			Put16(optional, is64Bit ? PeImage::Pe32PlusMagic : PeImage::Pe32Magic);
+			if (is64Bit)
+				Put64(optional + 24, 0x180000000);
+			else
+				Put32(optional + 28, 0x10000000);
+			Put32(optional + 56, 0x3000);
+			Put32(optional + (is64Bit ? 108 : 92), 16);
+			Put32(directories + 1 * 8, DataRva);
+			Put32(directories + 13 * 8, DataRva + 0x100);
+
+			std::uint32_t sections = optional + optionalSize;
+			Section(sections, ".text", TextRva, 0x180, 0x400, 0x200);
+			Section(sections + 40, ".idata", DataRva, 0x800, DataOffset, 0x800);
+		}
+
+		// Imports of a library, the name and thunks placed at the given offsets into .idata
+		void Import(std::uint32_t index, std::string_view library, std::uint32_t functions, std::uint32_t at)
+		{
+			std::uint32_t descriptor = DataOffset + index * 20;
+			Put32(descriptor, DataRva + at);
+			Put32(descriptor + 12, DataRva + at + 0x80);
+			Put32(descriptor + 16, DataRva + at);
+			Thunks(at, functions);
+			_file.replace(DataOffset + at + 0x80, library.size(), library);
+		}
+
+		void DelayImport(std::uint32_t index, std::string_view library, std::uint32_t functions, std::uint32_t at)
+		{
+			std::uint32_t descriptor = DataOffset + 0x100 + index * 32;
+			Put32(descriptor, 1);
+			Put32(descriptor + 4, DataRva + at + 0x80);
+			Put32(descriptor + 16, DataRva + at);
+			Thunks(at, functions);
+			_file.replace(DataOffset + at + 0x80, library.size(), library);
+		}
+
+		std::string& File()
+		{
+			return _file;
+		}
+
+		void Put16(std::size_t offset, std::uint16_t value)
+		{
+			Put(offset, value, 2);
+		}
+
+		void Put32(std::size_t offset, std::uint32_t value)
+		{
+			Put(offset, value, 4);
+		}
+
+		void Put64(std::size_t offset, std::uint64_t value)
+		{
+			Put(offset, value, 8);
+		}
+
+	private:
+		void Put(std::size_t offset, std::uint64_t value, std::size_t size)
+		{
+			for (std::size_t i = 0; i < size; i++)
+				_file[offset + i] = (char)(value >> (8 * i));
+		}
+
+		void Section(std::uint32_t header, std::string_view name, std::uint32_t rva, std::uint32_t virtualSize, std::uint32_t offset, std::uint32_t size)
+		{
+			_file.replace(header, name.size(), name);
+			Put32(header + 8, virtualSize);
+			Put32(header + 12, rva);
+			Put32(header + 16, size);
+			Put32(header + 20, offset);
+		}
+
+		// Imports by name, each thunk pointing at a hint/name entry further in .idata
+		void Thunks(std::uint32_t at, std::uint32_t count)
+		{
+			for (std::uint32_t i = 0; i < count; i++)
+			{
+				if (_is64Bit)
+					Put64(DataOffset + at + i * 8, DataRva + 0x700);
+				else
+					Put32(DataOffset + at + i * 4, DataRva + 0x700);
+			}
+		}
+	};
+}
+
+TEST(PeImage, ReadsHeadersAndSections)
+{
+	for (bool is64Bit : { true, false })
+	{
+		PeBuilder builder(is64Bit);
+		PeImage image;
+		REQUIRE(PeImage::Parse(builder.File(), image));
+
+		CHECK(image.Is64Bit == is64Bit);
+		CHECK(image.Machine == (is64Bit ? 0x8664 : 0x14C));
+		CHECK(image.ImageBase == (is64Bit ? 0x180000000 : 0x10000000));
+		CHECK(image.SizeOfImage == 0x3000);
+		CHECK(image.FileSize == 0x1000);
+		REQUIRE(image.Sections.size() == 2);
+		CHECK(image.Sections[0].Name == ".text");
+		CHECK(image.Sections[0].VirtualSize == 0x180);
+		CHECK(image.Sections[1].Name == ".idata");
+		CHECK(image.Sections[1].RawOffset == PeBuilder::DataOffset);
+		CHECK(image.Imports.empty());
+	}
+}
+
+TEST(PeImage, CountsImportsAndDelayImports)
+{
+	for (bool is64Bit : { true, false })
+	{
+		PeBuilder builder(is64Bit);
+		builder.Import(0, "KERNEL32.dll", 12, 0x200);
+		builder.Import(1, "ole32.dll", 3, 0x300);
+		builder.DelayImport(0, "SHELL32.dll", 5, 0x400);
+		builder.DelayImport(1, "SHLWAPI.dll", 1, 0x500);
+
+		PeImage image;
+		REQUIRE(PeImage::Parse(builder.File(), image));
+		REQUIRE(image.Imports.size() == 4);
+		CHECK(image.Imports[0].Library == "KERNEL32.dll");
+		CHECK(image.Imports[0].FunctionCount == 12);
+		CHECK(!image.Imports[0].Delayed);
+		CHECK(image.Imports[2].Library == "SHELL32.dll");
+		CHECK(image.Imports[2].Delayed);
+
+		CHECK(image.GetLibraryCount(false) == 2);
+		CHECK(image.GetFunctionCount(false) == 15);
+		CHECK(image.GetLibraryCount(true) == 2);
+		CHECK(image.GetFunctionCount(true) == 6);
+	}
+}
+
+TEST(PeImage, RejectsDamagedImages)
+{
+	PeImage image;
+	CHECK(!PeImage::Parse("", image));
+	CHECK(!PeImage::Parse("MZ", image));
+
+	PeBuilder signature(true);
+	signature.Put32(PeBuilder::PeOffset, 0);
+	CHECK(!PeImage::Parse(signature.File(), image));
+
+	PeBuilder magic(true);
+	magic.Put16(PeBuilder::PeOffset + 24, 0x107);
+	CHECK(!PeImage::Parse(magic.File(), image));
+
+	// Sections past the end of the file
+	PeBuilder sections(true);
+	sections.Put16(PeBuilder::PeOffset + 6, 200);
+	CHECK(!PeImage::Parse(sections.File(), image));
+
+	// A library name outside of every section
+	PeBuilder name(true);
+	name.Import(0, "KERNEL32.dll", 1, 0x200);
+	name.Put32(PeBuilder::DataOffset + 12, 0x9000);
+	CHECK(!PeImage::Parse(name.File(), image));
+
+	// A name table running off the end of the file
+	PeBuilder thunks(true);
+	thunks.Import(0, "KERNEL32.dll", 1, 0x200);
+	thunks.Put32(PeBuilder::DataOffset, PeBuilder::DataRva + 0x7F8);
+	thunks.Put64(PeBuilder::DataOffset + 0x7F8, PeBuilder::DataRva + 0x700);
+	thunks.File().resize(PeBuilder::DataOffset + 0x800);
+	CHECK(!PeImage::Parse(thunks.File(), image));
+}
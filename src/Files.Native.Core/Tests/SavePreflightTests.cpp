@@ -0,0 +1,94 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <thread>
+#include "SavePreflight.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	// Answers with fixed facts, after a delay to stand in for slow storage
+	struct TestStorage
+	{
+		std::chrono::milliseconds Delay{ 0 };
+		SaveTargetFacts Facts;
+		std::optional<std::uint64_t> Free = 100;
+		std::uint32_t CreateError = 0;
+		int Calls = 0;
+
+		SaveTargetFacts Stat(const std::wstring&)
+		{
+			Calls++;
+			std::this_thread::sleep_for(Delay);
+			return Facts;
+		}
+
+		std::optional<std::uint64_t> FreeBytes(const std::wstring&)
+		{
+			Calls++;
+			return Free;
+		}
+
+		std::uint32_t OpenForWrite(const std::wstring&)
+		{
+			Calls++;
+			return 0;
+		}
+
+		std::uint32_t Create(const std::wstring&, bool)
+		{
+			Calls++;
+			return CreateError;
+		}
+	};
+}
+
+TEST(SavePreflight, ReportsStorageIssues)
+{
+	TestStorage storage;
+	storage.CreateError = 5;
+	SavePreflightReport report = SavePreflight::Run(storage, L"C:\\a.txt", {});
+	CHECK(report.Status == SavePreflightStatus::AccessDenied);
+	CHECK(report.Error == 5);
+	CHECK(storage.Calls == 3);
+
+	storage.Free = 0;
+	CHECK(SavePreflight::Run(storage, L"C:\\a.txt", {}).Status == SavePreflightStatus::DiskFull);
+
+	storage.Facts.Exists = true;
+	CHECK(SavePreflight::Run(storage, L"C:\\a.txt", {}).Status == SavePreflightStatus::Ready);
+}
+
+TEST(SavePreflight, FollowsDialogOptions)
+{
+	TestStorage storage;
+	storage.Facts.Exists = true;
+	storage.Facts.ReadOnly = true;
+	CHECK(SavePreflight::Run(storage, L"C:\\a.txt", {}).Status == SavePreflightStatus::Ready);
+
+	SavePreflightOptions options = SavePreflightOptions::FromDialogOptions(DialogOptions::NoReadOnlyReturn | DialogOptions::NoTestFileCreate);
+	CHECK(SavePreflight::Run(storage, L"C:\\a.txt", options).Status == SavePreflightStatus::ReadOnly);
+
+	// Nothing is created or opened
+	storage.Facts.ReadOnly = false;
+	storage.Calls = 0;
+	CHECK(SavePreflight::Run(storage, L"C:\\a.txt", options).Status == SavePreflightStatus::Ready);
+	CHECK(storage.Calls == 1);
+
+	storage.Facts.IsDirectory = true;
+	CHECK(SavePreflight::Run(storage, L"C:\\a", {}).Status == SavePreflightStatus::IsFolder);
+
+	TestStorage missing;
+	missing.Free.reset();
+	CHECK(SavePreflight::Run(missing, L"C:\\x\\a.txt", {}).Status == SavePreflightStatus::ParentMissing);
+
+	CHECK(SavePreflightOptions::FromDialogOptions(DialogOptions::CreatePrompt).KeepPlaceholder);
+}
+
+TEST(SavePreflight, GetsParent)
+{
+	CHECK(SavePreflight::GetParent(L"C:\\x\\y.txt") == L"C:\\x");
+	CHECK(SavePreflight::GetParent(L"\\\\srv\\share\\y") == L"\\\\srv\\share");
+}
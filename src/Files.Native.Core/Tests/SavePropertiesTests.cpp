@@ -0,0 +1,122 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include <map>
+#include <memory>
+#include "SaveProperties.h"
+#include "Tests/Test.h"
+#include "Tests/TestPropertyStores.h"
+
+using namespace Files::Native;
+using namespace Files::Native::Tests;
+
+namespace
+{
+	using Cache = BasicSavePropertyCache<TestPropertyStores>;
+
+	TestPropertyStores::Store GetHostStore()
+	{
+		return std::make_shared<std::map<std::string, std::string>>(std::map<std::string, std::string>{
+			{ "System.Title", "Quarterly Report" }, { "System.Author", "User" }, { "System.Keywords", "finance" } });
+	}
+}
+
+TEST(SaveProperties, HandsOutOneStorePerShow)
+{
+	Cache cache;
+	TestPropertyStores::Store first, second;
+	REQUIRE(cache.Get(first) == 0);
+	REQUIRE(cache.Get(second) == 0);
+	CHECK(first == second);
+
+	// What the host sets is there on the next call, and gone on the next Show()
+	(*first)["System.Comment"] = "Draft";
+	cache.Get(second);
+	CHECK(second->count("System.Comment") == 1);
+
+	cache.Reset();
+	cache.Get(second);
+	CHECK(second != first);
+	CHECK(second->empty());
+}
+
+TEST(SaveProperties, CopiesDefaults)
+{
+	Cache cache;
+	TestPropertyStores::Store host = GetHostStore();
+	REQUIRE(cache.SetDefaults(host) == 0);
+	(*host)["System.Title"] = "Changed";
+
+	TestPropertyStores::Store store;
+	REQUIRE(cache.Get(store) == 0);
+	CHECK(store->size() == 3);
+	CHECK(store->at("System.Title") == "Quarterly Report");
+	CHECK(store != host);
+}
+
+TEST(SaveProperties, KeepsCollectedProperties)
+{
+	Cache cache;
+	cache.SetDefaults(GetHostStore());
+
+	TestPropertyStores::Store store;
+	cache.Get(store);
+	(*store)["System.Comment"] = "Draft";
+
+	// A new list starts the store over
+	cache.SetCollected(std::make_shared<std::vector<std::string>>(std::vector<std::string>{ "System.Title", "System.Keywords", "System.Rating" }));
+	cache.Get(store);
+	CHECK(store->size() == 2);
+	CHECK(store->count("System.Title") == 1);
+	CHECK(store->count("System.Author") == 0);
+	CHECK(store->count("System.Comment") == 0);
+}
+
+TEST(SaveProperties, PutsDefaultsOverItem)
+{
+	Cache cache;
+	cache.SetDefaults(GetHostStore());
+
+	int loads = 0;
+	auto loadItem = [&]()
+	{
+		loads++;
+		return std::make_shared<std::map<std::string, std::string>>(std::map<std::string, std::string>{
+			{ "System.Title", "Old Report" }, { "System.Rating", "5" }, { "System.Size", "1024" } });
+	};
+
+	TestPropertyStores::Store store;
+	REQUIRE(cache.Get(store, loadItem) == 0);
+	CHECK(store->size() == 5);
+	CHECK(store->at("System.Title") == "Quarterly Report");
+	CHECK(store->at("System.Rating") == "5");
+
+	// Loaded once per Show()
+	cache.Get(store, loadItem);
+	CHECK(loads == 1);
+
+	cache.SetCollected(std::make_shared<std::vector<std::string>>(std::vector<std::string>{ "System.Title", "System.Rating" }));
+	cache.Get(store, loadItem);
+	CHECK(loads == 2);
+	CHECK(store->size() == 2);
+	CHECK(store->at("System.Title") == "Quarterly Report");
+	CHECK(store->at("System.Rating") == "5");
+
+	// A new item has nothing yet
+	cache.Reset();
+	cache.Get(store, []() { return TestPropertyStores::Store(); });
+	CHECK(store->size() == 1);
+	CHECK(store->count("System.Rating") == 0);
+}
+
+TEST(SaveProperties, ReportsFailures)
+{
+	TestPropertyStores stores;
+	stores.FailCreate = true;
+	Cache cache(stores);
+
+	TestPropertyStores::Store store;
+	CHECK(cache.Get(store) == TestPropertyStores::OutOfMemory);
+	CHECK(!store);
+	CHECK(cache.SetDefaults(GetHostStore()) == TestPropertyStores::OutOfMemory);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+#include "ShellLocationCache.h"
+#include "Tests/Test.h"
+
+using namespace Files::Native;
+using namespace std::literals;
+
+namespace
+{
+	const std::string ControlPanel = "::{26ee0668-a00a-44d7-9371-beb064c98683}";
+	const std::string IdList("\x14\0AAAAAAAAAAAAAAAAAA\0\0", 22);
+	const std::string EmptyIdList("\0\0", 2);
+
+	std::string GetEncodedCache()
+	{
+		ShellLocationCache cache;
+		cache.OsBuild = 26100;
+		cache.OsRevision = 4351;
+		cache.User = "S-1-5-21-1";
+		cache.Add(ControlPanel, IdList);
+		for (int i = 0; i < 70; i++)
+			cache.Add(std::string("k").append(std::to_string(i)), IdList);
+		cache.Add("k10", EmptyIdList);
+
+		return cache.Encode();
+	}
+}
+
+TEST(ShellLocationCache, NormalizesKeys)
+{
+	CHECK(ShellLocationCache::GetKey(L"::{26EE0668-A00A-44D7-9371-BEB064C98683}"sv) == ControlPanel);
+	CHECK(ShellLocationCache::GetKey("Shell:::{26EE0668-A00A-44D7-9371-BEB064C98683}"sv) == ControlPanel);
+	CHECK(ShellLocationCache::GetKey("::{26EE0668-A00A-44D7-9371-BEB064C98683}\\::{21EC2020-3AEA-1069-A2DD-08002B30309D}"sv) ==
+		ControlPanel + "\\::{21ec2020-3aea-1069-a2dd-08002b30309d}");
+	CHECK(ShellLocationCache::GetKey(L"Shell:RecycleBinFolder"sv) == "shell:recyclebinfolder");
+
+	// Only virtual locations are cached
+	CHECK(ShellLocationCache::GetKey("::{26EE0668-A00A-44D7-9371-BEB064C98683}\\C:"sv).empty());
+	CHECK(ShellLocationCache::GetKey("::{26EE0668-A00A-44D7-9371-BEB064C98683}\\"sv).empty());
+	CHECK(ShellLocationCache::GetKey("C:\\Windows"sv).empty());
+	CHECK(ShellLocationCache::GetKey("shell:Downloads"sv).empty());
+	CHECK(ShellLocationCache::GetKey(L"::{26EE0668-A00A-44D7-9371-BEB064C9868\u0133}"sv).empty());
+}
+
+TEST(ShellLocationCache, ValidatesIdLists)
+{
+	CHECK(ShellLocationCache::IsValidIdList(IdList));
+	CHECK(ShellLocationCache::IsValidIdList(EmptyIdList));
+	CHECK(!ShellLocationCache::IsValidIdList(IdList.substr(0, 21)));
+	CHECK(!ShellLocationCache::IsValidIdList(std::string("\x01\0\0\0", 4)));
+}
+
+TEST(ShellLocationCache, FindsEntriesOfTheSameSystem)
+{
+	ShellLocationCache cache;
+	CHECK(cache.Add(ControlPanel, IdList));
+	CHECK(!cache.Add(ControlPanel, "xx"));
+
+	std::string encoded = GetEncodedCache();
+	CHECK(ShellLocationCache::Find(encoded, 26100, 4351, "S-1-5-21-1", "k69") == IdList);
+	CHECK(ShellLocationCache::Find(encoded, 26100, 4351, "S-1-5-21-1", "k10") == EmptyIdList);
+	// Evicted
+	CHECK(ShellLocationCache::Find(encoded, 26100, 4351, "S-1-5-21-1", ControlPanel).empty());
+	// Another update or user
+	CHECK(ShellLocationCache::Find(encoded, 26100, 4352, "S-1-5-21-1", "k69").empty());
+	CHECK(ShellLocationCache::Find(encoded, 26100, 4351, "S-1-5-21-2", "k69").empty());
+
+	ShellLocationCache decoded;
+	REQUIRE(ShellLocationCache::Decode(encoded, decoded));
+	CHECK(decoded.Entries.size() == ShellLocationCache::MaxEntries);
+	CHECK(decoded.Entries[0].Key == "k6");
+	CHECK(decoded.IsFor(26100, 4351, "S-1-5-21-1"));
+}
+
+TEST(ShellLocationCache, SurvivesDamagedCaches)
+{
+	std::string encoded = GetEncodedCache();
+	for (std::size_t size = 0; size < encoded.size(); size++)
+	{
+		ShellLocationCache decoded;
+		CHECK(!ShellLocationCache::Decode(std::string_view(encoded).substr(0, size), decoded));
+		ShellLocationCache::Find(std::string_view(encoded).substr(0, size), 26100, 4351, "S-1-5-21-1", "k69");
+	}
+
+	for (std::size_t i = 0; i < encoded.size(); i++)
+	{
+		std::string damaged = encoded;
+		damaged[i] ^= 0x5A;
+		ShellLocationCache decoded;
+		ShellLocationCache::Decode(damaged, decoded);
+		std::string_view idList = ShellLocationCache::Find(damaged, 26100, 4351, "S-1-5-21-1", "k69");
+		CHECK(idList.empty() || ShellLocationCache::IsValidIdList(idList));
+	}
+}
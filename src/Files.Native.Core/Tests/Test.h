@@ -0,0 +1,75 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Minimal test registry of the portable Files.Native.Core tests.
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace Files::Native::Tests
+{
+	struct TestCase
+	{
+		const char* Suite;
+		const char* Name;
+		void (*Run)();
+	};
+
+	inline std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	struct TestRegistration
+	{
+		TestRegistration(const char* suite, const char* name, void (*run)())
+		{
+			GetTestCases().push_back({ suite, name, run });
+		}
+	};
+
+	// Thrown by REQUIRE to leave the test, the runner moves on to the next one
+	struct RequireFailed
+	{
+	};
+
+	inline void ReportFailure(const char* file, int line, const char* expression)
+	{
+		std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+		GetFailureCount()++;
+	}
+}
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static ::Files::Native::Tests::TestRegistration suite##_##name##_registration(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+// Records the failure and carries on
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+			::Files::Native::Tests::ReportFailure(__FILE__, __LINE__, #expression); \
+	} while (false)
+
+// Records the failure and leaves the test, for what the rest of it depends on
+#define REQUIRE(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			::Files::Native::Tests::ReportFailure(__FILE__, __LINE__, #expression); \
+			throw ::Files::Native::Tests::RequireFailed(); \
+		} \
+	} while (false)
@@ -0,0 +1,103 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  ExecutorHost of the portable tests and benchmarks, standing in for the message
+//  pump. The handles it waits on are TestEvents.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "DialogExecutor.h"
+
+namespace Files::Native::Tests
+{
+	struct TestEvent
+	{
+		std::atomic<bool> IsSet{ false };
+	};
+
+	class TestExecutorHost : public ExecutorHost
+	{
+		std::mutex _mutex;
+		std::condition_variable _wake;
+		bool _woken = false;
+		std::size_t _working = 0;
+
+	public:
+		// Events are polled, setting one doesn't wake the host
+		static constexpr std::chrono::milliseconds PollInterval{ 1 };
+
+		TestExecutorHost() = default;
+		TestExecutorHost(const TestExecutorHost&) = delete;
+		TestExecutorHost& operator=(const TestExecutorHost&) = delete;
+
+		// Waits for the work given up on, which still reaches into the test
+		~TestExecutorHost()
+		{
+			std::unique_lock lock(_mutex);
+			_wake.wait(lock, [this]() { return _working == 0; });
+		}
+
+		std::size_t Wait(const std::vector<void*>& handles, std::optional<std::chrono::milliseconds> timeout) override
+		{
+			using Clock = std::chrono::steady_clock;
+			Clock::time_point deadline = timeout ? Clock::now() + *timeout : Clock::time_point::max();
+
+			std::unique_lock lock(_mutex);
+			while (true)
+			{
+				for (std::size_t i = 0; i < handles.size(); i++)
+				{
+					if (((TestEvent*)handles[i])->IsSet)
+						return i;
+				}
+
+				if (_woken)
+				{
+					_woken = false;
+					return NoHandle;
+				}
+
+				Clock::time_point now = Clock::now();
+				if (now >= deadline)
+					return NoHandle;
+
+				if (handles.empty() && !timeout)
+					_wake.wait(lock);
+				else
+					_wake.wait_until(lock, handles.empty() ? deadline : std::min(deadline, now + PollInterval));
+			}
+		}
+
+		void Wake() override
+		{
+			std::lock_guard lock(_mutex);
+			_woken = true;
+			_wake.notify_all();
+		}
+
+		void Submit(std::function<void()> work) override
+		{
+			{
+				std::lock_guard lock(_mutex);
+				_working++;
+			}
+
+			std::thread([this, work = std::move(work)]()
+			{
+				work();
+
+				std::lock_guard lock(_mutex);
+				_working--;
+				_wake.notify_all();
+			}).detach();
+		}
+	};
+}
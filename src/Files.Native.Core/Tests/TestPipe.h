@@ -0,0 +1,94 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  In-process duplex pipe of the portable tests and benchmarks, standing in for the
+//  named pipes between the launcher or the dialogs and Files.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Files::Native::Tests
+{
+	// Bytes written to one end are read from the other. Reads block until there is
+	// enough to read, or fail once the other end is closed.
+	class TestPipe
+	{
+		struct Channel
+		{
+			std::mutex Mutex;
+			std::condition_variable Written;
+			std::string Buffer;
+			std::size_t Offset = 0;
+			bool Closed = false;
+		};
+
+		struct Shared
+		{
+			Channel Channels[2];
+		};
+
+		std::shared_ptr<Shared> _shared;
+		int _side;
+
+		TestPipe(std::shared_ptr<Shared> shared, int side) :
+			_shared(std::move(shared)),
+			_side(side)
+		{
+		}
+
+	public:
+		static std::pair<TestPipe, TestPipe> Create()
+		{
+			auto shared = std::make_shared<Shared>();
+			return { TestPipe(shared, 0), TestPipe(shared, 1) };
+		}
+
+		bool Write(const char* data, std::size_t size)
+		{
+			Channel& channel = _shared->Channels[1 - _side];
+			std::lock_guard lock(channel.Mutex);
+			if (channel.Closed)
+				return false;
+
+			channel.Buffer.append(data, size);
+			channel.Written.notify_one();
+			return true;
+		}
+
+		bool Read(char* data, std::size_t size)
+		{
+			Channel& channel = _shared->Channels[_side];
+			std::unique_lock lock(channel.Mutex);
+			channel.Written.wait(lock, [&]() { return channel.Closed || channel.Buffer.size() - channel.Offset >= size; });
+			if (channel.Buffer.size() - channel.Offset < size)
+				return false;
+
+			std::memcpy(data, channel.Buffer.data() + channel.Offset, size);
+			channel.Offset += size;
+			if (channel.Offset == channel.Buffer.size())
+			{
+				channel.Buffer.clear();
+				channel.Offset = 0;
+			}
+
+			return true;
+		}
+
+		// Fails pending and later reads on both ends, once what was written is read
+		void Close()
+		{
+			for (Channel& channel : _shared->Channels)
+			{
+				std::lock_guard lock(channel.Mutex);
+				channel.Closed = true;
+				channel.Written.notify_all();
+			}
+		}
+	};
+}
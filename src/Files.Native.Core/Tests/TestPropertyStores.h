@@ -0,0 +1,61 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  In-memory property stores of the portable tests and benchmarks, standing in for
+//  the shell's memory property stores. Keys are canonical property names.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Files::Native::Tests
+{
+	struct TestPropertyStores
+	{
+		using Store = std::shared_ptr<std::map<std::string, std::string>>;
+		using KeyList = std::shared_ptr<std::vector<std::string>>;
+		// Zero on success, like an HRESULT
+		using Status = int;
+
+		static constexpr Status OutOfMemory = -1;
+
+		bool FailCreate = false;
+
+		Status Create(Store& store)
+		{
+			if (FailCreate)
+				return OutOfMemory;
+
+			store = std::make_shared<std::map<std::string, std::string>>();
+			return 0;
+		}
+
+		Status Copy(const Store& source, const Store& target, const KeyList& keys)
+		{
+			if (!keys)
+			{
+				for (const auto& [key, value] : *source)
+					(*target)[key] = value;
+				return 0;
+			}
+
+			for (const std::string& key : *keys)
+			{
+				auto value = source->find(key);
+				if (value != source->end())
+					(*target)[key] = value->second;
+			}
+
+			return 0;
+		}
+
+		static bool Failed(Status status)
+		{
+			return status < 0;
+		}
+	};
+}
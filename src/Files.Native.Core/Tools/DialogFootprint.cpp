@@ -0,0 +1,211 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Reports what loading the dialog DLLs costs a host: image size, sections and
+//  imports on any platform, and on Windows the time loading takes, the modules it
+//  pulls in and the memory it commits.
+//
+//  Files.Native.Core.DialogFootprint <dll>... [--csv] [--loads <count>]
+//
+//  A first load pays for the libraries the process didn't have yet, so the first
+//  image passed gets the cold numbers. Run once per image to compare those.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "PeImage.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+using namespace Files::Native;
+
+namespace
+{
+	struct LoadCost
+	{
+		bool Measured = false;
+		double FirstLoad = 0;
+		double Load = 0;
+		// Mapping the image alone, without imports, relocations, initializers or DllMain
+		double Map = 0;
+		std::size_t Modules = 0;
+		std::int64_t Commit = 0;
+	};
+
+#ifdef _WIN32
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values.empty() ? 0 : values[values.size() / 2];
+	}
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::size_t GetModuleCount()
+	{
+		DWORD needed = 0;
+		EnumProcessModules(GetCurrentProcess(), NULL, 0, &needed);
+		return needed / sizeof(HMODULE);
+	}
+
+	std::int64_t GetCommit()
+	{
+		PROCESS_MEMORY_COUNTERS_EX counters{ sizeof(counters) };
+		GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+		return (std::int64_t)counters.PrivateUsage;
+	}
+
+	LoadCost MeasureLoad(const char* path, int loads)
+	{
+		LoadCost cost;
+		int length = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+		std::wstring widePath(length > 0 ? length - 1 : 0, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath.data(), length);
+
+		std::size_t modules = GetModuleCount();
+		std::int64_t commit = GetCommit();
+		auto start = std::chrono::steady_clock::now();
+		HMODULE module = LoadLibraryExW(widePath.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+		cost.FirstLoad = Milliseconds(start);
+		if (!module)
+			return cost;
+
+		// The image itself and what it brought along
+		cost.Modules = GetModuleCount() - modules - 1;
+		cost.Commit = GetCommit() - commit;
+		FreeLibrary(module);
+
+		std::vector<double> load, map;
+		for (int i = 0; i < loads; i++)
+		{
+			start = std::chrono::steady_clock::now();
+			module = LoadLibraryExW(widePath.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+			load.push_back(Milliseconds(start));
+			if (module)
+				FreeLibrary(module);
+
+			start = std::chrono::steady_clock::now();
+			module = LoadLibraryExW(widePath.c_str(), NULL, LOAD_LIBRARY_AS_IMAGE_RESOURCE);
+			map.push_back(Milliseconds(start));
+			if (module)
+				FreeLibrary(module);
+		}
+
+		cost.Measured = true;
+		cost.Load = Median(load);
+		cost.Map = Median(map);
+		return cost;
+	}
+#else
+	LoadCost MeasureLoad(const char*, int)
+	{
+		return LoadCost();
+	}
+#endif
+
+	double KiB(std::uint64_t bytes)
+	{
+		return bytes / 1024.0;
+	}
+
+	void PrintReport(const char* path, const PeImage& image, const LoadCost& cost)
+	{
+		std::printf("%s\n", path);
+		std::printf("  file %.1f KiB, image %.1f KiB, %s\n", KiB(image.FileSize), KiB(image.SizeOfImage),
+			image.Machine == 0x8664 ? "x64" : image.Machine == 0xAA64 ? "arm64" : image.Machine == 0x14C ? "x86" : "other");
+
+		std::printf("  sections:");
+		for (const PeSection& section : image.Sections)
+			std::printf(" %s %.1f KiB", section.Name.c_str(), KiB(section.VirtualSize));
+
+		std::printf("\n  imports: %zu libraries, %zu functions; delayed: %zu libraries, %zu functions\n",
+			image.GetLibraryCount(false), image.GetFunctionCount(false), image.GetLibraryCount(true), image.GetFunctionCount(true));
+		for (const PeImport& import : image.Imports)
+			std::printf("    %-32s %5zu%s\n", import.Library.c_str(), import.FunctionCount, import.Delayed ? "  delayed" : "");
+
+		if (cost.Measured)
+		{
+			std::printf("  first load %.3f ms, +%zu modules, %+.1f KiB committed\n", cost.FirstLoad, cost.Modules, cost.Commit / 1024.0);
+			std::printf("  load %.3f ms: mapping %.3f ms, imports, initializers and DllMain %.3f ms\n",
+				cost.Load, cost.Map, std::max(cost.Load - cost.Map, 0.0));
+		}
+		else if (cost.FirstLoad > 0)
+		{
+			std::printf("  could not be loaded\n");
+		}
+	}
+
+	void PrintRow(const char* path, const PeImage& image, const LoadCost& cost)
+	{
+		std::printf("%s,%llu,%u,%zu,%zu,%zu,%zu", path, (unsigned long long)image.FileSize, image.SizeOfImage,
+			image.GetLibraryCount(false), image.GetFunctionCount(false), image.GetLibraryCount(true), image.GetFunctionCount(true));
+		if (cost.Measured)
+			std::printf(",%.3f,%.3f,%.3f,%zu,%lld\n", cost.FirstLoad, cost.Load, cost.Map, cost.Modules, (long long)cost.Commit);
+		else
+			std::printf(",,,,,\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<const char*> paths;
+	bool csv = false;
+	bool valid = true;
+	int loads = 20;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--loads") && i + 1 < argc)
+			loads = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--csv"))
+			csv = true;
+		else if (argv[i][0] != '-')
+			paths.push_back(argv[i]);
+		else
+			valid = false;
+	}
+
+	if (!valid || paths.empty())
+	{
+		std::fprintf(stderr, "Usage: %s <dll>... [--csv] [--loads <count>]\n", argv[0]);
+		return 2;
+	}
+
+	if (csv)
+		std::printf("image,file_bytes,image_bytes,libraries,functions,delayed_libraries,delayed_functions,first_load_ms,load_ms,map_ms,modules,commit_bytes\n");
+
+	int result = 0;
+	for (const char* path : paths)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		PeImage image;
+		if (!file || !PeImage::Parse(data, image))
+		{
+			std::fprintf(stderr, "Not a PE image: %s\n", path);
+			result = 1;
+			continue;
+		}
+
+		LoadCost cost = MeasureLoad(path, loads);
+		if (csv)
+			PrintRow(path, image, cost);
+		else
+			PrintReport(path, image, cost);
+	}
+
+	return result;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Shows many dialogs at once against stand-ins for Files, each dialog with its own
+//  session and result channel, and reports the throughput and the latency of Show().
+//  A dialog that gets another's result, or none, counts as a failure.
+//
+//  Files.Native.Core.DialogStress [--dialogs <count>] [--shows <count>]
+//      [--startup-ms <ms>] [--show-ms <ms>] [--pick-ms <ms>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Tests/FilesStandIn.h"
+
+using namespace Files::Native::Tests;
+using namespace std::chrono;
+
+namespace
+{
+	double Percentile(std::vector<steady_clock::duration>& latencies, double percentile)
+	{
+		if (latencies.empty())
+			return 0;
+
+		std::size_t index = std::min(latencies.size() - 1, (std::size_t)(latencies.size() * percentile));
+		std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+		return duration<double, std::milli>(latencies[index]).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t dialogs = 16, shows = 50;
+	FilesStandInTimings timings{ milliseconds(0), milliseconds(1), milliseconds(0) };
+	bool valid = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+			valid = false;
+		else if (!std::strcmp(argv[i], "--dialogs"))
+			dialogs = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--shows"))
+			shows = std::max(std::atoi(argv[++i]), 1);
+		else if (!std::strcmp(argv[i], "--startup-ms"))
+			timings.Startup = milliseconds(std::max(std::atoi(argv[++i]), 0));
+		else if (!std::strcmp(argv[i], "--show-ms"))
+			timings.Show = milliseconds(std::max(std::atoi(argv[++i]), 0));
+		else if (!std::strcmp(argv[i], "--pick-ms"))
+			timings.Pick = milliseconds(std::max(std::atoi(argv[++i]), 0));
+		else
+			valid = false;
+	}
+
+	if (!valid)
+	{
+		std::fprintf(stderr, "Usage: %s [--dialogs <count>] [--shows <count>] [--startup-ms <ms>] [--show-ms <ms>] [--pick-ms <ms>]\n", argv[0]);
+		return 2;
+	}
+
+	ConcurrentDialogsResult result = RunConcurrentDialogs(dialogs, shows, timings);
+	double seconds = duration<double>(result.Elapsed).count();
+	std::printf("%zu dialogs, %zu shows in %.3f s: %.1f shows/s\n", dialogs, result.Shows, seconds, result.Shows / seconds);
+	std::printf("show latency: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", Percentile(result.Latencies, 0.5),
+		Percentile(result.Latencies, 0.99), Percentile(result.Latencies, 1));
+	std::printf("failures: %zu\n", result.Failures);
+
+	return result.Failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Prints the launch latencies of one or more LaunchLatency.v2.bin files, merged,
+//  and optionally writes the merged file for the next round of merging.
+//
+//  Files.Native.Core.LaunchLatencyDump <file>... [--csv] [--out <file>]
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "LaunchLatency.h"
+
+using namespace Files::Native;
+
+namespace
+{
+	constexpr double Percentiles[] = { 50, 90, 99, 99.9 };
+
+	bool ReadStore(const char* path, std::vector<char>& region)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		region.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return region.size() == LaunchLatencyStore::RequiredSize && LaunchLatencyStore(region.data(), region.size()).IsValid();
+	}
+
+	double ToMilliseconds(std::uint64_t microseconds)
+	{
+		return microseconds / 1000.0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<const char*> paths;
+	const char* outputPath = nullptr;
+	bool csv = false;
+	bool valid = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--out") && i + 1 < argc)
+			outputPath = argv[++i];
+		else if (!std::strcmp(argv[i], "--csv"))
+			csv = true;
+		else if (argv[i][0] != '-')
+			paths.push_back(argv[i]);
+		else
+			valid = false;
+	}
+
+	if (!valid || paths.empty())
+	{
+		std::fprintf(stderr, "Usage: %s <file>... [--csv] [--out <file>]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<char> merged(LaunchLatencyStore::RequiredSize, 0), region;
+	LaunchLatencyStore total(merged.data(), merged.size());
+	for (const char* path : paths)
+	{
+		// A launcher may be writing the file, a torn sample shows as a count off by one
+		if (!ReadStore(path, region))
+		{
+			std::fprintf(stderr, "Not a launch latency file of version %u: %s\n", LaunchLatencyStore::Version, path);
+			return 1;
+		}
+
+		total.Merge(LaunchLatencyStore(region.data(), region.size()));
+	}
+
+	if (csv)
+		std::printf("outcome,count,mean_ms,p50_ms,p90_ms,p99_ms,p999_ms,max_ms\n");
+	else
+		std::printf("%-20s %10s %10s %10s %10s %10s %10s %10s\n", "Outcome (ms)", "Count", "Mean", "p50", "p90", "p99", "p99.9", "Max");
+
+	for (int outcome = 0; outcome < (int)LaunchOutcome::Count; outcome++)
+	{
+		LatencyHistogram histogram = total.Read((LaunchOutcome)outcome);
+		std::string name(GetLaunchOutcomeName((LaunchOutcome)outcome));
+		std::printf(csv ? "%s,%llu,%.1f" : "%-20s %10llu %10.1f", name.c_str(), (unsigned long long)histogram.GetCount(), histogram.GetMean() / 1000);
+		for (double percentile : Percentiles)
+			std::printf(csv ? ",%.1f" : " %10.1f", ToMilliseconds(histogram.GetPercentile(percentile)));
+
+		std::printf(csv ? ",%.1f\n" : " %10.1f\n", ToMilliseconds(histogram.GetMax()));
+	}
+
+	if (outputPath)
+	{
+		std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+		if (!output.write(merged.data(), merged.size()))
+		{
+			std::fprintf(stderr, "Could not write %s\n", outputPath);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Debug log of the dialogs, written through the iostreams unless the dialogs are
+//  built lean (LEANDIALOG), which leaves it and the iostreams out.
+
+#pragma once
+
+#ifndef LEANDIALOG
+#include <iostream>
+#endif
+
+namespace Files::Native::DialogLog
+{
+#ifdef LEANDIALOG
+	// Takes whatever is logged and writes nothing, the calls compile away
+	struct NullLog
+	{
+		template <typename T>
+		const NullLog& operator<<(const T&) const
+		{
+			return *this;
+		}
+	};
+
+	inline constexpr NullLog cout{};
+	inline constexpr NullLog wcout{};
+	inline constexpr NullLog endl{};
+#else
+	using std::cout;
+	using std::wcout;
+	using std::endl;
+#endif
+}
@@ -0,0 +1,120 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Records the calls a host makes on a dialog to a DialogTrace under
+//  %LOCALAPPDATA%\Files\DialogTraces, when enabled in the dialog settings.
+
+#pragma once
+
+#include <windows.h>
+#include <shlobj.h>
+#include <chrono>
+#include <string>
+#include "DialogTrace.h"
+#include "Windows/DialogSettings.h"
+
+namespace Files::Native
+{
+	// The trace is kept in memory and written when the dialog is released, so recording
+	// costs the host no I/O while it drives the dialog
+	class DialogRecorder
+	{
+		using Clock = std::chrono::steady_clock;
+
+		DialogKind _kind;
+		std::string _records;
+		Clock::time_point _last;
+
+	public:
+		// Calls past this are dropped, a host keeping a dialog around for ever stays bounded
+		static constexpr std::size_t MaxTraceSize = 4 * 1024 * 1024;
+
+		explicit DialogRecorder(DialogKind kind) :
+			_kind(kind),
+			_last(Clock::now())
+		{
+		}
+
+		DialogRecorder(const DialogRecorder&) = delete;
+		DialogRecorder& operator=(const DialogRecorder&) = delete;
+
+		void Record(const DialogCall& call)
+		{
+			if (!IsEnabled() || _records.size() >= MaxTraceSize)
+				return;
+
+			Clock::time_point now = Clock::now();
+			DialogTrace::AppendRecord(_records, std::chrono::duration_cast<std::chrono::microseconds>(now - _last).count(), call);
+			_last = now;
+		}
+
+		void Save()
+		{
+			if (_records.empty())
+				return;
+
+			PWSTR localAppData = NULL;
+			if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &localAppData)))
+				return;
+
+			std::wstring folder = std::wstring(localAppData) + L"\\Files";
+			CoTaskMemFree(localAppData);
+			CreateDirectoryW(folder.c_str(), NULL);
+			folder += L"\\DialogTraces";
+			CreateDirectoryW(folder.c_str(), NULL);
+
+			std::wstring host = GetHostName();
+			std::string trace;
+			trace.reserve(64 + _records.size());
+			DialogTrace::AppendHeader(trace, _kind, ToUtf8(host));
+			trace.append(_records);
+			_records.clear();
+
+			FILETIME now;
+			GetSystemTimeAsFileTime(&now);
+			std::wstring path = folder + L"\\" + host + L"." + std::to_wstring(GetCurrentProcessId()) + L"." +
+				std::to_wstring(((ULONGLONG)now.dwHighDateTime << 32) | now.dwLowDateTime) +
+				L".v" + std::to_wstring(DialogTrace::Version) + L".trace";
+
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			DWORD written = 0;
+			bool complete = WriteFile(file, trace.data(), (DWORD)trace.size(), &written, NULL) && written == trace.size();
+			CloseHandle(file);
+			if (!complete)
+				DeleteFileW(path.c_str());
+		}
+
+	private:
+		// Read once per host process, turning recording on takes effect with the next host
+		static bool IsEnabled()
+		{
+			static const bool enabled = DialogSettings::Load().RecordTraces;
+			return enabled;
+		}
+
+		static std::wstring GetHostName()
+		{
+			WCHAR path[MAX_PATH];
+			DWORD length = GetModuleFileNameW(NULL, path, MAX_PATH);
+			if (length == 0 || length >= MAX_PATH)
+				return L"unknown";
+
+			std::wstring name(path, length);
+			return name.substr(name.find_last_of(L'\\') + 1);
+		}
+
+		static std::string ToUtf8(const std::wstring& value)
+		{
+			int size = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0, NULL, NULL);
+			std::string result(size > 0 ? size : 0, '\0');
+			if (size > 0)
+				WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), size, NULL, NULL);
+
+			return result;
+		}
+	};
+}
@@ -0,0 +1,147 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Item array the open dialog hands out from GetResults. It never changes once created
+//  and aggregates the free-threaded marshaler, so that a host can pass it to its workers
+//  without a proxy back to the dialog's thread.
+
+#pragma once
+
+#include <windows.h>
+#include <atlbase.h>
+#include <atlcom.h>
+#include <shlobj.h>
+#include <shobjidl.h>
+#include <string>
+#include <vector>
+
+namespace Files::Native
+{
+	// Holds the ID lists of the items, resolved once on the dialog's thread. The shell
+	// objects are created on the thread that asks for them.
+	class ATL_NO_VTABLE DialogResultArray :
+		public CComObjectRootEx<CComMultiThreadModel>,
+		public IShellItemArray
+	{
+		std::vector<PIDLIST_ABSOLUTE> _items;
+		CComPtr<IUnknown> _freeThreadedMarshaler;
+
+	public:
+		DECLARE_GET_CONTROLLING_UNKNOWN()
+
+		BEGIN_COM_MAP(DialogResultArray)
+			COM_INTERFACE_ENTRY(IShellItemArray)
+			COM_INTERFACE_ENTRY_AGGREGATE(IID_IMarshal, _freeThreadedMarshaler.p)
+		END_COM_MAP()
+
+		DECLARE_PROTECT_FINAL_CONSTRUCT()
+
+		HRESULT FinalConstruct()
+		{
+			return CoCreateFreeThreadedMarshaler(GetControllingUnknown(), &_freeThreadedMarshaler);
+		}
+
+		void FinalRelease()
+		{
+			for (PIDLIST_ABSOLUTE item : _items)
+				CoTaskMemFree(item);
+
+			_freeThreadedMarshaler.Release();
+		}
+
+		// Over the given UTF-8 paths, leaving out those that no longer parse
+		static HRESULT Create(const std::vector<std::string>& paths, IShellItemArray** array)
+		{
+			*array = NULL;
+			CComObject<DialogResultArray>* object;
+			HRESULT hr = CComObject<DialogResultArray>::CreateInstance(&object);
+			if (FAILED(hr))
+				return hr;
+
+			CComPtr<IShellItemArray> result(object);
+			for (const std::string& path : paths)
+			{
+				PIDLIST_ABSOLUTE item = NULL;
+				if (SUCCEEDED(SHParseDisplayName(ToWide(path).c_str(), NULL, &item, 0, NULL)))
+					object->_items.push_back(item);
+			}
+
+			if (object->_items.empty())
+				return E_FAIL;
+
+			*array = result.Detach();
+			return S_OK;
+		}
+
+		STDMETHODIMP BindToHandler(IBindCtx* pbc, REFGUID bhid, REFIID riid, void** ppvOut) override
+		{
+			*ppvOut = NULL;
+			CComPtr<IShellItemArray> array;
+			HRESULT hr = CreateShellArray(&array);
+			return SUCCEEDED(hr) ? array->BindToHandler(pbc, bhid, riid, ppvOut) : hr;
+		}
+
+		STDMETHODIMP GetPropertyStore(GETPROPERTYSTOREFLAGS flags, REFIID riid, void** ppv) override
+		{
+			*ppv = NULL;
+			CComPtr<IShellItemArray> array;
+			HRESULT hr = CreateShellArray(&array);
+			return SUCCEEDED(hr) ? array->GetPropertyStore(flags, riid, ppv) : hr;
+		}
+
+		STDMETHODIMP GetPropertyDescriptionList(REFPROPERTYKEY keyType, REFIID riid, void** ppv) override
+		{
+			*ppv = NULL;
+			CComPtr<IShellItemArray> array;
+			HRESULT hr = CreateShellArray(&array);
+			return SUCCEEDED(hr) ? array->GetPropertyDescriptionList(keyType, riid, ppv) : hr;
+		}
+
+		STDMETHODIMP GetAttributes(SIATTRIBFLAGS attribFlags, SFGAOF sfgaoMask, SFGAOF* psfgaoAttribs) override
+		{
+			CComPtr<IShellItemArray> array;
+			HRESULT hr = CreateShellArray(&array);
+			return SUCCEEDED(hr) ? array->GetAttributes(attribFlags, sfgaoMask, psfgaoAttribs) : hr;
+		}
+
+		STDMETHODIMP GetCount(DWORD* pdwNumItems) override
+		{
+			*pdwNumItems = (DWORD)_items.size();
+			return S_OK;
+		}
+
+		STDMETHODIMP GetItemAt(DWORD dwIndex, IShellItem** ppsi) override
+		{
+			*ppsi = NULL;
+			if (dwIndex >= _items.size())
+				return E_INVALIDARG;
+
+			return SHCreateItemFromIDList(_items[dwIndex], IID_PPV_ARGS(ppsi));
+		}
+
+		STDMETHODIMP EnumItems(IEnumShellItems** ppenumShellItems) override
+		{
+			*ppenumShellItems = NULL;
+			CComPtr<IShellItemArray> array;
+			HRESULT hr = CreateShellArray(&array);
+			return SUCCEEDED(hr) ? array->EnumItems(ppenumShellItems) : hr;
+		}
+
+	private:
+		// The shell's own array of the items, for the calls that need the items' folders
+		HRESULT CreateShellArray(IShellItemArray** array)
+		{
+			return SHCreateShellItemArrayFromIDLists((UINT)_items.size(), (PCIDLIST_ABSOLUTE_ARRAY)_items.data(), array);
+		}
+
+		static std::wstring ToWide(const std::string& value)
+		{
+			std::wstring result;
+			int length = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0);
+			result.resize(length);
+			MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), length);
+			return result;
+		}
+	};
+}
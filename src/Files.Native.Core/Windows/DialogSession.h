@@ -0,0 +1,323 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Named pipe end of a dialog session. The dialog starts Files in the background
+//  as soon as it is configured and Files connects back to the pipe, so that Show()
+//  only has to hand the final parameters to an instance that is already running.
+
+#pragma once
+
+#include <windows.h>
+#include <objbase.h>
+#include <chrono>
+#include <string>
+#include "DialogExecutor.h"
+#include "DialogSessionProtocol.h"
+#include "Windows/PumpingExecutorHost.h"
+
+namespace Files::Native
+{
+	class DialogSession
+	{
+		static constexpr DWORD BufferSize = 4096;
+		// Files reads its end as soon as it is ready, a write still pending after this is
+		// cancelled rather than holding up the host's thread
+		static constexpr DWORD WriteTimeout = 2000;
+
+		HANDLE _pipe = INVALID_HANDLE_VALUE;
+		HANDLE _ioEvent = NULL;
+		OVERLAPPED _overlapped = {};
+		HANDLE _readEvent = NULL;
+		OVERLAPPED _readOverlapped = {};
+		char _readBuffer[BufferSize];
+		std::wstring _name;
+		DialogMessageCodec _codec;
+		bool _connecting = false;
+		bool _reading = false;
+		bool _ready = false;
+
+	public:
+		DialogSession() = default;
+		DialogSession(const DialogSession&) = delete;
+		DialogSession& operator=(const DialogSession&) = delete;
+
+		~DialogSession()
+		{
+			Close();
+		}
+
+		// Name of the pipe, without the \\.\pipe\ prefix, as passed to Files with -dialogsession
+		const std::wstring& Name() const
+		{
+			return _name;
+		}
+
+		bool IsOpen() const
+		{
+			return _pipe != INVALID_HANDLE_VALUE;
+		}
+
+		// Files has connected and the session can take Show() requests
+		bool IsReady() const
+		{
+			return _ready;
+		}
+
+		// Creates the pipe and starts waiting for Files to connect without blocking
+		bool Listen()
+		{
+			if (IsOpen())
+				return true;
+
+			GUID guid;
+			WCHAR guidString[40];
+			if (FAILED(CoCreateGuid(&guid)) || !StringFromGUID2(guid, guidString, _countof(guidString)))
+				return false;
+
+			_name = std::wstring(L"Files-DialogSession-") + guidString;
+			_ioEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			_readEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			_pipe = CreateNamedPipeW((L"\\\\.\\pipe\\" + _name).c_str(),
+				PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+				PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+				1, BufferSize, BufferSize, 0, NULL);
+
+			if (!_ioEvent || !_readEvent || _pipe == INVALID_HANDLE_VALUE)
+			{
+				Close();
+				return false;
+			}
+
+			_overlapped = {};
+			_overlapped.hEvent = _ioEvent;
+			if (ConnectNamedPipe(_pipe, &_overlapped))
+				return true;
+
+			DWORD error = GetLastError();
+			if (error == ERROR_IO_PENDING)
+				_connecting = true;
+			else if (error != ERROR_PIPE_CONNECTED)
+			{
+				Close();
+				return false;
+			}
+
+			return true;
+		}
+
+		// Waits until Files has connected and greeted the dialog. A session that does not
+		// become ready within the timeout is closed.
+		Task<bool> WaitReadyAsync(DialogExecutor& executor, DWORD timeout)
+		{
+			if (_ready)
+				co_return true;
+			if (!IsOpen())
+				co_return false;
+
+			auto start = std::chrono::steady_clock::now();
+			auto remaining = [start, timeout]()
+			{
+				DWORD waited = (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+				return timeout == INFINITE ? INFINITE : waited < timeout ? timeout - waited : 0;
+			};
+
+			if (_connecting)
+			{
+				DWORD transferred = 0;
+				if (co_await executor.Wait(_ioEvent, ToTimeout(timeout)) != WaitResult::Signalled ||
+					!GetOverlappedResult(_pipe, &_overlapped, &transferred, FALSE))
+				{
+					Close();
+					co_return false;
+				}
+
+				_connecting = false;
+			}
+
+			DialogMessage message;
+			while (!_codec.Next(message))
+			{
+				if (_codec.IsCorrupt() || !co_await ReadAsync(executor, remaining()))
+				{
+					Close();
+					co_return false;
+				}
+			}
+
+			if (message.Type != DialogMessageType::Hello)
+			{
+				Close();
+				co_return false;
+			}
+
+			_ready = true;
+			co_return true;
+		}
+
+		// Asks Files to show the picker for the given activation command line. Files keeps
+		// serving the session after the picker is closed, so this can be called again.
+		bool Show(const std::wstring& args)
+		{
+			return _ready && Write(DialogMessageType::Show, ToUtf8(args));
+		}
+
+		bool Send(DialogMessageType type, const std::string& payload)
+		{
+			return _ready && Write(type, payload);
+		}
+
+		// Signalled when Files has sent something, see Serve
+		HANDLE ReadEvent() const
+		{
+			return _readEvent;
+		}
+
+		// Passes every message Files has sent so far to handler(const DialogMessage&) and
+		// keeps a read pending so that ReadEvent is signalled by the next one. Returns false
+		// when Files is gone.
+		template <typename THandler>
+		bool Serve(THandler handler)
+		{
+			if (!_ready)
+				return false;
+
+			if (_reading && WaitForSingleObject(_readEvent, 0) == WAIT_OBJECT_0 && !EndRead())
+				return false;
+
+			DialogMessage message;
+			while (_codec.Next(message))
+				handler(message);
+
+			return !_codec.IsCorrupt() && BeginRead();
+		}
+
+		// Ends the session. Files reclaims a session that never got to show the picker.
+		void Close()
+		{
+			if (_ready)
+				Write(DialogMessageType::Close, std::string());
+
+			if (_connecting)
+			{
+				DWORD transferred = 0;
+				CancelIoEx(_pipe, &_overlapped);
+				GetOverlappedResult(_pipe, &_overlapped, &transferred, TRUE);
+			}
+
+			CancelRead();
+
+			if (_pipe != INVALID_HANDLE_VALUE)
+				CloseHandle(_pipe);
+			if (_ioEvent)
+				CloseHandle(_ioEvent);
+			if (_readEvent)
+				CloseHandle(_readEvent);
+
+			_pipe = INVALID_HANDLE_VALUE;
+			_ioEvent = NULL;
+			_readEvent = NULL;
+			_codec = DialogMessageCodec();
+			_connecting = false;
+			_ready = false;
+		}
+
+	private:
+		Task<bool> ReadAsync(DialogExecutor& executor, DWORD timeout)
+		{
+			if (!BeginRead())
+				co_return false;
+
+			if (co_await executor.Wait(_readEvent, ToTimeout(timeout)) != WaitResult::Signalled)
+			{
+				CancelRead();
+				co_return false;
+			}
+
+			co_return EndRead();
+		}
+
+		// Reads have their own buffer and event, so one can stay pending between calls
+		// while writes go through
+		bool BeginRead()
+		{
+			if (_reading)
+				return true;
+
+			ResetEvent(_readEvent);
+			_readOverlapped = {};
+			_readOverlapped.hEvent = _readEvent;
+
+			// Also completes through the event when the data is already there
+			if (!ReadFile(_pipe, _readBuffer, sizeof(_readBuffer), NULL, &_readOverlapped) &&
+				GetLastError() != ERROR_IO_PENDING)
+				return false;
+
+			_reading = true;
+			return true;
+		}
+
+		bool EndRead()
+		{
+			DWORD transferred = 0;
+			_reading = false;
+
+			if (!GetOverlappedResult(_pipe, &_readOverlapped, &transferred, FALSE))
+				return false;
+
+			_codec.Feed(_readBuffer, transferred);
+			return transferred > 0;
+		}
+
+		void CancelRead()
+		{
+			if (!_reading)
+				return;
+
+			DWORD transferred = 0;
+			CancelIoEx(_pipe, &_readOverlapped);
+			GetOverlappedResult(_pipe, &_readOverlapped, &transferred, TRUE);
+			_reading = false;
+		}
+
+		bool Write(DialogMessageType type, const std::string& payload)
+		{
+			std::string frame = DialogMessageCodec::Encode(type, payload);
+			DWORD transferred = 0;
+
+			ResetEvent(_ioEvent);
+			_overlapped = {};
+			_overlapped.hEvent = _ioEvent;
+
+			bool written = (WriteFile(_pipe, frame.data(), (DWORD)frame.size(), &transferred, &_overlapped) ||
+				GetLastError() == ERROR_IO_PENDING) && Complete(_overlapped, WriteTimeout, transferred) && transferred == frame.size();
+
+			// A frame cut short leaves the stream unusable, nothing more is sent
+			if (!written)
+				_ready = false;
+
+			return written;
+		}
+
+		// Waits up to timeout milliseconds for an operation on the pipe, then cancels it
+		bool Complete(OVERLAPPED& overlapped, DWORD timeout, DWORD& transferred)
+		{
+			if (WaitForSingleObject(overlapped.hEvent, timeout) != WAIT_OBJECT_0)
+				CancelIoEx(_pipe, &overlapped);
+
+			// Returns at once for an operation that has completed or been cancelled
+			return GetOverlappedResult(_pipe, &overlapped, &transferred, TRUE) != FALSE;
+		}
+
+		static std::string ToUtf8(const std::wstring& input)
+		{
+			int cbNeeded = WideCharToMultiByte(CP_UTF8, 0, input.c_str(), (int)input.size(), NULL, 0, NULL, NULL);
+			if (cbNeeded <= 0)
+				return std::string();
+
+			std::string output(cbNeeded, '\0');
+			WideCharToMultiByte(CP_UTF8, 0, input.c_str(), (int)input.size(), &output[0], cbNeeded, NULL, NULL);
+			return output;
+		}
+	};
+}
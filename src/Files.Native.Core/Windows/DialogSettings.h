@@ -0,0 +1,74 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Runtime settings shared by the Files open and save dialogs.
+
+#pragma once
+
+#include <windows.h>
+
+namespace Files::Native
+{
+	// How Show() picks between Files and the system dialog.
+	enum class DialogMode : DWORD
+	{
+		// Always activate Files and wait for it, even if it never answers.
+		FilesOnly = 0,
+		// Activate Files and fall back to the system dialog when Files does not
+		// acknowledge the activation within the deadline.
+		Hybrid = 1,
+		// Always show the system dialog.
+		SystemOnly = 2,
+	};
+
+	struct DialogSettings
+	{
+		static constexpr const wchar_t* RegistryKey = L"Software\\Files Community\\Files\\Dialogs";
+
+		DialogMode Mode = DialogMode::Hybrid;
+
+		// Milliseconds Files gets to acknowledge the activation in hybrid mode
+		DWORD ActivationTimeout = 5000;
+
+		// Start Files in the background as soon as the dialog is configured
+		bool PreActivate = true;
+
+		// Milliseconds the save dialog waits on the storage of the picked target
+		DWORD PreflightTimeout = 2000;
+
+		// Record the calls of every host to a trace under %LOCALAPPDATA%\Files\DialogTraces
+		bool RecordTraces = false;
+
+		static DialogSettings Load()
+		{
+			DialogSettings settings;
+
+			DWORD value = 0;
+			DWORD size = sizeof(value);
+			if (RegGetValueW(HKEY_CURRENT_USER, RegistryKey, L"Mode", RRF_RT_REG_DWORD, NULL, &value, &size) == ERROR_SUCCESS &&
+				value <= (DWORD)DialogMode::SystemOnly)
+				settings.Mode = (DialogMode)value;
+
+			size = sizeof(value);
+			if (RegGetValueW(HKEY_CURRENT_USER, RegistryKey, L"ActivationTimeout", RRF_RT_REG_DWORD, NULL, &value, &size) == ERROR_SUCCESS &&
+				value > 0)
+				settings.ActivationTimeout = value;
+
+			size = sizeof(value);
+			if (RegGetValueW(HKEY_CURRENT_USER, RegistryKey, L"PreActivate", RRF_RT_REG_DWORD, NULL, &value, &size) == ERROR_SUCCESS)
+				settings.PreActivate = value != 0;
+
+			size = sizeof(value);
+			if (RegGetValueW(HKEY_CURRENT_USER, RegistryKey, L"PreflightTimeout", RRF_RT_REG_DWORD, NULL, &value, &size) == ERROR_SUCCESS &&
+				value > 0)
+				settings.PreflightTimeout = value;
+
+			size = sizeof(value);
+			if (RegGetValueW(HKEY_CURRENT_USER, RegistryKey, L"RecordTraces", RRF_RT_REG_DWORD, NULL, &value, &size) == ERROR_SUCCESS)
+				settings.RecordTraces = value != 0;
+
+			return settings;
+		}
+	};
+}
@@ -0,0 +1,202 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Protocol activation of Files on behalf of the open and save dialogs.
+
+#pragma once
+
+#include <windows.h>
+#include <shellapi.h>
+#include <chrono>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include "DialogExecutor.h"
+#include "Windows/LaunchLatencyFile.h"
+#include "Windows/PumpingExecutorHost.h"
+#include "Windows/ResultChannel.h"
+
+namespace Files::Native
+{
+	enum class ActivationResult
+	{
+		// Files closed the picker and signalled the result channel
+		Completed,
+		// Files did not acknowledge the activation before the deadline
+		TimedOut,
+		// The protocol activation or the wait failed
+		Failed,
+		// The host closed the dialog while the picker was up
+		Cancelled,
+	};
+
+	// What FilesActivation::RunAsync waits for before calling its service again: the event
+	// being signalled or, when there is work due later, the timeout elapsing
+	struct ServiceWait
+	{
+		HANDLE Event = NULL;
+		DWORD Timeout = INFINITE;
+	};
+
+	class FilesActivation
+	{
+	public:
+		static std::wstring GetExecutablePath()
+		{
+			WCHAR szBuf[MAX_PATH];
+			ExpandEnvironmentStringsW(L"%LOCALAPPDATA%\\Microsoft\\WindowsApps\\files-dev.exe", szBuf, MAX_PATH - 1);
+			return szBuf;
+		}
+
+		static bool IsInstalled()
+		{
+			return GetFileAttributesW(GetExecutablePath().c_str()) != INVALID_FILE_ATTRIBUTES;
+		}
+
+		// Starts Files through the protocol handler without waiting for it
+		static bool Launch(LPCWSTR uri)
+		{
+			SHELLEXECUTEINFO ShExecInfo = { 0 };
+			ShExecInfo.cbSize = sizeof(SHELLEXECUTEINFO);
+			ShExecInfo.fMask = SEE_MASK_NOCLOSEPROCESS;
+			ShExecInfo.lpFile = uri;
+			ShExecInfo.nShow = SW_SHOW;
+
+			if (!ShellExecuteEx(&ShExecInfo))
+				return false;
+
+			if (ShExecInfo.hProcess)
+				CloseHandle(ShExecInfo.hProcess);
+
+			return true;
+		}
+
+		// Asks Files for the picker through activate() -> Task<bool>, e.g. a protocol
+		// activation or a dialog session, then waits until Files signals on the channel that
+		// the picker was closed. Files acknowledges the activation as soon as it receives it;
+		// when that does not happen within ackTimeout milliseconds the wait is abandoned.
+		// Pass INFINITE to wait for Files indefinitely. Unless it completes, the channel is
+		// cancelled so that a Files still on its way closes its picker.
+		// While waiting, service() answers the requests and events Files sends about the
+		// picker: it is called once the activation is done and again each time the ServiceWait
+		// it returned is satisfied. ackTimeout starts when activate() returns, the time it
+		// spent reaching Files is not taken from it.
+		template <typename TActivate, typename TService>
+		static Task<ActivationResult> RunAsync(DialogExecutor& executor, const ResultChannel& channel, TActivate activate, TService service, HWND hwndOwner, DWORD ackTimeout, DWORD* pAckLatency)
+		{
+			HANDLE events[3] =
+			{
+				CreateEvent(NULL, FALSE, FALSE, channel.CompletionEventName().c_str()),
+				CreateEvent(NULL, FALSE, FALSE, channel.AckEventName().c_str()),
+				CreateEvent(NULL, TRUE, FALSE, channel.CancelEventName().c_str()),
+			};
+
+			if (!events[0] || !events[1] || !events[2])
+			{
+				CloseEvents(events);
+				co_return ActivationResult::Failed;
+			}
+
+			// Disabled first, the activation may itself wait on Files
+			if (hwndOwner)
+				EnableWindow(hwndOwner, FALSE);
+
+			auto start = std::chrono::steady_clock::now();
+			ActivationResult result = ActivationResult::Failed;
+			std::optional<std::chrono::steady_clock::duration> ackLatency;
+
+			if (co_await activate())
+			{
+				// The acknowledgement and the service run alongside the wait for completion.
+				// abandon ends the wait when Files does not acknowledge, stages ends the rest.
+				std::stop_source abandon;
+				std::stop_source stages;
+				auto watch = executor.Spawn(WatchAckAsync(executor, events[1], ackTimeout, start, abandon, stages.get_token(), ackLatency));
+				auto serve = executor.Spawn(ServeAsync(executor, service, stages.get_token()));
+
+				WaitResult completion = co_await executor.Wait(events[0], std::nullopt, abandon.get_token());
+				stages.request_stop();
+
+				// Completion wins over a deadline that expired at the same time
+				if (completion != WaitResult::Signalled && WaitForSingleObject(events[0], 0) == WAIT_OBJECT_0)
+					completion = WaitResult::Signalled;
+
+				bool acknowledged = co_await watch;
+				co_await serve;
+
+				result = completion == WaitResult::Signalled ? ActivationResult::Completed :
+					executor.IsCancelled() ? ActivationResult::Cancelled :
+					!acknowledged ? ActivationResult::TimedOut :
+					ActivationResult::Failed;
+			}
+
+			// Files may still be starting, or show its picker after the deadline
+			if (result != ActivationResult::Completed)
+				SetEvent(events[2]);
+
+			CloseEvents(events);
+
+			if (hwndOwner)
+			{
+				EnableWindow(hwndOwner, TRUE);
+				SetForegroundWindow(hwndOwner);
+			}
+
+			// Kept with the launcher's latencies, for the p50/p99 of Files taking over a dialog
+			if (ackLatency)
+			{
+				if (pAckLatency)
+					*pAckLatency = (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(*ackLatency).count();
+				LaunchLatencyFile().Record(LaunchOutcome::DialogAcknowledged, (std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(*ackLatency).count());
+			}
+			else if (result == ActivationResult::TimedOut)
+			{
+				LaunchLatencyFile().Record(LaunchOutcome::DialogTimedOut, (std::uint64_t)ackTimeout * 1000);
+			}
+
+			co_return result;
+		}
+
+	private:
+		// Returns whether Files acknowledged the activation, abandoning the activation
+		// when it does not within ackTimeout of now. The latency is counted from start.
+		static Task<bool> WatchAckAsync(DialogExecutor& executor, HANDLE ack, DWORD ackTimeout, std::chrono::steady_clock::time_point start, std::stop_source& abandon, std::stop_token token, std::optional<std::chrono::steady_clock::duration>& ackLatency)
+		{
+			std::optional<std::chrono::milliseconds> timeout;
+			if (ackTimeout != INFINITE)
+				timeout = std::chrono::milliseconds(ackTimeout);
+
+			WaitResult wait = co_await executor.Wait(ack, timeout, token);
+			if (wait == WaitResult::TimedOut)
+				abandon.request_stop();
+			else if (wait == WaitResult::Signalled)
+				ackLatency = std::chrono::steady_clock::now() - start;
+
+			co_return wait == WaitResult::Signalled || ackTimeout == INFINITE;
+		}
+
+		template <typename TService>
+		static Task<void> ServeAsync(DialogExecutor& executor, TService& service, std::stop_token token)
+		{
+			while (!token.stop_requested())
+			{
+				ServiceWait wait = service();
+				if (!wait.Event && wait.Timeout == INFINITE)
+					break;
+
+				co_await executor.Wait(wait.Event, ToTimeout(wait.Timeout), token);
+			}
+		}
+
+		static void CloseEvents(HANDLE (&events)[3])
+		{
+			for (HANDLE& event : events)
+			{
+				if (event)
+					CloseHandle(event);
+				event = NULL;
+			}
+		}
+	};
+}
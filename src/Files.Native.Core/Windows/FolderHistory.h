@@ -0,0 +1,157 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Last folder of each dialog client, shared by every process through a mapped
+//  FolderMruStore under %LOCALAPPDATA%.
+
+#pragma once
+
+#include <windows.h>
+#include <shlobj.h>
+#include <optional>
+#include <string>
+#include "FolderMruStore.h"
+
+namespace Files::Native
+{
+	// The file name carries the layout version, a new layout starts a new file
+	class FolderHistory
+	{
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = NULL;
+		void* _view = NULL;
+		FolderMruStore _store;
+		bool _opened = false;
+
+	public:
+		// Milliseconds Show() waits to find out whether the last folder is still there
+		static constexpr DWORD FolderCheckTimeout = 500;
+
+		FolderHistory() = default;
+		FolderHistory(const FolderHistory&) = delete;
+		FolderHistory& operator=(const FolderHistory&) = delete;
+
+		~FolderHistory()
+		{
+			if (_view)
+				UnmapViewOfFile(_view);
+			if (_mapping)
+				CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE)
+				CloseHandle(_file);
+		}
+
+		// Client set with SetClientGuid, or else the host executable
+		static std::string GetClientKey(const GUID* clientGuid)
+		{
+			WCHAR buffer[MAX_PATH];
+			if (clientGuid)
+			{
+				StringFromGUID2(*clientGuid, buffer, ARRAYSIZE(buffer));
+				return "guid:" + ToUtf8(buffer);
+			}
+
+			DWORD length = GetModuleFileNameW(NULL, buffer, ARRAYSIZE(buffer));
+			if (length == 0 || length == ARRAYSIZE(buffer))
+				return std::string();
+
+			CharLowerBuffW(buffer, length);
+			return "exe:" + ToUtf8(std::wstring(buffer, length));
+		}
+
+		std::optional<std::wstring> Lookup(const std::string& key)
+		{
+			if (key.empty() || !Open())
+				return std::nullopt;
+
+			auto folder = _store.Lookup(key);
+			if (!folder)
+				return std::nullopt;
+
+			return FromUtf8(*folder);
+		}
+
+		void Remember(const std::string& key, const std::wstring& folder)
+		{
+			if (!key.empty() && !folder.empty() && Open())
+				_store.Remember(key, ToUtf8(folder));
+		}
+
+		void Forget(const std::string& key)
+		{
+			if (!key.empty() && Open())
+				_store.Forget(key);
+		}
+
+		static bool FolderExists(const std::wstring& path)
+		{
+			DWORD attributes = GetFileAttributesW(path.c_str());
+			return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+		}
+
+		// Folder of a picked item, keeping the separator of a drive root
+		static std::wstring GetParent(const std::wstring& path)
+		{
+			std::size_t separator = path.find_last_of(L"\\/");
+			if (separator == std::wstring::npos)
+				return std::wstring();
+			if (separator == 2 && path[1] == L':')
+				return path.substr(0, 3);
+
+			return path.substr(0, separator);
+		}
+
+	private:
+		// Maps the file on first use, a failure is final for this instance
+		bool Open()
+		{
+			if (_opened)
+				return _store.IsValid();
+
+			_opened = true;
+
+			PWSTR localAppData = NULL;
+			if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &localAppData)))
+				return false;
+
+			std::wstring folder = std::wstring(localAppData) + L"\\Files";
+			CoTaskMemFree(localAppData);
+			CreateDirectoryW(folder.c_str(), NULL);
+
+			std::wstring path = folder + L"\\DialogMru.v" + std::to_wstring(FolderMruStore::Version) + L".bin";
+			_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			// Grows a new file to the store size, zero filled
+			_mapping = CreateFileMappingW(_file, NULL, PAGE_READWRITE, 0, (DWORD)FolderMruStore::RequiredSize, NULL);
+			if (!_mapping)
+				return false;
+
+			_view = MapViewOfFile(_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, FolderMruStore::RequiredSize);
+			if (!_view)
+				return false;
+
+			_store = FolderMruStore(_view, FolderMruStore::RequiredSize);
+			return _store.IsValid();
+		}
+
+		static std::string ToUtf8(const std::wstring& value)
+		{
+			int length = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0, NULL, NULL);
+			std::string result(length, '\0');
+			WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), length, NULL, NULL);
+			return result;
+		}
+
+		static std::wstring FromUtf8(const std::string& value)
+		{
+			int length = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0);
+			std::wstring result(length, L'\0');
+			MultiByteToWideChar(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), length);
+			return result;
+		}
+	};
+}
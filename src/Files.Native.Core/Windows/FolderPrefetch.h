@@ -0,0 +1,160 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Takes the FolderSnapshot of the folder a dialog opens in on a background
+//  thread, while Files is being activated.
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "FolderSnapshot.h"
+
+namespace Files::Native
+{
+	// Entries of a folder in the order FindNextFile returns them, which is what
+	// Files would see enumerating the folder itself
+	class Win32FolderSource
+	{
+		HANDLE _find = INVALID_HANDLE_VALUE;
+		WIN32_FIND_DATAW _data;
+		bool _pending = false;
+
+	public:
+		explicit Win32FolderSource(const std::wstring& folder)
+		{
+			std::wstring pattern = folder;
+			if (!pattern.empty() && pattern.back() != L'\\')
+				pattern += L'\\';
+			pattern += L'*';
+
+			_find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &_data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			_pending = _find != INVALID_HANDLE_VALUE;
+		}
+
+		Win32FolderSource(const Win32FolderSource&) = delete;
+		Win32FolderSource& operator=(const Win32FolderSource&) = delete;
+
+		~Win32FolderSource()
+		{
+			if (_find != INVALID_HANDLE_VALUE)
+				FindClose(_find);
+		}
+
+		bool IsValid() const
+		{
+			return _find != INVALID_HANDLE_VALUE;
+		}
+
+		bool Next(FolderSnapshotEntry& entry)
+		{
+			if (!_pending)
+				return false;
+
+			entry.Name = ToUtf8(_data.cFileName);
+			entry.Attributes = _data.dwFileAttributes;
+			entry.Size = ((std::uint64_t)_data.nFileSizeHigh << 32) | _data.nFileSizeLow;
+			entry.CreationTime = ToTicks(_data.ftCreationTime);
+			entry.LastAccessTime = ToTicks(_data.ftLastAccessTime);
+			entry.LastWriteTime = ToTicks(_data.ftLastWriteTime);
+
+			_pending = FindNextFileW(_find, &_data) != FALSE;
+			return true;
+		}
+
+		static std::uint64_t ToTicks(const FILETIME& time)
+		{
+			return ((std::uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+		}
+
+		static std::string ToUtf8(const std::wstring& value)
+		{
+			int length = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0, NULL, NULL);
+			std::string result(length, '\0');
+			WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), length, NULL, NULL);
+			return result;
+		}
+	};
+
+	// Writes the snapshot next to the dialog's output file. The file only appears once
+	// complete; Files lists the folder itself when it isn't there yet.
+	class FolderPrefetch
+	{
+		std::thread _thread;
+		std::atomic<bool> _cancelled = false;
+
+	public:
+		FolderPrefetch() = default;
+		FolderPrefetch(const FolderPrefetch&) = delete;
+		FolderPrefetch& operator=(const FolderPrefetch&) = delete;
+
+		~FolderPrefetch()
+		{
+			Cancel();
+		}
+
+		void Start(const std::wstring& folder, const std::wstring& snapshotPath)
+		{
+			Cancel();
+			DeleteFileW(snapshotPath.c_str());
+
+			_cancelled = false;
+			_thread = std::thread([this, folder, snapshotPath]()
+			{
+				Write(folder, snapshotPath, _cancelled);
+			});
+		}
+
+		// Stops at the next entry, a single slow FindNextFile still has to return
+		void Cancel()
+		{
+			_cancelled = true;
+			if (_thread.joinable())
+				_thread.join();
+		}
+
+		static bool Write(const std::wstring& folder, const std::wstring& snapshotPath, const std::atomic<bool>& cancelled)
+		{
+			// Taken before listing, a change made meanwhile invalidates the snapshot
+			WIN32_FILE_ATTRIBUTE_DATA folderData;
+			if (!GetFileAttributesExW(folder.c_str(), GetFileExInfoStandard, &folderData) ||
+				!(folderData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				return false;
+
+			FolderSnapshot snapshot;
+			snapshot.Folder = Win32FolderSource::ToUtf8(folder);
+			snapshot.FolderLastWriteTime = Win32FolderSource::ToTicks(folderData.ftLastWriteTime);
+
+			FILETIME now;
+			GetSystemTimeAsFileTime(&now);
+			snapshot.CaptureTime = Win32FolderSource::ToTicks(now);
+
+			Win32FolderSource source(folder);
+			if (!source.IsValid() || !snapshot.Capture(source, cancelled))
+				return false;
+
+			std::wstring partialPath = snapshotPath + L".partial";
+			bool written = false;
+			HANDLE file = CreateFileW(partialPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				std::string data = snapshot.Encode();
+				DWORD size = 0;
+				written = WriteFile(file, data.data(), (DWORD)data.size(), &size, NULL) && size == data.size();
+				CloseHandle(file);
+			}
+
+			if (!written || cancelled || !MoveFileExW(partialPath.c_str(), snapshotPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+			{
+				DeleteFileW(partialPath.c_str());
+				return false;
+			}
+
+			return true;
+		}
+	};
+}
@@ -0,0 +1,111 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Launch latencies of every launcher and dialog activation, kept in a mapped
+//  LaunchLatencyStore under %LOCALAPPDATA%\Files and updated under a named mutex.
+
+#pragma once
+
+#include <windows.h>
+#include <shlobj.h>
+#include <string>
+#include "LaunchLatency.h"
+
+namespace Files::Native
+{
+	// The file name carries the layout version, a new layout starts a new file
+	class LaunchLatencyFile
+	{
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = NULL;
+		HANDLE _mutex = NULL;
+		void* _view = NULL;
+
+	public:
+		// Milliseconds a launcher waits for another one to finish its update, after that
+		// the sample is dropped rather than holding up the launch
+		static constexpr DWORD LockTimeout = 100;
+
+		LaunchLatencyFile() = default;
+		LaunchLatencyFile(const LaunchLatencyFile&) = delete;
+		LaunchLatencyFile& operator=(const LaunchLatencyFile&) = delete;
+
+		~LaunchLatencyFile()
+		{
+			if (_view)
+				UnmapViewOfFile(_view);
+			if (_mapping)
+				CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE)
+				CloseHandle(_file);
+			if (_mutex)
+				CloseHandle(_mutex);
+		}
+
+		// Microseconds since this process was created, which includes starting it
+		static std::uint64_t GetTimeSinceProcessStart()
+		{
+			FILETIME creation, exit, kernel, user, now;
+			if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+				return 0;
+
+			GetSystemTimePreciseAsFileTime(&now);
+			ULONGLONG start = ((ULONGLONG)creation.dwHighDateTime << 32) | creation.dwLowDateTime;
+			ULONGLONG end = ((ULONGLONG)now.dwHighDateTime << 32) | now.dwLowDateTime;
+			return end > start ? (end - start) / 10 : 0;
+		}
+
+		void Record(LaunchOutcome outcome, std::uint64_t microseconds)
+		{
+			if (!Open())
+				return;
+
+			// An abandoned mutex hands the region over as the dead launcher left it, an
+			// update cut short costs a sample and no more
+			DWORD wait = WaitForSingleObject(_mutex, LockTimeout);
+			if (wait != WAIT_OBJECT_0 && wait != WAIT_ABANDONED)
+				return;
+
+			LaunchLatencyStore store(_view, LaunchLatencyStore::RequiredSize);
+			store.Record(outcome, microseconds);
+			ReleaseMutex(_mutex);
+		}
+
+	private:
+		bool Open()
+		{
+			if (_view)
+				return true;
+			if (_file != INVALID_HANDLE_VALUE)
+				return false;
+
+			PWSTR localAppData = NULL;
+			if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &localAppData)))
+				return false;
+
+			std::wstring folder = std::wstring(localAppData) + L"\\Files";
+			CoTaskMemFree(localAppData);
+			CreateDirectoryW(folder.c_str(), NULL);
+
+			std::wstring version = std::to_wstring(LaunchLatencyStore::Version);
+			_mutex = CreateMutexW(NULL, FALSE, (L"Local\\FilesLaunchLatency.v" + version).c_str());
+			if (!_mutex)
+				return false;
+
+			std::wstring path = folder + L"\\LaunchLatency.v" + version + L".bin";
+			_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			// Grows a new file to the store size, zero filled
+			_mapping = CreateFileMappingW(_file, NULL, PAGE_READWRITE, 0, (DWORD)LaunchLatencyStore::RequiredSize, NULL);
+			if (!_mapping)
+				return false;
+
+			_view = MapViewOfFile(_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, LaunchLatencyStore::RequiredSize);
+			return _view != NULL;
+		}
+	};
+}
@@ -0,0 +1,156 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Client end of the pipe a running Files instance listens on for launcher
+//  requests, see LaunchProtocol.
+
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <string>
+#include "LaunchProtocol.h"
+
+namespace Files::Native
+{
+	class LaunchPipe
+	{
+		HANDLE _pipe = INVALID_HANDLE_VALUE;
+		HANDLE _ioEvent = NULL;
+		std::chrono::steady_clock::time_point _deadline;
+
+	public:
+		// Milliseconds a request may take before the launcher falls back to protocol activation
+		static constexpr DWORD DefaultTimeout = 1000;
+
+		LaunchPipe() = default;
+		LaunchPipe(const LaunchPipe&) = delete;
+		LaunchPipe& operator=(const LaunchPipe&) = delete;
+
+		~LaunchPipe()
+		{
+			Close();
+		}
+
+		// Keep in sync with LaunchRequestHelper in Files.App. One name per logon session, so
+		// that a launcher never talks to the instance of another user on the same machine.
+		static std::wstring GetName()
+		{
+			DWORD sessionId = 0;
+			ProcessIdToSessionId(GetCurrentProcessId(), &sessionId);
+			return L"\\\\.\\pipe\\files-dev-launch-" + std::to_wstring(sessionId);
+		}
+
+		// Hands the request to the running instance, if there is one
+		static LaunchStatus Send(LaunchRequestKind kind, const std::wstring& payload, DWORD timeout = DefaultTimeout)
+		{
+			LaunchPipe pipe;
+			if (!pipe.Connect(timeout))
+				return LaunchStatus::Unreachable;
+
+			return LaunchProtocol::Send(pipe, kind, ToUtf8(payload));
+		}
+
+		// Fails right away when no instance listens
+		bool Connect(DWORD timeout)
+		{
+			Close();
+			_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+			std::wstring name = GetName();
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				// Identification only, a process squatting the name can't act as the launcher's user
+				_pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+					FILE_FLAG_OVERLAPPED | SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION, NULL);
+				if (_pipe != INVALID_HANDLE_VALUE || GetLastError() != ERROR_PIPE_BUSY ||
+					!WaitNamedPipeW(name.c_str(), Remaining()))
+					break;
+			}
+
+			_ioEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			if (_pipe == INVALID_HANDLE_VALUE || !_ioEvent)
+			{
+				Close();
+				return false;
+			}
+
+			// Files may bring its window to the foreground like the launcher could
+			ULONG serverProcessId;
+			if (GetNamedPipeServerProcessId(_pipe, &serverProcessId))
+				AllowSetForegroundWindow(serverProcessId);
+
+			return true;
+		}
+
+		void Close()
+		{
+			if (_pipe != INVALID_HANDLE_VALUE)
+				CloseHandle(_pipe);
+			if (_ioEvent)
+				CloseHandle(_ioEvent);
+
+			_pipe = INVALID_HANDLE_VALUE;
+			_ioEvent = NULL;
+		}
+
+		bool Write(const char* data, std::size_t size)
+		{
+			return Transfer(data, size, true);
+		}
+
+		bool Read(char* data, std::size_t size)
+		{
+			return Transfer(data, size, false);
+		}
+
+	private:
+		DWORD Remaining() const
+		{
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(_deadline - std::chrono::steady_clock::now()).count();
+			return remaining > 0 ? (DWORD)remaining : 0;
+		}
+
+		// Moves all of data or gives up at the deadline
+		bool Transfer(const char* data, std::size_t size, bool write)
+		{
+			while (size > 0)
+			{
+				OVERLAPPED overlapped = {};
+				overlapped.hEvent = _ioEvent;
+				ResetEvent(_ioEvent);
+
+				BOOL done = write
+					? WriteFile(_pipe, data, (DWORD)size, NULL, &overlapped)
+					: ReadFile(_pipe, (char*)data, (DWORD)size, NULL, &overlapped);
+				if (!done && GetLastError() != ERROR_IO_PENDING)
+					return false;
+
+				DWORD transferred = 0;
+				if (WaitForSingleObject(_ioEvent, Remaining()) != WAIT_OBJECT_0)
+				{
+					CancelIoEx(_pipe, &overlapped);
+					GetOverlappedResult(_pipe, &overlapped, &transferred, TRUE);
+					return false;
+				}
+
+				if (!GetOverlappedResult(_pipe, &overlapped, &transferred, FALSE) || transferred == 0)
+					return false;
+
+				data += transferred;
+				size -= transferred;
+			}
+
+			return true;
+		}
+
+		static std::string ToUtf8(const std::wstring& value)
+		{
+			int length = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), NULL, 0, NULL, NULL);
+			std::string result(length, '\0');
+			WideCharToMultiByte(CP_UTF8, 0, value.c_str(), (int)value.size(), result.data(), length, NULL, NULL);
+			return result;
+		}
+	};
+}
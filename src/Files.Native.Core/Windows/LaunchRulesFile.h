@@ -0,0 +1,153 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  The user's launch rules in %LOCALAPPDATA%\Files\LaunchRules.txt, compiled
+//  next to it the first time they are used after an edit and mapped from there.
+
+#pragma once
+
+#include <windows.h>
+#include <shlobj.h>
+#include <string>
+#include "LaunchRules.h"
+
+namespace Files::Native
+{
+	// The compiled file name carries the layout version, a new layout starts a new file.
+	// The compiled file is only ever replaced whole, never written in place, so a mapped
+	// view stays valid.
+	class LaunchRulesFile
+	{
+		HANDLE _mapping = NULL;
+		void* _view = NULL;
+		// Rules compiled by this instance, when the compiled file couldn't be replaced
+		std::string _image;
+		LaunchRuleSet _rules;
+		bool _opened = false;
+
+	public:
+		// Rules files larger than this are ignored
+		static constexpr LONGLONG MaxRulesFileSize = 16 * 1024 * 1024;
+
+		LaunchRulesFile() = default;
+		LaunchRulesFile(const LaunchRulesFile&) = delete;
+		LaunchRulesFile& operator=(const LaunchRulesFile&) = delete;
+
+		~LaunchRulesFile()
+		{
+			if (_view)
+				UnmapViewOfFile(_view);
+			if (_mapping)
+				CloseHandle(_mapping);
+		}
+
+		// Null when the user has no rules
+		const LaunchRuleSet* Open()
+		{
+			if (!_opened)
+			{
+				_opened = true;
+				Load();
+			}
+
+			return _rules.GetRuleCount() ? &_rules : nullptr;
+		}
+
+	private:
+		void Load()
+		{
+			PWSTR localAppData = NULL;
+			if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &localAppData)))
+				return;
+
+			std::wstring folder = std::wstring(localAppData) + L"\\Files";
+			CoTaskMemFree(localAppData);
+
+			std::wstring rulesPath = folder + L"\\LaunchRules.txt";
+			WIN32_FILE_ATTRIBUTE_DATA attributes;
+			if (!GetFileAttributesExW(rulesPath.c_str(), GetFileExInfoStandard, &attributes))
+				return;
+
+			std::uint64_t writeTime = ((std::uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+			std::uint64_t size = ((std::uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+			if (size > (std::uint64_t)MaxRulesFileSize)
+				return;
+
+			std::wstring compiledPath = folder + L"\\LaunchRules.v" + std::to_wstring(LaunchRuleSet::Version) + L".bin";
+			if (Map(compiledPath, writeTime, size))
+				return;
+
+			std::string text;
+			if (!ReadAll(rulesPath, text) || text.size() != size)
+				return;
+
+			std::size_t skipped = 0;
+			_image = LaunchRuleSet::Compile(text, writeTime, size, skipped);
+			if (!_rules.Attach(_image, writeTime, size))
+				return;
+
+			std::wstring temporaryPath = compiledPath + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+			HANDLE file = CreateFileW(temporaryPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			DWORD written = 0;
+			bool complete = WriteFile(file, _image.data(), (DWORD)_image.size(), &written, NULL) && written == _image.size();
+			CloseHandle(file);
+
+			if (!complete || !MoveFileExW(temporaryPath.c_str(), compiledPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+				DeleteFileW(temporaryPath.c_str());
+		}
+
+		// Maps the compiled rules if they are those of the rules file as it is now
+		bool Map(const std::wstring& path, std::uint64_t writeTime, std::uint64_t size)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+			{
+				_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				_view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+			}
+
+			CloseHandle(file);
+			if (_view && _rules.Attach(std::string_view((const char*)_view, (std::size_t)fileSize.QuadPart), writeTime, size))
+				return true;
+
+			// Stale or damaged, compiled again
+			if (_view)
+				UnmapViewOfFile(_view);
+			if (_mapping)
+				CloseHandle(_mapping);
+
+			_view = NULL;
+			_mapping = NULL;
+			return false;
+		}
+
+		static bool ReadAll(const std::wstring& path, std::string& content)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size;
+			DWORD read = 0;
+			bool complete = GetFileSizeEx(file, &size) && size.QuadPart <= MaxRulesFileSize;
+			if (complete)
+			{
+				content.assign((std::size_t)size.QuadPart, '\0');
+				complete = ReadFile(file, content.data(), (DWORD)content.size(), &read, NULL) && read == content.size();
+			}
+
+			CloseHandle(file);
+			return complete;
+		}
+	};
+}
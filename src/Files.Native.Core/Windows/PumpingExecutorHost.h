@@ -0,0 +1,104 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  DialogExecutor host that waits in MsgWaitForMultipleObjectsEx, dispatching the
+//  messages of the host's thread while Show() has nothing to run.
+
+#pragma once
+
+#include <windows.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "DialogExecutor.h"
+
+namespace Files::Native
+{
+	class PumpingExecutorHost : public ExecutorHost
+	{
+		HANDLE _wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	public:
+		PumpingExecutorHost() = default;
+		PumpingExecutorHost(const PumpingExecutorHost&) = delete;
+		PumpingExecutorHost& operator=(const PumpingExecutorHost&) = delete;
+
+		~PumpingExecutorHost()
+		{
+			if (_wakeEvent)
+				CloseHandle(_wakeEvent);
+		}
+
+		std::size_t Wait(const std::vector<void*>& handles, std::optional<std::chrono::milliseconds> timeout) override
+		{
+			// The wake event goes last, MAXIMUM_WAIT_OBJECTS leaves plenty for the stages
+			std::vector<HANDLE> waitHandles(handles.begin(), handles.end());
+			if (_wakeEvent)
+				waitHandles.push_back(_wakeEvent);
+
+			DWORD count = (DWORD)waitHandles.size();
+			DWORD wait = MsgWaitForMultipleObjectsEx(count, waitHandles.data(), timeout ? (DWORD)timeout->count() : INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+			if (wait < WAIT_OBJECT_0 + handles.size())
+				return wait - WAIT_OBJECT_0;
+
+			if (wait == WAIT_OBJECT_0 + count)
+			{
+				MSG msg;
+				while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+				{
+					TranslateMessage(&msg);
+					DispatchMessage(&msg);
+				}
+			}
+
+			return NoHandle;
+		}
+
+		void Wake() override
+		{
+			if (_wakeEvent)
+				SetEvent(_wakeEvent);
+		}
+
+		// On the process's thread pool, holding a reference on the dialog's DLL: the host may
+		// release the dialog and unload it while work stuck on a hung share still runs
+		void Submit(std::function<void()> work) override
+		{
+			HMODULE module = NULL;
+			GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)&RunWork, &module);
+
+			auto* context = new std::function<void()>(std::move(work));
+			if (TrySubmitThreadpoolCallback(RunWork, context, NULL))
+				return;
+
+			// Out of resources, the work runs here rather than not at all
+			std::unique_ptr<std::function<void()>> owned(context);
+			(*owned)();
+			if (module)
+				FreeLibrary(module);
+		}
+
+	private:
+		static void CALLBACK RunWork(PTP_CALLBACK_INSTANCE instance, PVOID context)
+		{
+			std::unique_ptr<std::function<void()>> work((std::function<void()>*)context);
+			(*work)();
+			work.reset();
+
+			HMODULE module = NULL;
+			if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCWSTR)&RunWork, &module))
+				FreeLibraryWhenCallbackReturns(instance, module);
+		}
+	};
+
+	// DWORD timeouts of the Win32 API, INFINITE for none
+	inline std::optional<std::chrono::milliseconds> ToTimeout(DWORD timeout)
+	{
+		if (timeout == INFINITE)
+			return std::nullopt;
+
+		return std::chrono::milliseconds(timeout);
+	}
+}
@@ -0,0 +1,87 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Named events through which Files reports back on a single Show() call, and the
+//  file it writes the results to.
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace Files::Native
+{
+	// Every Show() gets its own three events, passed to Files with -dialogchannel, so that
+	// dialogs shown at the same time, by one host or by many, never wake each other: Files
+	// sets the acknowledgement and completion events, the dialog sets the cancel event.
+	// Process id and a per-process counter keep the names unique among running processes.
+	class ResultChannel
+	{
+		std::wstring _id;
+
+	public:
+		// Output files larger than this are not read, a picker returns paths and no more
+		static constexpr LONGLONG MaxResultFileSize = 64 * 1024 * 1024;
+
+		ResultChannel()
+		{
+			static std::atomic<unsigned long> counter = 0;
+			_id = std::to_wstring(GetCurrentProcessId()) + L"_" + std::to_wstring(++counter);
+		}
+
+		const std::wstring& Id() const
+		{
+			return _id;
+		}
+
+		// Set by Files once the picker is closed and the results are written
+		std::wstring CompletionEventName() const
+		{
+			return L"FILEDIALOG_" + _id;
+		}
+
+		// Set by Files as soon as it receives the activation
+		std::wstring AckEventName() const
+		{
+			return L"FILEDIALOG_ACK_" + _id;
+		}
+
+		// Set by the dialog when it stops waiting for the picker, after the activation timed
+		// out or the host closed the dialog. A Files that turns up late finds it set, or gone
+		// with the dialog's handle, and closes its picker.
+		std::wstring CancelEventName() const
+		{
+			return L"FILEDIALOG_CANCEL_" + _id;
+		}
+
+		// Contents of the output file, which is deleted. Read with the file API rather
+		// than the iostreams, which would load and initialize in the host for this alone.
+		static std::string TakeResultFile(const std::wstring& path)
+		{
+			std::string text;
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				LARGE_INTEGER size;
+				if (GetFileSizeEx(file, &size) && size.QuadPart <= MaxResultFileSize)
+				{
+					text.resize((std::size_t)size.QuadPart);
+					DWORD read = 0;
+					if (!ReadFile(file, text.data(), (DWORD)text.size(), &read, NULL))
+						read = 0;
+
+					text.resize(read);
+				}
+
+				CloseHandle(file);
+			}
+
+			DeleteFileW(path.c_str());
+			return text;
+		}
+	};
+}
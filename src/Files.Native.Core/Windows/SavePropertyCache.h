@@ -0,0 +1,128 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  SavePropertyCache over shell property stores, so that hosts round-tripping
+//  metadata don't bind to the shell item on every call.
+
+#pragma once
+
+#include <windows.h>
+#include <atlbase.h>
+#include <propsys.h>
+#include <propvarutil.h>
+#include <shobjidl.h>
+#include <string>
+#include "SaveProperties.h"
+
+// PSCreateMemoryPropertyStore
+#pragma comment(lib, "propsys.lib")
+
+namespace Files::Native
+{
+	// Shell property stores, kept in memory until the result is written to the item
+	struct ShellPropertyStores
+	{
+		using Store = CComPtr<IPropertyStore>;
+		using KeyList = CComPtr<IPropertyDescriptionList>;
+		using Status = HRESULT;
+
+		HRESULT Create(Store& store)
+		{
+			store.Release();
+			return PSCreateMemoryPropertyStore(IID_PPV_ARGS(&store));
+		}
+
+		HRESULT Copy(const Store& source, const Store& target, const KeyList& keys)
+		{
+			return CopyValues(source, target, keys);
+		}
+
+		static bool Failed(HRESULT hr)
+		{
+			return FAILED(hr);
+		}
+
+		// Every value of the source, or only those of the list when there is one
+		static HRESULT CopyValues(IPropertyStore* source, IPropertyStore* target, IPropertyDescriptionList* list)
+		{
+			DWORD count = 0;
+			HRESULT hr = list ? list->GetCount((UINT*)&count) : source->GetCount(&count);
+
+			for (DWORD i = 0; SUCCEEDED(hr) && i < count; i++)
+			{
+				PROPERTYKEY key;
+				if (list)
+				{
+					CComPtr<IPropertyDescription> description;
+					hr = list->GetAt(i, IID_PPV_ARGS(&description));
+					if (SUCCEEDED(hr))
+						hr = description->GetPropertyKey(&key);
+				}
+				else
+				{
+					hr = source->GetAt(i, &key);
+				}
+
+				PROPVARIANT value;
+				PropVariantInit(&value);
+				if (SUCCEEDED(hr) && SUCCEEDED(source->GetValue(key, &value)) && value.vt != VT_EMPTY)
+					hr = target->SetValue(key, value);
+
+				PropVariantClear(&value);
+			}
+
+			return hr;
+		}
+	};
+
+	class SavePropertyCache : public BasicSavePropertyCache<ShellPropertyStores>
+	{
+	public:
+		HRESULT SetDefaults(IPropertyStore* store)
+		{
+			return BasicSavePropertyCache::SetDefaults(Store(store));
+		}
+
+		void SetCollected(IPropertyDescriptionList* list)
+		{
+			BasicSavePropertyCache::SetCollected(KeyList(list));
+		}
+
+		// Starts with the properties the item at path already has, if it exists
+		HRESULT Get(IPropertyStore** ppStore, const std::wstring& path)
+		{
+			*ppStore = NULL;
+			Store store;
+			HRESULT hr = BasicSavePropertyCache::Get(store, [&]()
+			{
+				Store item;
+				if (FAILED(SHGetPropertyStoreFromParsingName(path.c_str(), NULL, GPS_DEFAULT, IID_PPV_ARGS(&item))))
+					item.Release();
+
+				return item;
+			});
+			if (SUCCEEDED(hr))
+				*ppStore = store.Detach();
+
+			return hr;
+		}
+
+		// Writes the values of the store to the item with a single commit
+		static HRESULT Apply(IShellItem* item, IPropertyStore* store)
+		{
+			CComQIPtr<IShellItem2> item2(item);
+			if (!item2 || !store)
+				return E_INVALIDARG;
+
+			CComPtr<IPropertyStore> target;
+			HRESULT hr = item2->GetPropertyStore(GPS_READWRITE, IID_PPV_ARGS(&target));
+			if (SUCCEEDED(hr))
+				hr = ShellPropertyStores::CopyValues(store, target, NULL);
+			if (SUCCEEDED(hr))
+				hr = target->Commit();
+
+			return hr;
+		}
+	};
+}
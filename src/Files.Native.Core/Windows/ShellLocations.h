@@ -0,0 +1,197 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Parses shell locations, keeping the item ID lists of virtual ones in a
+//  ShellLocationCache under %LOCALAPPDATA% for the next launch.
+
+#pragma once
+
+#include <windows.h>
+#include <sddl.h>
+#include <shlobj.h>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include "ShellLocationCache.h"
+
+namespace Files::Native
+{
+	// The file name carries the layout version, a new layout starts a new file. The file
+	// is only ever replaced whole, never written in place, so a mapped view stays valid.
+	class ShellLocations
+	{
+		std::wstring _path;
+		DWORD _osBuild = 0;
+		DWORD _osRevision = 0;
+		std::string _user;
+		bool _identified = false;
+		bool _identifiedOnce = false;
+
+	public:
+		ShellLocations() = default;
+		ShellLocations(const ShellLocations&) = delete;
+		ShellLocations& operator=(const ShellLocations&) = delete;
+
+		// Parses location like SHParseDisplayName, free the result with CoTaskMemFree
+		PIDLIST_ABSOLUTE Parse(const std::wstring& location)
+		{
+			std::string key = ShellLocationCache::GetKey(std::wstring_view(location));
+			bool cached = !key.empty() && Identify();
+			if (cached)
+			{
+				if (PIDLIST_ABSOLUTE pidl = Load(key))
+					return pidl;
+			}
+
+			PIDLIST_ABSOLUTE pidl = NULL;
+			if (FAILED(SHParseDisplayName(location.c_str(), NULL, &pidl, 0, NULL)))
+				return NULL;
+
+			if (cached)
+				Store(key, pidl);
+
+			return pidl;
+		}
+
+	private:
+		// Build and user the cache is written for, and its path. A failure is final for
+		// this instance and every location is parsed by the shell.
+		bool Identify()
+		{
+			if (_identifiedOnce)
+				return _identified;
+
+			_identifiedOnce = true;
+
+			// The revision changes with monthly updates, which may register shell folders too
+			WCHAR build[16];
+			DWORD size = sizeof(build);
+			if (RegGetValueW(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion", L"CurrentBuildNumber",
+				RRF_RT_REG_SZ, NULL, build, &size) != ERROR_SUCCESS)
+				return false;
+
+			_osBuild = (DWORD)wcstoul(build, NULL, 10);
+			size = sizeof(_osRevision);
+			RegGetValueW(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion", L"UBR",
+				RRF_RT_REG_DWORD, NULL, &_osRevision, &size);
+
+			HANDLE token = NULL;
+			if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token))
+				return false;
+
+			BYTE tokenUser[sizeof(TOKEN_USER) + SECURITY_MAX_SID_SIZE];
+			DWORD tokenUserSize = 0;
+			LPWSTR sid = NULL;
+			BOOL gotUser = GetTokenInformation(token, TokenUser, tokenUser, sizeof(tokenUser), &tokenUserSize) &&
+				ConvertSidToStringSidW(((TOKEN_USER*)tokenUser)->User.Sid, &sid);
+			CloseHandle(token);
+			if (!gotUser)
+				return false;
+
+			// SID strings are ASCII
+			for (LPWSTR c = sid; *c; c++)
+				_user.push_back((char)*c);
+			LocalFree(sid);
+
+			PWSTR localAppData = NULL;
+			if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &localAppData)))
+				return false;
+
+			std::wstring folder = std::wstring(localAppData) + L"\\Files";
+			CoTaskMemFree(localAppData);
+			CreateDirectoryW(folder.c_str(), NULL);
+
+			_path = folder + L"\\ShellLocations.v" + std::to_wstring(ShellLocationCache::Version) + L".bin";
+			_identified = true;
+			return true;
+		}
+
+		// Maps the cache for as long as it takes to copy one item ID list out of it
+		PIDLIST_ABSOLUTE Load(const std::string& key)
+		{
+			HANDLE file = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return NULL;
+
+			PIDLIST_ABSOLUTE pidl = NULL;
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= MaxFileSize)
+			{
+				HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+				if (view)
+				{
+					std::string_view idList = ShellLocationCache::Find(
+						std::string_view((const char*)view, (std::size_t)size.QuadPart), _osBuild, _osRevision, _user, key);
+					if (!idList.empty() && (pidl = (PIDLIST_ABSOLUTE)CoTaskMemAlloc(idList.size())))
+						std::memcpy(pidl, idList.data(), idList.size());
+
+					UnmapViewOfFile(view);
+				}
+
+				if (mapping)
+					CloseHandle(mapping);
+			}
+
+			CloseHandle(file);
+			return pidl;
+		}
+
+		// Replaces the cache with one that has pidl too. Launchers racing to store leave
+		// the cache of the last one, the others parse again next time.
+		void Store(const std::string& key, PCIDLIST_ABSOLUTE pidl)
+		{
+			ShellLocationCache cache;
+			std::string current;
+			if (!ReadAll(_path, current) || !ShellLocationCache::Decode(current, cache) ||
+				!cache.IsFor(_osBuild, _osRevision, _user))
+			{
+				cache = ShellLocationCache();
+				cache.OsBuild = _osBuild;
+				cache.OsRevision = _osRevision;
+				cache.User = _user;
+			}
+
+			if (!cache.Add(key, std::string_view((const char*)pidl, ILGetSize(pidl))))
+				return;
+
+			std::string encoded = cache.Encode();
+			std::wstring temporaryPath = _path + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+			HANDLE file = CreateFileW(temporaryPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			DWORD written = 0;
+			bool complete = WriteFile(file, encoded.data(), (DWORD)encoded.size(), &written, NULL) && written == encoded.size();
+			CloseHandle(file);
+
+			if (!complete || !MoveFileExW(temporaryPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING))
+				DeleteFileW(temporaryPath.c_str());
+		}
+
+		static bool ReadAll(const std::wstring& path, std::string& content)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size;
+			DWORD read = 0;
+			bool complete = GetFileSizeEx(file, &size) && size.QuadPart <= MaxFileSize;
+			if (complete)
+			{
+				content.assign((std::size_t)size.QuadPart, '\0');
+				complete = ReadFile(file, content.data(), (DWORD)content.size(), &read, NULL) && read == content.size();
+			}
+
+			CloseHandle(file);
+			return complete;
+		}
+
+		// Comfortably more than MaxEntries of the largest entries
+		static constexpr LONGLONG MaxFileSize = 1024 * 1024;
+	};
+}
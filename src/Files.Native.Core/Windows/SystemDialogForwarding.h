@@ -0,0 +1,199 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Hands the system dialog what the host has configured on a dialog, when Show()
+//  falls back to it, and reads back what the user did to the host's controls there.
+
+#pragma once
+
+#include <windows.h>
+#include <shobjidl.h>
+#include <atlbase.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DialogState.h"
+
+namespace Files::Native
+{
+	// Shell items, file types, the filter and the event handler stay with the COM object,
+	// which hands them over itself. The rest of the state is forwarded here.
+	class SystemDialogForwarding
+	{
+	public:
+		// Call before Show(), controls can't be added to a dialog that is open
+		static void Forward(const DialogState& state, IFileDialog* dialog)
+		{
+			dialog->SetOptions(state.GetOptions());
+			if (!state.GetFileName().empty())
+				dialog->SetFileName(ToWide(state.GetFileName()).c_str());
+			if (!state.GetTitle().empty())
+				dialog->SetTitle(ToWide(state.GetTitle()).c_str());
+			if (!state.GetOkButtonLabel().empty())
+				dialog->SetOkButtonLabel(ToWide(state.GetOkButtonLabel()).c_str());
+			if (!state.GetFileNameLabel().empty())
+				dialog->SetFileNameLabel(ToWide(state.GetFileNameLabel()).c_str());
+			if (!state.GetDefaultExtension().empty())
+				dialog->SetDefaultExtension(ToWide(state.GetDefaultExtension()).c_str());
+
+			CComQIPtr<IFileDialogCustomize> customize(dialog);
+			if (customize && !state.GetControls().IsEmpty())
+				AddControls(state.GetControls(), customize);
+		}
+
+		// What the user left the check buttons, edit boxes, combo boxes and radio button
+		// lists at, as changes for the state to apply after Show()
+		static std::vector<DialogControlChange> ReadControls(const DialogControls& controls, IFileDialog* dialog)
+		{
+			std::vector<DialogControlChange> changes;
+			CComQIPtr<IFileDialogCustomize> customize(dialog);
+			if (!customize)
+				return changes;
+
+			for (const DialogControl& control : controls.GetControls())
+			{
+				DialogControlChange change;
+				change.Control = control.Id;
+				if (control.Kind == DialogControlKind::CheckButton)
+				{
+					BOOL checked;
+					if (FAILED(customize->GetCheckButtonState(control.Id, &checked)) || (checked != FALSE) == control.Checked)
+						continue;
+
+					change.Kind = DialogControlChangeKind::CheckToggled;
+					change.Value = checked != FALSE;
+				}
+				else if (control.Kind == DialogControlKind::EditBox)
+				{
+					WCHAR* text = NULL;
+					if (FAILED(customize->GetEditBoxText(control.Id, &text)))
+						continue;
+
+					change.Kind = DialogControlChangeKind::TextChanged;
+					change.Text = ToUtf8(text);
+					CoTaskMemFree(text);
+					if (change.Text == controls.GetString(control.Text))
+						continue;
+				}
+				else if (control.Kind == DialogControlKind::ComboBox || control.Kind == DialogControlKind::RadioButtonList)
+				{
+					DWORD item;
+					if (FAILED(customize->GetSelectedControlItem(control.Id, &item)) || (control.HasSelection && item == control.SelectedItem))
+						continue;
+
+					change.Kind = DialogControlChangeKind::ItemSelected;
+					change.Value = item;
+				}
+				else
+				{
+					continue;
+				}
+
+				changes.push_back(std::move(change));
+			}
+
+			return changes;
+		}
+
+	private:
+		// In the order the host added them, so that groups and the prominent control come
+		// out the same
+		static void AddControls(const DialogControls& controls, IFileDialogCustomize* customize)
+		{
+			const std::vector<DialogControl>& list = controls.GetControls();
+			std::uint32_t group = 0;
+			for (std::size_t index = 0; index < list.size(); index++)
+			{
+				const DialogControl& control = list[index];
+				if (group && control.Group != group)
+				{
+					customize->EndVisualGroup();
+					group = 0;
+				}
+
+				std::wstring label = ToWide(controls.GetString(control.Label));
+				HRESULT hr = E_INVALIDARG;
+				switch (control.Kind)
+				{
+				case DialogControlKind::PushButton:
+					hr = customize->AddPushButton(control.Id, label.c_str());
+					break;
+				case DialogControlKind::Menu:
+					hr = customize->AddMenu(control.Id, label.c_str());
+					break;
+				case DialogControlKind::ComboBox:
+					hr = customize->AddComboBox(control.Id);
+					break;
+				case DialogControlKind::RadioButtonList:
+					hr = customize->AddRadioButtonList(control.Id);
+					break;
+				case DialogControlKind::CheckButton:
+					hr = customize->AddCheckButton(control.Id, label.c_str(), control.Checked);
+					break;
+				case DialogControlKind::EditBox:
+					hr = customize->AddEditBox(control.Id, ToWide(controls.GetString(control.Text)).c_str());
+					break;
+				case DialogControlKind::Separator:
+					hr = customize->AddSeparator(control.Id);
+					break;
+				case DialogControlKind::Text:
+					hr = customize->AddText(control.Id, label.c_str());
+					break;
+				case DialogControlKind::VisualGroup:
+					hr = customize->StartVisualGroup(control.Id, label.c_str());
+					if (SUCCEEDED(hr))
+						group = (std::uint32_t)index + 1;
+					break;
+				case DialogControlKind::OpenDropDown:
+					hr = customize->EnableOpenDropDown(control.Id);
+					break;
+				default:
+					break;
+				}
+
+				if (FAILED(hr))
+					continue;
+
+				for (const DialogControlItem& item : controls.GetItems())
+				{
+					if (item.Control != index)
+						continue;
+
+					if (SUCCEEDED(customize->AddControlItem(control.Id, item.Id, ToWide(controls.GetString(item.Label)).c_str())) &&
+						item.State != (DialogControls::Enabled | DialogControls::Visible))
+						customize->SetControlItemState(control.Id, item.Id, item.State);
+				}
+
+				if (control.HasSelection)
+					customize->SetSelectedControlItem(control.Id, control.SelectedItem);
+				if (control.State != (DialogControls::Enabled | DialogControls::Visible))
+					customize->SetControlState(control.Id, control.State);
+				if (control.Prominent)
+					customize->MakeProminent(control.Id);
+			}
+
+			if (group)
+				customize->EndVisualGroup();
+		}
+
+		static std::wstring ToWide(std::string_view value)
+		{
+			std::wstring result;
+			int length = MultiByteToWideChar(CP_UTF8, 0, value.data(), (int)value.size(), NULL, 0);
+			result.resize(length);
+			MultiByteToWideChar(CP_UTF8, 0, value.data(), (int)value.size(), result.data(), length);
+			return result;
+		}
+
+		static std::string ToUtf8(const WCHAR* value)
+		{
+			std::string result;
+			int size = (int)wcslen(value);
+			int length = WideCharToMultiByte(CP_UTF8, 0, value, size, NULL, 0, NULL, NULL);
+			result.resize(length);
+			WideCharToMultiByte(CP_UTF8, 0, value, size, result.data(), length, NULL, NULL);
+			return result;
+		}
+	};
+}
@@ -0,0 +1,73 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Pre-loads the system file dialog on a background thread so that falling back
+//  to it does not pay for loading comdlg32 and its dependencies on the UI thread.
+
+#pragma once
+
+#include <windows.h>
+#include <objbase.h>
+#include <thread>
+
+namespace Files::Native
+{
+	// Loads comdlg32 and creates a throwaway instance of the dialog in a private
+	// apartment. The instance itself cannot be handed over to the host thread
+	// (the dialogs are apartment threaded), but once the module, its resources
+	// and the shell components it binds to are loaded, creating the real instance
+	// on the host thread is cheap.
+	class SystemDialogWarmup
+	{
+		std::thread _thread;
+
+	public:
+		SystemDialogWarmup() = default;
+		SystemDialogWarmup(const SystemDialogWarmup&) = delete;
+		SystemDialogWarmup& operator=(const SystemDialogWarmup&) = delete;
+
+		~SystemDialogWarmup()
+		{
+			Wait();
+		}
+
+		void Start(REFCLSID clsid)
+		{
+			if (_thread.joinable())
+				return;
+
+			CLSID dialogClsid = clsid;
+			_thread = std::thread([dialogClsid]()
+			{
+				if (FAILED(CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE)))
+					return;
+
+				WCHAR comdlg32Path[MAX_PATH];
+				ExpandEnvironmentStringsW(L"%WINDIR%\\System32\\comdlg32.dll", comdlg32Path, MAX_PATH - 1);
+
+				// Never freed, the module stays loaded for GetSystemDialog
+				HINSTANCE lib = CoLoadLibrary(comdlg32Path, false);
+				auto dllGetClassObject = lib ? (HRESULT(WINAPI*)(REFCLSID, REFIID, LPVOID*))GetProcAddress(lib, "DllGetClassObject") : NULL;
+
+				IClassFactory* pClassFactory = NULL;
+				if (dllGetClassObject && SUCCEEDED(dllGetClassObject(dialogClsid, IID_IClassFactory, (void**)&pClassFactory)))
+				{
+					IUnknown* pDialog = NULL;
+					if (SUCCEEDED(pClassFactory->CreateInstance(NULL, IID_IUnknown, (void**)&pDialog)))
+						pDialog->Release();
+
+					pClassFactory->Release();
+				}
+
+				CoUninitialize();
+			});
+		}
+
+		void Wait()
+		{
+			if (_thread.joinable())
+				_thread.join();
+		}
+	};
+}
@@ -0,0 +1,112 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  File system access of SavePreflight on Windows, and the error the save dialog
+//  answers a failed preflight with.
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "SavePreflight.h"
+
+namespace Files::Native
+{
+	// Shared by the dialog and the preflight, which the dialog stops waiting for at its
+	// timeout. A test file still open then would be deleted under the host, which is about
+	// to create the same file.
+	class Win32SaveStorage
+	{
+		std::mutex _lock;
+		bool _abandoned = false;
+
+	public:
+		SaveTargetFacts Stat(const std::wstring& path)
+		{
+			SaveTargetFacts facts;
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+				return facts;
+
+			facts.Exists = true;
+			facts.IsDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+			facts.ReadOnly = (data.dwFileAttributes & FILE_ATTRIBUTE_READONLY) != 0;
+			return facts;
+		}
+
+		std::optional<std::uint64_t> FreeBytes(const std::wstring& folder)
+		{
+			ULARGE_INTEGER freeBytes;
+			if (folder.empty() || !GetDiskFreeSpaceExW(folder.c_str(), &freeBytes, NULL, NULL))
+				return std::nullopt;
+
+			return freeBytes.QuadPart;
+		}
+
+		std::uint32_t OpenForWrite(const std::wstring& path)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return GetLastError();
+
+			CloseHandle(file);
+			return 0;
+		}
+
+		// Without keep, the file is gone as soon as it is closed, unless the dialog stopped
+		// waiting meanwhile: it is then left for the host
+		std::uint32_t Create(const std::wstring& path, bool keep)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, CREATE_NEW, keep ? FILE_ATTRIBUTE_NORMAL : FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return GetLastError();
+
+			std::lock_guard lock(_lock);
+			if (!keep && _abandoned)
+			{
+				FILE_DISPOSITION_INFO disposition = { FALSE };
+				SetFileInformationByHandle(file, FileDispositionInfo, &disposition, sizeof(disposition));
+			}
+
+			CloseHandle(file);
+			return 0;
+		}
+
+		// Called by the dialog when it stops waiting, returns once no test file is being
+		// closed. The file system calls still running leave their files alone.
+		void Abandon()
+		{
+			std::lock_guard lock(_lock);
+			_abandoned = true;
+		}
+
+		// What Show() fails with for a target the host could not save to
+		static HRESULT GetError(const SavePreflightReport& report)
+		{
+			if (report.Error)
+				return HRESULT_FROM_WIN32(report.Error);
+
+			switch (report.Status)
+			{
+			case SavePreflightStatus::ParentMissing:
+				return HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND);
+			case SavePreflightStatus::IsFolder:
+				return HRESULT_FROM_WIN32(ERROR_DIRECTORY_NOT_SUPPORTED);
+			case SavePreflightStatus::ReadOnly:
+				return HRESULT_FROM_WIN32(ERROR_FILE_READ_ONLY);
+			case SavePreflightStatus::DiskFull:
+				return HRESULT_FROM_WIN32(ERROR_DISK_FULL);
+			case SavePreflightStatus::AccessDenied:
+				return E_ACCESSDENIED;
+			default:
+				return S_OK;
+			}
+		}
+	};
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Files Community
+// Licensed under the MIT License.
+
+// Abstract:
+//  Reading and writing the integers and strings the protocols and file formats of the
+//  dialogs are made of. Fixed-size integers are little-endian, strings are prefixed
+//  with their size.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Files::Native
+{
+	namespace Detail
+	{
+		inline void AppendUInt32(std::string& output, std::uint32_t value)
+		{
+			output.push_back((char)(value & 0xFF));
+			output.push_back((char)((value >> 8) & 0xFF));
+			output.push_back((char)((value >> 16) & 0xFF));
+			output.push_back((char)((value >> 24) & 0xFF));
+		}
+
+		inline bool ReadUInt32(std::string_view input, std::size_t& offset, std::uint32_t& value)
+		{
+			if (offset > input.size() || input.size() - offset < 4)
+				return false;
+
+			const unsigned char* bytes = (const unsigned char*)input.data() + offset;
+			value = (std::uint32_t)bytes[0] | ((std::uint32_t)bytes[1] << 8) |
+				((std::uint32_t)bytes[2] << 16) | ((std::uint32_t)bytes[3] << 24);
+			offset += 4;
+			return true;
+		}
+
+		// Points into input rather than copying
+		inline bool ReadStringView(std::string_view input, std::size_t& offset, std::string_view& value)
+		{
+			std::uint32_t size;
+			if (!ReadUInt32(input, offset, size) || input.size() - offset < size)
+				return false;
+
+			value = input.substr(offset, size);
+			offset += size;
+			return true;
+		}
+
+		inline bool ReadString(std::string_view input, std::size_t& offset, std::string& value)
+		{
+			std::string_view view;
+			if (!ReadStringView(input, offset, view))
+				return false;
+
+			value.assign(view);
+			return true;
+		}
+
+		// 7 bits per byte, low bits first, the high bit set on every byte but the last
+		inline void AppendVarUInt(std::string& output, std::uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				output.push_back((char)(value | 0x80));
+				value >>= 7;
+			}
+
+			output.push_back((char)value);
+		}
+
+		inline bool ReadVarUInt(std::string_view input, std::size_t& offset, std::uint64_t& value)
+		{
+			value = 0;
+			for (unsigned shift = 0; shift < 64 && offset < input.size(); shift += 7)
+			{
+				std::uint64_t byte = (unsigned char)input[offset++];
+				value |= (byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return true;
+			}
+
+			return false;
+		}
+	}
+}